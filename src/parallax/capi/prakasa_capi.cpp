@@ -0,0 +1,479 @@
+#include "prakasa_capi.h"
+#include "config/config_manager.h"
+#include "environment/environment_installer.h"
+#include "environment/mirror_selector.h"
+#include "utils/cpu_partition.h"
+#include "utils/gpu_telemetry.h"
+#include "utils/prakasa_sessions.h"
+#include "utils/process.h"
+#include "utils/serving_profile.h"
+#include "utils/slo_watchdog.h"
+#include "utils/weight_residency.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using parallax::environment::ComponentResult;
+using parallax::environment::ComponentSelection;
+using parallax::environment::EnvironmentComponent;
+using parallax::environment::EnvironmentInstaller;
+using parallax::environment::EnvironmentResult;
+
+namespace {
+
+// Upper bound for one supervised server run, ExecCommandEx2 needs a
+// timeout and multiplies it by 1000 in 32 bits (about 23 days)
+const int kServerMaxSeconds = 2000000;
+// How long prakasa_server_launch waits for the server to record its pid
+const int kLaunchWaitSeconds = 30;
+
+struct LaunchedServer {
+    std::string launcher;
+    std::string pid_file;
+    std::thread supervisor;
+    std::atomic<bool> finished{false};
+    int exit_code = 0;
+};
+
+std::mutex g_mutex;
+bool g_initialized = false;
+// The check or install in progress, for prakasa_cancel
+std::shared_ptr<EnvironmentInstaller> g_active_installer;
+std::vector<std::unique_ptr<LaunchedServer>> g_servers;
+std::atomic<bool> g_shutting_down{false};
+
+std::string GetDistro() {
+    return parallax::config::ConfigManager::GetInstance().GetConfigValue(
+        parallax::config::KEY_WSL_LINUX_DISTRO);
+}
+
+// "cuda,prakasa" -> --only selection; false on an unknown key
+bool ParseSelection(const char* components, ComponentSelection& selection) {
+    if (components == nullptr) {
+        return true;
+    }
+    std::istringstream stream(components);
+    std::string key;
+    while (std::getline(stream, key, ',')) {
+        key.erase(std::remove(key.begin(), key.end(), ' '), key.end());
+        if (key.empty()) {
+            continue;
+        }
+        EnvironmentComponent component;
+        if (!parallax::environment::ParseComponentKey(key, component)) {
+            return false;
+        }
+        selection.only.push_back(component);
+    }
+    return true;
+}
+
+void ReportComponent(const ComponentResult& result,
+                     prakasa_component_callback callback, void* user_data) {
+    if (callback == nullptr) {
+        return;
+    }
+    std::string key = parallax::environment::ComponentToKey(result.component);
+    std::string name =
+        parallax::environment::ComponentToString(result.component);
+    prakasa_component_result c_result;
+    c_result.key = key.c_str();
+    c_result.name = name.c_str();
+    c_result.status = static_cast<int>(result.status);
+    c_result.error_code = result.error_code;
+    c_result.message = result.message.c_str();
+    c_result.duration_ms = result.duration_ms;
+    callback(&c_result, user_data);
+}
+
+int CountFailures(const EnvironmentResult& result) {
+    return static_cast<int>(std::count_if(
+        result.component_results.begin(), result.component_results.end(),
+        [](const ComponentResult& component) {
+            return component.status ==
+                   parallax::environment::InstallationStatus::kFailed;
+        }));
+}
+
+// Runs operation with a fresh installer registered for prakasa_cancel;
+// only one check or install at a time
+int RunInstallerOperation(
+    const std::function<EnvironmentResult(EnvironmentInstaller&)>& operation,
+    int* reboot_required) {
+    std::shared_ptr<EnvironmentInstaller> installer;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_initialized) {
+            return PRAKASA_E_NOT_INITIALIZED;
+        }
+        if (g_active_installer) {
+            return PRAKASA_E_BUSY;
+        }
+        installer = std::make_shared<EnvironmentInstaller>();
+        installer->SetSilentMode(true);
+        g_active_installer = installer;
+    }
+
+    EnvironmentResult result = operation(*installer);
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_active_installer.reset();
+    }
+    if (reboot_required != nullptr) {
+        *reboot_required = result.reboot_required ? 1 : 0;
+    }
+    return CountFailures(result);
+}
+
+bool FindServer(int pid, parallax::utils::PrakasaServerInfo& server) {
+    parallax::utils::PrakasaSessionProbe probe =
+        parallax::utils::ProbePrakasaSessions(GetDistro());
+    for (const auto& candidate : probe.servers) {
+        if (candidate.pid == pid) {
+            server = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+int GetDrainTimeout(int drain_timeout_seconds) {
+    if (drain_timeout_seconds >= 0) {
+        return drain_timeout_seconds;
+    }
+    return parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+        parallax::config::KEY_SHUTDOWN_DRAIN_TIMEOUT, 30);
+}
+
+}  // namespace
+
+extern "C" {
+
+int prakasa_api_version(void) { return PRAKASA_CAPI_VERSION; }
+
+int prakasa_init(const char* log_path) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_initialized) {
+        return 0;
+    }
+
+    std::string path = log_path != nullptr && log_path[0] != '\0'
+                           ? std::string(log_path)
+                           : parallax::utils::JoinPath(
+                                 parallax::utils::GetAppBinDir(),
+                                 "prakasa.log");
+    // 10MB, 5 files, no console output, synchronous write
+    tinylog_init(path.c_str(), 1024 * 1024 * 10, 5, 0, 1);
+
+    // The first access loads the configuration file
+    parallax::config::ConfigManager::GetInstance();
+    g_shutting_down = false;
+    g_initialized = true;
+    info_log("[CAPI] prakasa_core initialized, API version %d",
+             PRAKASA_CAPI_VERSION);
+    return 0;
+}
+
+void prakasa_shutdown(void) {
+    std::vector<std::unique_ptr<LaunchedServer>> servers;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_initialized) {
+            return;
+        }
+        if (g_active_installer) {
+            g_active_installer->Stop();
+        }
+        servers.swap(g_servers);
+        g_initialized = false;
+    }
+
+    // Drain the supervised servers; their wsl.exe exits with them, the flag
+    // only covers a server that ignores the stop
+    for (auto& server : servers) {
+        if (!server->finished) {
+            std::string stdout_output, stderr_output;
+            parallax::utils::ExecCommandEx(
+                parallax::utils::BuildWSLCommand(
+                    GetDistro(), parallax::utils::BuildWSLSignalCommand(
+                                     server->pid_file, "INT")),
+                30, stdout_output, stderr_output, false, true);
+        }
+    }
+    int drain_timeout = GetDrainTimeout(-1);
+    uint64_t deadline =
+        parallax::utils::GetTickCountMs() + drain_timeout * 1000ULL;
+    for (auto& server : servers) {
+        while (!server->finished &&
+               parallax::utils::GetTickCountMs() < deadline) {
+            Sleep(200);
+        }
+    }
+    g_shutting_down = true;
+    for (auto& server : servers) {
+        if (server->supervisor.joinable()) {
+            server->supervisor.join();
+        }
+    }
+    info_log("[CAPI] prakasa_core shut down");
+}
+
+int prakasa_check(const char* components, prakasa_component_callback callback,
+                  void* user_data, int* reboot_required) {
+    ComponentSelection selection;
+    if (!ParseSelection(components, selection)) {
+        return PRAKASA_E_INVALID_ARGUMENT;
+    }
+    return RunInstallerOperation(
+        [&](EnvironmentInstaller& installer) {
+            return installer.CheckEnvironment(
+                [&](const ComponentResult& result) {
+                    ReportComponent(result, callback, user_data);
+                },
+                selection);
+        },
+        reboot_required);
+}
+
+int prakasa_install(const char* components, prakasa_progress_callback progress,
+                    prakasa_component_callback callback, void* user_data,
+                    int* reboot_required) {
+    ComponentSelection selection;
+    if (!ParseSelection(components, selection)) {
+        return PRAKASA_E_INVALID_ARGUMENT;
+    }
+    return RunInstallerOperation(
+        [&](EnvironmentInstaller& installer) {
+            EnvironmentResult result = installer.InstallEnvironment(
+                [&](const std::string& step, const std::string& message,
+                    int percent) {
+                    if (progress != nullptr) {
+                        progress(step.c_str(), message.c_str(), percent,
+                                 user_data);
+                    }
+                },
+                selection);
+            for (const auto& component : result.component_results) {
+                ReportComponent(component, callback, user_data);
+            }
+            return result;
+        },
+        reboot_required);
+}
+
+void prakasa_cancel(void) {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_active_installer) {
+        g_active_installer->Stop();
+    }
+}
+
+int prakasa_server_launch(const char* launcher, const char* args, int* pid) {
+    if (launcher == nullptr ||
+        (std::strcmp(launcher, "run") != 0 &&
+         std::strcmp(launcher, "join") != 0)) {
+        return PRAKASA_E_INVALID_ARGUMENT;
+    }
+
+    LaunchedServer* server = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_initialized) {
+            return PRAKASA_E_NOT_INITIALIZED;
+        }
+        // The pid file is named after the launcher and this process, so
+        // one server per launcher at a time
+        for (const auto& existing : g_servers) {
+            if (existing->launcher == launcher && !existing->finished) {
+                return PRAKASA_E_BUSY;
+            }
+        }
+        g_servers.erase(
+            std::remove_if(g_servers.begin(), g_servers.end(),
+                           [](const std::unique_ptr<LaunchedServer>& old) {
+                               if (!old->finished) {
+                                   return false;
+                               }
+                               if (old->supervisor.joinable()) {
+                                   old->supervisor.join();
+                               }
+                               return true;
+                           }),
+            g_servers.end());
+
+        auto launched = std::make_unique<LaunchedServer>();
+        launched->launcher = launcher;
+        launched->pid_file = parallax::utils::BuildWSLPidFilePath(launcher);
+        server = launched.get();
+        g_servers.push_back(std::move(launched));
+    }
+
+    std::string distro = GetDistro();
+    std::string proxy_url = parallax::utils::GetProxyUrl();
+    std::string prakasa_command = std::string("prakasa ") + launcher;
+    if (args != nullptr && args[0] != '\0') {
+        prakasa_command += std::string(" ") + args;
+    }
+    std::string staging_message;
+    prakasa_command = parallax::utils::StageModelWeights(
+        distro, parallax::utils::SplitArguments(args != nullptr ? args : ""),
+        prakasa_command, staging_message);
+    prakasa_command = parallax::utils::PartitionServerCpus(
+        distro, parallax::utils::ProbePrakasaSessions(distro).servers,
+        prakasa_command);
+    // Output goes only to the session log; this process keeps wsl.exe
+    // running, which keeps the server's distro session alive
+    std::string launch_command = parallax::utils::BuildServerLaunchCommand(
+        prakasa_command, server->pid_file, proxy_url,
+        parallax::environment::SelectHuggingFaceEndpoint(distro, proxy_url),
+        false);
+    info_log("[CAPI] Launching %s: %s", launcher, prakasa_command.c_str());
+
+    server->supervisor = std::thread([server, distro, launch_command]() {
+        parallax::utils::ServingProfileSession profile(server->launcher);
+        bool relaunch = false;
+        server->exit_code = parallax::utils::RunUnderSloWatchdog(
+            distro, server->launcher, server->pid_file, false, [&]() {
+                // The watchdog drained the server; not while shutting down
+                if (relaunch) {
+                    std::lock_guard<std::mutex> lock(g_mutex);
+                    if (!g_initialized) {
+                        return server->exit_code;
+                    }
+                }
+                relaunch = true;
+                std::string stdout_output, stderr_output;
+                server->exit_code = parallax::utils::ExecCommandEx2(
+                    parallax::utils::BuildWSLCommand(distro, launch_command),
+                    kServerMaxSeconds, stdout_output, stderr_output,
+                    []() { return g_shutting_down.load(); }, false, true);
+                return server->exit_code;
+            });
+        info_log("[CAPI] Server %s exited with code %d", server->pid_file.c_str(),
+                 server->exit_code);
+        server->finished = true;
+    });
+
+    // Wait for the shell to record its pid, which prakasa then inherits
+    uint64_t deadline =
+        parallax::utils::GetTickCountMs() + kLaunchWaitSeconds * 1000ULL;
+    while (parallax::utils::GetTickCountMs() < deadline) {
+        if (server->finished) {
+            return PRAKASA_E_FAILED;
+        }
+        std::string stdout_output, stderr_output;
+        int exit_code = parallax::utils::ExecCommandEx(
+            parallax::utils::BuildWSLCommand(
+                distro, "cat " + server->pid_file + " 2>/dev/null"),
+            10, stdout_output, stderr_output, false, true);
+        int server_pid = std::atoi(stdout_output.c_str());
+        if (exit_code == 0 && server_pid > 0) {
+            if (pid != nullptr) {
+                *pid = server_pid;
+            }
+            return 0;
+        }
+        Sleep(500);
+    }
+    return PRAKASA_E_FAILED;
+}
+
+int prakasa_server_stop(int pid, int drain_timeout_seconds) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_initialized) {
+            return PRAKASA_E_NOT_INITIALIZED;
+        }
+    }
+    if (pid <= 0) {
+        return PRAKASA_E_INVALID_ARGUMENT;
+    }
+
+    parallax::utils::PrakasaServerInfo server;
+    if (!FindServer(pid, server)) {
+        return PRAKASA_E_NOT_FOUND;
+    }
+    return parallax::utils::ReclaimPrakasaServers(
+               GetDistro(), {server}, GetDrainTimeout(drain_timeout_seconds))
+               ? 0
+               : PRAKASA_E_FAILED;
+}
+
+int prakasa_server_status(prakasa_server_callback callback, void* user_data) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_initialized) {
+            return PRAKASA_E_NOT_INITIALIZED;
+        }
+    }
+
+    parallax::utils::PrakasaSessionProbe probe =
+        parallax::utils::ProbePrakasaSessions(GetDistro());
+    if (!probe.ok) {
+        return PRAKASA_E_FAILED;
+    }
+    for (const auto& server : probe.servers) {
+        if (callback == nullptr) {
+            break;
+        }
+        prakasa_server_info info;
+        info.pid = server.pid;
+        info.pgid = server.pgid;
+        info.elapsed_seconds = server.elapsed_seconds;
+        info.launcher = server.launcher.c_str();
+        info.state = server.state.c_str();
+        info.command = server.command.c_str();
+        info.owner_session = server.owner_session;
+        info.owner_alive = server.owner_alive ? 1 : 0;
+        info.healthy = server.IsHealthy() ? 1 : 0;
+        info.gpu_memory_mib = server.gpu_memory_mib;
+        callback(&info, user_data);
+    }
+    return static_cast<int>(probe.servers.size());
+}
+
+int prakasa_gpu_telemetry(prakasa_gpu_sample* samples, int capacity) {
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (!g_initialized) {
+            return PRAKASA_E_NOT_INITIALIZED;
+        }
+    }
+    if (capacity < 0 || (samples == nullptr && capacity > 0)) {
+        return PRAKASA_E_INVALID_ARGUMENT;
+    }
+
+    parallax::utils::GpuTelemetrySnapshot snapshot =
+        parallax::utils::SampleGpuTelemetry(GetDistro());
+    if (!snapshot.available) {
+        return 0;
+    }
+    int count = static_cast<int>(snapshot.devices.size());
+    for (int i = 0; i < count && i < capacity; ++i) {
+        const auto& device = snapshot.devices[i];
+        prakasa_gpu_sample& sample = samples[i];
+        sample.index = device.index;
+        std::strncpy(sample.name, device.name.c_str(), sizeof(sample.name) - 1);
+        sample.name[sizeof(sample.name) - 1] = '\0';
+        sample.memory_used_mib = device.memory_used_mib;
+        sample.memory_total_mib = device.memory_total_mib;
+        sample.utilization_percent = device.utilization_percent;
+        sample.temperature_c = device.temperature_c;
+        sample.power_draw_w = device.power_draw_w;
+        sample.sm_clock_mhz = device.sm_clock_mhz;
+    }
+    return count;
+}
+
+}  // extern "C"
@@ -0,0 +1,155 @@
+#pragma once
+
+/*
+ * C API of prakasa_core for in-process frontends (tray launcher, GUI).
+ *
+ * All functions are synchronous and thread-safe unless noted. Strings passed
+ * to callbacks are UTF-8 and valid only for the duration of the call. The
+ * configuration and logs are those of prakasa.exe, located next to the host
+ * executable.
+ */
+
+#include <stdint.h>
+
+#if defined(PRAKASA_CAPI_STATIC)
+#define PRAKASA_API
+#elif defined(PRAKASA_CAPI_EXPORTS)
+#define PRAKASA_API __declspec(dllexport)
+#else
+#define PRAKASA_API __declspec(dllimport)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on incompatible changes; additions keep the version */
+#define PRAKASA_CAPI_VERSION 1
+
+/* Negative return codes */
+#define PRAKASA_E_NOT_INITIALIZED -1
+#define PRAKASA_E_INVALID_ARGUMENT -2
+#define PRAKASA_E_BUSY -3      /* A check or install, or a server of the
+                                  same launcher, is already running */
+#define PRAKASA_E_NOT_FOUND -4
+#define PRAKASA_E_FAILED -5
+
+/* Component status, same values as InstallationStatus */
+#define PRAKASA_STATUS_SUCCESS 0
+#define PRAKASA_STATUS_FAILED 1
+#define PRAKASA_STATUS_SKIPPED 2
+#define PRAKASA_STATUS_IN_PROGRESS 3
+#define PRAKASA_STATUS_WARNING 4
+
+typedef struct prakasa_component_result {
+    const char* key;  /* Component key, e.g. "cuda" */
+    const char* name; /* Display name, e.g. "CUDA Toolkit" */
+    int status;       /* PRAKASA_STATUS_* */
+    int error_code;
+    const char* message;
+    uint64_t duration_ms;
+} prakasa_component_result;
+
+typedef struct prakasa_server_info {
+    int pid;
+    int pgid;
+    long elapsed_seconds;
+    const char* launcher; /* "run", "join" or "chat" */
+    const char* state;    /* ps STAT column */
+    const char* command;
+    unsigned long owner_session; /* Windows PID of the launching process */
+    int owner_alive;
+    int healthy;
+    int gpu_memory_mib;
+} prakasa_server_info;
+
+typedef struct prakasa_gpu_sample {
+    int index;
+    char name[128];
+    int memory_used_mib;
+    int memory_total_mib;
+    int utilization_percent;
+    int temperature_c;
+    double power_draw_w;
+    int sm_clock_mhz;
+} prakasa_gpu_sample;
+
+typedef void (*prakasa_component_callback)(
+    const prakasa_component_result* result, void* user_data);
+typedef void (*prakasa_progress_callback)(const char* step,
+                                          const char* message,
+                                          int progress_percent,
+                                          void* user_data);
+typedef void (*prakasa_server_callback)(const prakasa_server_info* server,
+                                        void* user_data);
+
+PRAKASA_API int prakasa_api_version(void);
+
+/*
+ * Load the configuration and open the log. log_path may be NULL for
+ * prakasa.log next to the host executable. Returns 0 or PRAKASA_E_FAILED.
+ */
+PRAKASA_API int prakasa_init(const char* log_path);
+
+/* Stop the servers started with prakasa_server_launch and release state */
+PRAKASA_API void prakasa_shutdown(void);
+
+/*
+ * Check the environment. components is a comma-separated list of component
+ * keys ("cuda,prakasa"), NULL or "" for all. callback receives each result
+ * as soon as it is known. Returns the number of failed components or a
+ * PRAKASA_E_* code; reboot_required may be NULL.
+ */
+PRAKASA_API int prakasa_check(const char* components,
+                              prakasa_component_callback callback,
+                              void* user_data, int* reboot_required);
+
+/*
+ * Install the selected components and their missing prerequisites, same
+ * selection and return value as prakasa_check. Requires administrator
+ * rights for the Windows feature components.
+ */
+PRAKASA_API int prakasa_install(const char* components,
+                                prakasa_progress_callback progress,
+                                prakasa_component_callback callback,
+                                void* user_data, int* reboot_required);
+
+/* Ask a running check or install to stop; returns immediately */
+PRAKASA_API void prakasa_cancel(void);
+
+/*
+ * Start "prakasa <launcher> <args>" in the distro (launcher "run" or
+ * "join"), supervised by this process until the server exits or is
+ * stopped. Output goes to the session log. pid receives the server's pid
+ * in the distro once it started. Returns 0 or a PRAKASA_E_* code,
+ * PRAKASA_E_BUSY while a server this process launched with the same
+ * launcher is still running.
+ */
+PRAKASA_API int prakasa_server_launch(const char* launcher, const char* args,
+                                      int* pid);
+
+/*
+ * Stop a server by pid (any server reported by prakasa_server_status):
+ * SIGINT, then SIGKILL after drain_timeout_seconds (negative for the
+ * shutdown_drain_timeout setting). Returns 0 or a PRAKASA_E_* code.
+ */
+PRAKASA_API int prakasa_server_stop(int pid, int drain_timeout_seconds);
+
+/*
+ * Report every prakasa server in the distro through callback, with one
+ * wsl.exe call. Returns the number of servers or a PRAKASA_E_* code.
+ */
+PRAKASA_API int prakasa_server_status(prakasa_server_callback callback,
+                                      void* user_data);
+
+/*
+ * Sample GPU telemetry into samples (up to capacity entries). Returns the
+ * number of GPUs, which may exceed capacity, 0 when nvidia-smi did not
+ * answer, or a PRAKASA_E_* code.
+ */
+PRAKASA_API int prakasa_gpu_telemetry(prakasa_gpu_sample* samples,
+                                      int capacity);
+
+#ifdef __cplusplus
+}
+#endif
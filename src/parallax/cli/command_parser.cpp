@@ -4,6 +4,11 @@
 #include "commands/config_command.h"
 #include "commands/model_commands.h"
 #include "commands/cmd_command.h"
+#include "commands/broker_command.h"
+#include "commands/move_distro_command.h"
+#include "commands/doctor_command.h"
+#include "commands/serving_profile_command.h"
+#include "commands/cluster_command.h"
 #include "tinylog/tinylog.h"
 #include <iostream>
 #include <algorithm>
@@ -174,6 +179,46 @@ void CommandParser::InitializeBuiltinCommands() {
                         auto result = cmd_cmd.Execute(args);
                         return static_cast<int>(result);
                     });
+
+    // Register broker command (warm WSL/PowerShell sessions across calls)
+    RegisterCommand("broker", "Keep warm WSL/PowerShell sessions for later calls",
+                    [](const std::vector<std::string>& args) -> int {
+                        parallax::commands::BrokerCommand broker_cmd;
+                        auto result = broker_cmd.Execute(args);
+                        return static_cast<int>(result);
+                    });
+
+    // Register move-distro command (relocate the distro to a faster drive)
+    RegisterCommand("move-distro", "Move the WSL distro to a faster local drive",
+                    [](const std::vector<std::string>& args) -> int {
+                        parallax::commands::MoveDistroCommand move_cmd;
+                        auto result = move_cmd.Execute(args);
+                        return static_cast<int>(result);
+                    });
+
+    // Register doctor command (performance diagnostics)
+    RegisterCommand("doctor", "Diagnose performance bottlenecks of this node",
+                    [](const std::vector<std::string>& args) -> int {
+                        parallax::commands::DoctorCommand doctor_cmd;
+                        auto result = doctor_cmd.Execute(args);
+                        return static_cast<int>(result);
+                    });
+
+    // Register serving-profile command (settings changed while serving)
+    RegisterCommand("serving-profile", "Show or restore the settings changed while serving",
+                    [](const std::vector<std::string>& args) -> int {
+                        parallax::commands::ServingProfileCommand profile_cmd;
+                        auto result = profile_cmd.Execute(args);
+                        return static_cast<int>(result);
+                    });
+
+    // Register cluster command (local scheduler and workers from a manifest)
+    RegisterCommand("cluster", "Run a local scheduler and workers from a manifest",
+                    [](const std::vector<std::string>& args) -> int {
+                        parallax::commands::ClusterCommand cluster_cmd;
+                        auto result = cluster_cmd.Execute(args);
+                        return static_cast<int>(result);
+                    });
 }
 
 }  // namespace cli
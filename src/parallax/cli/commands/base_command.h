@@ -5,8 +5,14 @@
 #include <functional>
 #include <memory>
 #include <unordered_map>
+#include <sstream>
 #include "utils/utils.h"
 #include "utils/process.h"
+#include "utils/prakasa_sessions.h"
+#include "utils/cpu_partition.h"
+#include "utils/weight_residency.h"
+#include "utils/session_broker.h"
+#include "environment/mirror_selector.h"
 #include "config/config_manager.h"
 #include "tinylog/tinylog.h"
 #include <iostream>
@@ -22,7 +28,11 @@ namespace parallax
             Success = 0,
             InvalidArgs = 1,
             EnvironmentError = 2,
-            ExecutionError = 3
+            ExecutionError = 3,
+            // Only returned in non-interactive modes (e.g. check --ci) so
+            // scripts can tell these apart from hard failures
+            Warning = 4,
+            RebootRequired = 5
         };
 
         // Command execution context
@@ -160,6 +170,18 @@ namespace parallax
 
             bool CheckWSLEnvironment(const CommandContext &context)
             {
+                // A warm PowerShell host of the session broker answers in
+                // milliseconds; its output is UTF-8 already
+                parallax::utils::BrokerCommandResult brokered;
+                if (parallax::utils::RunThroughSessionBroker(
+                        parallax::utils::BrokerShell::kPowerShell, context.ubuntu_version,
+                        "wsl --list --quiet", 30, nullptr, brokered))
+                {
+                    return brokered.exit_code == 0 &&
+                           brokered.stdout_output.find(context.ubuntu_version) !=
+                               std::string::npos;
+                }
+
                 std::string stdout_output, stderr_output;
                 int exit_code = parallax::utils::ExecCommandEx(
                     "powershell.exe -Command \"wsl --list --quiet\"", 30, stdout_output,
@@ -245,11 +267,148 @@ namespace parallax
             // Build venv activation command with CUDA environment
             std::string BuildVenvActivationCommand(const CommandContext &context)
             {
-                // Filter out Windows paths and add CUDA path
-                // Use single quotes and careful escaping for PowerShell/CMD compatibility
-                return "cd ~/prakasa && "
-                       "export PATH=/usr/local/cuda-12.8/bin:$(echo '$PATH' | tr ':' '\\n' | grep -v '/mnt/c' | paste -sd ':' -) && "
-                       "source ./venv/bin/activate";
+                return parallax::utils::BuildVenvActivationCommand();
+            }
+
+            // Build the in-distro command line for a long-running prakasa
+            // subcommand, recorded in pid_file and logged to its session log
+            std::string BuildPrakasaLaunchCommand(const CommandContext &context,
+                                                  const std::string &prakasa_command,
+                                                  const std::string &pid_file)
+            {
+                return parallax::utils::BuildServerLaunchCommand(
+                    prakasa_command, pid_file, context.proxy_url,
+                    parallax::environment::SelectHuggingFaceEndpoint(
+                        context.ubuntu_version, context.proxy_url),
+                    true);
+            }
+
+            // Remove the launcher-only options (--reclaim, --attach) so the
+            // remaining arguments can be passed to prakasa unchanged
+            void ExtractLaunchFlags(CommandContext &context)
+            {
+                std::vector<std::string> remaining;
+                for (const auto &arg : context.args)
+                {
+                    if (arg == "--reclaim")
+                    {
+                        reclaim_stale_ = true;
+                    }
+                    else if (arg == "--attach")
+                    {
+                        attach_existing_ = true;
+                    }
+                    else
+                    {
+                        remaining.push_back(arg);
+                    }
+                }
+                context.args = remaining;
+            }
+
+            // Launch preflight for servers: list prakasa servers already
+            // running in the distro with their GPU memory, stop the stale ones
+            // (--reclaim) or attach to a healthy one (--attach), and give the
+            // new server its CPU slot next to the running ones. Returns the
+            // in-distro command to run under pid_file
+            std::string PrepareServerLaunch(const CommandContext &context,
+                                            const std::string &launcher_name,
+                                            const std::string &prakasa_command,
+                                            const std::string &pid_file)
+            {
+                parallax::utils::PrakasaSessionProbe probe =
+                    parallax::utils::ProbePrakasaSessions(context.ubuntu_version);
+
+                std::vector<parallax::utils::PrakasaServerInfo> stale;
+                const parallax::utils::PrakasaServerInfo *attach_target = nullptr;
+                for (const auto &server : probe.servers)
+                {
+                    std::string description =
+                        parallax::utils::DescribePrakasaServer(server);
+                    if (!server.IsStale())
+                    {
+                        this->ShowInfo("Server running: " + description);
+                        continue;
+                    }
+                    this->ShowWarning("Stale server: " + description);
+                    stale.push_back(server);
+                    if (server.IsHealthy() &&
+                        (attach_target == nullptr ||
+                         (attach_target->launcher != launcher_name &&
+                          server.launcher == launcher_name)))
+                    {
+                        attach_target = &server;
+                    }
+                }
+
+                if (attach_existing_)
+                {
+                    if (attach_target != nullptr)
+                    {
+                        this->ShowInfo("Attaching to " +
+                                       parallax::utils::DescribePrakasaServer(*attach_target));
+                        return parallax::utils::BuildAttachCommand(*attach_target, pid_file);
+                    }
+                    this->ShowWarning("No healthy stale server to attach to, starting a new one.");
+                }
+
+                if (!stale.empty() && reclaim_stale_)
+                {
+                    int drain_timeout =
+                        parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+                            parallax::config::KEY_SHUTDOWN_DRAIN_TIMEOUT, 30);
+                    int used_before = probe.gpu.TotalMemoryUsedMib();
+                    this->ShowInfo("Stopping " + std::to_string(stale.size()) +
+                                   " stale server(s)...");
+                    if (!parallax::utils::ReclaimPrakasaServers(context.ubuntu_version,
+                                                                stale, drain_timeout))
+                    {
+                        this->ShowWarning("Some stale servers could not be stopped.");
+                    }
+
+                    parallax::utils::GpuTelemetrySnapshot after =
+                        parallax::utils::SampleGpuTelemetry(context.ubuntu_version);
+                    if (after.available && probe.gpu.available)
+                    {
+                        this->ShowInfo("GPU memory in use: " + std::to_string(used_before) +
+                                       " MiB -> " + std::to_string(after.TotalMemoryUsedMib()) +
+                                       " MiB");
+                    }
+                }
+                else if (!stale.empty())
+                {
+                    this->ShowWarning("Stale servers may hold GPU memory and ports. Use "
+                                      "--reclaim to stop them or --attach to reuse one.");
+                }
+                else if (probe.gpu.available)
+                {
+                    info_log("GPU memory in use before launch: %d/%d MiB",
+                             probe.gpu.TotalMemoryUsedMib(), probe.gpu.TotalMemoryMib());
+                }
+
+                // Opt-in: serve the weights from /dev/shm across restarts
+                std::string staging_message;
+                std::string server_command = parallax::utils::StageModelWeights(
+                    context.ubuntu_version, context.args, prakasa_command,
+                    staging_message);
+                if (!staging_message.empty())
+                {
+                    this->ShowInfo(staging_message);
+                }
+
+                std::vector<parallax::utils::PrakasaServerInfo> running;
+                for (const auto &server : probe.servers)
+                {
+                    if (!(reclaim_stale_ && server.IsStale()))
+                    {
+                        running.push_back(server);
+                    }
+                }
+                return BuildPrakasaLaunchCommand(
+                    context,
+                    parallax::utils::PartitionServerCpus(context.ubuntu_version,
+                                                         running, server_command),
+                    pid_file);
             }
 
             // Escape arguments for safe passing through bash -c "..."
@@ -301,6 +460,10 @@ namespace parallax
                 // If no special characters, return directly
                 return arg;
             }
+
+        private:
+            bool reclaim_stale_ = false;
+            bool attach_existing_ = false;
         };
 
     } // namespace commands
@@ -0,0 +1,111 @@
+#include "broker_command.h"
+#include "utils/session_broker.h"
+#include "tinylog/tinylog.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace parallax {
+namespace commands {
+
+namespace {
+
+// Idle timeout of a broker started by hand while the setting is 0
+const int kDefaultIdleTimeoutSeconds = 600;
+
+}  // namespace
+
+CommandResult BrokerCommand::ValidateArgsImpl(CommandContext& context) {
+    if (context.args.empty()) {
+        this->ShowError("No broker action specified");
+        this->ShowError("Usage: prakasa broker <start|stop|status>");
+        return CommandResult::InvalidArgs;
+    }
+
+    const std::string& action = context.args[0];
+    if (action != "start" && action != "stop" && action != "status") {
+        this->ShowError("Unknown broker action: " + action);
+        this->ShowError("Usage: prakasa broker <start|stop|status>");
+        return CommandResult::InvalidArgs;
+    }
+
+    idle_timeout_seconds_ =
+        parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+            parallax::config::KEY_SESSION_BROKER_IDLE_TIMEOUT, 0);
+    if (idle_timeout_seconds_ <= 0) {
+        idle_timeout_seconds_ = kDefaultIdleTimeoutSeconds;
+    }
+    for (size_t i = 1; i < context.args.size(); ++i) {
+        if (context.args[i] == "--idle-timeout" &&
+            i + 1 < context.args.size()) {
+            idle_timeout_seconds_ = std::atoi(context.args[++i].c_str());
+            if (idle_timeout_seconds_ <= 0) {
+                this->ShowError("--idle-timeout must be a positive number");
+                return CommandResult::InvalidArgs;
+            }
+        } else {
+            this->ShowError("Unknown option: " + context.args[i]);
+            return CommandResult::InvalidArgs;
+        }
+    }
+
+    return CommandResult::Success;
+}
+
+CommandResult BrokerCommand::ExecuteImpl(const CommandContext& context) {
+    const std::string& action = context.args[0];
+
+    if (action == "start") {
+        // Runs in the foreground; clients start it detached on demand
+        info_log("Starting session broker, idle timeout %d s",
+                 idle_timeout_seconds_);
+        return parallax::utils::RunSessionBroker(idle_timeout_seconds_) == 0
+                   ? CommandResult::Success
+                   : CommandResult::ExecutionError;
+    }
+
+    if (action == "stop") {
+        if (!parallax::utils::StopSessionBroker()) {
+            this->ShowInfo("No session broker is running");
+            return CommandResult::Success;
+        }
+        this->ShowInfo("Session broker stopped");
+        return CommandResult::Success;
+    }
+
+    std::string status;
+    if (!parallax::utils::QuerySessionBroker(status)) {
+        this->ShowInfo("No session broker is running");
+        return CommandResult::Success;
+    }
+    std::cout << "Session broker: " << status << std::endl;
+    std::cout << "Pipe: " << parallax::utils::GetSessionBrokerPipeName()
+              << std::endl;
+    return CommandResult::Success;
+}
+
+void BrokerCommand::ShowHelpImpl() {
+    std::cout << "Usage: prakasa broker <start|stop|status> [options]\n\n";
+    std::cout << "Keep warm WSL bash sessions and a PowerShell host between "
+                 "prakasa calls, so\n";
+    std::cout << "repeated checks from scripts skip the wsl.exe and "
+                 "PowerShell start.\n\n";
+    std::cout << "With session_broker_idle_timeout set above 0, the first "
+                 "call starts the broker\n";
+    std::cout << "in the background and later calls use it; it exits after "
+                 "that many idle seconds.\n\n";
+    std::cout << "Actions:\n";
+    std::cout << "  start                Run the broker in the foreground\n";
+    std::cout << "  stop                 Stop the running broker\n";
+    std::cout << "  status               Show the running broker\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --idle-timeout <s>   Exit after this many idle seconds "
+                 "(start)\n";
+    std::cout << "  --help, -h           Show this help message\n\n";
+    std::cout << "Examples:\n";
+    std::cout << "  prakasa config set session_broker_idle_timeout 600\n";
+    std::cout << "  prakasa broker status\n";
+    std::cout << "  prakasa broker stop\n";
+}
+
+}  // namespace commands
+}  // namespace parallax
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "base_command.h"
+#include <string>
+
+namespace parallax {
+namespace commands {
+
+// Broker command - runs and controls the per-user session broker that keeps
+// warm WSL/PowerShell sessions between CLI invocations
+class BrokerCommand : public BaseCommand<BrokerCommand> {
+ public:
+    std::string GetName() const override { return "broker"; }
+    std::string GetDescription() const override {
+        return "Keep warm WSL/PowerShell sessions for later calls";
+    }
+
+    EnvironmentRequirements GetEnvironmentRequirements() {
+        // start serves whatever distro its clients ask for
+        EnvironmentRequirements req;
+        return req;
+    }
+
+    CommandResult ValidateArgsImpl(CommandContext& context);
+    CommandResult ExecuteImpl(const CommandContext& context);
+    void ShowHelpImpl();
+
+ private:
+    int idle_timeout_seconds_ = 0;
+};
+
+}  // namespace commands
+}  // namespace parallax
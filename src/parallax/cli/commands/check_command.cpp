@@ -5,28 +5,150 @@
 #include <iomanip>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <functional>
+#include <ctime>
+#include <sstream>
+#include "utils/utils.h"
 
 namespace parallax {
 namespace commands {
 
+namespace {
+
+// Prints check results on its own thread with a short gap between lines,
+// so the output keeps a steady rhythm without slowing down the probes
+class PacedResultPrinter {
+ public:
+    using PrintFunction = std::function<void(const environment::ComponentResult&)>;
+
+    PacedResultPrinter(PrintFunction print, std::chrono::milliseconds pace)
+        : print_(print), pace_(pace), done_(false) {
+        thread_ = std::thread([this]() { Run(); });
+    }
+
+    ~PacedResultPrinter() { Finish(); }
+
+    void Push(const environment::ComponentResult& result) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(result);
+        }
+        cv_.notify_one();
+    }
+
+    // Print whatever is still queued and stop the thread
+    void Finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_ = true;
+        }
+        cv_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+ private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this]() { return done_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;  // done_ and drained
+            }
+            environment::ComponentResult result = queue_.front();
+            queue_.pop_front();
+            lock.unlock();
+            print_(result);
+            // Only pace while the probes are still running
+            if (!done_) {
+                std::this_thread::sleep_for(pace_);
+            }
+            lock.lock();
+        }
+    }
+
+    PrintFunction print_;
+    std::chrono::milliseconds pace_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<environment::ComponentResult> queue_;
+    std::atomic<bool> done_;
+    std::thread thread_;
+};
+
+std::string CurrentTimestampUtc() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc_time;
+    gmtime_s(&utc_time, &now);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc_time);
+    return buffer;
+}
+
+}  // namespace
+
 CheckCommand::CheckCommand() = default;
 CheckCommand::~CheckCommand() = default;
 
 CommandResult CheckCommand::ValidateArgsImpl(CommandContext& context) {
-    // check command does not accept additional parameters
-    for (const auto& arg : context.args) {
-        if (arg != "--help" && arg != "-h") {
+    // Component selectors narrow the check to part of the environment
+    std::vector<std::string> remaining_args;
+    std::string error;
+    if (!environment::ParseComponentSelection(context.args, selection_,
+                                              remaining_args, error)) {
+        this->ShowError(error);
+        this->ShowError("Valid components: " +
+                        environment::GetComponentKeyList());
+        return CommandResult::InvalidArgs;
+    }
+
+    for (const auto& arg : remaining_args) {
+        if (arg == "--json") {
+            json_output_ = true;
+            ci_mode_ = true;
+        } else if (arg == "--ci") {
+            ci_mode_ = true;
+        } else if (arg != "--help" && arg != "-h") {
             this->ShowError("Unknown parameter: " + arg);
             this->ShowError(
-                "The 'check' command does not accept additional parameters.");
-            this->ShowError("Usage: prakasa check [--help|-h]");
+                "Usage: prakasa check [--json|--ci] [--only <list>] "
+                "[--skip <list>] [--from <component>] [--help|-h]");
             return CommandResult::InvalidArgs;
         }
     }
     return CommandResult::Success;
 }
 
+EnvironmentRequirements CheckCommand::GetEnvironmentRequirements() {
+    EnvironmentRequirements req = AdminCommand::GetEnvironmentRequirements();
+    // In machine mode a missing elevation is reported through the JSON
+    // document (the installer checks it first) instead of a text error
+    if (json_output_) {
+        req.need_admin = false;
+    }
+    return req;
+}
+
 CommandResult CheckCommand::ExecuteImpl(const CommandContext& context) {
+    if (ci_mode_) {
+        // Non-interactive: no banner, no next steps, distinct exit codes
+        switch (CheckAllComponents()) {
+            case 0:
+                return CommandResult::Success;
+            case 2:
+                return CommandResult::RebootRequired;
+            case 3:
+                return CommandResult::Warning;
+            default:
+                return CommandResult::EnvironmentError;
+        }
+    }
+
     std::cout << "Parallax Environment Check\n";
     std::cout << "=========================\n\n";
 
@@ -85,23 +207,36 @@ void CheckCommand::ShowHelpImpl() {
     std::cout << "  6. Python pip upgrade\n";
     std::cout << "  7. Parallax distributed inference framework\n\n";
     std::cout << "Options:\n";
+    std::cout << "  --ci            Non-interactive: no pacing, distinct exit "
+                 "codes\n";
+    std::cout << "  --json          Like --ci, print a JSON report on stdout\n";
+    std::cout << "  --only <list>   Check only these components "
+                 "(comma separated)\n";
+    std::cout << "  --skip <list>   Do not check these components\n";
+    std::cout << "  --from <name>   Start at this component in check order\n";
     std::cout << "  --help, -h      Show this help message\n\n";
+    std::cout << "Components:\n";
+    std::cout << "  " << environment::GetComponentKeyList() << "\n\n";
     std::cout << "Exit codes:\n";
     std::cout << "  0    All checks passed (including warnings)\n";
     std::cout << "  1    Invalid arguments\n";
-    std::cout << "  2    Environment issues found or reboot required\n\n";
+    std::cout << "  2    Environment issues found or reboot required\n";
+    std::cout << "  With --ci/--json: 0 passed, 1 invalid arguments, 2 failed,\n";
+    std::cout << "  4 passed with warnings, 5 reboot required\n\n";
     std::cout << "Examples:\n";
     std::cout << "  prakasa check             Run environment check\n";
+    std::cout << "  prakasa check --only cuda,prakasa\n";
+    std::cout << "                            Check CUDA and the prakasa "
+                 "project only\n";
+    std::cout << "  prakasa check --json      Print a machine-readable report\n";
     std::cout << "  prakasa check --help      Show this help message\n";
 }
 
 int CheckCommand::CheckAllComponents() {
     environment::EnvironmentInstaller installer;
 
-    // Define component check callback function to display check results in
-    // real-time
-    auto component_callback = [](const environment::ComponentResult&
-                                     comp_result) {
+    // Display function for a single check result
+    auto print_result = [](const environment::ComponentResult& comp_result) {
         std::string component_name =
             environment::ComponentToString(comp_result.component);
 
@@ -149,30 +284,39 @@ int CheckCommand::CheckAllComponents() {
         }
 
         std::cout << std::endl;
-
-        // Add appropriate delay to improve user experience
-        std::this_thread::sleep_for(std::chrono::milliseconds(800));
     };
 
-    // Execute environment check using callback mechanism
-    auto result = installer.CheckEnvironment(component_callback);
+    uint64_t start_ms = parallax::utils::GetTickCountMs();
+    environment::EnvironmentResult result;
+    if (ci_mode_) {
+        // Probes run back to back; text mode prints each result as it lands
+        environment::ComponentCheckCallback callback = nullptr;
+        if (!json_output_) {
+            callback = print_result;
+        }
+        result = installer.CheckEnvironment(callback, selection_);
+    } else {
+        // Interactive mode keeps a steady pace on a separate printer thread
+        PacedResultPrinter printer(print_result, std::chrono::milliseconds(150));
+        result = installer.CheckEnvironment(
+            [&printer](const environment::ComponentResult& comp_result) {
+                printer.Push(comp_result);
+            },
+            selection_);
+        printer.Finish();
+    }
+    uint64_t duration_ms = parallax::utils::GetTickCountMs() - start_ms;
+
+    int exit_code = ClassifyResult(result);
+    if (json_output_) {
+        PrintJsonReport(result, exit_code, duration_ms);
+        return exit_code;
+    }
 
     DisplayResults(result);
 
     // Return appropriate exit code based on check results
-    bool has_failures = false;
-    bool has_warnings = false;
-    for (const auto& comp_result : result.component_results) {
-        if (comp_result.status == environment::InstallationStatus::kFailed) {
-            has_failures = true;
-            break;
-        } else if (comp_result.status ==
-                   environment::InstallationStatus::kWarning) {
-            has_warnings = true;
-        }
-    }
-
-    if (result.reboot_required) {
+    if (exit_code == 2) {
         std::cout << "\n[WARNING] SYSTEM REBOOT REQUIRED\n";
         std::cout
             << "Some components require a system restart to take effect.\n";
@@ -180,11 +324,11 @@ int CheckCommand::CheckAllComponents() {
         return 2;  // Special exit code indicating reboot required
     }
 
-    if (has_failures) {
+    if (exit_code == 1) {
         std::cout << "\n[ERROR] Some environment requirements are not met.\n";
         std::cout << "Run 'parallax install' to install missing components.\n";
         return 1;
-    } else if (has_warnings) {
+    } else if (exit_code == 3) {
         std::cout << "\n[WARNING] Environment is ready but some components "
                      "have updates available.\n";
         std::cout
@@ -198,6 +342,86 @@ int CheckCommand::CheckAllComponents() {
     }
 }
 
+int CheckCommand::ClassifyResult(
+    const parallax::environment::EnvironmentResult& result) {
+    bool has_failures = false;
+    bool has_warnings = false;
+    for (const auto& comp_result : result.component_results) {
+        if (comp_result.status == environment::InstallationStatus::kFailed) {
+            has_failures = true;
+            break;
+        } else if (comp_result.status ==
+                   environment::InstallationStatus::kWarning) {
+            has_warnings = true;
+        }
+    }
+
+    if (result.reboot_required) {
+        return 2;  // Reboot required
+    }
+    if (has_failures) {
+        return 1;
+    }
+    return has_warnings ? 3 : 0;  // 3: warnings only
+}
+
+void CheckCommand::PrintJsonReport(
+    const parallax::environment::EnvironmentResult& result, int exit_code,
+    uint64_t duration_ms) {
+    using parallax::utils::EscapeJsonString;
+
+    static const char* const kOverallStatus[] = {"ok", "failed",
+                                                 "reboot_required", "warning"};
+    int process_exit_code = 0;
+    switch (exit_code) {
+        case 1:
+            process_exit_code = static_cast<int>(CommandResult::EnvironmentError);
+            break;
+        case 2:
+            process_exit_code = static_cast<int>(CommandResult::RebootRequired);
+            break;
+        case 3:
+            process_exit_code = static_cast<int>(CommandResult::Warning);
+            break;
+    }
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"schema_version\": 1,\n";
+    json << "  \"command\": \"check\",\n";
+    json << "  \"timestamp\": \"" << CurrentTimestampUtc() << "\",\n";
+    json << "  \"status\": \"" << kOverallStatus[exit_code] << "\",\n";
+    json << "  \"exit_code\": " << process_exit_code << ",\n";
+    json << "  \"reboot_required\": "
+         << (result.reboot_required ? "true" : "false") << ",\n";
+    json << "  \"message\": \"" << EscapeJsonString(result.overall_message)
+         << "\",\n";
+    json << "  \"duration_ms\": " << duration_ms << ",\n";
+    json << "  \"components\": [";
+
+    for (size_t i = 0; i < result.component_results.size(); ++i) {
+        const auto& comp_result = result.component_results[i];
+        json << (i == 0 ? "\n" : ",\n");
+        json << "    {\"key\": \""
+             << environment::ComponentToKey(comp_result.component)
+             << "\", \"name\": \""
+             << EscapeJsonString(
+                    environment::ComponentToString(comp_result.component))
+             << "\", \"status\": \""
+             << environment::StatusToString(comp_result.status)
+             << "\", \"message\": \"" << EscapeJsonString(comp_result.message)
+             << "\", \"duration_ms\": " << comp_result.duration_ms
+             << ", \"probe\": {\"category\": \""
+             << environment::ComponentFactory::GetComponentCategory(
+                    comp_result.component)
+             << "\", \"error_code\": " << comp_result.error_code << "}}";
+    }
+    json << (result.component_results.empty() ? "]\n" : "\n  ]\n");
+    json << "}\n";
+
+    std::cout << json.str() << std::flush;
+}
+
 void CheckCommand::DisplayResults(
     const parallax::environment::EnvironmentResult& result) {
     std::cout << "\nEnvironment Check Summary:\n";
@@ -1,12 +1,9 @@
 #pragma once
 
 #include "base_command.h"
+#include "environment/environment_installer.h"
 
 namespace parallax {
-namespace environment {
-struct EnvironmentResult;
-}
-
 namespace commands {
 
 // parallax check command implementation - using new architecture
@@ -20,6 +17,7 @@ class CheckCommand : public AdminCommand<CheckCommand> {
         return "Check Parallax environment requirements";
     }
 
+    EnvironmentRequirements GetEnvironmentRequirements();
     CommandResult ValidateArgsImpl(CommandContext& context);
     CommandResult ExecuteImpl(const CommandContext& context);
     void ShowHelpImpl();
@@ -30,6 +28,19 @@ class CheckCommand : public AdminCommand<CheckCommand> {
 
     // Display check results
     void DisplayResults(const parallax::environment::EnvironmentResult& result);
+
+    // 0 passed, 1 failures, 2 reboot required, 3 warnings only
+    int ClassifyResult(const parallax::environment::EnvironmentResult& result);
+
+    // Machine-readable report for --json
+    void PrintJsonReport(const parallax::environment::EnvironmentResult& result,
+                         int exit_code, uint64_t duration_ms);
+
+    // Components chosen with --only/--skip/--from (empty means all)
+    parallax::environment::ComponentSelection selection_;
+
+    bool ci_mode_ = false;      // --ci or --json: no pacing, distinct exit codes
+    bool json_output_ = false;  // --json
 };
 
 }  // namespace commands
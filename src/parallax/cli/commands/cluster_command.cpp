@@ -0,0 +1,359 @@
+#include "cluster_command.h"
+#include "utils/cpu_partition.h"
+#include "utils/prakasa_sessions.h"
+#include "utils/serving_profile.h"
+#include "utils/weight_residency.h"
+#include "utils/wsl_process.h"
+#include "utils/utils.h"
+#include "environment/mirror_selector.h"
+#include "config/config_manager.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <map>
+#include <set>
+
+namespace parallax {
+namespace commands {
+
+namespace {
+
+int GetDrainTimeout() {
+    return parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+        parallax::config::KEY_SHUTDOWN_DRAIN_TIMEOUT, 30);
+}
+
+std::string DescribeNodeState(const parallax::utils::ClusterNodeStatus& node) {
+    if (node.exited) {
+        return "exited with code " + std::to_string(node.exit_code);
+    }
+    if (node.ready_seconds >= 0) {
+        return "ready in " + std::to_string(node.ready_seconds) + "s";
+    }
+    return node.started ? "starting" : "waiting for the scheduler";
+}
+
+}  // namespace
+
+CommandResult ClusterCommand::ValidateArgsImpl(CommandContext& context) {
+    if (context.args.empty()) {
+        this->ShowError("No cluster action specified");
+        this->ShowError(
+            "Usage: prakasa cluster <up [manifest] [--reclaim]|down|status>");
+        return CommandResult::InvalidArgs;
+    }
+
+    action_ = context.args[0];
+    if (action_ != "up" && action_ != "down" && action_ != "status") {
+        this->ShowError("Unknown cluster action: " + action_);
+        this->ShowError(
+            "Usage: prakasa cluster <up [manifest] [--reclaim]|down|status>");
+        return CommandResult::InvalidArgs;
+    }
+
+    bool has_manifest = false;
+    for (size_t i = 1; i < context.args.size(); ++i) {
+        const std::string& arg = context.args[i];
+        if (action_ == "up" && arg == "--reclaim") {
+            reclaim_stale_ = true;
+        } else if (action_ == "up" && !has_manifest && arg[0] != '-') {
+            manifest_path_ = arg;
+            has_manifest = true;
+        } else {
+            this->ShowError("Unknown option: " + arg);
+            return CommandResult::InvalidArgs;
+        }
+    }
+    return CommandResult::Success;
+}
+
+CommandResult ClusterCommand::ExecuteImpl(const CommandContext& context) {
+    if (action_ == "up") {
+        return Up(context);
+    }
+    if (action_ == "down") {
+        return Down(context);
+    }
+    return Status(context);
+}
+
+std::string ClusterCommand::BuildNodeCommand(
+    const CommandContext& context, const parallax::utils::ClusterNode& node) {
+    std::vector<std::string> args = parallax::utils::SplitArguments(node.args);
+    std::string command = node.scheduler ? "prakasa run" : "prakasa join";
+    bool has_scheduler = false;
+    for (const auto& arg : args) {
+        command += " " + this->EscapeForShell(arg);
+        has_scheduler = has_scheduler || arg == "-s" ||
+                        arg.compare(0, 11, "--scheduler") == 0;
+    }
+    if (!node.scheduler && !has_scheduler) {
+        // Filled in by the supervisor once the scheduler printed it
+        std::string variable = parallax::utils::kClusterSchedulerVariable;
+        command += " \\${" + variable + ":+-s \\$" + variable + "}";
+    }
+
+    std::string staging_message;
+    command = parallax::utils::StageModelWeights(
+        context.ubuntu_version, args, command, staging_message);
+    if (!staging_message.empty()) {
+        this->ShowInfo(node.name + ": " + staging_message);
+    }
+
+    if (!node.env.empty()) {
+        std::string env = "env";
+        for (const auto& assignment : node.env) {
+            env += " " + assignment;
+        }
+        command = env + " " + command;
+    }
+    return command;
+}
+
+CommandResult ClusterCommand::Up(const CommandContext& context) {
+    parallax::utils::ClusterManifest manifest;
+    std::string error;
+    if (!parallax::utils::ClusterManifest::Load(manifest_path_, manifest,
+                                                error)) {
+        this->ShowError("Invalid cluster manifest: " + error);
+        return CommandResult::InvalidArgs;
+    }
+    const std::string& distro = context.ubuntu_version;
+    int drain_timeout = GetDrainTimeout();
+
+    // Servers already in the distro compete for the GPU and ports
+    parallax::utils::PrakasaSessionProbe probe =
+        parallax::utils::ProbePrakasaSessions(distro);
+    std::vector<parallax::utils::PrakasaServerInfo> stale;
+    for (const auto& server : probe.servers) {
+        if (server.IsStale()) {
+            stale.push_back(server);
+        }
+    }
+    if (!stale.empty() && reclaim_stale_) {
+        this->ShowInfo("Stopping " + std::to_string(stale.size()) +
+                       " stale server(s)...");
+        if (!parallax::utils::ReclaimPrakasaServers(distro, stale,
+                                                    drain_timeout)) {
+            this->ShowWarning("Some stale servers could not be stopped.");
+        }
+    } else if (!stale.empty()) {
+        this->ShowWarning(std::to_string(stale.size()) +
+                          " stale server(s) may hold GPU memory and ports. "
+                          "Use --reclaim to stop them.");
+    }
+    if (probe.servers.size() > stale.size()) {
+        this->ShowWarning(std::to_string(probe.servers.size() - stale.size()) +
+                          " prakasa server(s) of running sessions keep "
+                          "running next to the cluster.");
+    }
+
+    // Every node gets its own cores unless cpu_partition is off
+    std::string partition =
+        parallax::config::ConfigManager::GetInstance().GetConfigValue(
+            parallax::config::KEY_CPU_PARTITION);
+    std::transform(partition.begin(), partition.end(), partition.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    std::vector<parallax::utils::CpuSlot> slots;
+    if (partition != "off" && manifest.nodes.size() > 1) {
+        std::vector<parallax::utils::CpuCore> cores =
+            parallax::utils::ProbeCpuTopology(distro);
+        if (!cores.empty()) {
+            slots = parallax::utils::PlanCpuSlots(
+                cores, static_cast<int>(manifest.nodes.size()));
+        }
+    }
+
+    std::string hf_endpoint = parallax::environment::SelectHuggingFaceEndpoint(
+        distro, context.proxy_url);
+    std::vector<parallax::utils::ClusterLaunchNode> launch_nodes;
+    for (size_t i = 0; i < manifest.nodes.size(); ++i) {
+        const parallax::utils::ClusterNode& node = manifest.nodes[i];
+        parallax::utils::ClusterLaunchNode launch_node;
+        launch_node.name = node.name;
+        launch_node.scheduler = node.scheduler;
+        launch_node.ready = node.ready;
+        launch_node.pid_file = parallax::utils::BuildWSLPidFilePath(node.name);
+
+        std::string command = BuildNodeCommand(context, node);
+        if (!slots.empty()) {
+            command = parallax::utils::BuildCpuSlotCommand(slots[i], command);
+            info_log("[CLUSTER] Node %s gets CPUs %s", node.name.c_str(),
+                     parallax::utils::FormatCpuList(slots[i].cpus).c_str());
+        }
+        launch_node.launch_command = parallax::utils::BuildServerLaunchCommand(
+            command, launch_node.pid_file, context.proxy_url, hf_endpoint,
+            false);
+        launch_nodes.push_back(launch_node);
+    }
+
+    unsigned long session = GetCurrentProcessId();
+    std::string script_path = parallax::utils::InstallClusterSupervisorScript(
+        distro, session,
+        parallax::utils::BuildClusterSupervisorScript(
+            session, launch_nodes, manifest.ready_timeout_seconds,
+            drain_timeout));
+    if (script_path.empty()) {
+        this->ShowError("Failed to write the cluster supervisor script.");
+        return CommandResult::ExecutionError;
+    }
+
+    this->ShowInfo("Starting " + std::to_string(launch_nodes.size()) +
+                   " node(s) from " + manifest_path_ +
+                   ", press Ctrl+C to stop them all.");
+    parallax::utils::ServingProfileSession profile("cluster");
+    WSLProcess wsl_process;
+    wsl_process.EnableGracefulStop(
+        distro, parallax::utils::GetClusterSupervisorPidFile(session),
+        drain_timeout);
+    int exit_code =
+        wsl_process.Execute(this->BuildWSLCommand(context, "bash " + script_path));
+    if (exit_code != 0) {
+        this->ShowError("Cluster stopped with exit code: " +
+                        std::to_string(exit_code));
+        return CommandResult::ExecutionError;
+    }
+    return CommandResult::Success;
+}
+
+CommandResult ClusterCommand::Down(const CommandContext& context) {
+    const std::string& distro = context.ubuntu_version;
+    int drain_timeout = GetDrainTimeout();
+    std::vector<parallax::utils::ClusterStatus> clusters =
+        parallax::utils::ProbeClusters(distro);
+
+    size_t supervisors = 0;
+    std::set<std::string> node_pid_files;
+    for (const auto& cluster : clusters) {
+        supervisors += cluster.running ? 1 : 0;
+        for (const auto& node : cluster.nodes) {
+            node_pid_files.insert(node.pid_file);
+        }
+    }
+    bool ok = true;
+    if (supervisors > 0) {
+        this->ShowInfo("Stopping " + std::to_string(supervisors) +
+                       " cluster(s), draining for up to " +
+                       std::to_string(drain_timeout) + "s...");
+        ok = parallax::utils::StopClusterSupervisors(distro, clusters,
+                                                     drain_timeout);
+    }
+
+    // Nodes whose supervisor was killed before it could stop them
+    std::vector<parallax::utils::PrakasaServerInfo> leftovers;
+    for (const auto& server :
+         parallax::utils::ProbePrakasaSessions(distro).servers) {
+        if (node_pid_files.count(server.pid_file)) {
+            leftovers.push_back(server);
+        }
+    }
+    if (!leftovers.empty()) {
+        this->ShowInfo("Stopping " + std::to_string(leftovers.size()) +
+                       " cluster node(s) left running...");
+        ok = parallax::utils::ReclaimPrakasaServers(distro, leftovers,
+                                                    drain_timeout) &&
+             ok;
+    }
+
+    if (supervisors == 0 && leftovers.empty()) {
+        this->ShowInfo("No local cluster is running.");
+        return CommandResult::Success;
+    }
+    if (!ok) {
+        this->ShowError("Some cluster nodes could not be stopped.");
+        return CommandResult::ExecutionError;
+    }
+    this->ShowInfo("Local cluster stopped.");
+    return CommandResult::Success;
+}
+
+CommandResult ClusterCommand::Status(const CommandContext& context) {
+    std::vector<parallax::utils::ClusterStatus> clusters =
+        parallax::utils::ProbeClusters(context.ubuntu_version);
+    if (clusters.empty()) {
+        this->ShowInfo("No local cluster has been started.");
+        return CommandResult::Success;
+    }
+
+    std::map<std::string, parallax::utils::PrakasaServerInfo> servers;
+    for (const auto& server :
+         parallax::utils::ProbePrakasaSessions(context.ubuntu_version)
+             .servers) {
+        if (!server.pid_file.empty()) {
+            servers[server.pid_file] = server;
+        }
+    }
+
+    for (const auto& cluster : clusters) {
+        std::cout << "Cluster of session " << cluster.session << ": "
+                  << (cluster.running ? "running" : "stopped") << ", started "
+                  << cluster.up_seconds << "s ago" << std::endl;
+        if (!cluster.scheduler_address.empty()) {
+            std::cout << "  Scheduler address: " << cluster.scheduler_address
+                      << std::endl;
+        }
+        size_t width = 0;
+        for (const auto& node : cluster.nodes) {
+            width = (std::max)(width, node.name.size());
+        }
+        for (const auto& node : cluster.nodes) {
+            std::cout << "  " << node.name
+                      << std::string(width - node.name.size() + 2, ' ')
+                      << DescribeNodeState(node);
+            auto server = servers.find(node.pid_file);
+            if (server != servers.end()) {
+                std::cout << ", "
+                          << parallax::utils::DescribePrakasaServer(
+                                 server->second);
+            } else if (cluster.running && !node.exited && node.started) {
+                std::cout << ", process not found";
+            }
+            std::cout << std::endl;
+        }
+    }
+    return CommandResult::Success;
+}
+
+void ClusterCommand::ShowHelpImpl() {
+    std::cout << "Usage: prakasa cluster <up [manifest] [--reclaim]|down|"
+                 "status>\n\n";
+    std::cout << "Run a whole prakasa topology, one scheduler and any number "
+                 "of workers, on this\n";
+    std::cout << "machine. The workers get the scheduler's address, the node "
+                 "logs are shown\n";
+    std::cout << "with a prefix per node and the time each node takes to get "
+                 "ready is reported.\n\n";
+    std::cout << "Actions:\n";
+    std::cout << "  up [manifest]        Start the nodes of the manifest "
+                 "(default cluster.ini)\n";
+    std::cout << "                       and follow them until Ctrl+C\n";
+    std::cout << "  down                 Drain and stop the running clusters\n";
+    std::cout << "  status               Show the nodes, their readiness and "
+                 "GPU memory\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --reclaim            Stop prakasa servers left by earlier "
+                 "sessions first\n";
+    std::cout << "  --help, -h           Show this help message\n\n";
+    std::cout << "Manifest:\n";
+    std::cout << "  [cluster]\n";
+    std::cout << "  ready_timeout = 900            # Seconds before a node is "
+                 "reported late\n";
+    std::cout << "  [scheduler]\n";
+    std::cout << "  args = -m Qwen/Qwen3-0.6B -n 2 # prakasa run arguments\n";
+    std::cout << "  [worker.w1]\n";
+    std::cout << "  env = CUDA_VISIBLE_DEVICES=0   # Set for this node only\n";
+    std::cout << "  [worker.w2]\n";
+    std::cout << "  args = --max-batch-size 8      # prakasa join arguments, "
+                 "-s is added\n";
+    std::cout << "  ready = Layer allocation done  # Log line (regex) "
+                 "marking it ready\n\n";
+    std::cout << "Examples:\n";
+    std::cout << "  prakasa cluster up pp2.ini\n";
+    std::cout << "  prakasa cluster status\n";
+    std::cout << "  prakasa cluster down\n";
+}
+
+}  // namespace commands
+}  // namespace parallax
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "base_command.h"
+#include "utils/local_cluster.h"
+#include <string>
+
+namespace parallax {
+namespace commands {
+
+// Cluster command - starts, stops and shows a scheduler and its workers
+// described by a manifest, all on this machine
+class ClusterCommand : public WSLCommand<ClusterCommand> {
+ public:
+    std::string GetName() const override { return "cluster"; }
+    std::string GetDescription() const override {
+        return "Run a local scheduler and workers from a manifest";
+    }
+
+    CommandResult ValidateArgsImpl(CommandContext& context);
+    CommandResult ExecuteImpl(const CommandContext& context);
+    void ShowHelpImpl();
+
+ private:
+    std::string action_;
+    std::string manifest_path_ = "cluster.ini";
+    bool reclaim_stale_ = false;
+
+    CommandResult Up(const CommandContext& context);
+    CommandResult Down(const CommandContext& context);
+    CommandResult Status(const CommandContext& context);
+    std::string BuildNodeCommand(const CommandContext& context,
+                                 const parallax::utils::ClusterNode& node);
+};
+
+}  // namespace commands
+}  // namespace parallax
@@ -0,0 +1,125 @@
+#include "doctor_command.h"
+#include "environment/perf_probes.h"
+#include "tinylog/tinylog.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace parallax {
+namespace commands {
+
+namespace {
+
+std::string FormatMeasurement(double value, const std::string& unit) {
+    char text[64];
+    std::snprintf(text, sizeof(text), value >= 100 ? "%.0f %s" : "%.2f %s",
+                  value, unit.c_str());
+    return text;
+}
+
+std::string FormatMeasured(const environment::PerfProbeResult& result) {
+    if (result.skipped) {
+        return "-";
+    }
+    // Settings checks have no unit; their detail names the setting
+    return result.unit.empty() ? result.detail
+                               : FormatMeasurement(result.value, result.unit);
+}
+
+std::string FormatExpected(const environment::PerfProbeResult& result) {
+    if (result.unit.empty()) {
+        return "High performance";
+    }
+    return (result.lower_is_better ? "<= " : ">= ") +
+           FormatMeasurement(result.expected, result.unit);
+}
+
+std::string FormatStatus(const environment::PerfProbeResult& result) {
+    if (result.skipped) {
+        return "skipped: " + result.detail;
+    }
+    double score = result.Score();
+    return score >= 1 ? "OK" : score >= 0.5 ? "below expected" : "severe";
+}
+
+}  // namespace
+
+CommandResult DoctorCommand::ValidateArgsImpl(CommandContext& context) {
+    if (context.args.empty()) {
+        this->ShowError("No diagnostics selected");
+        this->ShowError("Usage: prakasa doctor --perf");
+        return CommandResult::InvalidArgs;
+    }
+    for (const auto& arg : context.args) {
+        if (arg != "--perf") {
+            this->ShowError("Unknown option: " + arg);
+            this->ShowError("Usage: prakasa doctor --perf");
+            return CommandResult::InvalidArgs;
+        }
+    }
+    return CommandResult::Success;
+}
+
+CommandResult DoctorCommand::ExecuteImpl(const CommandContext& context) {
+    std::cout << "Running performance probes against "
+              << context.ubuntu_version << ", about 30 seconds..."
+              << std::endl;
+    std::vector<environment::PerfProbeResult> results =
+        environment::RunPerfProbes(context.ubuntu_version);
+
+    std::printf("\n%-26s %-18s %-20s %s\n", "Probe", "Measured", "Expected",
+                "Status");
+    for (const auto& result : results) {
+        std::printf("%-26s %-18s %-20s %s\n", result.name.c_str(),
+                    FormatMeasured(result).c_str(),
+                    FormatExpected(result).c_str(),
+                    FormatStatus(result).c_str());
+    }
+
+    std::vector<const environment::PerfProbeResult*> bottlenecks;
+    for (const auto& result : results) {
+        if (result.Score() < 1) {
+            bottlenecks.push_back(&result);
+        }
+    }
+    std::sort(bottlenecks.begin(), bottlenecks.end(),
+              [](const environment::PerfProbeResult* a,
+                 const environment::PerfProbeResult* b) {
+                  return a->Score() < b->Score();
+              });
+
+    std::cout << std::endl;
+    if (bottlenecks.empty()) {
+        this->ShowInfo("No bottlenecks found, every probe met its expectation");
+        return CommandResult::Success;
+    }
+    std::cout << "Bottlenecks, worst first:" << std::endl;
+    for (size_t i = 0; i < bottlenecks.size(); ++i) {
+        const auto& result = *bottlenecks[i];
+        std::printf("  %zu. %s: %s, %.0f%% of expected (%s)\n", i + 1,
+                    result.name.c_str(), FormatMeasured(result).c_str(),
+                    result.Score() * 100, result.detail.c_str());
+        std::printf("     %s\n", result.hint.c_str());
+    }
+    return CommandResult::Success;
+}
+
+void DoctorCommand::ShowHelpImpl() {
+    std::cout << "Usage: prakasa doctor --perf\n\n";
+    std::cout << "Run short benchmarks of the paths a node depends on and "
+                 "rank the bottlenecks\n";
+    std::cout << "against what the detected hardware should reach:\n";
+    std::cout << "  - guest ext4 and /mnt/c (9P) read throughput\n";
+    std::cout << "  - GPU host<->device copy bandwidth (needs the Prakasa "
+                 "venv and a GPU)\n";
+    std::cout << "  - RAM copy bandwidth, wsl.exe start latency\n";
+    std::cout << "  - loopback and NAT gateway latency, guest memory cap, "
+                 "power plan\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --perf               Run the performance probes\n";
+    std::cout << "  --help, -h           Show this help message\n\n";
+    std::cout << "Results are also written to the log.\n";
+}
+
+}  // namespace commands
+}  // namespace parallax
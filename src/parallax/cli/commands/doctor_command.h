@@ -0,0 +1,23 @@
+#pragma once
+
+#include "base_command.h"
+#include <string>
+
+namespace parallax {
+namespace commands {
+
+// Doctor command - diagnoses why a node underperforms
+class DoctorCommand : public WSLCommand<DoctorCommand> {
+ public:
+    std::string GetName() const override { return "doctor"; }
+    std::string GetDescription() const override {
+        return "Diagnose performance bottlenecks of this node";
+    }
+
+    CommandResult ValidateArgsImpl(CommandContext& context);
+    CommandResult ExecuteImpl(const CommandContext& context);
+    void ShowHelpImpl();
+};
+
+}  // namespace commands
+}  // namespace parallax
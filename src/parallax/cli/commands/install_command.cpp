@@ -11,13 +11,24 @@ InstallCommand::InstallCommand() = default;
 InstallCommand::~InstallCommand() = default;
 
 CommandResult InstallCommand::ValidateArgsImpl(CommandContext& context) {
-    // install command does not accept additional parameters
-    for (const auto& arg : context.args) {
+    // Component selectors limit the run to the chosen components and their
+    // unmet prerequisites
+    std::vector<std::string> remaining_args;
+    std::string error;
+    if (!environment::ParseComponentSelection(context.args, selection_,
+                                              remaining_args, error)) {
+        this->ShowError(error);
+        this->ShowError("Valid components: " +
+                        environment::GetComponentKeyList());
+        return CommandResult::InvalidArgs;
+    }
+
+    for (const auto& arg : remaining_args) {
         if (arg != "--help" && arg != "-h") {
             this->ShowError("Unknown parameter: " + arg);
             this->ShowError(
-                "The 'install' command does not accept additional parameters.");
-            this->ShowError("Usage: parallax install [--help|-h]");
+                "Usage: parallax install [--only <list>] [--skip <list>] "
+                "[--from <component>] [--help|-h]");
             return CommandResult::InvalidArgs;
         }
     }
@@ -30,17 +41,31 @@ CommandResult InstallCommand::ExecuteImpl(const CommandContext& context) {
 
     // Administrator privileges already checked by base class
     this->ShowInfo("Running with Administrator privileges OK");
-    this->ShowInfo(
-        "This will install and configure the required components for "
-        "Parallax:");
-    std::cout << "1. System requirements (OS version, NVIDIA GPU & driver)\n";
-    std::cout << "2. Windows Subsystem for Linux 2 (WSL2) and Virtual Machine "
-                 "Platform\n";
-    std::cout << "3. WSL package, kernel and Ubuntu distribution\n";
-    std::cout << "4. CUDA Toolkit 12.8\n";
-    std::cout << "5. Development tools (Rust Cargo, Ninja build system)\n";
-    std::cout << "6. Python pip upgrade\n";
-    std::cout << "7. Parallax distributed inference framework\n\n";
+    if (selection_.IsEmpty()) {
+        this->ShowInfo(
+            "This will install and configure the required components for "
+            "Parallax:");
+        std::cout
+            << "1. System requirements (OS version, NVIDIA GPU & driver)\n";
+        std::cout << "2. Windows Subsystem for Linux 2 (WSL2) and Virtual "
+                     "Machine Platform\n";
+        std::cout << "3. WSL package, kernel and Ubuntu distribution\n";
+        std::cout << "4. CUDA Toolkit 12.8\n";
+        std::cout << "5. Development tools (Rust Cargo, Ninja build system)\n";
+        std::cout << "6. Python pip upgrade\n";
+        std::cout << "7. Parallax distributed inference framework\n\n";
+    } else {
+        this->ShowInfo(
+            "This will install the selected components and any unmet "
+            "prerequisites:");
+        for (auto component :
+             environment::ComponentFactory::ResolveSelection(selection_)) {
+            std::cout << "  - " << environment::ComponentToString(component)
+                      << " (" << environment::ComponentToKey(component)
+                      << ")\n";
+        }
+        std::cout << "\n";
+    }
 
     this->ShowWarning("System reboot may be required during the process.");
 
@@ -76,13 +101,23 @@ void InstallCommand::ShowHelpImpl() {
     std::cout << "  - Internet connection\n";
     std::cout << "  - At least 4GB free disk space\n\n";
     std::cout << "Options:\n";
+    std::cout << "  --only <list>   Install only these components "
+                 "(comma separated)\n";
+    std::cout << "                  plus their unmet prerequisites\n";
+    std::cout << "  --skip <list>   Do not run these components\n";
+    std::cout << "  --from <name>   Start at this component in install order\n";
     std::cout << "  --help, -h      Show this help message\n\n";
+    std::cout << "Components:\n";
+    std::cout << "  " << environment::GetComponentKeyList() << "\n\n";
     std::cout << "Exit codes:\n";
     std::cout << "  0    Installation completed successfully\n";
     std::cout << "  1    Invalid arguments\n";
     std::cout << "  3    Installation failed\n\n";
     std::cout << "Examples:\n";
     std::cout << "  parallax install           Install all components\n";
+    std::cout << "  parallax install --only prakasa\n";
+    std::cout << "                             Refresh the prakasa project "
+                 "only\n";
     std::cout << "  parallax install --help    Show this help message\n\n";
     std::cout << "Note: This process may require multiple reboots and can take "
                  "15-30 minutes.\n";
@@ -91,7 +126,7 @@ void InstallCommand::ShowHelpImpl() {
 int InstallCommand::InstallAllComponents() {
     environment::EnvironmentInstaller installer;
 
-    auto result = installer.InstallEnvironment(ProgressCallback);
+    auto result = installer.InstallEnvironment(ProgressCallback, selection_);
 
     DisplayResults(result);
 
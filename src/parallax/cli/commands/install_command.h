@@ -1,12 +1,9 @@
 #pragma once
 
 #include "base_command.h"
+#include "environment/environment_installer.h"
 
 namespace parallax {
-namespace environment {
-struct EnvironmentResult;
-}
-
 namespace commands {
 
 // parallax install command implementation - using new architecture
@@ -35,6 +32,9 @@ class InstallCommand : public AdminCommand<InstallCommand> {
     static void ProgressCallback(const std::string& step,
                                  const std::string& message,
                                  int progress_percent);
+
+    // Components chosen with --only/--skip/--from (empty means all)
+    parallax::environment::ComponentSelection selection_;
 };
 
 }  // namespace commands
@@ -1,43 +1,57 @@
 #include "model_commands.h"
 #include "utils/wsl_process.h"
+#include "utils/serving_profile.h"
+#include "utils/slo_watchdog.h"
 #include "utils/utils.h"
 #include "tinylog/tinylog.h"
+#include "config/config_manager.h"
 #include <sstream>
 
 namespace parallax
 {
     namespace commands
     {
-
-        // ModelRunCommand implementation (WSL version)
-        bool ModelRunCommand::CheckLaunchScriptExists(const CommandContext &context)
+        namespace
         {
-            std::string check_cmd = "test -f ~/prakasa/src/prakasa/launch.py";
-            std::string wsl_command = BuildWSLCommand(context, check_cmd);
+            // Run a prakasa server command with real-time output. Ctrl+C is
+            // turned into SIGINT/SIGTERM for the process recorded in pid_file
+            // so the server can release the GPU before it exits
+            int ExecuteWithGracefulStop(const std::string &ubuntu_version,
+                                        const std::string &wsl_command,
+                                        const std::string &pid_file)
+            {
+                int drain_timeout = parallax::config::ConfigManager::GetInstance()
+                                        .GetConfigIntValue(parallax::config::KEY_SHUTDOWN_DRAIN_TIMEOUT, 30);
 
-            std::string stdout_output, stderr_output;
-            int exit_code = parallax::utils::ExecCommandEx(
-                wsl_command, 30, stdout_output, stderr_output, false, true);
+                WSLProcess wsl_process;
+                wsl_process.EnableGracefulStop(ubuntu_version, pid_file, drain_timeout);
+                return wsl_process.Execute(wsl_command);
+            }
 
-            return exit_code == 0;
-        }
+            // Same as ExecuteWithGracefulStop, under the serving profile for
+            // as long as the server runs and under the throughput SLO watchdog
+            int ExecuteServer(const std::string &launcher,
+                              const std::string &ubuntu_version,
+                              const std::string &wsl_command,
+                              const std::string &pid_file)
+            {
+                parallax::utils::ServingProfileSession profile(launcher);
+                return parallax::utils::RunUnderSloWatchdog(
+                    ubuntu_version, launcher, pid_file, true, [&]()
+                    { return ExecuteWithGracefulStop(ubuntu_version, wsl_command, pid_file); });
+            }
+        } // namespace
 
-        bool ModelRunCommand::IsParallaxProcessRunning(const CommandContext &context)
+        // ModelRunCommand implementation (WSL version)
+        bool ModelRunCommand::CheckLaunchScriptExists(const CommandContext &context)
         {
-            // Use pgrep to find processes, matching python/python3 and
-            // prakasa/launch.py
-            std::string check_cmd = "pgrep -f 'python[0-9]*.*prakasa/launch.py'";
+            std::string check_cmd = "test -f ~/prakasa/src/prakasa/launch.py";
             std::string wsl_command = BuildWSLCommand(context, check_cmd);
 
             std::string stdout_output, stderr_output;
             int exit_code = parallax::utils::ExecCommandEx(
                 wsl_command, 30, stdout_output, stderr_output, false, true);
 
-            // pgrep returns 0 if matching process is found, returns 1 if not found
-            if (exit_code == 0)
-            {
-                info_log("Parallax process found: %s", stdout_output.c_str());
-            }
             return exit_code == 0;
         }
 
@@ -47,26 +61,14 @@ namespace parallax
             std::string run_command = BuildRunCommand(context);
 
             // Build complete WSL command with venv activation and CUDA environment
-            std::string full_command = BuildVenvActivationCommand(context);
-
-            // If proxy is configured, add proxy environment variables
-            if (!context.proxy_url.empty())
-            {
-                full_command += " && HTTP_PROXY='" + context.proxy_url +
-                                "' HTTPS_PROXY='" + context.proxy_url + "' " +
-                                run_command;
-            }
-            else
-            {
-                full_command += " && " + run_command;
-            }
-
-            std::string wsl_command = BuildWSLCommand(context, full_command);
+            std::string pid_file = parallax::utils::BuildWSLPidFilePath("run");
+            std::string wsl_command = BuildWSLCommand(
+                context, PrepareServerLaunch(context, "run", run_command, pid_file));
 
             info_log("Executing Parallax launch command: %s", wsl_command.c_str());
 
-            WSLProcess wsl_process;
-            int exit_code = wsl_process.Execute(wsl_command);
+            int exit_code = ExecuteServer("run", context.ubuntu_version,
+                                          wsl_command, pid_file);
 
             return exit_code == 0;
         }
@@ -98,6 +100,9 @@ namespace parallax
                 return CommandResult::Success;
             }
 
+            // Launcher options are consumed here, the rest goes to prakasa join
+            ExtractLaunchFlags(context);
+
             // join command can be executed without parameters (using default
             // scripts/join.sh)
             return CommandResult::Success;
@@ -109,27 +114,15 @@ namespace parallax
             std::string join_command = BuildJoinCommand(context);
 
             // Build complete WSL command with venv activation and CUDA environment
-            std::string full_command = BuildVenvActivationCommand(context);
-
-            // If proxy is configured, add proxy environment variables
-            if (!context.proxy_url.empty())
-            {
-                full_command += " && HTTP_PROXY='" + context.proxy_url +
-                                "' HTTPS_PROXY='" + context.proxy_url + "' " +
-                                join_command;
-            }
-            else
-            {
-                full_command += " && " + join_command;
-            }
-
-            std::string wsl_command = BuildWSLCommand(context, full_command);
+            std::string pid_file = parallax::utils::BuildWSLPidFilePath("join");
+            std::string wsl_command = BuildWSLCommand(
+                context, PrepareServerLaunch(context, "join", join_command, pid_file));
 
             info_log("Executing cluster join command: %s", wsl_command.c_str());
 
             // Use WSLProcess to execute command for real-time output
-            WSLProcess wsl_process;
-            int exit_code = wsl_process.Execute(wsl_command);
+            int exit_code = ExecuteServer("join", context.ubuntu_version,
+                                          wsl_command, pid_file);
 
             if (exit_code == 0)
             {
@@ -157,6 +150,10 @@ namespace parallax
             std::cout << "  args...       Arguments to pass to prakasa join "
                          "(optional)\n\n";
             std::cout << "Options:\n";
+            std::cout << "  --reclaim     Stop prakasa servers left by earlier "
+                         "sessions before joining\n";
+            std::cout << "  --attach      Attach to a healthy node left by an "
+                         "earlier session instead of starting a new one\n";
             std::cout << "  --help, -h    Show this help message\n\n";
             std::cout << "Examples:\n";
             std::cout
@@ -209,27 +206,15 @@ namespace parallax
             std::string chat_command = BuildChatCommand(context);
 
             // Build complete WSL command with venv activation and CUDA environment
-            std::string full_command = BuildVenvActivationCommand(context);
-
-            // If proxy is configured, add proxy environment variables
-            if (!context.proxy_url.empty())
-            {
-                full_command += " && HTTP_PROXY='" + context.proxy_url +
-                                "' HTTPS_PROXY='" + context.proxy_url + "' " +
-                                chat_command;
-            }
-            else
-            {
-                full_command += " && " + chat_command;
-            }
-
-            std::string wsl_command = BuildWSLCommand(context, full_command);
+            std::string pid_file = parallax::utils::BuildWSLPidFilePath("chat");
+            std::string wsl_command = BuildWSLCommand(
+                context, BuildPrakasaLaunchCommand(context, chat_command, pid_file));
 
             info_log("Executing chat interface command: %s", wsl_command.c_str());
 
             // Use WSLProcess to execute command for real-time output
-            WSLProcess wsl_process;
-            int exit_code = wsl_process.Execute(wsl_command);
+            int exit_code = ExecuteWithGracefulStop(context.ubuntu_version,
+                                                    wsl_command, pid_file);
 
             if (exit_code == 0)
             {
@@ -30,6 +30,9 @@ class ModelRunCommand : public WSLCommand<ModelRunCommand> {
             return CommandResult::Success;
         }
 
+        // Launcher options are consumed here, the rest goes to prakasa run
+        this->ExtractLaunchFlags(context);
+
         // run command can be executed with any user-provided parameters
         return CommandResult::Success;
     }
@@ -46,14 +49,6 @@ class ModelRunCommand : public WSLCommand<ModelRunCommand> {
         //     return CommandResult::ExecutionError;
         // }
 
-        // Check if there are already running processes
-        // if (IsParallaxProcessRunning(context)) {
-        //     this->ShowError(
-        //         "Parallax server is already running. Use 'parallax stop' to "
-        //         "stop it first.");
-        //     return CommandResult::ExecutionError;
-        // }
-
         // Start Parallax server
         this->ShowInfo("Starting Parallax inference server...");
         this->ShowInfo("Server will be accessible at http://localhost:3000");
@@ -81,6 +76,10 @@ class ModelRunCommand : public WSLCommand<ModelRunCommand> {
         std::cout << "  args...       Arguments to pass to prakasa run "
                      "(optional)\n\n";
         std::cout << "Options:\n";
+        std::cout << "  --reclaim     Stop prakasa servers left by earlier "
+                     "sessions before starting\n";
+        std::cout << "  --attach      Attach to a healthy server left by an "
+                     "earlier session instead of starting a new one\n";
         std::cout << "  --help, -h    Show this help message\n\n";
         std::cout << "Examples:\n";
         std::cout
@@ -94,11 +93,14 @@ class ModelRunCommand : public WSLCommand<ModelRunCommand> {
         std::cout << "Note: All arguments will be passed to the built-in "
                      "prakasa run script\n";
         std::cout << "      in the Parallax Python virtual environment.\n";
+        std::cout << "      Ctrl+C asks the server to shut down and waits up to "
+                     "shutdown_drain_timeout\n";
+        std::cout << "      seconds before killing it; press Ctrl+C twice to "
+                     "force.\n";
     }
 
  private:
     bool CheckLaunchScriptExists(const CommandContext& context);
-    bool IsParallaxProcessRunning(const CommandContext& context);
     bool RunParallaxScript(const CommandContext& context);
     std::string BuildRunCommand(const CommandContext& context);
 };
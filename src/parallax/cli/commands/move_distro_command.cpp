@@ -0,0 +1,354 @@
+#include "move_distro_command.h"
+#include "environment/disk_footprint.h"
+#include "utils/prakasa_sessions.h"
+#include "utils/session_broker.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace parallax {
+namespace commands {
+
+namespace {
+
+// Room left on the target beyond the vhdx itself
+const uint64_t kMoveMarginBytes = 5ULL << 30;
+// Copying a large vhdx to a slow drive takes a while
+const int kMoveTimeoutSeconds = 3600;
+
+int RunPowerShell(const std::string& command, int timeout_seconds,
+                  std::string& output) {
+    std::string stdout_output, stderr_output;
+    int exit_code = parallax::utils::ExecCommandEx(
+        "powershell.exe -Command \"" + command + "\"", timeout_seconds,
+        stdout_output, stderr_output);
+    output = parallax::utils::TrimNewlines(stdout_output + stderr_output);
+    return exit_code;
+}
+
+bool SameVolume(const std::string& a, const std::string& b) {
+    return _stricmp(parallax::utils::GetVolumeRoot(a).c_str(),
+                    parallax::utils::GetVolumeRoot(b).c_str()) == 0;
+}
+
+// Sequential and random reads weigh the same: model loads are sequential,
+// pip installs and imports are small random reads
+double Score(const parallax::utils::VolumeBenchmark& benchmark,
+             double best_sequential, double best_random) {
+    if (!benchmark.ok || best_sequential <= 0 || best_random <= 0) {
+        return 0;
+    }
+    return benchmark.sequential_mib_s / best_sequential +
+           benchmark.random_iops / best_random;
+}
+
+}  // namespace
+
+CommandResult MoveDistroCommand::ValidateArgsImpl(CommandContext& context) {
+    for (size_t i = 0; i < context.args.size(); ++i) {
+        if (context.args[i] == "--to" && i + 1 < context.args.size()) {
+            target_dir_ = context.args[++i];
+        } else if (context.args[i] == "--force") {
+            force_ = true;
+        } else {
+            this->ShowError("Unknown option: " + context.args[i]);
+            this->ShowError(
+                "Usage: prakasa move-distro [--to <dir>] [--force]");
+            return CommandResult::InvalidArgs;
+        }
+    }
+
+    while (target_dir_.size() > 3 &&
+           (target_dir_.back() == '\\' || target_dir_.back() == '/')) {
+        target_dir_.pop_back();
+    }
+    if (!target_dir_.empty() &&
+        (target_dir_.size() < 3 || target_dir_[1] != ':' ||
+         (target_dir_[2] != '\\' && target_dir_[2] != '/'))) {
+        this->ShowError("--to needs an absolute path such as D:\\wsl\\Ubuntu");
+        return CommandResult::InvalidArgs;
+    }
+
+    return CommandResult::Success;
+}
+
+CommandResult MoveDistroCommand::ExecuteImpl(const CommandContext& context) {
+    const std::string& distro = context.ubuntu_version;
+    std::string vhdx_path = environment::LocateDistroVhdx(distro);
+    int64_t vhdx_bytes = vhdx_path.empty()
+                             ? -1
+                             : parallax::utils::GetFileSize(vhdx_path.c_str());
+    if (vhdx_bytes < 0) {
+        this->ShowError("Cannot find the virtual disk of " + distro);
+        return CommandResult::EnvironmentError;
+    }
+    uint64_t needed_bytes =
+        static_cast<uint64_t>(vhdx_bytes) + kMoveMarginBytes;
+    std::string current_dir =
+        vhdx_path.substr(0, vhdx_path.find_last_of('\\'));
+    std::string current_root = parallax::utils::GetVolumeRoot(vhdx_path);
+
+    // The current volume is measured where the vhdx lives, other volumes at
+    // their root or at the requested target
+    std::vector<std::string> directories = {current_dir};
+    if (!target_dir_.empty()) {
+        if (SameVolume(target_dir_, vhdx_path)) {
+            this->ShowError(distro + " is already on " + current_root);
+            return CommandResult::InvalidArgs;
+        }
+        if (!parallax::utils::CreateDirectoryTree(target_dir_)) {
+            this->ShowError("Cannot create " + target_dir_);
+            return CommandResult::ExecutionError;
+        }
+        directories.push_back(target_dir_);
+    } else {
+        for (const auto& root : parallax::utils::ListFixedVolumes()) {
+            if (!SameVolume(root, vhdx_path)) {
+                directories.push_back(root);
+            }
+        }
+    }
+
+    std::cout << "Benchmarking " << directories.size()
+              << " volume(s), about 5 seconds each..." << std::endl;
+    std::vector<parallax::utils::VolumeBenchmark> benchmarks;
+    double best_sequential = 0, best_random = 0;
+    for (const auto& directory : directories) {
+        benchmarks.push_back(parallax::utils::BenchmarkVolume(directory));
+        best_sequential =
+            (std::max)(best_sequential, benchmarks.back().sequential_mib_s);
+        best_random = (std::max)(best_random, benchmarks.back().random_iops);
+    }
+    int recommended = 0;
+    double best_score = Score(benchmarks[0], best_sequential, best_random);
+    for (size_t i = 1; i < benchmarks.size(); ++i) {
+        double score = Score(benchmarks[i], best_sequential, best_random);
+        if (benchmarks[i].free_bytes >= needed_bytes && score > best_score) {
+            best_score = score;
+            recommended = static_cast<int>(i);
+        }
+    }
+    PrintBenchmarks(benchmarks, current_root, needed_bytes, recommended);
+
+    if (target_dir_.empty()) {
+        if (recommended == 0) {
+            this->ShowInfo(distro + " is already on the fastest volume");
+        } else {
+            this->ShowInfo("Recommended: " + benchmarks[recommended].root +
+                           ". Move with: prakasa move-distro --to " +
+                           benchmarks[recommended].root + "wsl\\" + distro);
+        }
+        return CommandResult::Success;
+    }
+
+    const auto& target = benchmarks[1];
+    if (!target.ok) {
+        this->ShowError("Benchmark of " + target_dir_ + " failed: " +
+                        target.error);
+        return CommandResult::ExecutionError;
+    }
+    if (target.free_bytes < needed_bytes) {
+        this->ShowError(target.root + " has " +
+                        environment::FormatBytes(target.free_bytes) +
+                        " free, the move needs " +
+                        environment::FormatBytes(needed_bytes));
+        return CommandResult::ExecutionError;
+    }
+    if (recommended != 1 && !force_) {
+        this->ShowError(target.root + " is not faster than " + current_root +
+                        "; use --force to move anyway");
+        return CommandResult::ExecutionError;
+    }
+    if (GetFileAttributesA(
+            parallax::utils::JoinPath(target_dir_, "ext4.vhdx").c_str()) !=
+        INVALID_FILE_ATTRIBUTES) {
+        this->ShowError(target_dir_ + " already contains an ext4.vhdx");
+        return CommandResult::ExecutionError;
+    }
+
+    // Stopping the distro would take running servers down with it
+    parallax::utils::PrakasaSessionProbe sessions =
+        parallax::utils::ProbePrakasaSessions(distro);
+    if (!sessions.ok || !sessions.servers.empty()) {
+        this->ShowError("Stop the running prakasa servers before moving " +
+                        distro);
+        return CommandResult::ExecutionError;
+    }
+    parallax::utils::StopSessionBroker();
+
+    std::string fingerprint = ReadFingerprint(context);
+    if (fingerprint.empty()) {
+        this->ShowError("Cannot read " + distro + " before the move");
+        return CommandResult::ExecutionError;
+    }
+
+    this->ShowInfo("Moving " + distro + " from " + current_dir + " to " +
+                   target_dir_ + ", this can take several minutes...");
+    std::string error;
+    bool managed = MoveWithManage(context, error);
+    if (!managed) {
+        this->ShowWarning("wsl --manage --move failed (" + error +
+                          "), exporting and importing instead");
+        if (!MoveWithExportImport(context, error)) {
+            this->ShowError(error);
+            return CommandResult::ExecutionError;
+        }
+    }
+
+    std::string moved_path = environment::LocateDistroVhdx(distro);
+    if (!SameVolume(moved_path, target_dir_)) {
+        this->ShowError(distro + " is registered at " + moved_path +
+                        " instead of " + target_dir_);
+        return CommandResult::ExecutionError;
+    }
+    if (ReadFingerprint(context) != fingerprint) {
+        this->ShowError(distro +
+                        " does not match its state before the move; check "
+                        "it with 'prakasa check'");
+        return CommandResult::ExecutionError;
+    }
+
+    // Only a WSL release with --manage --move also takes
+    // wsl --install --location, used when the distro is installed again
+    if (managed) {
+        auto& config = parallax::config::ConfigManager::GetInstance();
+        config.SetConfigValue(parallax::config::KEY_WSL_INSTALL_LOCATION,
+                              target_dir_);
+        if (!config.SaveConfig()) {
+            this->ShowWarning("Failed to save wsl_install_location");
+        }
+    }
+
+    char summary[256];
+    std::snprintf(summary, sizeof(summary),
+                  "Moved %s to %s: %.0f -> %.0f MiB/s sequential, "
+                  "%.0f -> %.0f IOPS random",
+                  distro.c_str(), target_dir_.c_str(),
+                  benchmarks[0].sequential_mib_s, target.sequential_mib_s,
+                  benchmarks[0].random_iops, target.random_iops);
+    info_log("%s", summary);
+    this->ShowInfo(summary);
+    return CommandResult::Success;
+}
+
+void MoveDistroCommand::PrintBenchmarks(
+    const std::vector<parallax::utils::VolumeBenchmark>& benchmarks,
+    const std::string& current_root, uint64_t needed_bytes, int recommended) {
+    std::printf("%-8s %12s %12s %12s  %s\n", "Volume", "Free", "Seq MiB/s",
+                "Random IOPS", "Note");
+    for (size_t i = 0; i < benchmarks.size(); ++i) {
+        const auto& benchmark = benchmarks[i];
+        std::string note = i == 0 ? "current" : "";
+        if (!benchmark.ok) {
+            note = benchmark.error;
+        } else if (i > 0 && benchmark.free_bytes < needed_bytes) {
+            note = "too little free space";
+        } else if (static_cast<int>(i) == recommended) {
+            note += note.empty() ? "recommended" : ", fastest";
+        }
+        std::printf("%-8s %12s %12.0f %12.0f  %s\n", benchmark.root.c_str(),
+                    environment::FormatBytes(benchmark.free_bytes).c_str(),
+                    benchmark.sequential_mib_s, benchmark.random_iops,
+                    note.c_str());
+    }
+    std::cout << std::endl;
+}
+
+// Identity of the distro's file system, compared across the move
+std::string MoveDistroCommand::ReadFingerprint(const CommandContext& context) {
+    std::string stdout_output, stderr_output;
+    int exit_code = parallax::utils::ExecCommandEx(
+        this->BuildWSLCommand(
+            context,
+            "cat /etc/machine-id && df -B1 --output=size / | tail -n 1 && "
+            "(md5sum /var/lib/prakasa/install-stamps 2>/dev/null; "
+            "ls -d /root/prakasa/venv 2>/dev/null; true)"),
+        120, stdout_output, stderr_output);
+    return exit_code == 0 ? parallax::utils::TrimNewlines(stdout_output) : "";
+}
+
+bool MoveDistroCommand::MoveWithManage(const CommandContext& context,
+                                       std::string& error) {
+    const std::string& distro = context.ubuntu_version;
+    RunPowerShell("wsl --terminate " + distro, 60, error);
+    int exit_code = RunPowerShell(
+        "wsl --manage " + distro + " --move '" + target_dir_ + "'",
+        kMoveTimeoutSeconds, error);
+    return exit_code == 0;
+}
+
+// For WSL releases without --manage --move: export the disk to the target,
+// unregister the distro (which deletes the old disk) and register the
+// exported disk in place
+bool MoveDistroCommand::MoveWithExportImport(const CommandContext& context,
+                                             std::string& error) {
+    const std::string& distro = context.ubuntu_version;
+    std::string default_user, stderr_output;
+    parallax::utils::ExecCommandEx("wsl -d " + distro + " -e id -un", 60,
+                                   default_user, stderr_output);
+    default_user = parallax::utils::TrimNewlines(default_user);
+    std::string output;
+    RunPowerShell("wsl --terminate " + distro, 60, output);
+
+    std::string exported = parallax::utils::JoinPath(target_dir_, "ext4.vhdx");
+    if (RunPowerShell("wsl --export " + distro + " '" + exported + "' --vhd",
+                      kMoveTimeoutSeconds, output) != 0 ||
+        parallax::utils::GetFileSize(exported.c_str()) <= 0) {
+        DeleteFileA(exported.c_str());
+        error = "wsl --export failed: " + output;
+        return false;
+    }
+    if (RunPowerShell("wsl --unregister " + distro, 300, output) != 0) {
+        DeleteFileA(exported.c_str());
+        error = "wsl --unregister failed, " + distro + " was left in place: " +
+                output;
+        return false;
+    }
+    if (RunPowerShell("wsl --import-in-place " + distro + " '" + exported + "'",
+                      300, output) != 0) {
+        error = "wsl --import-in-place failed: " + output +
+                ". The distro is saved in " + exported +
+                "; register it with: wsl --import-in-place " + distro + " " +
+                exported;
+        return false;
+    }
+
+    // An imported distro logs in as root; keep the previous default user
+    if (!default_user.empty() && default_user != "root") {
+        std::string stdout_output;
+        parallax::utils::ExecCommandEx(
+            this->BuildWSLCommand(
+                context, "grep -q '^\\[user\\]' /etc/wsl.conf 2>/dev/null || "
+                         "printf '\\n[user]\\ndefault=%s\\n' " +
+                             default_user + " >> /etc/wsl.conf"),
+            60, stdout_output, stderr_output);
+        RunPowerShell("wsl --terminate " + distro, 60, output);
+    }
+    return true;
+}
+
+void MoveDistroCommand::ShowHelpImpl() {
+    std::cout << "Usage: prakasa move-distro [--to <dir>] [--force]\n\n";
+    std::cout << "Benchmark sequential and random reads on the local "
+                 "volumes and move the WSL\n";
+    std::cout << "distro to a faster one. Without --to, only the benchmark "
+                 "and a recommendation\n";
+    std::cout << "are shown.\n\n";
+    std::cout << "The move uses 'wsl --manage <distro> --move', or export and "
+                 "import on WSL\n";
+    std::cout << "releases without it. Running prakasa servers must be "
+                 "stopped first.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --to <dir>           Directory to move the distro to\n";
+    std::cout << "  --force              Move even if <dir> is not faster\n";
+    std::cout << "  --help, -h           Show this help message\n\n";
+    std::cout << "Examples:\n";
+    std::cout << "  prakasa move-distro\n";
+    std::cout << "  prakasa move-distro --to D:\\wsl\\Ubuntu-24.04\n";
+}
+
+}  // namespace commands
+}  // namespace parallax
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "base_command.h"
+#include "utils/volume_benchmark.h"
+#include <string>
+#include <vector>
+
+namespace parallax {
+namespace commands {
+
+// Move-distro command - benchmarks the local volumes and relocates the WSL
+// distro to the one given with --to
+class MoveDistroCommand : public WSLCommand<MoveDistroCommand> {
+ public:
+    std::string GetName() const override { return "move-distro"; }
+    std::string GetDescription() const override {
+        return "Move the WSL distro to a faster local drive";
+    }
+
+    CommandResult ValidateArgsImpl(CommandContext& context);
+    CommandResult ExecuteImpl(const CommandContext& context);
+    void ShowHelpImpl();
+
+ private:
+    std::string target_dir_;
+    bool force_ = false;
+
+    void PrintBenchmarks(const std::vector<parallax::utils::VolumeBenchmark>&
+                             benchmarks,
+                         const std::string& current_root,
+                         uint64_t needed_bytes, int recommended);
+    std::string ReadFingerprint(const CommandContext& context);
+    bool MoveWithManage(const CommandContext& context, std::string& error);
+    bool MoveWithExportImport(const CommandContext& context,
+                              std::string& error);
+};
+
+}  // namespace commands
+}  // namespace parallax
@@ -0,0 +1,133 @@
+#include "serving_profile_command.h"
+#include "utils/serving_profile.h"
+#include "tinylog/tinylog.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace parallax {
+namespace commands {
+
+CommandResult ServingProfileCommand::ValidateArgsImpl(
+    CommandContext& context) {
+    if (context.args.empty()) {
+        this->ShowError("No serving-profile action specified");
+        this->ShowError("Usage: prakasa serving-profile <status|restore>");
+        return CommandResult::InvalidArgs;
+    }
+
+    const std::string& action = context.args[0];
+    if (action == "guard") {
+        // Started by run/join, not meant to be typed
+        if (context.args.size() != 2 ||
+            std::strtoul(context.args[1].c_str(), nullptr, 10) == 0) {
+            this->ShowError("Usage: prakasa serving-profile guard <pid>");
+            return CommandResult::InvalidArgs;
+        }
+        guard_pid_ = static_cast<uint32_t>(
+            std::strtoul(context.args[1].c_str(), nullptr, 10));
+        return CommandResult::Success;
+    }
+    if (action != "status" && action != "restore") {
+        this->ShowError("Unknown serving-profile action: " + action);
+        this->ShowError("Usage: prakasa serving-profile <status|restore>");
+        return CommandResult::InvalidArgs;
+    }
+    if (context.args.size() > 1) {
+        this->ShowError("Unknown option: " + context.args[1]);
+        return CommandResult::InvalidArgs;
+    }
+    return CommandResult::Success;
+}
+
+CommandResult ServingProfileCommand::ExecuteImpl(
+    const CommandContext& context) {
+    const std::string& action = context.args[0];
+
+    if (action == "guard") {
+        info_log("Serving profile guard waiting for process %u", guard_pid_);
+        return parallax::utils::RunServingProfileGuard(guard_pid_) == 0
+                   ? CommandResult::Success
+                   : CommandResult::ExecutionError;
+    }
+
+    auto platform = parallax::utils::CreateWindowsServingPlatform();
+    if (action == "restore") {
+        if (!parallax::utils::RestoreServingProfile(*platform)) {
+            this->ShowError("Serving profile state is locked, try again");
+            return CommandResult::ExecutionError;
+        }
+        this->ShowInfo("Settings from before serving restored");
+        return CommandResult::Success;
+    }
+
+    parallax::utils::ServingProfileSettings settings;
+    std::string error;
+    if (!parallax::utils::LoadServingProfileSettings(settings, error)) {
+        this->ShowError(error);
+        return CommandResult::ExecutionError;
+    }
+    std::cout << "Profile: " << settings.name << std::endl;
+    std::cout << "Power scheme: "
+              << (settings.power_scheme.empty() ? "unchanged"
+                                                : settings.power_scheme)
+              << std::endl;
+    std::cout << "Priority: "
+              << parallax::utils::FormatPriorityClass(settings.vm_priority)
+              << std::endl;
+    std::cout << "Prevent sleep: " << (settings.prevent_sleep ? "yes" : "no")
+              << std::endl;
+    std::cout << "Active power scheme: " << platform->GetActivePowerScheme()
+              << std::endl;
+
+    std::string text;
+    if (!platform->LoadState(text) || text.empty()) {
+        std::cout << "No server holds the profile" << std::endl;
+        return CommandResult::Success;
+    }
+    parallax::utils::ServingProfileState state =
+        parallax::utils::ParseServingProfileState(text);
+    std::cout << "Held by: ";
+    for (size_t i = 0; i < state.owners.size(); ++i) {
+        std::cout << (i > 0 ? ", " : "") << state.owners[i];
+    }
+    std::cout << std::endl;
+    if (!state.previous_scheme.empty()) {
+        std::cout << "Restores power scheme: " << state.previous_scheme
+                  << std::endl;
+    }
+    for (const auto& entry : state.vm_priorities) {
+        std::cout << "Restores VM process " << entry.first << " to "
+                  << parallax::utils::FormatPriorityClass(entry.second)
+                  << std::endl;
+    }
+    return CommandResult::Success;
+}
+
+void ServingProfileCommand::ShowHelpImpl() {
+    std::cout << "Usage: prakasa serving-profile <status|restore>\n\n";
+    std::cout << "While run or join serve a model, prakasa applies the "
+                 "serving profile: a\n";
+    std::cout << "power scheme, the priority class of the WSL VM and of "
+                 "prakasa, and sleep\n";
+    std::cout << "prevention. The previous settings come back when the last "
+                 "server exits; a\n";
+    std::cout << "guard process or the next server restores them after a "
+                 "crash.\n\n";
+    std::cout << "Profiles (serving_profile):\n";
+    std::cout << "  performance          High performance scheme, "
+                 "above-normal priority, no sleep\n";
+    std::cout << "  quiet                No sleep only\n";
+    std::cout << "  off                  Change nothing\n\n";
+    std::cout << "Actions:\n";
+    std::cout << "  status               Show the profile and what it will "
+                 "restore\n";
+    std::cout << "  restore              Restore the recorded settings now\n\n";
+    std::cout << "Examples:\n";
+    std::cout << "  prakasa config set serving_profile quiet\n";
+    std::cout << "  prakasa config set serving_power_scheme ultimate\n";
+    std::cout << "  prakasa config set serving_priority high\n";
+    std::cout << "  prakasa serving-profile status\n";
+}
+
+}  // namespace commands
+}  // namespace parallax
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "base_command.h"
+#include <cstdint>
+#include <string>
+
+namespace parallax {
+namespace commands {
+
+// Serving-profile command - shows and restores the power and scheduling
+// settings that run/join change while they serve
+class ServingProfileCommand : public BaseCommand<ServingProfileCommand> {
+ public:
+    std::string GetName() const override { return "serving-profile"; }
+    std::string GetDescription() const override {
+        return "Show or restore the settings changed while serving";
+    }
+
+    EnvironmentRequirements GetEnvironmentRequirements() {
+        // Only touches host settings
+        EnvironmentRequirements req;
+        return req;
+    }
+
+    CommandResult ValidateArgsImpl(CommandContext& context);
+    CommandResult ExecuteImpl(const CommandContext& context);
+    void ShowHelpImpl();
+
+ private:
+    uint32_t guard_pid_ = 0;
+};
+
+}  // namespace commands
+}  // namespace parallax
@@ -19,6 +19,53 @@ namespace parallax
         const std::string KEY_PRAKASA_GIT_REPO_URL = "prakasa_git_repo_url";
         const std::string KEY_PRAKASA_GIT_BRANCH = "prakasa_git_branch";
         const std::string KEY_PIP_INDEX_URL = "pip_index_url";
+        const std::string KEY_SHUTDOWN_DRAIN_TIMEOUT = "shutdown_drain_timeout";
+        // Comma-separated failover mirrors for network-bound install steps
+        const std::string KEY_APT_MIRRORS = "apt_mirrors";
+        const std::string KEY_CUDA_REPO_MIRRORS = "cuda_repo_mirrors";
+        const std::string KEY_PIP_MIRRORS = "pip_mirrors";
+        const std::string KEY_GIT_MIRRORS = "git_mirrors";
+        const std::string KEY_HF_MIRRORS = "hf_mirrors";
+        // Hours a mirror ranking stays valid before candidates are probed again
+        const std::string KEY_MIRROR_PROBE_TTL = "mirror_probe_ttl";
+        // Shared compiler cache (redis://, memcached:// or WebDAV http(s)://)
+        const std::string KEY_SCCACHE_BACKEND = "sccache_backend";
+        // Rust toolchain installed by rustup, pinned for reproducible builds
+        const std::string KEY_RUST_TOOLCHAIN = "rust_toolchain";
+        // Seconds the session broker keeps warm shells after the last request,
+        // 0 disables the broker
+        const std::string KEY_SESSION_BROKER_IDLE_TIMEOUT = "session_broker_idle_timeout";
+        // Directory wsl --install --location puts the distro in, set by
+        // move-distro; empty keeps the WSL default
+        const std::string KEY_WSL_INSTALL_LOCATION = "wsl_install_location";
+        // Power and scheduling profile run/join apply while serving:
+        // performance, quiet or off
+        const std::string KEY_SERVING_PROFILE = "serving_profile";
+        // Power scheme of the serving profile (high, ultimate, balanced, keep
+        // or a GUID), empty uses the profile's
+        const std::string KEY_SERVING_POWER_SCHEME = "serving_power_scheme";
+        // Priority class of the WSL VM and prakasa while serving (normal,
+        // above_normal, high or keep), empty uses the profile's
+        const std::string KEY_SERVING_PRIORITY = "serving_priority";
+        // CPU slots for co-located servers: auto (the new server's share of
+        // the running ones plus itself), a fixed slot count, or off
+        const std::string KEY_CPU_PARTITION = "cpu_partition";
+        // Stage served models' weights in /dev/shm across restarts (on/off)
+        const std::string KEY_WEIGHT_RESIDENCY = "weight_residency";
+        // GiB of /dev/shm the staged models may use, 0 for 3/4 of /dev/shm
+        const std::string KEY_WEIGHT_RESIDENCY_BUDGET_GIB = "weight_residency_budget_gib";
+        // GiB the CUDA/Triton/inductor JIT caches may keep, 0 for no limit
+        const std::string KEY_JIT_CACHE_MAX_GIB = "jit_cache_max_gib";
+        // Base URL of <key>.tar.gz archives seeding empty JIT caches
+        const std::string KEY_JIT_CACHE_SEED_URL = "jit_cache_seed_url";
+        // Generation throughput (tokens/s) a server must keep, 0 disables the
+        // SLO watchdog
+        const std::string KEY_SLO_MIN_TOKENS_PER_S = "slo_min_tokens_per_s";
+        // Seconds throughput must stay below the SLO before the watchdog acts
+        const std::string KEY_SLO_WINDOW_SECONDS = "slo_window_seconds";
+        // What the watchdog does on a violation: alert, or restart (drain
+        // and relaunch when a restart can help)
+        const std::string KEY_SLO_ACTION = "slo_action";
 
         // Default configuration file name
         const std::string ConfigManager::DEFAULT_CONFIG_PATH = "parallax_config.txt";
@@ -63,7 +110,21 @@ namespace parallax
             config_values_[KEY_PRAKASA_GIT_REPO_URL] =
                 "https://github.com/hetu-project/prakasa.git";
             config_values_[KEY_PRAKASA_GIT_BRANCH] = "main";
+            // Seconds to wait for the inference server to exit after SIGINT
+            config_values_[KEY_SHUTDOWN_DRAIN_TIMEOUT] = "30";
+            config_values_[KEY_MIRROR_PROBE_TTL] = "24";
+            config_values_[KEY_RUST_TOOLCHAIN] = "1.86.0";
+            config_values_[KEY_SESSION_BROKER_IDLE_TIMEOUT] = "0";
+            config_values_[KEY_SERVING_PROFILE] = "performance";
+            config_values_[KEY_CPU_PARTITION] = "auto";
+            config_values_[KEY_WEIGHT_RESIDENCY] = "off";
+            config_values_[KEY_WEIGHT_RESIDENCY_BUDGET_GIB] = "0";
+            config_values_[KEY_JIT_CACHE_MAX_GIB] = "20";
+            config_values_[KEY_SLO_MIN_TOKENS_PER_S] = "0";
+            config_values_[KEY_SLO_WINDOW_SECONDS] = "120";
+            config_values_[KEY_SLO_ACTION] = "alert";
             // proxy_url and pip_index_url have no default value (use official PyPI by default)
+            // The *_mirrors lists are empty by default (no failover)
         }
 
         // Load configuration file
@@ -111,7 +172,21 @@ namespace parallax
                 {KEY_WSL_KERNEL_URL, config_values_[KEY_WSL_KERNEL_URL]},
                 {KEY_PRAKASA_GIT_REPO_URL, config_values_[KEY_PRAKASA_GIT_REPO_URL]},
                 {KEY_PRAKASA_GIT_BRANCH, config_values_[KEY_PRAKASA_GIT_BRANCH]},
-                {KEY_PIP_INDEX_URL, config_values_[KEY_PIP_INDEX_URL]}};
+                {KEY_PIP_INDEX_URL, config_values_[KEY_PIP_INDEX_URL]},
+                {KEY_SHUTDOWN_DRAIN_TIMEOUT, config_values_[KEY_SHUTDOWN_DRAIN_TIMEOUT]},
+                {KEY_MIRROR_PROBE_TTL, config_values_[KEY_MIRROR_PROBE_TTL]},
+                {KEY_RUST_TOOLCHAIN, config_values_[KEY_RUST_TOOLCHAIN]},
+                {KEY_SESSION_BROKER_IDLE_TIMEOUT,
+                 config_values_[KEY_SESSION_BROKER_IDLE_TIMEOUT]},
+                {KEY_SERVING_PROFILE, config_values_[KEY_SERVING_PROFILE]},
+                {KEY_CPU_PARTITION, config_values_[KEY_CPU_PARTITION]},
+                {KEY_WEIGHT_RESIDENCY, config_values_[KEY_WEIGHT_RESIDENCY]},
+                {KEY_WEIGHT_RESIDENCY_BUDGET_GIB,
+                 config_values_[KEY_WEIGHT_RESIDENCY_BUDGET_GIB]},
+                {KEY_JIT_CACHE_MAX_GIB, config_values_[KEY_JIT_CACHE_MAX_GIB]},
+                {KEY_SLO_MIN_TOKENS_PER_S, config_values_[KEY_SLO_MIN_TOKENS_PER_S]},
+                {KEY_SLO_WINDOW_SECONDS, config_values_[KEY_SLO_WINDOW_SECONDS]},
+                {KEY_SLO_ACTION, config_values_[KEY_SLO_ACTION]}};
 
             std::string line;
             while (std::getline(file, line))
@@ -307,6 +382,28 @@ namespace parallax
             return default_value;
         }
 
+        // Get configuration item as integer
+        int ConfigManager::GetConfigIntValue(const std::string &key,
+                                             int default_value) const
+        {
+            std::string value = GetConfigValue(key);
+            if (value.empty())
+            {
+                return default_value;
+            }
+
+            try
+            {
+                return std::stoi(value);
+            }
+            catch (const std::exception &)
+            {
+                warn_log("Config key '%s' has invalid integer value '%s', using %d",
+                         key.c_str(), value.c_str(), default_value);
+                return default_value;
+            }
+        }
+
         // Set configuration item value
         void ConfigManager::SetConfigValue(const std::string &key,
                                            const std::string &value)
@@ -328,7 +425,16 @@ namespace parallax
             static const std::set<std::string> valid_keys = {
                 KEY_PROXY_URL, KEY_WSL_LINUX_DISTRO, KEY_WSL_INSTALLER_URL,
                 KEY_WSL_KERNEL_URL, KEY_PRAKASA_GIT_REPO_URL, KEY_PRAKASA_GIT_BRANCH,
-                KEY_PIP_INDEX_URL};
+                KEY_PIP_INDEX_URL, KEY_SHUTDOWN_DRAIN_TIMEOUT, KEY_APT_MIRRORS,
+                KEY_CUDA_REPO_MIRRORS, KEY_PIP_MIRRORS, KEY_GIT_MIRRORS,
+                KEY_HF_MIRRORS, KEY_MIRROR_PROBE_TTL, KEY_SCCACHE_BACKEND,
+                KEY_RUST_TOOLCHAIN, KEY_SESSION_BROKER_IDLE_TIMEOUT,
+                KEY_WSL_INSTALL_LOCATION, KEY_SERVING_PROFILE,
+                KEY_SERVING_POWER_SCHEME, KEY_SERVING_PRIORITY,
+                KEY_CPU_PARTITION, KEY_WEIGHT_RESIDENCY,
+                KEY_WEIGHT_RESIDENCY_BUDGET_GIB, KEY_JIT_CACHE_MAX_GIB,
+                KEY_JIT_CACHE_SEED_URL, KEY_SLO_MIN_TOKENS_PER_S,
+                KEY_SLO_WINDOW_SECONDS, KEY_SLO_ACTION};
 
             return valid_keys.find(key) != valid_keys.end();
         }
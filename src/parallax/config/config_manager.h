@@ -16,6 +16,28 @@ namespace parallax
       extern const std::string KEY_PRAKASA_GIT_REPO_URL;
       extern const std::string KEY_PRAKASA_GIT_BRANCH;
       extern const std::string KEY_PIP_INDEX_URL;
+      extern const std::string KEY_SHUTDOWN_DRAIN_TIMEOUT;
+      extern const std::string KEY_APT_MIRRORS;
+      extern const std::string KEY_CUDA_REPO_MIRRORS;
+      extern const std::string KEY_PIP_MIRRORS;
+      extern const std::string KEY_GIT_MIRRORS;
+      extern const std::string KEY_HF_MIRRORS;
+      extern const std::string KEY_MIRROR_PROBE_TTL;
+      extern const std::string KEY_SCCACHE_BACKEND;
+      extern const std::string KEY_RUST_TOOLCHAIN;
+      extern const std::string KEY_SESSION_BROKER_IDLE_TIMEOUT;
+      extern const std::string KEY_WSL_INSTALL_LOCATION;
+      extern const std::string KEY_SERVING_PROFILE;
+      extern const std::string KEY_SERVING_POWER_SCHEME;
+      extern const std::string KEY_SERVING_PRIORITY;
+      extern const std::string KEY_CPU_PARTITION;
+      extern const std::string KEY_WEIGHT_RESIDENCY;
+      extern const std::string KEY_WEIGHT_RESIDENCY_BUDGET_GIB;
+      extern const std::string KEY_JIT_CACHE_MAX_GIB;
+      extern const std::string KEY_JIT_CACHE_SEED_URL;
+      extern const std::string KEY_SLO_MIN_TOKENS_PER_S;
+      extern const std::string KEY_SLO_WINDOW_SECONDS;
+      extern const std::string KEY_SLO_ACTION;
 
       // Configuration file manager class
       class ConfigManager
@@ -35,6 +57,10 @@ namespace parallax
          std::string GetConfigValue(const std::string &key,
                                     const std::string &default_value = "") const;
 
+         // Get configuration item as integer, return default value if not
+         // exists or not a valid number
+         int GetConfigIntValue(const std::string &key, int default_value) const;
+
          // Set configuration item value
          void SetConfigValue(const std::string &key, const std::string &value);
 
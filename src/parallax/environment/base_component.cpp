@@ -54,6 +54,14 @@ bool ExecutionContext::IsStopRequested() const {
 
 void ExecutionContext::ResetStop() { stop_requested_ = false; }
 
+MirrorSelector& ExecutionContext::GetMirrorSelector() {
+    if (!mirror_selector_) {
+        mirror_selector_ = std::make_unique<MirrorSelector>(
+            std::make_shared<WSLCurlMirrorProbe>(ubuntu_version_, proxy_url_));
+    }
+    return *mirror_selector_;
+}
+
 // BaseEnvironmentComponent implementation
 BaseEnvironmentComponent::BaseEnvironmentComponent(
     std::shared_ptr<ExecutionContext> context)
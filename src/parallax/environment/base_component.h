@@ -4,6 +4,8 @@
 #include <functional>
 #include <atomic>
 #include <memory>
+#include "install_history.h"
+#include "mirror_selector.h"
 
 namespace parallax {
 namespace environment {
@@ -82,6 +84,12 @@ class ExecutionContext {
     const std::string& GetUbuntuVersion() const { return ubuntu_version_; }
     const std::string& GetProxyUrl() const { return proxy_url_; }
 
+    // Step duration history for ETA and adaptive timeouts
+    InstallHistory& GetInstallHistory() { return install_history_; }
+
+    // Mirror ranking, created on first use
+    MirrorSelector& GetMirrorSelector();
+
     // Silent mode
     void SetSilentMode(bool silent) { silent_mode_ = silent; }
     bool IsSilentMode() const { return silent_mode_; }
@@ -93,6 +101,8 @@ class ExecutionContext {
     bool silent_mode_;
     std::atomic<bool> stop_requested_;
     ProgressCallback progress_callback_;
+    InstallHistory install_history_;
+    std::unique_ptr<MirrorSelector> mirror_selector_;
 };
 
 /**
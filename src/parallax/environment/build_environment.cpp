@@ -0,0 +1,246 @@
+#include "build_environment.h"
+#include "command_executor.h"
+#include "config/config_manager.h"
+#include "install_history.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kCpuMarker = "#cpu";
+const char* const kMemoryMarker = "#mem";
+
+// Memory budget per parallel job: nvcc on torch extensions peaks around
+// 2.5 GB, rustc on the prakasa crates around 1 GB
+const uint64_t kMibPerNativeJob = 2560;
+const uint64_t kMibPerCargoJob = 1024;
+
+std::string JoinCapabilities(const std::vector<std::string>& capabilities,
+                             bool keep_dot) {
+    std::string joined;
+    for (const auto& capability : capabilities) {
+        std::string value = capability;
+        if (!keep_dot) {
+            value.erase(std::remove(value.begin(), value.end(), '.'),
+                        value.end());
+        }
+        joined += (joined.empty() ? "" : ";") + value;
+    }
+    return joined;
+}
+
+int JobsFor(int cpu_count, uint64_t mem_available_mib, uint64_t mib_per_job) {
+    int jobs = cpu_count > 0 ? cpu_count : 1;
+    if (mem_available_mib > 0) {
+        int memory_jobs = static_cast<int>(mem_available_mib / mib_per_job);
+        jobs = (std::min)(jobs, memory_jobs);
+    }
+    return (std::max)(jobs, 1);
+}
+
+// "Cache hits                     412" -> label "Cache hits", value 412
+bool ParseStatsLine(const std::string& line, std::string& label,
+                    double& value) {
+    size_t gap = line.find("  ");
+    if (gap == std::string::npos) {
+        return false;
+    }
+    size_t value_start = line.find_first_not_of(' ', gap);
+    if (value_start == std::string::npos) {
+        return false;
+    }
+    label = line.substr(0, gap);
+    value = std::atof(line.c_str() + value_start);
+    return true;
+}
+
+}  // namespace
+
+const char* const kCompilerCacheDir = "/var/cache/prakasa/sccache";
+const char* const kCargoTargetDir = "/var/cache/prakasa/cargo-target";
+
+double CompilerCacheStats::HitRatePercent() const {
+    int lookups = cache_hits + cache_misses;
+    return lookups > 0 ? cache_hits * 100.0 / lookups : 0.0;
+}
+
+double CompilerCacheStats::EstimatedSecondsSaved() const {
+    double saved_per_hit = average_compile_seconds - average_hit_read_seconds;
+    return saved_per_hit > 0.0 ? cache_hits * saved_per_hit : 0.0;
+}
+
+std::string CompilerCacheStats::Summary() const {
+    if (!available) {
+        return "no statistics";
+    }
+    std::ostringstream out;
+    out << cache_hits << " hits / " << cache_misses << " misses ("
+        << static_cast<int>(HitRatePercent() + 0.5) << "%)";
+    if (EstimatedSecondsSaved() >= 1.0) {
+        out << ", about "
+            << InstallHistory::FormatDuration(
+                   static_cast<uint64_t>(EstimatedSecondsSaved() * 1000))
+            << " saved";
+    }
+    return out.str();
+}
+
+std::string BuildCompilerCacheExportCommand() {
+    // C/C++ goes through the CMake launchers only: wrapping CC/CXX as well
+    // would run every CMake compile as "sccache sccache gcc", and tools that
+    // take CC for a path break on a multi-word value
+    std::string exports =
+        std::string("export SCCACHE_DIR=") + kCompilerCacheDir +
+        " SCCACHE_CACHE_SIZE=20G RUSTC_WRAPPER=sccache "
+        "CMAKE_C_COMPILER_LAUNCHER=sccache "
+        "CMAKE_CXX_COMPILER_LAUNCHER=sccache "
+        "CMAKE_CUDA_COMPILER_LAUNCHER=sccache "
+        "PYTORCH_NVCC='sccache /usr/local/cuda/bin/nvcc'";
+
+    // A LAN backend is shared by all nodes of a site; the local directory
+    // is used when it is not configured
+    std::string backend =
+        parallax::config::ConfigManager::GetInstance().GetConfigValue(
+            parallax::config::KEY_SCCACHE_BACKEND);
+    if (backend.rfind("redis://", 0) == 0 ||
+        backend.rfind("rediss://", 0) == 0) {
+        exports += " SCCACHE_REDIS_ENDPOINT='" + backend + "'";
+    } else if (backend.rfind("memcached://", 0) == 0 ||
+               backend.rfind("tcp://", 0) == 0) {
+        exports += " SCCACHE_MEMCACHED_ENDPOINT='" + backend + "'";
+    } else if (backend.rfind("http://", 0) == 0 ||
+               backend.rfind("https://", 0) == 0) {
+        exports += " SCCACHE_WEBDAV_ENDPOINT='" + backend + "'";
+    } else if (!backend.empty()) {
+        warn_log("[ENV] Unsupported sccache_backend '%s', using the local "
+                 "cache",
+                 backend.c_str());
+    }
+    return exports;
+}
+
+CompilerCacheStats ParseCompilerCacheStats(const std::string& output) {
+    CompilerCacheStats stats;
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::string label;
+        double value = 0.0;
+        if (!ParseStatsLine(parallax::utils::TrimNewlines(line), label,
+                            value)) {
+            continue;
+        }
+        if (label == "Compile requests") {
+            stats.compile_requests = static_cast<int>(value);
+            stats.available = true;
+        } else if (label == "Cache hits") {
+            stats.cache_hits = static_cast<int>(value);
+        } else if (label == "Cache misses") {
+            stats.cache_misses = static_cast<int>(value);
+        } else if (label == "Average compiler") {
+            stats.average_compile_seconds = value;
+        } else if (label == "Average cache read hit") {
+            stats.average_hit_read_seconds = value;
+        }
+    }
+    return stats;
+}
+
+std::string BuildEnvironment::GetTorchCudaArchList() const {
+    return JoinCapabilities(compute_capabilities, true);
+}
+
+std::string BuildEnvironment::GetCmakeCudaArchitectures() const {
+    return JoinCapabilities(compute_capabilities, false);
+}
+
+std::string BuildEnvironment::BuildExportCommand() const {
+    std::string exports = "export MAX_JOBS=" + std::to_string(max_jobs) +
+                          " CARGO_BUILD_JOBS=" + std::to_string(cargo_jobs) +
+                          " CARGO_TARGET_DIR=" + kCargoTargetDir +
+                          " CARGO_REGISTRIES_CRATES_IO_PROTOCOL=sparse";
+    if (!compute_capabilities.empty()) {
+        // Quoted, ';' would end the export otherwise
+        exports += " TORCH_CUDA_ARCH_LIST='" + GetTorchCudaArchList() +
+                   "' CMAKE_CUDA_ARCHITECTURES='" +
+                   GetCmakeCudaArchitectures() + "'";
+    }
+    return exports;
+}
+
+BuildEnvironment DetectBuildEnvironment(
+    const std::shared_ptr<CommandExecutor>& executor) {
+    BuildEnvironment build_env;
+
+    // compute_cap needs driver 510 or newer; without it all architectures
+    // are built as before
+    auto [exit_code, output] = executor->ExecuteWSL(
+        std::string("nvidia-smi --query-gpu=compute_cap "
+                    "--format=csv,noheader 2>/dev/null; echo '") +
+            kCpuMarker + "'; nproc; echo '" + kMemoryMarker +
+            "'; grep MemAvailable /proc/meminfo",
+        30, CommandKind::kProbe);
+    if (exit_code != 0) {
+        warn_log("[ENV] Build environment probe failed (code %d): %s",
+                 exit_code, output.c_str());
+    }
+
+    enum class Section { kGpus, kCpu, kMemory } section = Section::kGpus;
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        line = parallax::utils::TrimNewlines(line);
+        if (line == kCpuMarker) {
+            section = Section::kCpu;
+            continue;
+        }
+        if (line == kMemoryMarker) {
+            section = Section::kMemory;
+            continue;
+        }
+
+        if (section == Section::kGpus) {
+            // "8.6"; anything else is an error message
+            double capability = std::atof(line.c_str());
+            if (capability > 0.0 && line.find('.') != std::string::npos) {
+                build_env.compute_capabilities.push_back(line);
+            }
+        } else if (section == Section::kCpu) {
+            build_env.cpu_count = std::atoi(line.c_str());
+        } else if (line.rfind("MemAvailable:", 0) == 0) {
+            // "MemAvailable:   15728640 kB"
+            build_env.mem_available_mib =
+                std::strtoull(line.substr(13).c_str(), nullptr, 10) / 1024;
+        }
+    }
+
+    auto& capabilities = build_env.compute_capabilities;
+    std::sort(capabilities.begin(), capabilities.end(),
+              [](const std::string& a, const std::string& b) {
+                  return std::atof(a.c_str()) < std::atof(b.c_str());
+              });
+    capabilities.erase(std::unique(capabilities.begin(), capabilities.end()),
+                       capabilities.end());
+
+    build_env.max_jobs = JobsFor(build_env.cpu_count,
+                                 build_env.mem_available_mib, kMibPerNativeJob);
+    build_env.cargo_jobs = JobsFor(
+        build_env.cpu_count, build_env.mem_available_mib, kMibPerCargoJob);
+
+    info_log("[ENV] Build environment: %d cores, %llu MiB available, "
+             "CUDA archs '%s', MAX_JOBS=%d, CARGO_BUILD_JOBS=%d",
+             build_env.cpu_count,
+             static_cast<unsigned long long>(build_env.mem_available_mib),
+             build_env.GetTorchCudaArchList().c_str(), build_env.max_jobs,
+             build_env.cargo_jobs);
+    return build_env;
+}
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace parallax {
+namespace environment {
+
+class CommandExecutor;
+
+/**
+ * @brief Native build settings for pip install of the Prakasa project
+ *
+ * Restricts CUDA extension builds to the architectures of the installed
+ * GPUs and sizes the compiler job counts to the cores and free memory of
+ * the distro, so large machines are used fully and small ones do not run
+ * out of memory.
+ */
+struct BuildEnvironment {
+    std::vector<std::string> compute_capabilities;  // e.g. "8.6", sorted
+    int cpu_count = 0;
+    uint64_t mem_available_mib = 0;
+    int max_jobs = 1;    // nvcc/C++ jobs (MAX_JOBS)
+    int cargo_jobs = 1;  // rustc jobs (CARGO_BUILD_JOBS)
+
+    // "8.6;8.9", empty when no GPU answered
+    std::string GetTorchCudaArchList() const;
+    // "86;89", empty when no GPU answered
+    std::string GetCmakeCudaArchitectures() const;
+
+    // "export A=x B=y" for the variables that could be determined, plus
+    // the shared cargo target directory and sparse registry protocol
+    std::string BuildExportCommand() const;
+};
+
+// sccache counters for one build, from sccache --show-stats
+struct CompilerCacheStats {
+    bool available = false;
+    int compile_requests = 0;
+    int cache_hits = 0;
+    int cache_misses = 0;
+    double average_compile_seconds = 0.0;   // "Average compiler"
+    double average_hit_read_seconds = 0.0;  // "Average cache read hit"
+
+    double HitRatePercent() const;
+    // Compiler time avoided by the hits
+    double EstimatedSecondsSaved() const;
+    // e.g. "412 hits / 38 misses (92%), about 6m10s saved"
+    std::string Summary() const;
+};
+
+// Persistent sccache directory inside the distro
+extern const char* const kCompilerCacheDir;
+
+// Cargo target directory shared by all Rust builds inside the distro, so
+// Rust-backed dependencies are not rebuilt from scratch on every update
+extern const char* const kCargoTargetDir;
+
+// "export ..." routing C/C++ (CC, CXX, CMake launchers), CUDA
+// (PYTORCH_NVCC, CMake launcher) and Rust (RUSTC_WRAPPER) compiles through
+// sccache, plus the sccache_backend LAN cache when configured
+std::string BuildCompilerCacheExportCommand();
+
+CompilerCacheStats ParseCompilerCacheStats(const std::string& output);
+
+// Query GPUs, cores and MemAvailable inside the distro in one call
+BuildEnvironment DetectBuildEnvironment(
+    const std::shared_ptr<CommandExecutor>& executor);
+
+}  // namespace environment
+}  // namespace parallax
@@ -1,33 +1,91 @@
 #include "command_executor.h"
 #include "base_component.h"
+#include "retry_policy.h"
 #include "utils/process.h"
+#include "utils/session_broker.h"
 #include "utils/utils.h"
 #include "tinylog/tinylog.h"
 #include <windows.h>
+#include <chrono>
 
 namespace parallax {
 namespace environment {
 
-CommandExecutor::CommandExecutor(std::shared_ptr<ExecutionContext> context)
-    : context_(context) {}
+namespace {
 
-std::pair<int, std::string> CommandExecutor::ExecutePowerShell(
-    const std::string& command, int timeout_seconds) {
+const char* const kCancelledMessage = "Operation cancelled";
+
+// Run a command line, terminating it early when cancelled is set or a stop
+// is requested. Without a flag the plain blocking call is used. A cancelled
+// run returns -1 with kCancelledMessage. A probe goes to a warm session of
+// the session broker when one is available, brokered tells whether it did;
+// brokered output is UTF-8 already
+int RunCommandLine(ExecutionContext& context, parallax::utils::BrokerShell shell,
+                   CommandKind kind, const std::string& command,
+                   const std::string& command_line, int timeout_seconds,
+                   const std::shared_ptr<std::atomic<bool>>& cancelled,
+                   std::string& stdout_output, std::string& stderr_output,
+                   bool& brokered) {
+    parallax::utils::BrokerCommandResult broker_result;
+    brokered =
+        kind == CommandKind::kProbe &&
+        parallax::utils::RunThroughSessionBroker(
+            shell, context.GetUbuntuVersion(), command, timeout_seconds,
+            [&context, cancelled]() {
+                return (cancelled && cancelled->load()) ||
+                       context.IsStopRequested();
+            },
+            broker_result);
+    if (brokered) {
+        stdout_output = std::move(broker_result.stdout_output);
+        stderr_output = std::move(broker_result.stderr_output);
+        return (cancelled && cancelled->load() && broker_result.exit_code == -3)
+                   ? -1
+                   : broker_result.exit_code;
+    }
+
+    if (!cancelled) {
+        return parallax::utils::ExecCommandEx(command_line, timeout_seconds,
+                                              stdout_output, stderr_output,
+                                              false, true);
+    }
+    int exit_code = parallax::utils::ExecCommandEx2(
+        command_line, timeout_seconds, stdout_output, stderr_output,
+        [&context, cancelled]() {
+            return cancelled->load() || context.IsStopRequested();
+        },
+        false, true);
+    return (cancelled->load() && exit_code == -3) ? -1 : exit_code;
+}
+
+std::pair<int, std::string> RunPowerShell(
+    ExecutionContext& context, const std::string& command, int timeout_seconds,
+    const std::shared_ptr<std::atomic<bool>>& cancelled, CommandKind kind) {
     // Check if stop has been requested
-    if (context_->IsStopRequested()) {
+    if (context.IsStopRequested()) {
         return {-1, "Operation interrupted by stop request"};
     }
+    if (cancelled && cancelled->load()) {
+        return {-1, kCancelledMessage};
+    }
 
     std::string stdout_output, stderr_output;
-    int exit_code = parallax::utils::ExecCommandEx(
+    bool brokered = false;
+    int exit_code = RunCommandLine(
+        context, parallax::utils::BrokerShell::kPowerShell, kind, command,
         "powershell.exe -Command \"" + command + "\"", timeout_seconds,
-        stdout_output, stderr_output, false, true);
+        cancelled, stdout_output, stderr_output, brokered);
+    if (cancelled && cancelled->load()) {
+        return {-1, kCancelledMessage};
+    }
 
     // Handle PowerShell output encoding (usually UTF-16)
     std::string utf8_stdout =
-        parallax::utils::ConvertPowerShellOutputToUtf8(stdout_output);
+        brokered ? stdout_output
+                 : parallax::utils::ConvertPowerShellOutputToUtf8(stdout_output);
     std::string utf8_stderr =
-        parallax::utils::ConvertPowerShellOutputToUtf8(stderr_output);
+        brokered ? stderr_output
+                 : parallax::utils::ConvertPowerShellOutputToUtf8(stderr_output);
 
     // Merge output and return
     std::string combined_output = utf8_stdout;
@@ -48,7 +106,7 @@ std::pair<int, std::string> CommandExecutor::ExecutePowerShell(
     }
 
     // Check if stop has been requested after execution
-    if (context_->IsStopRequested()) {
+    if (context.IsStopRequested()) {
         return {
             -1,
             "Operation interrupted by stop request after command execution"};
@@ -57,29 +115,40 @@ std::pair<int, std::string> CommandExecutor::ExecutePowerShell(
     return {exit_code, combined_output};
 }
 
-std::pair<int, std::string> CommandExecutor::ExecuteWSL(
-    const std::string& command, int timeout_seconds) {
+std::pair<int, std::string> RunWSL(
+    ExecutionContext& context, const std::string& command, int timeout_seconds,
+    const std::shared_ptr<std::atomic<bool>>& cancelled, CommandKind kind) {
     // Check if stop has been requested
-    if (context_->IsStopRequested()) {
+    if (context.IsStopRequested()) {
         return {-1, "Operation interrupted by stop request"};
     }
+    if (cancelled && cancelled->load()) {
+        return {-1, kCancelledMessage};
+    }
 
     // Use specified Ubuntu version to execute command
     std::string wsl_command =
-        parallax::utils::BuildWSLCommand(context_->GetUbuntuVersion(), command);
+        parallax::utils::BuildWSLCommand(context.GetUbuntuVersion(), command);
 
     debug_log("[ENV] WSL command: %s", wsl_command.c_str());
 
     std::string stdout_output, stderr_output;
-    int exit_code = parallax::utils::ExecCommandEx(wsl_command, timeout_seconds,
-                                                   stdout_output, stderr_output,
-                                                   false, true);
+    bool brokered = false;
+    int exit_code = RunCommandLine(context, parallax::utils::BrokerShell::kWSL,
+                                   kind, command, wsl_command, timeout_seconds,
+                                   cancelled, stdout_output, stderr_output,
+                                   brokered);
+    if (cancelled && cancelled->load()) {
+        return {-1, kCancelledMessage};
+    }
 
     // Handle WSL output encoding
     std::string utf8_stdout =
-        parallax::utils::ConvertWslOutputToUtf8(stdout_output, false);
+        brokered ? stdout_output
+                 : parallax::utils::ConvertWslOutputToUtf8(stdout_output, false);
     std::string utf8_stderr =
-        parallax::utils::ConvertWslOutputToUtf8(stderr_output, true);
+        brokered ? stderr_output
+                 : parallax::utils::ConvertWslOutputToUtf8(stderr_output, true);
 
     if (utf8_stdout.empty() && !stdout_output.empty()) {
         utf8_stdout = stdout_output;
@@ -106,7 +175,7 @@ std::pair<int, std::string> CommandExecutor::ExecuteWSL(
     }
 
     // Check if stop has been requested after execution
-    if (context_->IsStopRequested()) {
+    if (context.IsStopRequested()) {
         return {
             -1,
             "Operation interrupted by stop request after command execution"};
@@ -115,6 +184,125 @@ std::pair<int, std::string> CommandExecutor::ExecuteWSL(
     return {exit_code, combined_output};
 }
 
+}  // namespace
+
+bool AsyncCommand::IsReady() const {
+    return WaitFor(0);
+}
+
+bool AsyncCommand::WaitFor(int timeout_ms) const {
+    return !result_.valid() ||
+           result_.wait_for(std::chrono::milliseconds(timeout_ms)) ==
+               std::future_status::ready;
+}
+
+std::pair<int, std::string> AsyncCommand::Get() const {
+    if (!result_.valid()) {
+        return {-1, kCancelledMessage};
+    }
+    return result_.get();
+}
+
+void AsyncCommand::Cancel() {
+    if (cancelled_) {
+        cancelled_->store(true);
+    }
+}
+
+std::vector<std::pair<int, std::string>> WhenAll(
+    const std::vector<AsyncCommand>& commands) {
+    std::vector<std::pair<int, std::string>> results;
+    results.reserve(commands.size());
+    for (const auto& command : commands) {
+        results.push_back(command.Get());
+    }
+    return results;
+}
+
+size_t WhenAny(std::vector<AsyncCommand>& commands, bool cancel_others) {
+    if (commands.empty()) {
+        return 0;
+    }
+    for (;;) {
+        for (size_t i = 0; i < commands.size(); ++i) {
+            if (!commands[i].IsReady()) {
+                continue;
+            }
+            if (cancel_others) {
+                for (size_t j = 0; j < commands.size(); ++j) {
+                    if (j != i) {
+                        commands[j].Cancel();
+                    }
+                }
+            }
+            return i;
+        }
+        // Wait on the first one a little, then look at all of them again
+        commands.front().WaitFor(20);
+    }
+}
+
+CommandExecutor::CommandExecutor(std::shared_ptr<ExecutionContext> context)
+    : context_(context) {}
+
+std::pair<int, std::string> CommandExecutor::ExecutePowerShell(
+    const std::string& command, int timeout_seconds, CommandKind kind) {
+    return RunPowerShell(*context_, command, timeout_seconds, nullptr, kind);
+}
+
+std::pair<int, std::string> CommandExecutor::ExecuteWSL(
+    const std::string& command, int timeout_seconds, CommandKind kind) {
+    return RunWSL(*context_, command, timeout_seconds, nullptr, kind);
+}
+
+AsyncCommand CommandExecutor::ExecutePowerShellAsync(
+    const std::string& command, int timeout_seconds, CommandKind kind) {
+    AsyncCommand async_command;
+    async_command.cancelled_ = std::make_shared<std::atomic<bool>>(false);
+    // The task owns the context and flag, so it may outlive this executor
+    async_command.result_ =
+        std::async(std::launch::async,
+                   [context = context_, command, timeout_seconds,
+                    cancelled = async_command.cancelled_, kind]() {
+                       return RunPowerShell(*context, command, timeout_seconds,
+                                            cancelled, kind);
+                   })
+            .share();
+    return async_command;
+}
+
+AsyncCommand CommandExecutor::ExecuteWSLAsync(const std::string& command,
+                                              int timeout_seconds,
+                                              CommandKind kind) {
+    AsyncCommand async_command;
+    async_command.cancelled_ = std::make_shared<std::atomic<bool>>(false);
+    async_command.result_ =
+        std::async(std::launch::async,
+                   [context = context_, command, timeout_seconds,
+                    cancelled = async_command.cancelled_, kind]() {
+                       return RunWSL(*context, command, timeout_seconds,
+                                     cancelled, kind);
+                   })
+            .share();
+    return async_command;
+}
+
+std::pair<int, std::string> CommandExecutor::ExecuteWSLWithRetry(
+    const std::string& step_name, const std::string& command,
+    int timeout_seconds) {
+    std::string last_output;
+    int exit_code = RunStepWithRetry(
+        *context_, step_name, command,
+        [&](const std::string& attempt_command, std::string& output) {
+            auto [attempt_code, attempt_output] =
+                ExecuteWSL(attempt_command, timeout_seconds);
+            output = attempt_output;
+            last_output = attempt_output;
+            return attempt_code;
+        });
+    return {exit_code, last_output};
+}
+
 bool CommandExecutor::IsWindowsFeatureEnabled(const std::string& feature_name) {
     std::string cmd = "Get-WindowsOptionalFeature -Online -FeatureName " +
                       feature_name + " | Select-Object -ExpandProperty State";
@@ -1,14 +1,55 @@
 #pragma once
 
+#include <atomic>
+#include <future>
 #include <string>
 #include <utility>
 #include <memory>
+#include <vector>
 
 namespace parallax {
 namespace environment {
 
 class ExecutionContext;
 
+// What a command does. Only read-only probes may run in a warm session of
+// the session broker; anything that changes state (feature installs, apt,
+// pip, configuration writes) always runs in a process of its own
+enum class CommandKind { kAction, kProbe };
+
+/**
+ * @brief Handle of a command started by ExecuteWSLAsync/ExecutePowerShellAsync
+ *
+ * Copies refer to the same run. Cancel terminates the process; the result
+ * of a cancelled command is -1 with "Operation cancelled". A stop request
+ * on the execution context cancels all running commands.
+ */
+class AsyncCommand {
+ public:
+    AsyncCommand() = default;
+
+    bool IsReady() const;
+    // True if the command finished within timeout_ms
+    bool WaitFor(int timeout_ms) const;
+    // Blocks until the command finished: (exit_code, combined_output)
+    std::pair<int, std::string> Get() const;
+    void Cancel();
+
+ private:
+    friend class CommandExecutor;
+
+    std::shared_future<std::pair<int, std::string>> result_;
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Wait for all commands; results in the order of the commands
+std::vector<std::pair<int, std::string>> WhenAll(
+    const std::vector<AsyncCommand>& commands);
+
+// Wait for the first command to finish and return its index; with
+// cancel_others the remaining commands are cancelled
+size_t WhenAny(std::vector<AsyncCommand>& commands, bool cancel_others = false);
+
 /**
  * @brief Command execution utility class
  *
@@ -24,19 +65,62 @@ class CommandExecutor {
      * @brief Execute a PowerShell command
      * @param command The PowerShell command to execute
      * @param timeout_seconds Timeout in seconds (default: 300)
+     * @param kind kProbe for read-only probes the session broker may run
      * @return Pair of (exit_code, combined_output)
      */
-    std::pair<int, std::string> ExecutePowerShell(const std::string& command,
-                                                  int timeout_seconds = 300);
+    std::pair<int, std::string> ExecutePowerShell(
+        const std::string& command, int timeout_seconds = 300,
+        CommandKind kind = CommandKind::kAction);
 
     /**
      * @brief Execute a WSL command
      * @param command The command to execute in WSL
      * @param timeout_seconds Timeout in seconds (default: 300)
+     * @param kind kProbe for read-only probes the session broker may run
      * @return Pair of (exit_code, combined_output)
      */
-    std::pair<int, std::string> ExecuteWSL(const std::string& command,
-                                           int timeout_seconds = 300);
+    std::pair<int, std::string> ExecuteWSL(
+        const std::string& command, int timeout_seconds = 300,
+        CommandKind kind = CommandKind::kAction);
+
+    /**
+     * @brief Start a PowerShell command on a worker thread
+     * @param command The PowerShell command to execute
+     * @param timeout_seconds Timeout in seconds (default: 300)
+     * @param kind kProbe for read-only probes the session broker may run
+     * @return Handle to wait for, combine or cancel the command
+     */
+    AsyncCommand ExecutePowerShellAsync(
+        const std::string& command, int timeout_seconds = 300,
+        CommandKind kind = CommandKind::kAction);
+
+    /**
+     * @brief Start a WSL command on a worker thread
+     * @param command The command to execute in WSL
+     * @param timeout_seconds Timeout in seconds (default: 300)
+     * @param kind kProbe for read-only probes the session broker may run
+     * @return Handle to wait for, combine or cancel the command
+     *
+     * Independent probes can overlap, e.g.
+     * WhenAll({ExecuteWSLAsync(a), ExecuteWSLAsync(b)}).
+     */
+    AsyncCommand ExecuteWSLAsync(const std::string& command,
+                                 int timeout_seconds = 300,
+                                 CommandKind kind = CommandKind::kAction);
+
+    /**
+     * @brief Execute a network-bound WSL command with retries
+     * @param step_name Step name for logging
+     * @param command The command to execute in WSL
+     * @param timeout_seconds Timeout per attempt in seconds (default: 300)
+     * @return Pair of (exit_code, combined_output) of the last attempt
+     *
+     * Transient network failures are retried with backoff and fail over to
+     * the configured mirrors, see RunStepWithRetry.
+     */
+    std::pair<int, std::string> ExecuteWSLWithRetry(
+        const std::string& step_name, const std::string& command,
+        int timeout_seconds = 300);
 
     /**
      * @brief Check if a Windows feature is enabled
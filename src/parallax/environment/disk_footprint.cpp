@@ -0,0 +1,339 @@
+#include "disk_footprint.h"
+#include "software_installer.h"
+#include "environment_installer.h"
+#include "command_executor.h"
+#include "utils/prakasa_sessions.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kLxssKey =
+    "Software\\Microsoft\\Windows\\CurrentVersion\\Lxss";
+const uint64_t kGiB = 1024ULL * 1024 * 1024;
+
+// Check warns below this much free space next to the vhdx
+const uint64_t kLowHostFreeBytes = 20 * kGiB;
+// Slack between the vhdx and the guest's used blocks worth a warning, and
+// worth stopping the distro to shrink the vhdx
+const uint64_t kReclaimWarnBytes = 10 * kGiB;
+const uint64_t kReclaimShrinkBytes = 2 * kGiB;
+
+std::string ReadRegistryString(HKEY key, const char* subkey,
+                               const char* value) {
+    char buffer[MAX_PATH * 2];
+    DWORD size = sizeof(buffer);
+    if (RegGetValueA(key, subkey, value, RRF_RT_REG_SZ | RRF_RT_REG_EXPAND_SZ,
+                     nullptr, buffer, &size) != ERROR_SUCCESS) {
+        return "";
+    }
+    return buffer;
+}
+
+// Guest used and free bytes of / from one df call
+bool ProbeGuestFootprint(CommandExecutor& executor, DiskFootprint& footprint) {
+    auto [exit_code, output] =
+        executor.ExecuteWSL("df -B1 --output=used,avail / | tail -n 1", 30,
+                            CommandKind::kProbe);
+    unsigned long long used = 0, avail = 0;
+    if (exit_code != 0 ||
+        std::sscanf(output.c_str(), "%llu %llu", &used, &avail) != 2) {
+        return false;
+    }
+    footprint.guest_known = true;
+    footprint.guest_used_bytes = used;
+    footprint.guest_free_bytes = avail;
+    return true;
+}
+
+uint64_t ReclaimableBytes(const DiskFootprint& footprint) {
+    if (!footprint.guest_known ||
+        footprint.vhdx_bytes <= footprint.guest_used_bytes) {
+        return 0;
+    }
+    return footprint.vhdx_bytes - footprint.guest_used_bytes;
+}
+
+std::string DescribeFootprint(const DiskFootprint& footprint) {
+    std::string text = "ext4.vhdx uses " + FormatBytes(footprint.vhdx_bytes);
+    if (footprint.vhdx_sparse) {
+        text += " (sparse)";
+    }
+    if (footprint.guest_known) {
+        text += ", " + FormatBytes(footprint.guest_used_bytes) +
+                " used inside the distro";
+    }
+    return text + ", " + FormatBytes(footprint.host_free_bytes) +
+           " free on the host";
+}
+
+}  // namespace
+
+std::string LocateDistroVhdx(const std::string& ubuntu_version) {
+    HKEY lxss = nullptr;
+    if (RegOpenKeyExA(HKEY_CURRENT_USER, kLxssKey, 0, KEY_READ, &lxss) !=
+        ERROR_SUCCESS) {
+        return "";
+    }
+
+    std::string vhdx_path;
+    char guid[256];
+    for (DWORD index = 0;; ++index) {
+        DWORD guid_size = sizeof(guid);
+        if (RegEnumKeyExA(lxss, index, guid, &guid_size, nullptr, nullptr,
+                          nullptr, nullptr) != ERROR_SUCCESS) {
+            break;
+        }
+        std::string name = ReadRegistryString(lxss, guid, "DistributionName");
+        if (_stricmp(name.c_str(), ubuntu_version.c_str()) != 0) {
+            continue;
+        }
+        std::string base_path = ReadRegistryString(lxss, guid, "BasePath");
+        if (base_path.rfind("\\\\?\\", 0) == 0) {
+            base_path = base_path.substr(4);
+        }
+        std::string file_name = ReadRegistryString(lxss, guid, "VhdFileName");
+        if (!base_path.empty()) {
+            vhdx_path = parallax::utils::JoinPath(
+                base_path, file_name.empty() ? "ext4.vhdx" : file_name);
+        }
+        break;
+    }
+    RegCloseKey(lxss);
+    return vhdx_path;
+}
+
+bool ProbeHostFootprint(const std::string& ubuntu_version,
+                        DiskFootprint& footprint) {
+    footprint.vhdx_path = LocateDistroVhdx(ubuntu_version);
+    DWORD attributes = footprint.vhdx_path.empty()
+                           ? INVALID_FILE_ATTRIBUTES
+                           : GetFileAttributesA(footprint.vhdx_path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        footprint.vhdx_path.clear();
+        return false;
+    }
+    footprint.vhdx_sparse = (attributes & FILE_ATTRIBUTE_SPARSE_FILE) != 0;
+
+    // Allocated size: a sparse or compacted vhdx is smaller than its length
+    DWORD high = 0;
+    DWORD low = GetCompressedFileSizeA(footprint.vhdx_path.c_str(), &high);
+    if (low != INVALID_FILE_SIZE || GetLastError() == NO_ERROR) {
+        footprint.vhdx_bytes = (static_cast<uint64_t>(high) << 32) | low;
+    }
+
+    std::string directory = footprint.vhdx_path.substr(
+        0, footprint.vhdx_path.find_last_of('\\') + 1);
+    ULARGE_INTEGER free_bytes;
+    if (GetDiskFreeSpaceExA(directory.c_str(), &free_bytes, nullptr,
+                            nullptr)) {
+        footprint.host_free_bytes = free_bytes.QuadPart;
+    }
+    return true;
+}
+
+DiskFootprint ProbeDiskFootprint(const std::string& ubuntu_version,
+                                 CommandExecutor& executor) {
+    DiskFootprint footprint;
+    ProbeHostFootprint(ubuntu_version, footprint);
+    ProbeGuestFootprint(executor, footprint);
+    return footprint;
+}
+
+std::string CheckFreeSpace(const std::string& ubuntu_version,
+                           CommandExecutor& executor, int min_free_gib) {
+    uint64_t needed = static_cast<uint64_t>(min_free_gib) * kGiB;
+    DiskFootprint footprint;
+    // The vhdx grows into the host volume, so that side runs out first
+    if (ProbeHostFootprint(ubuntu_version, footprint) &&
+        footprint.host_free_bytes < needed) {
+        return FormatBytes(footprint.host_free_bytes) +
+               " free on the volume of " + footprint.vhdx_path + ", " +
+               std::to_string(min_free_gib) + " GiB needed";
+    }
+    if (ProbeGuestFootprint(executor, footprint) &&
+        footprint.guest_free_bytes < needed) {
+        return FormatBytes(footprint.guest_free_bytes) +
+               " free inside " + ubuntu_version + ", " +
+               std::to_string(min_free_gib) + " GiB needed";
+    }
+    return "";
+}
+
+std::string FormatBytes(uint64_t bytes) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f GiB",
+                  static_cast<double>(bytes) / kGiB);
+    return text;
+}
+
+// DiskFootprintManager implementation
+DiskFootprintManager::DiskFootprintManager(
+    std::shared_ptr<ExecutionContext> context,
+    std::shared_ptr<CommandExecutor> executor)
+    : BaseEnvironmentComponent(context), executor_(executor) {}
+
+ComponentResult DiskFootprintManager::Check() {
+    LogOperationStart("Checking");
+
+    DiskFootprint footprint =
+        ProbeDiskFootprint(context_->GetUbuntuVersion(), *executor_);
+    ComponentResult result =
+        footprint.vhdx_path.empty()
+            ? CreateWarningResult("Virtual disk of " +
+                                  context_->GetUbuntuVersion() + " not found")
+        : footprint.host_free_bytes < kLowHostFreeBytes
+            ? CreateWarningResult("Low disk space: " +
+                                  DescribeFootprint(footprint))
+        : ReclaimableBytes(footprint) >= kReclaimWarnBytes
+            ? CreateWarningResult(
+                  DescribeFootprint(footprint) + "; about " +
+                  FormatBytes(ReclaimableBytes(footprint)) +
+                  " can be reclaimed with 'prakasa install --only disk'")
+            : CreateSkippedResult(DescribeFootprint(footprint));
+
+    LogOperationResult("Checking", result);
+    return result;
+}
+
+ComponentResult DiskFootprintManager::Install() {
+    LogOperationStart("Installing");
+
+    const std::string& ubuntu_version = context_->GetUbuntuVersion();
+    DiskFootprint before;
+    if (!ProbeHostFootprint(ubuntu_version, before)) {
+        ComponentResult result = CreateWarningResult(
+            "Virtual disk of " + ubuntu_version + " not found");
+        LogOperationResult("Installing", result);
+        return result;
+    }
+
+    // Package caches are only needed again on the next install, which
+    // downloads what it lacks. The trim hands the freed blocks to the vhdx
+    info_log("[ENV] Cleaning package caches in WSL...");
+    auto [clean_code, clean_output] = executor_->ExecuteWSL(
+        "du -scb /var/cache/apt/archives /root/.cache/pip 2>/dev/null | "
+        "tail -n 1 | cut -f1; apt-get clean && rm -rf /root/.cache/pip && "
+        "sync && (fstrim / >/dev/null 2>&1 || true)",
+        600);
+    if (clean_code != 0) {
+        ComponentResult result = CreateFailureResult(
+            "Failed to clean package caches: " + clean_output, 27);
+        LogOperationResult("Installing", result);
+        return result;
+    }
+    uint64_t cache_bytes = std::strtoull(clean_output.c_str(), nullptr, 10);
+
+    DiskFootprint guest;
+    ProbeGuestFootprint(*executor_, guest);
+    before.guest_known = guest.guest_known;
+    before.guest_used_bytes = guest.guest_used_bytes;
+
+    // A sparse vhdx gave the trimmed blocks back already; otherwise the
+    // distro has to stop, which a running server would not survive
+    std::string method = "sparse";
+    std::string shrink_note;
+    if (!before.vhdx_sparse) {
+        if (ReclaimableBytes(before) < kReclaimShrinkBytes) {
+            method = "not shrunk, nothing to reclaim";
+        } else {
+            parallax::utils::PrakasaSessionProbe sessions =
+                parallax::utils::ProbePrakasaSessions(ubuntu_version);
+            if (!sessions.ok || !sessions.servers.empty()) {
+                shrink_note =
+                    "ext4.vhdx not shrunk while prakasa servers are running";
+            } else if (!ShrinkVhdx(before.vhdx_path, method)) {
+                shrink_note = "ext4.vhdx not shrunk: " + method;
+            }
+        }
+    }
+
+    DiskFootprint after;
+    ProbeHostFootprint(ubuntu_version, after);
+    uint64_t reclaimed = before.vhdx_bytes > after.vhdx_bytes
+                             ? before.vhdx_bytes - after.vhdx_bytes
+                             : 0;
+    std::string summary =
+        "Reclaimed " + FormatBytes(reclaimed) + " on the host (ext4.vhdx " +
+        FormatBytes(before.vhdx_bytes) + " -> " + FormatBytes(after.vhdx_bytes) +
+        ", " + (shrink_note.empty() ? method : "not shrunk") + "), " +
+        FormatBytes(cache_bytes) + " of package caches removed";
+
+    ComponentResult result =
+        shrink_note.empty()
+            ? CreateSuccessResult(summary)
+            : CreateWarningResult(summary + "; " + shrink_note);
+
+    LogOperationResult("Installing", result);
+    return result;
+}
+
+// Stop the distro, then make the vhdx sparse, which newer WSL releases
+// support, or compact it with diskpart. method receives what was done, or
+// why nothing was
+bool DiskFootprintManager::ShrinkVhdx(const std::string& vhdx_path,
+                                      std::string& method) {
+    const std::string& ubuntu_version = context_->GetUbuntuVersion();
+    info_log("[ENV] Stopping %s to shrink %s", ubuntu_version.c_str(),
+             vhdx_path.c_str());
+    executor_->ExecutePowerShell("wsl --terminate " + ubuntu_version, 60);
+
+    auto [sparse_code, sparse_output] = executor_->ExecutePowerShell(
+        "wsl --manage " + ubuntu_version + " --set-sparse true", 120);
+    if (sparse_code == 0) {
+        // Blocks trimmed before the switch are still allocated; trim again
+        // so the sparse file releases them
+        executor_->ExecuteWSL("fstrim / >/dev/null 2>&1 || true", 600);
+        method = "made sparse";
+        return true;
+    }
+    info_log("[ENV] Sparse vhdx not available, compacting instead: %s",
+             sparse_output.c_str());
+
+    if (!parallax::utils::IsAdmin()) {
+        method = "compacting requires administrator rights";
+        return false;
+    }
+
+    char temp_dir[MAX_PATH];
+    DWORD temp_length = GetTempPathA(MAX_PATH, temp_dir);
+    std::string script_path = parallax::utils::JoinPath(
+        temp_length > 0 ? std::string(temp_dir, temp_length) : ".",
+        "prakasa-compact-vdisk.txt");
+    {
+        std::ofstream script(script_path);
+        script << "select vdisk file=\"" << vhdx_path << "\"\n"
+               << "attach vdisk readonly\n"
+               << "compact vdisk\n"
+               << "detach vdisk\n"
+               << "exit\n";
+    }
+    auto [compact_code, compact_output] = executor_->ExecutePowerShell(
+        "diskpart /s '" + script_path + "'", 1800);
+    DeleteFileA(script_path.c_str());
+    if (compact_code != 0) {
+        method = "diskpart failed: " + compact_output;
+        return false;
+    }
+    method = "compacted";
+    return true;
+}
+
+EnvironmentComponent DiskFootprintManager::GetComponentType() const {
+    return EnvironmentComponent::kDiskFootprint;
+}
+
+std::string DiskFootprintManager::GetComponentName() const {
+    return "WSL Disk Footprint";
+}
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace parallax {
+namespace environment {
+
+class CommandExecutor;
+
+// Disk usage of the distro, seen from both sides of its ext4.vhdx
+struct DiskFootprint {
+    std::string vhdx_path;         // Empty when the distro was not found
+    uint64_t vhdx_bytes = 0;       // Allocated on the host, not the max size
+    bool vhdx_sparse = false;
+    uint64_t host_free_bytes = 0;  // Free space of the volume of the vhdx
+    bool guest_known = false;      // df answered
+    uint64_t guest_used_bytes = 0;
+    uint64_t guest_free_bytes = 0;
+};
+
+// Path of the distro's ext4.vhdx from its Lxss registry entry, empty if the
+// distro is not registered for this user
+std::string LocateDistroVhdx(const std::string& ubuntu_version);
+
+// Host side only (registry and file system, no wsl.exe call); false when the
+// vhdx was not found
+bool ProbeHostFootprint(const std::string& ubuntu_version,
+                        DiskFootprint& footprint);
+
+// Host side plus one df call inside the distro
+DiskFootprint ProbeDiskFootprint(const std::string& ubuntu_version,
+                                 CommandExecutor& executor);
+
+// Empty when the volume of the vhdx and the distro's root file system both
+// have min_free_gib GiB free, else a message naming the side that is short.
+// Sides that cannot be measured are not held against the step
+std::string CheckFreeSpace(const std::string& ubuntu_version,
+                           CommandExecutor& executor, int min_free_gib);
+
+// "12.3 GiB"
+std::string FormatBytes(uint64_t bytes);
+
+}  // namespace environment
+}  // namespace parallax
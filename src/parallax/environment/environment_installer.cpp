@@ -4,12 +4,47 @@
 #include "system_checker.h"
 #include "windows_feature_manager.h"
 #include "software_installer.h"
+#include "disk_footprint.h"
+#include "kernel_tuning.h"
 #include "utils/utils.h"
 #include "tinylog/tinylog.h"
+#include <algorithm>
+#include <cctype>
 
 namespace parallax {
 namespace environment {
 
+namespace {
+
+// Command line keys used by --only/--skip/--from
+const std::pair<EnvironmentComponent, const char*> kComponentKeys[] = {
+    {EnvironmentComponent::kOSVersion, "os"},
+    {EnvironmentComponent::kNvidiaGPU, "gpu"},
+    {EnvironmentComponent::kNvidiaDriver, "driver"},
+    {EnvironmentComponent::kWSL2, "wsl2"},
+    {EnvironmentComponent::kVirtualMachinePlatform, "vmp"},
+    {EnvironmentComponent::kWSLInstall, "wsl"},
+    {EnvironmentComponent::kBIOSVirtualization, "bios"},
+    {EnvironmentComponent::kWSL2Kernel, "kernel"},
+    {EnvironmentComponent::kWSL2DefaultVersion, "wsl-default"},
+    {EnvironmentComponent::kUbuntu, "ubuntu"},
+    {EnvironmentComponent::kCudaToolkit, "cuda"},
+    {EnvironmentComponent::kCargo, "cargo"},
+    {EnvironmentComponent::kNinja, "ninja"},
+    {EnvironmentComponent::kCompilerCache, "sccache"},
+    {EnvironmentComponent::kPipUpgrade, "pip"},
+    {EnvironmentComponent::kParallaxProject, "prakasa"},
+    {EnvironmentComponent::kKernelTuning, "tuning"},
+    {EnvironmentComponent::kDiskFootprint, "disk"}};
+
+bool Contains(const std::vector<EnvironmentComponent>& components,
+              EnvironmentComponent component) {
+    return std::find(components.begin(), components.end(), component) !=
+           components.end();
+}
+
+}  // namespace
+
 // Component name conversion function implementation
 std::string ComponentToString(EnvironmentComponent component) {
     switch (component) {
@@ -39,15 +74,119 @@ std::string ComponentToString(EnvironmentComponent component) {
             return "Rust Cargo";
         case EnvironmentComponent::kNinja:
             return "Ninja Build Tool";
+        case EnvironmentComponent::kCompilerCache:
+            return "Compiler Cache";
         case EnvironmentComponent::kPipUpgrade:
             return "pip Upgrade";
         case EnvironmentComponent::kParallaxProject:
             return "Parallax Project";
+        case EnvironmentComponent::kKernelTuning:
+            return "Guest Kernel Tuning";
+        case EnvironmentComponent::kDiskFootprint:
+            return "WSL Disk Footprint";
         default:
             return "Unknown";
     }
 }
 
+std::string ComponentToKey(EnvironmentComponent component) {
+    for (const auto& entry : kComponentKeys) {
+        if (entry.first == component) {
+            return entry.second;
+        }
+    }
+    return "unknown";
+}
+
+bool ParseComponentKey(const std::string& key,
+                       EnvironmentComponent& component) {
+    std::string lower_key = key;
+    std::transform(lower_key.begin(), lower_key.end(), lower_key.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    for (const auto& entry : kComponentKeys) {
+        if (lower_key == entry.second) {
+            component = entry.first;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string GetComponentKeyList() {
+    std::string keys;
+    for (const auto& entry : kComponentKeys) {
+        if (!keys.empty()) keys += ", ";
+        keys += entry.second;
+    }
+    return keys;
+}
+
+bool ParseComponentSelection(const std::vector<std::string>& args,
+                             ComponentSelection& selection,
+                             std::vector<std::string>& remaining_args,
+                             std::string& error) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        std::string option = args[i];
+        std::string value;
+        size_t equals = option.find('=');
+        if (option.compare(0, 2, "--") == 0 && equals != std::string::npos) {
+            value = option.substr(equals + 1);
+            option = option.substr(0, equals);
+        }
+
+        if (option != "--only" && option != "--skip" && option != "--from") {
+            remaining_args.push_back(args[i]);
+            continue;
+        }
+        if (equals == std::string::npos) {
+            if (i + 1 >= args.size()) {
+                error = "Missing component list after " + option;
+                return false;
+            }
+            value = args[++i];
+        }
+
+        std::vector<EnvironmentComponent> components;
+        size_t start = 0;
+        while (start <= value.size()) {
+            size_t comma = value.find(',', start);
+            std::string key = value.substr(
+                start, comma == std::string::npos ? std::string::npos
+                                                  : comma - start);
+            EnvironmentComponent component;
+            if (!key.empty()) {
+                if (!ParseComponentKey(key, component)) {
+                    error = "Unknown component '" + key + "'";
+                    return false;
+                }
+                components.push_back(component);
+            }
+            if (comma == std::string::npos) break;
+            start = comma + 1;
+        }
+        if (components.empty()) {
+            error = "Missing component list after " + option;
+            return false;
+        }
+
+        if (option == "--only") {
+            selection.only.insert(selection.only.end(), components.begin(),
+                                  components.end());
+        } else if (option == "--skip") {
+            selection.skip.insert(selection.skip.end(), components.begin(),
+                                  components.end());
+        } else {
+            if (components.size() != 1) {
+                error = "--from takes a single component";
+                return false;
+            }
+            selection.has_from = true;
+            selection.from = components[0];
+        }
+    }
+    return true;
+}
+
 std::string StatusToString(InstallationStatus status) {
     switch (status) {
         case InstallationStatus::kSuccess:
@@ -65,24 +204,29 @@ std::string StatusToString(InstallationStatus status) {
     }
 }
 
-// Component progress mapping
+// Typical install durations in seconds, replaced by the median recorded in
+// the install history once a component has been installed on this machine
+// class
 const std::map<EnvironmentComponent, int>
-    EnvironmentInstaller::component_progress_ = {
-        {EnvironmentComponent::kOSVersion, 5},
-        {EnvironmentComponent::kNvidiaGPU, 8},
-        {EnvironmentComponent::kNvidiaDriver, 10},
-        {EnvironmentComponent::kWSL2, 15},
+    EnvironmentInstaller::component_install_seconds_ = {
+        {EnvironmentComponent::kOSVersion, 1},
+        {EnvironmentComponent::kNvidiaGPU, 2},
+        {EnvironmentComponent::kNvidiaDriver, 2},
+        {EnvironmentComponent::kWSL2, 20},
         {EnvironmentComponent::kVirtualMachinePlatform, 20},
-        {EnvironmentComponent::kWSLInstall, 25},
-        {EnvironmentComponent::kBIOSVirtualization, 30},
-        {EnvironmentComponent::kWSL2Kernel, 35},
-        {EnvironmentComponent::kWSL2DefaultVersion, 40},
-        {EnvironmentComponent::kUbuntu, 45},
-        {EnvironmentComponent::kCudaToolkit, 60},
-        {EnvironmentComponent::kCargo, 70},
-        {EnvironmentComponent::kNinja, 80},
-        {EnvironmentComponent::kPipUpgrade, 90},
-        {EnvironmentComponent::kParallaxProject, 95}};
+        {EnvironmentComponent::kWSLInstall, 60},
+        {EnvironmentComponent::kBIOSVirtualization, 2},
+        {EnvironmentComponent::kWSL2Kernel, 30},
+        {EnvironmentComponent::kWSL2DefaultVersion, 5},
+        {EnvironmentComponent::kUbuntu, 180},
+        {EnvironmentComponent::kCudaToolkit, 900},
+        {EnvironmentComponent::kCargo, 120},
+        {EnvironmentComponent::kNinja, 30},
+        {EnvironmentComponent::kCompilerCache, 20},
+        {EnvironmentComponent::kPipUpgrade, 60},
+        {EnvironmentComponent::kParallaxProject, 600},
+        {EnvironmentComponent::kKernelTuning, 60},
+        {EnvironmentComponent::kDiskFootprint, 120}};
 
 EnvironmentInstaller::EnvironmentInstaller() {
     // Initialize core components
@@ -104,6 +248,9 @@ EnvironmentInstaller::~EnvironmentInstaller() {
 void EnvironmentInstaller::InitializeComponents() {
     // Get all component types and create instances
     auto all_components = ComponentFactory::GetAllComponents();
+    auto optional_components = ComponentFactory::GetOptionalComponents();
+    all_components.insert(all_components.end(), optional_components.begin(),
+                          optional_components.end());
 
     for (auto component_type : all_components) {
         auto component = ComponentFactory::CreateComponent(component_type,
@@ -115,7 +262,8 @@ void EnvironmentInstaller::InitializeComponents() {
 }
 
 EnvironmentResult EnvironmentInstaller::CheckEnvironment(
-    ComponentCheckCallback component_callback) {
+    ComponentCheckCallback component_callback,
+    const ComponentSelection& selection) {
     EnvironmentResult result;
     result.reboot_required = false;
 
@@ -137,8 +285,9 @@ EnvironmentResult EnvironmentInstaller::CheckEnvironment(
     }
     info_log(ENV_LOG_PREFIX "Administrator privileges check passed");
 
-    // Step 2: Check all components in order
-    auto check_order = ComponentFactory::GetAllComponents();
+    // Step 2: Check the selected components (all by default) in order
+    auto check_order = ComponentFactory::ResolveSelection(selection);
+    BeginProgressPlan(check_order, false);
 
     for (auto component_type : check_order) {
         auto component_it = components_.find(component_type);
@@ -194,7 +343,7 @@ EnvironmentResult EnvironmentInstaller::CheckEnvironment(
 }
 
 EnvironmentResult EnvironmentInstaller::InstallEnvironment(
-    ProgressCallback progress_callback) {
+    ProgressCallback progress_callback, const ComponentSelection& selection) {
     context_->SetProgressCallback(progress_callback);
     context_->ResetStop();
 
@@ -218,6 +367,13 @@ EnvironmentResult EnvironmentInstaller::InstallEnvironment(
     }
     info_log(ENV_LOG_PREFIX "Administrator privileges check passed");
 
+    if (!selection.IsEmpty()) {
+        return InstallSelectedComponents(
+            ComponentFactory::ResolveSelection(selection), selection);
+    }
+
+    BeginProgressPlan(ComponentFactory::GetAllComponents(), true);
+
     // Install components in phases
 
     // Phase 1: System checks (cannot be installed)
@@ -246,7 +402,8 @@ EnvironmentResult EnvironmentInstaller::InstallEnvironment(
 
     // Phase 2: Windows Features
     context_->ReportProgress("phase2_start",
-                             "Phase 2: Installing Windows features...", 15);
+                             "Phase 2: Installing Windows features...",
+                             GetPlanProgressPercent());
     info_log(ENV_LOG_PREFIX "Phase 2: Installing Windows features");
 
     auto windows_components = ComponentFactory::GetWindowsFeatureComponents();
@@ -280,7 +437,8 @@ EnvironmentResult EnvironmentInstaller::InstallEnvironment(
 
     // Phase 3: Software Components
     context_->ReportProgress("phase3_start",
-                             "Phase 3: Installing software components...", 60);
+                             "Phase 3: Installing software components...",
+                             GetPlanProgressPercent());
     info_log(ENV_LOG_PREFIX "Phase 3: Installing software components");
 
     auto software_components = ComponentFactory::GetSoftwareComponents();
@@ -338,6 +496,108 @@ bool EnvironmentInstaller::IsStopped() const {
 
 void EnvironmentInstaller::ResetStop() { context_->ResetStop(); }
 
+EnvironmentResult EnvironmentInstaller::InstallSelectedComponents(
+    const std::vector<EnvironmentComponent>& targets,
+    const ComponentSelection& selection) {
+    EnvironmentResult result;
+    result.reboot_required = false;
+    std::set<EnvironmentComponent> visited;
+
+    info_log(ENV_LOG_PREFIX "Installing %zu selected component(s)",
+             targets.size());
+    // Prerequisites found unmet on the way join the plan when they run
+    BeginProgressPlan(targets, true);
+
+    for (auto component_type : targets) {
+        // Unmet prerequisites first; a target that was already handled as a
+        // prerequisite of an earlier target is not run twice
+        if (!EnsurePrerequisites(component_type, selection, visited, result)) {
+            return result;
+        }
+        if (!visited.insert(component_type).second) continue;
+
+        auto component_it = components_.find(component_type);
+        if (component_it == components_.end()) continue;
+
+        ComponentResult comp_result =
+            ExecuteComponentOperation(component_it->second, true);  // Install
+        result.component_results.push_back(comp_result);
+
+        if (comp_result.status == InstallationStatus::kFailed) {
+            info_log(ENV_LOG_PREFIX "Selected component failed: %s",
+                     comp_result.message.c_str());
+            result.overall_message =
+                "Installation failed: " + comp_result.message;
+            return result;
+        }
+
+        ProcessRebootRequirements(result);
+        if (result.reboot_required) {
+            return result;
+        }
+
+        if (context_->IsStopRequested()) {
+            result.overall_message = "Installation interrupted by stop request";
+            return result;
+        }
+    }
+
+    context_->ReportProgress("install_complete", "Installation completed", 100);
+
+    result.overall_message = "Selected components installed successfully";
+    info_log(ENV_LOG_PREFIX "Selective installation completed");
+    return result;
+}
+
+bool EnvironmentInstaller::EnsurePrerequisites(
+    EnvironmentComponent component, const ComponentSelection& selection,
+    std::set<EnvironmentComponent>& visited, EnvironmentResult& result) {
+    for (auto dependency : ComponentFactory::GetDependencies(component)) {
+        if (!visited.insert(dependency).second) continue;
+        if (Contains(selection.skip, dependency)) continue;
+
+        auto component_it = components_.find(dependency);
+        if (component_it == components_.end()) continue;
+
+        // A met prerequisite implies its own prerequisites are met, so the
+        // graph is only walked further down along unmet components
+        ComponentResult check_result =
+            ExecuteComponentOperation(component_it->second, false);
+        if (check_result.status != InstallationStatus::kFailed) {
+            result.component_results.push_back(check_result);
+            continue;
+        }
+
+        info_log(ENV_LOG_PREFIX "Prerequisite %s of %s is not met",
+                 ComponentToString(dependency).c_str(),
+                 ComponentToString(component).c_str());
+        if (!EnsurePrerequisites(dependency, selection, visited, result)) {
+            return false;
+        }
+
+        ComponentResult install_result =
+            ExecuteComponentOperation(component_it->second, true);
+        result.component_results.push_back(install_result);
+        if (install_result.status == InstallationStatus::kFailed) {
+            result.overall_message = "Prerequisite " +
+                                     ComponentToString(dependency) +
+                                     " failed: " + install_result.message;
+            return false;
+        }
+
+        ProcessRebootRequirements(result);
+        if (result.reboot_required) {
+            return false;
+        }
+
+        if (context_->IsStopRequested()) {
+            result.overall_message = "Installation interrupted by stop request";
+            return false;
+        }
+    }
+    return true;
+}
+
 bool EnvironmentInstaller::CheckAdminPrivileges() {
     return parallax::utils::IsAdmin();
 }
@@ -345,11 +605,31 @@ bool EnvironmentInstaller::CheckAdminPrivileges() {
 ComponentResult EnvironmentInstaller::ExecuteComponentOperation(
     std::shared_ptr<IEnvironmentComponent> component, bool perform_installation,
     ComponentCheckCallback callback) {
-    ReportComponentProgress(component->GetComponentType(),
+    EnvironmentComponent type = component->GetComponentType();
+    uint64_t expected_ms = GetExpectedDurationMs(type, perform_installation);
+    auto pending = plan_pending_ms_.find(type);
+    if (pending != plan_pending_ms_.end()) {
+        expected_ms = pending->second;
+        plan_pending_ms_.erase(pending);
+    } else {
+        plan_total_ms_ += expected_ms;
+    }
+
+    ReportComponentProgress(type,
                             perform_installation ? "Installing" : "Checking");
 
+    uint64_t start_ms = parallax::utils::GetTickCountMs();
     ComponentResult result =
         perform_installation ? component->Install() : component->Check();
+    result.duration_ms = parallax::utils::GetTickCountMs() - start_ms;
+    plan_done_ms_ += expected_ms;
+
+    // Only real installs are representative; skipped ones took no work
+    if (perform_installation &&
+        result.status == InstallationStatus::kSuccess) {
+        context_->GetInstallHistory().RecordDuration(
+            "install:" + ComponentToKey(type), result.duration_ms);
+    }
 
     if (callback) {
         callback(result);
@@ -358,10 +638,45 @@ ComponentResult EnvironmentInstaller::ExecuteComponentOperation(
     return result;
 }
 
-int EnvironmentInstaller::GetProgressPercentForComponent(
-    EnvironmentComponent component) {
-    auto it = component_progress_.find(component);
-    return (it != component_progress_.end()) ? it->second : 50;
+void EnvironmentInstaller::BeginProgressPlan(
+    const std::vector<EnvironmentComponent>& plan, bool installation) {
+    plan_total_ms_ = 0;
+    plan_done_ms_ = 0;
+    plan_pending_ms_.clear();
+    for (auto component : plan) {
+        uint64_t expected_ms = GetExpectedDurationMs(component, installation);
+        plan_pending_ms_[component] = expected_ms;
+        plan_total_ms_ += expected_ms;
+    }
+    info_log(ENV_LOG_PREFIX "Progress plan: %zu component(s), about %s",
+             plan.size(),
+             InstallHistory::FormatDuration(plan_total_ms_).c_str());
+}
+
+uint64_t EnvironmentInstaller::GetExpectedDurationMs(
+    EnvironmentComponent component, bool installation) const {
+    // Checks are short and roughly uniform
+    if (!installation) {
+        return 2000;
+    }
+
+    uint64_t typical_ms = 0;
+    if (context_->GetInstallHistory().GetTypicalDuration(
+            "install:" + ComponentToKey(component), typical_ms)) {
+        return (std::max)(typical_ms, static_cast<uint64_t>(1000));
+    }
+    auto it = component_install_seconds_.find(component);
+    int seconds = (it != component_install_seconds_.end()) ? it->second : 30;
+    return static_cast<uint64_t>(seconds) * 1000;
+}
+
+int EnvironmentInstaller::GetPlanProgressPercent() const {
+    if (plan_total_ms_ == 0) {
+        return 0;
+    }
+    // 100 is reserved for the completion report
+    uint64_t percent = plan_done_ms_ * 100 / plan_total_ms_;
+    return static_cast<int>((std::min)(percent, static_cast<uint64_t>(99)));
 }
 
 void EnvironmentInstaller::ReportComponentProgress(
@@ -370,8 +685,13 @@ void EnvironmentInstaller::ReportComponentProgress(
         "op_" + operation + "_" + std::to_string(static_cast<int>(component));
     std::string message =
         operation + " " + ComponentToString(component) + "...";
-    context_->ReportProgress(progress_id, message,
-                             GetProgressPercentForComponent(component));
+    if (plan_total_ms_ > plan_done_ms_ + 60000) {
+        message += " (about " +
+                   InstallHistory::FormatDuration(plan_total_ms_ -
+                                                  plan_done_ms_) +
+                   " left)";
+    }
+    context_->ReportProgress(progress_id, message, GetPlanProgressPercent());
 }
 
 bool EnvironmentInstaller::CheckIfRebootRequired(
@@ -468,11 +788,18 @@ std::shared_ptr<IEnvironmentComponent> ComponentFactory::CreateComponent(
             return std::make_shared<CargoInstaller>(context, executor);
         case EnvironmentComponent::kNinja:
             return std::make_shared<NinjaInstaller>(context, executor);
+        case EnvironmentComponent::kCompilerCache:
+            return std::make_shared<CompilerCacheInstaller>(context,
+                                                            executor);
         case EnvironmentComponent::kPipUpgrade:
             return std::make_shared<PipUpgradeManager>(context, executor);
         case EnvironmentComponent::kParallaxProject:
             return std::make_shared<ParallaxProjectInstaller>(context,
                                                               executor);
+        case EnvironmentComponent::kKernelTuning:
+            return std::make_shared<KernelTuningManager>(context, executor);
+        case EnvironmentComponent::kDiskFootprint:
+            return std::make_shared<DiskFootprintManager>(context, executor);
         default:
             return nullptr;
     }
@@ -492,8 +819,14 @@ std::vector<EnvironmentComponent> ComponentFactory::GetAllComponents() {
             EnvironmentComponent::kCudaToolkit,
             EnvironmentComponent::kCargo,
             EnvironmentComponent::kNinja,
+            EnvironmentComponent::kCompilerCache,
             EnvironmentComponent::kPipUpgrade,
-            EnvironmentComponent::kParallaxProject};
+            EnvironmentComponent::kParallaxProject,
+            EnvironmentComponent::kDiskFootprint};
+}
+
+std::vector<EnvironmentComponent> ComponentFactory::GetOptionalComponents() {
+    return {EnvironmentComponent::kKernelTuning};
 }
 
 std::vector<EnvironmentComponent> ComponentFactory::GetSystemComponents() {
@@ -514,8 +847,80 @@ ComponentFactory::GetWindowsFeatureComponents() {
 
 std::vector<EnvironmentComponent> ComponentFactory::GetSoftwareComponents() {
     return {EnvironmentComponent::kCudaToolkit, EnvironmentComponent::kCargo,
-            EnvironmentComponent::kNinja, EnvironmentComponent::kPipUpgrade,
-            EnvironmentComponent::kParallaxProject};
+            EnvironmentComponent::kNinja, EnvironmentComponent::kCompilerCache,
+            EnvironmentComponent::kPipUpgrade,
+            EnvironmentComponent::kParallaxProject,
+            EnvironmentComponent::kDiskFootprint};
+}
+
+std::string ComponentFactory::GetComponentCategory(EnvironmentComponent type) {
+    if (Contains(GetSystemComponents(), type)) return "system";
+    if (Contains(GetWindowsFeatureComponents(), type)) return "windows_feature";
+    return "software";
+}
+
+std::vector<EnvironmentComponent> ComponentFactory::GetDependencies(
+    EnvironmentComponent type) {
+    switch (type) {
+        case EnvironmentComponent::kNvidiaDriver:
+            return {EnvironmentComponent::kNvidiaGPU};
+        case EnvironmentComponent::kWSL2:
+        case EnvironmentComponent::kVirtualMachinePlatform:
+            return {EnvironmentComponent::kOSVersion};
+        case EnvironmentComponent::kWSLInstall:
+            return {EnvironmentComponent::kWSL2,
+                    EnvironmentComponent::kVirtualMachinePlatform};
+        case EnvironmentComponent::kBIOSVirtualization:
+            return {EnvironmentComponent::kVirtualMachinePlatform};
+        case EnvironmentComponent::kWSL2Kernel:
+            return {EnvironmentComponent::kWSLInstall};
+        case EnvironmentComponent::kWSL2DefaultVersion:
+            return {EnvironmentComponent::kWSL2Kernel};
+        case EnvironmentComponent::kUbuntu:
+            return {EnvironmentComponent::kWSL2DefaultVersion};
+        case EnvironmentComponent::kCudaToolkit:
+            return {EnvironmentComponent::kNvidiaDriver,
+                    EnvironmentComponent::kUbuntu};
+        case EnvironmentComponent::kCargo:
+        case EnvironmentComponent::kNinja:
+        case EnvironmentComponent::kCompilerCache:
+        case EnvironmentComponent::kPipUpgrade:
+        case EnvironmentComponent::kKernelTuning:
+        case EnvironmentComponent::kDiskFootprint:
+            return {EnvironmentComponent::kUbuntu};
+        case EnvironmentComponent::kParallaxProject:
+            return {EnvironmentComponent::kCudaToolkit,
+                    EnvironmentComponent::kCargo, EnvironmentComponent::kNinja,
+                    EnvironmentComponent::kPipUpgrade};
+        default:
+            return {};
+    }
+}
+
+std::vector<EnvironmentComponent> ComponentFactory::ResolveSelection(
+    const ComponentSelection& selection) {
+    std::vector<EnvironmentComponent> resolved;
+    auto run_order = GetAllComponents();
+    auto optional_components = GetOptionalComponents();
+    run_order.insert(run_order.end(), optional_components.begin(),
+                     optional_components.end());
+
+    bool started = !selection.has_from;
+    for (auto component : run_order) {
+        if (!started && component == selection.from) {
+            started = true;
+        }
+        if (!started) continue;
+        // Optional components only run when named with --only
+        if (Contains(optional_components, component) &&
+            !Contains(selection.only, component))
+            continue;
+        if (!selection.only.empty() && !Contains(selection.only, component))
+            continue;
+        if (Contains(selection.skip, component)) continue;
+        resolved.push_back(component);
+    }
+    return resolved;
 }
 
 }  // namespace environment
@@ -6,6 +6,8 @@
 #include <functional>
 #include <atomic>
 #include <map>
+#include <set>
+#include <cstdint>
 #include "utils/wsl_process.h"
 
 // Environment-related log prefix identifier
@@ -33,11 +35,14 @@ enum class EnvironmentComponent {
     kUbuntu,                  // Ubuntu distribution
     kBIOSVirtualization,      // BIOS virtualization detection
     // Extended mode components
-    kCudaToolkit,     // CUDA Toolkit 12.8
-    kCargo,           // Rust Cargo
-    kNinja,           // Ninja build tool
-    kPipUpgrade,      // pip upgrade
-    kParallaxProject  // Parallax project installation
+    kCudaToolkit,      // CUDA Toolkit 12.8
+    kCargo,            // Rust Cargo
+    kNinja,            // Ninja build tool
+    kCompilerCache,    // sccache compiler cache
+    kPipUpgrade,       // pip upgrade
+    kParallaxProject,  // Parallax project installation
+    kKernelTuning,     // Guest sysctl/THP/limits profile for inference
+    kDiskFootprint     // WSL disk cleanup and vhdx compaction
 };
 
 // Installation status enumeration - represents the current state of each
@@ -57,10 +62,15 @@ struct ComponentResult {
     InstallationStatus status;
     std::string message;
     int error_code;
+    uint64_t duration_ms;  // Wall time of the check/install operation
 
     ComponentResult(EnvironmentComponent comp, InstallationStatus stat,
                     const std::string& msg, int code = 0)
-        : component(comp), status(stat), message(msg), error_code(code) {}
+        : component(comp),
+          status(stat),
+          message(msg),
+          error_code(code),
+          duration_ms(0) {}
 };
 
 // Progress callback function type - used to report installation progress
@@ -72,6 +82,17 @@ using ProgressCallback = std::function<void(
 using ComponentCheckCallback =
     std::function<void(const ComponentResult& result)>;
 
+// Component subset selected on the command line (--only, --skip, --from).
+// An empty selection means every component
+struct ComponentSelection {
+    std::vector<EnvironmentComponent> only;  // Run just these
+    std::vector<EnvironmentComponent> skip;  // Never run these
+    bool has_from = false;                   // Start at 'from' in run order
+    EnvironmentComponent from = EnvironmentComponent::kOSVersion;
+
+    bool IsEmpty() const { return only.empty() && skip.empty() && !has_from; }
+};
+
 // Overall environment check and installation result
 struct EnvironmentResult {
     std::vector<ComponentResult> component_results;
@@ -92,10 +113,12 @@ class EnvironmentInstaller {
 
     // Main public interface
     EnvironmentResult CheckEnvironment(
-        ComponentCheckCallback component_callback = nullptr);
+        ComponentCheckCallback component_callback = nullptr,
+        const ComponentSelection& selection = ComponentSelection());
 
     EnvironmentResult InstallEnvironment(
-        ProgressCallback progress_callback = nullptr);
+        ProgressCallback progress_callback = nullptr,
+        const ComponentSelection& selection = ComponentSelection());
 
     // Configuration methods
     void SetSilentMode(bool silent);
@@ -119,18 +142,36 @@ class EnvironmentInstaller {
         std::shared_ptr<IEnvironmentComponent> component,
         bool perform_installation, ComponentCheckCallback callback = nullptr);
 
-    // Progress tracking
-    int GetProgressPercentForComponent(EnvironmentComponent component);
+    // Progress tracking, weighted by expected component durations
+    void BeginProgressPlan(const std::vector<EnvironmentComponent>& plan,
+                           bool installation);
+    uint64_t GetExpectedDurationMs(EnvironmentComponent component,
+                                   bool installation) const;
+    int GetPlanProgressPercent() const;
     void ReportComponentProgress(EnvironmentComponent component,
                                  const std::string& operation);
 
+    // Selective installation: selected components plus unmet prerequisites
+    EnvironmentResult InstallSelectedComponents(
+        const std::vector<EnvironmentComponent>& targets,
+        const ComponentSelection& selection);
+    bool EnsurePrerequisites(EnvironmentComponent component,
+                             const ComponentSelection& selection,
+                             std::set<EnvironmentComponent>& visited,
+                             EnvironmentResult& result);
+
     // Result processing
     bool CheckIfRebootRequired(const ComponentResult& result);
     void ProcessVirtualizationResults(std::vector<ComponentResult>& results);
     void ProcessRebootRequirements(EnvironmentResult& result);
 
-    // Component progress mapping
-    static const std::map<EnvironmentComponent, int> component_progress_;
+    // Expected install durations (seconds) until history is available
+    static const std::map<EnvironmentComponent, int> component_install_seconds_;
+
+    // Current run plan: expected total, completed share and pending parts
+    uint64_t plan_total_ms_ = 0;
+    uint64_t plan_done_ms_ = 0;
+    std::map<EnvironmentComponent, uint64_t> plan_pending_ms_;
 };
 
 /**
@@ -143,13 +184,41 @@ class ComponentFactory {
         std::shared_ptr<CommandExecutor> executor);
 
     static std::vector<EnvironmentComponent> GetAllComponents();
+    // Opt-in components, left out of GetAllComponents() and run only when
+    // selected with --only
+    static std::vector<EnvironmentComponent> GetOptionalComponents();
     static std::vector<EnvironmentComponent> GetSystemComponents();
     static std::vector<EnvironmentComponent> GetWindowsFeatureComponents();
     static std::vector<EnvironmentComponent> GetSoftwareComponents();
+
+    // "system", "windows_feature" or "software"
+    static std::string GetComponentCategory(EnvironmentComponent type);
+
+    // Direct prerequisites of a component
+    static std::vector<EnvironmentComponent> GetDependencies(
+        EnvironmentComponent type);
+
+    // Components a selection runs, in GetAllComponents() order followed by
+    // the optional components named in --only
+    static std::vector<EnvironmentComponent> ResolveSelection(
+        const ComponentSelection& selection);
 };
 
 // Component name conversion functions
 std::string ComponentToString(EnvironmentComponent component);
+// Short command line key (e.g. "cuda", "prakasa")
+std::string ComponentToKey(EnvironmentComponent component);
+bool ParseComponentKey(const std::string& key, EnvironmentComponent& component);
+// All keys, comma separated, for help and error messages
+std::string GetComponentKeyList();
+
+// Extract --only/--skip/--from ("--only cuda,pip" or "--only=cuda,pip")
+// from args. Other arguments are returned in remaining_args. Returns false
+// with error set for unknown keys or a missing value
+bool ParseComponentSelection(const std::vector<std::string>& args,
+                             ComponentSelection& selection,
+                             std::vector<std::string>& remaining_args,
+                             std::string& error);
 std::string StatusToString(InstallationStatus status);
 
 }  // namespace environment
@@ -0,0 +1,169 @@
+#include "install_history.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kHistoryFileName = "install_history.txt";
+
+// Nearest-rank percentile of an unsorted sample list
+uint64_t Percentile(std::vector<uint64_t> values, double percentile) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(
+        std::ceil(percentile / 100.0 * static_cast<double>(values.size())));
+    rank = (std::max)(rank, static_cast<size_t>(1));
+    return values[(std::min)(rank, values.size()) - 1];
+}
+
+}  // namespace
+
+InstallHistory::InstallHistory()
+    : history_path_(
+          utils::JoinPath(utils::GetAppBinDir(), kHistoryFileName)),
+      machine_class_(DetectMachineClass()) {
+    Load();
+}
+
+void InstallHistory::RecordDuration(const std::string& step,
+                                    uint64_t duration_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<uint64_t>& samples = samples_[machine_class_ + "|" + step];
+    samples.push_back(duration_ms);
+    if (samples.size() > kMaxSamples) {
+        samples.erase(samples.begin(),
+                      samples.begin() + (samples.size() - kMaxSamples));
+    }
+    if (!Save()) {
+        warn_log("Failed to save install history to %s",
+                 history_path_.c_str());
+    }
+}
+
+bool InstallHistory::GetTypicalDuration(const std::string& step,
+                                        uint64_t& duration_ms) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = samples_.find(machine_class_ + "|" + step);
+    if (it == samples_.end() || it->second.empty()) {
+        return false;
+    }
+    duration_ms = Percentile(it->second, 50.0);
+    return true;
+}
+
+int InstallHistory::GetAdaptiveTimeout(const std::string& step,
+                                       int default_timeout_seconds) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = samples_.find(machine_class_ + "|" + step);
+    if (it == samples_.end() || it->second.size() < kMinSamplesForTimeout) {
+        return default_timeout_seconds;
+    }
+
+    double p99_seconds = Percentile(it->second, 99.0) / 1000.0;
+    int timeout =
+        static_cast<int>(std::ceil(p99_seconds * kTimeoutSafetyFactor));
+    timeout = (std::max)(timeout, kMinTimeoutSeconds);
+    timeout = (std::min)(timeout, default_timeout_seconds);
+    if (timeout != default_timeout_seconds) {
+        debug_log("Adaptive timeout for %s: %ds (p99 %.0fs, %zu samples)",
+                  step.c_str(), timeout, p99_seconds, it->second.size());
+    }
+    return timeout;
+}
+
+std::string InstallHistory::FormatDuration(uint64_t duration_ms) {
+    uint64_t seconds = (duration_ms + 500) / 1000;
+    std::ostringstream out;
+    if (seconds >= 3600) {
+        out << seconds / 3600 << "h" << (seconds % 3600) / 60 << "m";
+    } else if (seconds >= 60) {
+        out << seconds / 60 << "m" << seconds % 60 << "s";
+    } else {
+        out << seconds << "s";
+    }
+    return out.str();
+}
+
+// One line per step: "<machine class>|<step>|<ms>,<ms>,..."
+void InstallHistory::Load() {
+    std::ifstream file(history_path_);
+    if (!file.is_open()) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = utils::TrimNewlines(line);
+        size_t separator = line.find_last_of('|');
+        if (line.empty() || separator == std::string::npos ||
+            line.find('|') == separator) {
+            continue;
+        }
+
+        std::vector<uint64_t> samples;
+        std::stringstream values(line.substr(separator + 1));
+        std::string value;
+        while (std::getline(values, value, ',')) {
+            uint64_t duration_ms = std::strtoull(value.c_str(), nullptr, 10);
+            if (duration_ms > 0) {
+                samples.push_back(duration_ms);
+            }
+        }
+        if (samples.size() > kMaxSamples) {
+            samples.erase(samples.begin(),
+                          samples.begin() + (samples.size() - kMaxSamples));
+        }
+        if (!samples.empty()) {
+            samples_[line.substr(0, separator)] = samples;
+        }
+    }
+    debug_log("Loaded install history for %zu step(s) from %s",
+              samples_.size(), history_path_.c_str());
+}
+
+bool InstallHistory::Save() const {
+    std::ofstream file(history_path_, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << "# Install step durations in ms, maintained by prakasa\n";
+    for (const auto& entry : samples_) {
+        file << entry.first << "|";
+        for (size_t i = 0; i < entry.second.size(); ++i) {
+            file << (i == 0 ? "" : ",") << entry.second[i];
+        }
+        file << "\n";
+    }
+    return file.good();
+}
+
+std::string InstallHistory::DetectMachineClass() {
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+
+    MEMORYSTATUSEX memory_status;
+    memory_status.dwLength = sizeof(memory_status);
+    uint64_t memory_gb = 0;
+    if (GlobalMemoryStatusEx(&memory_status)) {
+        // Round to the nearest GB, the firmware reserve makes 32 GB read 31.8
+        memory_gb = (memory_status.ullTotalPhys + (512ULL << 20)) >> 30;
+    }
+
+    return "c" + std::to_string(system_info.dwNumberOfProcessors) + "-m" +
+           std::to_string(memory_gb);
+}
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace parallax {
+namespace environment {
+
+/**
+ * @brief Local history of install step durations
+ *
+ * Durations are kept per step and per machine class (logical cores and RAM
+ * bucket) in install_history.txt next to the executable. They drive the
+ * install ETA, the weighted progress bar and adaptive step timeouts.
+ */
+class InstallHistory {
+ public:
+    InstallHistory();
+    ~InstallHistory() = default;
+
+    // Record a successful run of step on this machine class and persist it
+    void RecordDuration(const std::string& step, uint64_t duration_ms);
+
+    // Median of the recorded durations, false if the step has no history
+    bool GetTypicalDuration(const std::string& step,
+                            uint64_t& duration_ms) const;
+
+    // Timeout for a step: observed p99 times the safety factor, never above
+    // the hard-coded default and never below the floor. Falls back to the
+    // default until enough samples exist. Only meant for local steps, a
+    // network-bound step's no-op runs would collapse it
+    int GetAdaptiveTimeout(const std::string& step,
+                           int default_timeout_seconds) const;
+
+    // e.g. "c16-m32" for 16 logical cores and 32 GB of RAM
+    const std::string& GetMachineClass() const { return machine_class_; }
+
+    // Format a duration for progress messages, e.g. "4m10s"
+    static std::string FormatDuration(uint64_t duration_ms);
+
+ private:
+    static constexpr size_t kMaxSamples = 20;     // Per step, newest kept
+    static constexpr size_t kMinSamplesForTimeout = 3;
+    static constexpr int kMinTimeoutSeconds = 120;
+    static constexpr double kTimeoutSafetyFactor = 3.0;
+
+    void Load();
+    bool Save() const;
+    static std::string DetectMachineClass();
+
+    std::string history_path_;
+    std::string machine_class_;
+    // "<machine class>|<step>" -> durations in ms, oldest first
+    std::map<std::string, std::vector<uint64_t>> samples_;
+    mutable std::mutex mutex_;
+};
+
+}  // namespace environment
+}  // namespace parallax
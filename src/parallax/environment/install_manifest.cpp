@@ -0,0 +1,518 @@
+#include "install_manifest.h"
+#include "base_component.h"
+#include "command_executor.h"
+#include "disk_footprint.h"
+#include "install_history.h"
+#include "retry_policy.h"
+#include "config/config_manager.h"
+#include "utils/wsl_process.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kStampFile = "/var/lib/prakasa/install-stamps";
+
+// Keys: run, timeout (seconds, default 300), realtime, always, input
+// (repeatable), input_probe, output (repeatable, a path the step creates),
+// verify, skip_if, min_free_gib (checked on the
+// host volume of the vhdx and inside the distro before the step runs, so a
+// full disk fails up front instead of midway). ${name} expands to a variable
+// of the installer or a configuration item; the proxy is applied by the
+// runner, so commands never splice it in themselves
+const char* const kEmbeddedManifest = R"MANIFEST(
+# CUDA Toolkit 12.8
+[cuda.download_cuda_keyring]
+run = wget -q -O /tmp/cuda-keyring_1.1-1_all.deb \
+      https://developer.download.nvidia.com/compute/cuda/repos/wsl-ubuntu/x86_64/cuda-keyring_1.1-1_all.deb
+output = /tmp/cuda-keyring_1.1-1_all.deb
+skip_if = dpkg -s cuda-keyring >/dev/null 2>&1
+
+[cuda.install_cuda_keyring]
+run = dpkg -i /tmp/cuda-keyring_1.1-1_all.deb
+output = /usr/share/keyrings/cuda-archive-keyring.gpg
+skip_if = dpkg -s cuda-keyring >/dev/null 2>&1
+timeout = 60
+
+[cuda.update_package_list]
+run = apt-get update
+always = true
+
+[cuda.install_cuda_toolkit]
+run = apt-get -y install cuda-toolkit-12-8
+output = /usr/local/cuda-12.8/bin/nvcc
+verify = dpkg -s cuda-toolkit-12-8 >/dev/null 2>&1
+timeout = 1200
+realtime = true
+min_free_gib = 12
+
+[cuda.add_cuda_to_bashrc]
+run = grep -q '/usr/local/cuda-12.8/bin' ~/.bashrc || \
+      echo 'export PATH=/usr/local/cuda-12.8/bin:$PATH' >> ~/.bashrc
+timeout = 60
+
+[cuda.add_cuda_lib_to_bashrc]
+run = grep -q '/usr/local/cuda-12.8/lib64' ~/.bashrc || \
+      echo 'export LD_LIBRARY_PATH=/usr/local/cuda-12.8/lib64:$LD_LIBRARY_PATH' >> ~/.bashrc
+timeout = 60
+
+[cuda.add_cuda_to_profile]
+run = grep -q '/usr/local/cuda-12.8/bin' /etc/profile || \
+      echo 'export PATH=/usr/local/cuda-12.8/bin:$PATH' >> /etc/profile
+timeout = 60
+
+[cuda.add_cuda_lib_to_profile]
+run = grep -q '/usr/local/cuda-12.8/lib64' /etc/profile || \
+      echo 'export LD_LIBRARY_PATH=/usr/local/cuda-12.8/lib64:$LD_LIBRARY_PATH' >> /etc/profile
+timeout = 60
+
+[cuda.create_cuda_env_script]
+run = echo -e '#!/bin/bash\nexport PATH=/usr/local/cuda-12.8/bin:$PATH\nexport LD_LIBRARY_PATH=/usr/local/cuda-12.8/lib64:$LD_LIBRARY_PATH' \
+      > /etc/profile.d/cuda.sh && chmod +x /etc/profile.d/cuda.sh
+output = /etc/profile.d/cuda.sh
+verify = [ -x /etc/profile.d/cuda.sh ]
+timeout = 60
+
+# Prakasa project
+[prakasa.remove_old_prakasa]
+run = [ -d ~/prakasa/.git ] || rm -rf ~/prakasa
+always = true
+timeout = 60
+
+[prakasa.clone_prakasa]
+run = cd ~ && git clone -b ${prakasa_git_branch} ${prakasa_git_repo_url}
+output = ~/prakasa/.git
+skip_if = [ -d ~/prakasa/.git ]
+always = true
+timeout = 600
+
+[prakasa.update_parallax]
+run = cd ~/prakasa && git checkout ${prakasa_git_branch} && git pull
+always = true
+
+[prakasa.install_python3_venv]
+run = apt-get update && apt-get install -y python3-venv
+verify = dpkg -s python3-venv >/dev/null 2>&1
+
+# pip install is repeated only when the checkout or the index changed
+[prakasa.install_prakasa_base]
+run = ${build_exports} && cd ~/prakasa && ([ -d ./venv ] || python3 -m venv ./venv) && \
+      source ./venv/bin/activate && pip install ${pip_index_option} -e '.[gpu]'
+input = ${pip_index_url}
+input_probe = cd ~/prakasa && git rev-parse HEAD
+output = ~/prakasa/venv/bin/python
+verify = cd ~/prakasa && ./venv/bin/pip list 2>/dev/null | grep -q prakasa
+timeout = 1800
+realtime = true
+min_free_gib = 15
+
+[prakasa.add_cuda_env]
+run = grep -q '/usr/local/cuda-12.8/bin' ~/.bashrc || \
+      echo 'export PATH=/usr/local/cuda-12.8/bin:$PATH' >> ~/.bashrc
+timeout = 30
+
+# compileall is incremental by itself; the stamp saves the scan
+[prakasa.precompile_bytecode]
+run = cd ~/prakasa && ./venv/bin/python -m compileall -q -j0 \
+      ./venv/lib/python3*/site-packages ./src >/dev/null || \
+      echo 'compileall reported errors, ignored'
+input_probe = cd ~/prakasa && git rev-parse HEAD && ./venv/bin/pip freeze 2>/dev/null | md5sum
+timeout = 900
+)MANIFEST";
+
+std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+// FNV-1a, enough to tell whether the inputs of a step changed
+uint64_t HashText(uint64_t hash, const std::string& text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    // Separator, so ("ab", "c") and ("a", "bc") differ
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+// "[ -e a ] && [ -e b ]", empty without outputs. Paths are left unquoted so
+// that ~ expands
+std::string BuildOutputsProbe(
+    const std::vector<std::string>& outputs,
+    const std::map<std::string, std::string>& variables) {
+    std::string probe;
+    for (const auto& output : outputs) {
+        probe += (probe.empty() ? "" : " && ") + std::string("[ -e ") +
+                 ExpandManifestVariables(output, variables) + " ]";
+    }
+    return probe;
+}
+
+std::string BuildProxyExports(const std::string& proxy_url) {
+    if (proxy_url.empty()) {
+        return "";
+    }
+    return "export ALL_PROXY=" + proxy_url + " HTTP_PROXY=" + proxy_url +
+           " HTTPS_PROXY=" + proxy_url + " http_proxy=" + proxy_url +
+           " https_proxy=" + proxy_url + " && ";
+}
+
+}  // namespace
+
+InstallManifest InstallManifest::Parse(const std::string& text,
+                                       std::string* error) {
+    InstallManifest manifest;
+    std::istringstream stream(text);
+    std::string raw_line;
+    std::string line;
+    int line_number = 0;
+    auto fail = [&](const std::string& message) {
+        if (error && error->empty()) {
+            *error = "line " + std::to_string(line_number) + ": " + message;
+        }
+    };
+
+    while (std::getline(stream, raw_line)) {
+        ++line_number;
+        raw_line = Trim(raw_line);
+
+        // "\" at the end joins the next line with a single space
+        if (!raw_line.empty() && raw_line.back() == '\\') {
+            raw_line.pop_back();
+            line += Trim(raw_line) + " ";
+            continue;
+        }
+        line += raw_line;
+        std::string current = Trim(line);
+        line.clear();
+        if (current.empty() || current[0] == '#') {
+            continue;
+        }
+
+        if (current.front() == '[') {
+            size_t dot = current.find('.');
+            if (current.back() != ']' || dot == std::string::npos) {
+                fail("expected [component.step]");
+                continue;
+            }
+            ManifestStep step;
+            step.component = current.substr(1, dot - 1);
+            step.name = current.substr(dot + 1, current.size() - dot - 2);
+            manifest.steps_.push_back(step);
+            continue;
+        }
+
+        size_t equals = current.find('=');
+        if (equals == std::string::npos || manifest.steps_.empty()) {
+            fail("expected key = value inside a step");
+            continue;
+        }
+        std::string key = Trim(current.substr(0, equals));
+        std::string value = Trim(current.substr(equals + 1));
+        ManifestStep& step = manifest.steps_.back();
+        if (key == "run") {
+            step.run = value;
+        } else if (key == "timeout") {
+            step.timeout_seconds = std::atoi(value.c_str());
+        } else if (key == "realtime") {
+            step.realtime = (value == "true");
+        } else if (key == "always") {
+            step.always = (value == "true");
+        } else if (key == "input") {
+            step.inputs.push_back(value);
+        } else if (key == "input_probe") {
+            step.input_probe = value;
+        } else if (key == "output") {
+            step.outputs.push_back(value);
+        } else if (key == "verify") {
+            step.verify = value;
+        } else if (key == "skip_if") {
+            step.skip_if = value;
+        } else if (key == "min_free_gib") {
+            step.min_free_gib = std::atoi(value.c_str());
+        } else {
+            fail("unknown key '" + key + "'");
+        }
+    }
+
+    for (const auto& step : manifest.steps_) {
+        if (step.run.empty()) {
+            fail("step " + step.GetId() + " has no run command");
+        }
+    }
+    return manifest;
+}
+
+const InstallManifest& InstallManifest::GetEmbedded() {
+    static const InstallManifest manifest = [] {
+        std::string error;
+        InstallManifest parsed = Parse(kEmbeddedManifest, &error);
+        if (!error.empty()) {
+            error_log("[ENV] Embedded install manifest: %s", error.c_str());
+        }
+        return parsed;
+    }();
+    return manifest;
+}
+
+std::vector<ManifestStep> InstallManifest::GetSteps(
+    const std::string& component) const {
+    std::vector<ManifestStep> steps;
+    for (const auto& step : steps_) {
+        if (step.component == component) {
+            steps.push_back(step);
+        }
+    }
+    return steps;
+}
+
+std::string ExpandManifestVariables(
+    const std::string& text,
+    const std::map<std::string, std::string>& variables) {
+    auto& config = parallax::config::ConfigManager::GetInstance();
+    std::string expanded;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t start = text.find("${", pos);
+        size_t end = start == std::string::npos ? std::string::npos
+                                                 : text.find('}', start);
+        if (end == std::string::npos) {
+            expanded += text.substr(pos);
+            break;
+        }
+        expanded += text.substr(pos, start - pos);
+        std::string name = text.substr(start + 2, end - start - 2);
+        auto it = variables.find(name);
+        if (it != variables.end()) {
+            expanded += it->second;
+        } else if (config.IsValidConfigKey(name)) {
+            expanded += config.GetConfigValue(name);
+        } else {
+            expanded += text.substr(start, end - start + 1);
+        }
+        pos = end + 1;
+    }
+    return expanded;
+}
+
+ManifestRunner::ManifestRunner(std::shared_ptr<ExecutionContext> context,
+                               std::shared_ptr<CommandExecutor> executor)
+    : context_(context), executor_(executor) {}
+
+ManifestRunResult ManifestRunner::Run(
+    const std::string& component,
+    const std::map<std::string, std::string>& variables,
+    const std::string& operation_name) {
+    ManifestRunResult result;
+    std::vector<ManifestStep> steps =
+        InstallManifest::GetEmbedded().GetSteps(component);
+    if (steps.empty()) {
+        result.error_message = "No install steps for component " + component;
+        return result;
+    }
+    LoadStamps();
+
+    InstallHistory& history = context_->GetInstallHistory();
+    for (const auto& step : steps) {
+        info_log("[ENV] %s step: %s", operation_name.c_str(),
+                 step.name.c_str());
+
+        // Done means the outputs exist and the verify probe passes
+        std::string verify = BuildOutputsProbe(step.outputs, variables);
+        if (!step.verify.empty()) {
+            std::string probe = ExpandManifestVariables(step.verify, variables);
+            verify = verify.empty() ? probe : verify + " && (" + probe + ")";
+        }
+        if (!step.skip_if.empty() &&
+            ProbeSucceeds(ExpandManifestVariables(step.skip_if, variables))) {
+            info_log("[ENV] %s step %s skipped (already done)",
+                     operation_name.c_str(), step.name.c_str());
+            ++result.skipped_steps;
+            continue;
+        }
+
+        std::string stamp;
+        if (!step.always) {
+            stamp = ComputeStamp(step, variables);
+            auto it = stamps_.find(step.GetId());
+            if (it != stamps_.end() && it->second == stamp &&
+                (verify.empty() || ProbeSucceeds(verify))) {
+                info_log("[ENV] %s step %s skipped (inputs unchanged)",
+                         operation_name.c_str(), step.name.c_str());
+                ++result.skipped_steps;
+                continue;
+            }
+        }
+
+        if (step.min_free_gib > 0) {
+            std::string shortage = CheckFreeSpace(
+                context_->GetUbuntuVersion(), *executor_, step.min_free_gib);
+            if (!shortage.empty()) {
+                result.exit_code = 1;
+                result.failed_step = step.name;
+                result.error_message = "Not enough disk space for step '" +
+                                       step.name + "': " + shortage;
+                return result;
+            }
+        }
+
+        std::string command = ExpandManifestVariables(step.run, variables);
+        int step_timeout = step.timeout_seconds;
+        uint64_t step_ms = 0;
+        int exit_code = ExecuteStep(step, command, step_timeout, step_ms);
+        if (exit_code == 0 && !verify.empty() && !ProbeSucceeds(verify)) {
+            result.exit_code = 1;
+            result.failed_step = step.name;
+            result.error_message = "Step '" + step.name +
+                                   "' completed but verification failed: " +
+                                   verify;
+            return result;
+        }
+        if (exit_code != 0) {
+            result.exit_code = exit_code;
+            result.failed_step = step.name;
+            result.error_message =
+                "Failed at step '" + step.name + "': " + command;
+            if (exit_code == -2) {
+                result.error_message += " (timed out after " +
+                                        std::to_string(step_timeout) + "s)";
+            }
+            return result;
+        }
+
+        info_log("[ENV] %s step %s finished in %s", operation_name.c_str(),
+                 step.name.c_str(),
+                 InstallHistory::FormatDuration(step_ms).c_str());
+        history.RecordDuration(step.component + ":" + step.name, step_ms);
+        if (!step.always) {
+            SaveStamp(step.GetId(), stamp);
+        }
+        ++result.executed_steps;
+    }
+
+    result.success = true;
+    return result;
+}
+
+// One line per step: "<component.step> <stamp>"
+void ManifestRunner::LoadStamps() {
+    stamps_.clear();
+    auto [exit_code, output] = executor_->ExecuteWSL(
+        std::string("cat ") + kStampFile + " 2>/dev/null || true", 30,
+        CommandKind::kProbe);
+    if (exit_code != 0) {
+        return;
+    }
+
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(parallax::utils::TrimNewlines(line));
+        std::string step_id, stamp;
+        if (fields >> step_id >> stamp) {
+            stamps_[step_id] = stamp;
+        }
+    }
+}
+
+void ManifestRunner::SaveStamp(const std::string& step_id,
+                               const std::string& stamp) {
+    stamps_[step_id] = stamp;
+    std::string file = kStampFile;
+    auto [exit_code, output] = executor_->ExecuteWSL(
+        "mkdir -p /var/lib/prakasa && touch " + file + " && sed -i '/^" +
+            step_id + " /d' " + file + " && echo '" + step_id + " " + stamp +
+            "' >> " + file,
+        30);
+    if (exit_code != 0) {
+        warn_log("[ENV] Failed to record install stamp of %s: %s",
+                 step_id.c_str(), output.c_str());
+    }
+}
+
+std::string ManifestRunner::ComputeStamp(
+    const ManifestStep& step,
+    const std::map<std::string, std::string>& variables) {
+    // The run template rather than the expanded command: build settings such
+    // as MAX_JOBS vary between runs without invalidating the step
+    uint64_t hash = HashText(14695981039346656037ULL, step.run);
+    for (const auto& input : step.inputs) {
+        hash = HashText(hash, ExpandManifestVariables(input, variables));
+    }
+    if (!step.input_probe.empty()) {
+        auto [exit_code, output] = executor_->ExecuteWSL(
+            ExpandManifestVariables(step.input_probe, variables), 60,
+            CommandKind::kProbe);
+        hash = HashText(hash, std::to_string(exit_code) + ":" + output);
+    }
+
+    char stamp[17];
+    std::snprintf(stamp, sizeof(stamp), "%016llx",
+                  static_cast<unsigned long long>(hash));
+    return stamp;
+}
+
+bool ManifestRunner::ProbeSucceeds(const std::string& command) {
+    auto [exit_code, output] =
+        executor_->ExecuteWSL(command, 60, CommandKind::kProbe);
+    return exit_code == 0;
+}
+
+int ManifestRunner::ExecuteStep(const ManifestStep& step,
+                                const std::string& command, int& step_timeout,
+                                uint64_t& duration_ms) {
+    // Tighten the timeout of local steps to what this machine class usually
+    // needs, so a hung step fails in minutes instead of running out the
+    // default. Network-bound steps keep the default: their history is
+    // dominated by cached or already-installed runs, which say nothing about
+    // how long a real download takes
+    InstallHistory& history = context_->GetInstallHistory();
+    int timeout = step.timeout_seconds;
+    step_timeout = timeout;
+    if (ClassifyStep(command) == StepClass::kLocal) {
+        step_timeout = history.GetAdaptiveTimeout(
+            step.component + ":" + step.name, timeout);
+    }
+    std::string proxy_exports = BuildProxyExports(context_->GetProxyUrl());
+    uint64_t start_ms = 0;
+
+    // Network steps are retried on transient errors; only the successful
+    // attempt counts towards the duration
+    int exit_code = RunStepWithRetry(
+        *context_, step.name, command,
+        [&](const std::string& attempt_cmd, std::string& output) {
+            start_ms = parallax::utils::GetTickCountMs();
+            if (step.realtime) {
+                std::string wsl_cmd = parallax::utils::BuildWSLCommand(
+                    context_->GetUbuntuVersion(), proxy_exports + attempt_cmd);
+                WSLProcess wsl_process;
+                if (step_timeout < timeout) {
+                    wsl_process.SetTimeout(step_timeout);
+                }
+                int realtime_code = wsl_process.Execute(wsl_cmd);
+                output = wsl_process.GetOutputTail();
+                return realtime_code;
+            }
+            auto [attempt_code, attempt_output] = executor_->ExecuteWSL(
+                proxy_exports + attempt_cmd, step_timeout);
+            output = attempt_output;
+            return attempt_code;
+        });
+    duration_ms = parallax::utils::GetTickCountMs() - start_ms;
+    return exit_code;
+}
+
+}  // namespace environment
+}  // namespace parallax
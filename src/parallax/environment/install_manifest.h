@@ -0,0 +1,109 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace parallax {
+namespace environment {
+
+class ExecutionContext;
+class CommandExecutor;
+
+// One install step of a component, as declared in the manifest
+struct ManifestStep {
+    std::string component;  // e.g. "cuda"
+    std::string name;       // e.g. "install_cuda_toolkit"
+    std::string run;        // Command template, ${name} not yet expanded
+    int timeout_seconds = 300;
+    bool realtime = false;  // Stream the output through WSLProcess
+    bool always = false;    // Never skipped because of a matching stamp
+    std::vector<std::string> inputs;  // Values hashed into the stamp
+    std::string input_probe;  // Command whose output is hashed as well
+    std::vector<std::string> outputs;  // Paths the step creates
+    std::string verify;       // Must succeed after the step, and to skip it
+    std::string skip_if;      // Skips the step when it succeeds
+    int min_free_gib = 0;     // Free space needed on host and guest, in GiB
+
+    // "cuda.install_cuda_toolkit"
+    std::string GetId() const { return component + "." + name; }
+};
+
+/**
+ * @brief Declarative description of the software install steps
+ *
+ * INI-like text: a "[component.step]" header per step followed by
+ * "key = value" lines, '#' comments and '\' line continuations. The
+ * manifest compiled into the executable describes the CUDA Toolkit and
+ * Prakasa project installs.
+ */
+class InstallManifest {
+ public:
+    // Parse manifest text; error receives the first problem found
+    static InstallManifest Parse(const std::string& text,
+                                 std::string* error = nullptr);
+
+    // The manifest compiled into the executable
+    static const InstallManifest& GetEmbedded();
+
+    // Steps of one component in declaration order
+    std::vector<ManifestStep> GetSteps(const std::string& component) const;
+
+    const std::vector<ManifestStep>& GetAllSteps() const { return steps_; }
+
+ private:
+    std::vector<ManifestStep> steps_;
+};
+
+// Replace ${name} with variables[name], or else with the configuration item
+// of that name; unknown names are left as they are
+std::string ExpandManifestVariables(
+    const std::string& text,
+    const std::map<std::string, std::string>& variables);
+
+struct ManifestRunResult {
+    bool success = false;
+    int exit_code = 0;
+    std::string failed_step;
+    std::string error_message;
+    int executed_steps = 0;
+    int skipped_steps = 0;
+};
+
+/**
+ * @brief Runs the manifest steps of a component inside the distro
+ *
+ * A step is skipped when its skip_if probe succeeds, or when its stamp (a
+ * hash of the run template, the expanded inputs and the input_probe
+ * output) equals the stamp of its last successful run, its outputs exist
+ * and its verify probe passes. A step that succeeds without creating its
+ * outputs fails. Stamps are kept in the distro, so a reset distro starts over.
+ * Executed steps get the proxy, adaptive timeout, retry and mirror
+ * handling of the install history and retry policy.
+ */
+class ManifestRunner {
+ public:
+    ManifestRunner(std::shared_ptr<ExecutionContext> context,
+                   std::shared_ptr<CommandExecutor> executor);
+
+    ManifestRunResult Run(const std::string& component,
+                          const std::map<std::string, std::string>& variables,
+                          const std::string& operation_name);
+
+ private:
+    void LoadStamps();
+    void SaveStamp(const std::string& step_id, const std::string& stamp);
+    std::string ComputeStamp(const ManifestStep& step,
+                             const std::map<std::string, std::string>& variables);
+    bool ProbeSucceeds(const std::string& command);
+    int ExecuteStep(const ManifestStep& step, const std::string& command,
+                    int& step_timeout, uint64_t& duration_ms);
+
+    std::shared_ptr<ExecutionContext> context_;
+    std::shared_ptr<CommandExecutor> executor_;
+    std::map<std::string, std::string> stamps_;  // step id -> stamp
+};
+
+}  // namespace environment
+}  // namespace parallax
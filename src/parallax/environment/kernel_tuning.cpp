@@ -0,0 +1,249 @@
+#include "kernel_tuning.h"
+#include "environment_installer.h"
+#include "command_executor.h"
+#include "perf_probes.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kSysctlFile = "/etc/sysctl.d/90-prakasa-inference.conf";
+const char* const kLimitsFile = "/etc/security/limits.d/90-prakasa.conf";
+// Sourced by every server launch (see BuildServerLaunchCommand): without
+// systemd, sysctl.d and sysfs settings are lost when the WSL VM restarts,
+// and wsl.exe shells do not go through PAM, so limits.d alone is not seen
+const char* const kLaunchScript = "/etc/prakasa/inference-tuning.sh";
+const char* const kLaunchScriptTag = "# prakasa inference tuning v1";
+
+struct TuningSetting {
+    const char* key;
+    const char* value;
+};
+
+const TuningSetting kSysctlProfile[] = {
+    // Keep weights and KV cache pages in RAM rather than trading them for
+    // page cache while large files stream in
+    {"vm.swappiness", "10"},
+    // Write back early and cap dirty pages, so downloads and checkpoint
+    // writes do not stall weight loads behind a large flush
+    {"vm.dirty_background_ratio", "5"},
+    {"vm.dirty_ratio", "15"},
+    // Sharded safetensors are mmapped in many pieces
+    {"vm.max_map_count", "1048576"},
+    // Keep the model directories' dentries and inodes cached
+    {"vm.vfs_cache_pressure", "50"},
+};
+
+// Hugepages only where the allocator asks for them (madvise), and never a
+// synchronous compaction in the allocation path, which stalls serving
+const TuningSetting kHugepageProfile[] = {
+    {"enabled", "madvise"},
+    {"defrag", "defer+madvise"},
+};
+
+// Pinned host buffers are locked memory; open files cover many shards and
+// sockets
+const char* const kLimitLines[] = {
+    "* soft memlock unlimited",    "* hard memlock unlimited",
+    "root soft memlock unlimited", "root hard memlock unlimited",
+    "* soft nofile 1048576",       "* hard nofile 1048576",
+    "root soft nofile 1048576",    "root hard nofile 1048576",
+};
+
+std::string HugepagePath(const TuningSetting& setting) {
+    return std::string("/sys/kernel/mm/transparent_hugepage/") + setting.key;
+}
+
+// { echo 'line'; ... } > path. The lines hold no single quotes or $
+std::string BuildWriteFile(const std::string& path,
+                           const std::vector<std::string>& lines) {
+    std::string command = "{";
+    for (const auto& line : lines) {
+        command += " echo '" + line + "';";
+    }
+    return command + " } > " + path;
+}
+
+std::string BuildLaunchScriptCommand() {
+    std::vector<std::string> lines = {
+        kLaunchScriptTag,
+        "sysctl -q -p " + std::string(kSysctlFile) + " > /dev/null 2>&1"};
+    for (const auto& setting : kHugepageProfile) {
+        lines.push_back("echo " + std::string(setting.value) + " > " +
+                        HugepagePath(setting) + " 2> /dev/null");
+    }
+    lines.push_back("ulimit -l unlimited 2> /dev/null");
+    lines.push_back("ulimit -n 1048576 2> /dev/null");
+    lines.push_back("true");
+    return BuildWriteFile(kLaunchScript, lines);
+}
+
+std::string FormatTransfer(bool ok, double h2d, double d2h) {
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.1f/%.1f GB/s", h2d, d2h);
+    return ok ? buffer : "n/a";
+}
+
+}  // namespace
+
+KernelTuningManager::KernelTuningManager(
+    std::shared_ptr<ExecutionContext> context,
+    std::shared_ptr<CommandExecutor> executor)
+    : BaseEnvironmentComponent(context), executor_(executor) {}
+
+std::string KernelTuningManager::FindInactiveSettings(bool& installed) {
+    // One line per setting, "key=current"; the launch shell's limits are
+    // what a server gets, so they are read after sourcing the script
+    std::string query = "head -n 1 " + std::string(kLaunchScript) +
+                        " 2>/dev/null | sed 's/^/tag=/'; ";
+    for (const auto& setting : kSysctlProfile) {
+        query += "echo " + std::string(setting.key) + "=\\$(sysctl -n " +
+                 setting.key + " 2>/dev/null); ";
+    }
+    for (const auto& setting : kHugepageProfile) {
+        query += "echo thp." + std::string(setting.key) + "=\\$(grep -o " +
+                 "'\\[[a-z+]*\\]' " + HugepagePath(setting) +
+                 " 2>/dev/null | tr -d '[]'); ";
+    }
+    query += "echo memlock=\\$( [ -f " + std::string(kLaunchScript) +
+             " ] && . " + kLaunchScript + "; ulimit -l)";
+
+    auto [exit_code, output] =
+        executor_->ExecuteWSL(query, 60, CommandKind::kProbe);
+    std::map<std::string, std::string> current;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = parallax::utils::TrimNewlines(line);
+        size_t equals = line.find('=');
+        if (equals != std::string::npos) {
+            current[line.substr(0, equals)] = line.substr(equals + 1);
+        }
+    }
+    installed = current["tag"] == kLaunchScriptTag;
+
+    std::string inactive;
+    auto compare = [&](const std::string& key, const std::string& expected) {
+        if (current[key] != expected) {
+            inactive += (inactive.empty() ? "" : ", ") + key + " " +
+                        (current[key].empty() ? "?" : current[key]) +
+                        " (want " + expected + ")";
+        }
+    };
+    for (const auto& setting : kSysctlProfile) {
+        compare(setting.key, setting.value);
+    }
+    for (const auto& setting : kHugepageProfile) {
+        compare(std::string("thp.") + setting.key, setting.value);
+    }
+    compare("memlock", "unlimited");
+    return inactive;
+}
+
+ComponentResult KernelTuningManager::Check() {
+    LogOperationStart("Checking");
+
+    bool installed = false;
+    std::string inactive = FindInactiveSettings(installed);
+    // The profile is opt-in, so its absence is informational only
+    ComponentResult result =
+        !installed
+            ? CreateSuccessResult(
+                  "Inference tuning profile not installed (optional); apply "
+                  "it with 'prakasa install --only tuning'")
+        : !inactive.empty()
+            // A restarted VM drops them until the next run/join
+            ? CreateWarningResult("Inference tuning installed, active on "
+                                  "the next run/join: " +
+                                  inactive)
+            : CreateSkippedResult("Inference tuning profile active");
+
+    LogOperationResult("Checking", result);
+    return result;
+}
+
+ComponentResult KernelTuningManager::Install() {
+    LogOperationStart("Installing");
+
+    const std::string& ubuntu_version = context_->GetUbuntuVersion();
+    double h2d_before = 0, d2h_before = 0;
+    std::string reason;
+    bool measured_before = MeasurePinnedTransfer(
+        ubuntu_version, "", h2d_before, d2h_before, reason);
+    if (!measured_before) {
+        info_log("[ENV] Pinned transfer benchmark skipped: %s",
+                 reason.c_str());
+    }
+
+    std::vector<std::string> sysctl_lines = {
+        "# Managed by prakasa install (tuning component)"};
+    for (const auto& setting : kSysctlProfile) {
+        sysctl_lines.push_back(std::string(setting.key) + " = " +
+                               setting.value);
+    }
+    std::vector<std::string> limit_lines = {
+        "# Managed by prakasa install (tuning component)"};
+    limit_lines.insert(limit_lines.end(), std::begin(kLimitLines),
+                       std::end(kLimitLines));
+
+    info_log("[ENV] Writing the inference tuning profile...");
+    auto [write_code, write_output] = executor_->ExecuteWSL(
+        "mkdir -p /etc/prakasa /etc/security/limits.d /etc/sysctl.d && " +
+            BuildWriteFile(kSysctlFile, sysctl_lines) + " && " +
+            BuildWriteFile(kLimitsFile, limit_lines) + " && " +
+            BuildLaunchScriptCommand() + " && . " + kLaunchScript,
+        60);
+    if (write_code != 0) {
+        ComponentResult result = CreateFailureResult(
+            "Failed to write the tuning profile: " + write_output, 28);
+        LogOperationResult("Installing", result);
+        return result;
+    }
+
+    bool installed = false;
+    std::string inactive = FindInactiveSettings(installed);
+    if (!installed || !inactive.empty()) {
+        // e.g. a kernel without THP; the rest still applies
+        ComponentResult result = CreateWarningResult(
+            "Tuning profile installed, but not every setting took effect: " +
+            (inactive.empty() ? std::string("launch script missing")
+                              : inactive));
+        LogOperationResult("Installing", result);
+        return result;
+    }
+
+    std::string message =
+        "Inference tuning applied (swappiness 10, THP madvise, memlock "
+        "unlimited)";
+    if (measured_before) {
+        double h2d_after = 0, d2h_after = 0;
+        bool measured_after = MeasurePinnedTransfer(
+            ubuntu_version, std::string(". ") + kLaunchScript, h2d_after,
+            d2h_after, reason);
+        message += "; pinned H2D/D2H " +
+                   FormatTransfer(true, h2d_before, d2h_before) + " -> " +
+                   FormatTransfer(measured_after, h2d_after, d2h_after);
+    }
+    ComponentResult result = CreateSuccessResult(message);
+    LogOperationResult("Installing", result);
+    return result;
+}
+
+EnvironmentComponent KernelTuningManager::GetComponentType() const {
+    return EnvironmentComponent::kKernelTuning;
+}
+
+std::string KernelTuningManager::GetComponentName() const {
+    return "Guest Kernel Tuning";
+}
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "environment_installer.h"  // For ComponentResult definition
+#include "base_component.h"
+#include "command_executor.h"
+#include <memory>
+#include <string>
+
+namespace parallax {
+namespace environment {
+
+/**
+ * @brief Guest kernel tuning component
+ *
+ * Installs a reviewed sysctl, transparent hugepage and resource limit
+ * profile for inference inside the distro, persisted in /etc/sysctl.d and
+ * /etc/security/limits.d and re-applied by every server launch. Optional:
+ * runs only with --only tuning, and Check warns only when an installed
+ * profile is inactive.
+ */
+class KernelTuningManager : public BaseEnvironmentComponent {
+ public:
+    explicit KernelTuningManager(std::shared_ptr<ExecutionContext> context,
+                                 std::shared_ptr<CommandExecutor> executor);
+
+    ComponentResult Check() override;
+    ComponentResult Install() override;
+    EnvironmentComponent GetComponentType() const override;
+    std::string GetComponentName() const override;
+
+ private:
+    std::shared_ptr<CommandExecutor> executor_;
+
+    // Settings that differ from the profile, "" when it is fully active
+    std::string FindInactiveSettings(bool& installed);
+};
+
+}  // namespace environment
+}  // namespace parallax
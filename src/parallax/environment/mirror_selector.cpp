@@ -0,0 +1,295 @@
+#include "mirror_selector.h"
+#include "config/config_manager.h"
+#include "utils/process.h"
+#include "utils/utils.h"
+#include "tinylog/tinylog.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kRankingFileName = "mirror_rankings.txt";
+const char* const kPrimaryAptUrl = "http://archive.ubuntu.com/ubuntu";
+const char* const kPrimaryCudaRepoUrl =
+    "https://developer.download.nvidia.com/compute/cuda/repos";
+const char* const kPrimaryPipIndexUrl = "https://pypi.org/simple";
+const char* const kPrimaryHuggingFaceUrl = "https://huggingface.co";
+
+std::string TrimTrailingSlash(std::string url) {
+    while (!url.empty() && url.back() == '/') {
+        url.pop_back();
+    }
+    return url;
+}
+
+}  // namespace
+
+double MirrorProbeResult::ScoreMs() const {
+    if (!reachable) {
+        return -1.0;
+    }
+    double transfer_ms =
+        bytes_per_second > 0.0
+            ? WSLCurlMirrorProbe::kProbeBytes * 1000.0 / bytes_per_second
+            : 0.0;
+    return connect_ms + transfer_ms;
+}
+
+WSLCurlMirrorProbe::WSLCurlMirrorProbe(const std::string& ubuntu_version,
+                                       const std::string& proxy_url)
+    : ubuntu_version_(ubuntu_version), proxy_url_(proxy_url) {}
+
+std::vector<MirrorProbeResult> WSLCurlMirrorProbe::Probe(
+    const std::vector<std::string>& probe_urls) {
+    std::vector<MirrorProbeResult> results(probe_urls.size());
+    for (size_t i = 0; i < probe_urls.size(); ++i) {
+        results[i].url = probe_urls[i];
+    }
+    if (probe_urls.empty()) {
+        return results;
+    }
+
+    // One background curl per candidate, each printing
+    // "<index> <http code> <connect s> <bytes/s>"; '$' is escaped for the
+    // login shell wsl.exe starts first
+    std::string curl_options = "-s -o /dev/null -r 0-" +
+                               std::to_string(kProbeBytes - 1) +
+                               " --connect-timeout 5 --max-time 10";
+    if (!proxy_url_.empty()) {
+        curl_options += " -x " + proxy_url_;
+    }
+    std::string probe_cmd;
+    for (size_t i = 0; i < probe_urls.size(); ++i) {
+        probe_cmd += "(echo " + std::to_string(i) + " \\$(curl " +
+                     curl_options +
+                     " -w '%{http_code} %{time_connect} %{speed_download}' '" +
+                     probe_urls[i] + "')) & ";
+    }
+    probe_cmd += "wait";
+
+    std::string stdout_output, stderr_output;
+    int exit_code = parallax::utils::ExecCommandEx(
+        parallax::utils::BuildWSLCommand(ubuntu_version_, probe_cmd), 30,
+        stdout_output, stderr_output, false, true);
+    if (exit_code != 0) {
+        warn_log("[ENV] Mirror probe failed (code %d): %s", exit_code,
+                 stderr_output.c_str());
+        return results;
+    }
+
+    std::istringstream stream(stdout_output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(line);
+        size_t index = 0;
+        MirrorProbeResult sample;
+        double connect_seconds = 0.0;
+        if (!(fields >> index >> sample.http_code >> connect_seconds >>
+              sample.bytes_per_second) ||
+            index >= results.size()) {
+            continue;
+        }
+        results[index].http_code = sample.http_code;
+        results[index].connect_ms = connect_seconds * 1000.0;
+        results[index].bytes_per_second = sample.bytes_per_second;
+        results[index].reachable =
+            sample.http_code >= 200 && sample.http_code < 400;
+    }
+    return results;
+}
+
+MirrorSelector::MirrorSelector(std::shared_ptr<IMirrorProbe> probe,
+                               const std::string& cache_path)
+    : probe_(probe),
+      cache_path_(cache_path.empty()
+                      ? parallax::utils::JoinPath(
+                            parallax::utils::GetAppBinDir(), kRankingFileName)
+                      : cache_path) {
+    int ttl_hours =
+        parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+            parallax::config::KEY_MIRROR_PROBE_TTL, 24);
+    ttl_seconds_ = static_cast<int64_t>((std::max)(ttl_hours, 0)) * 3600;
+    Load();
+}
+
+std::vector<std::string> MirrorSelector::RankCandidates(StepClass service) {
+    std::vector<std::string> candidates{GetPrimaryUrl(service)};
+    for (const auto& mirror : GetConfiguredMirrors(service)) {
+        if (std::find(candidates.begin(), candidates.end(), mirror) ==
+            candidates.end()) {
+            candidates.push_back(mirror);
+        }
+    }
+    if (candidates.size() == 1) {
+        return candidates;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string prefix = std::string(StepClassToString(service)) + "|";
+    int64_t now = static_cast<int64_t>(std::time(nullptr));
+
+    // Probe only the candidates without a fresh measurement
+    std::vector<std::string> stale;
+    std::vector<std::string> probe_urls;
+    for (const auto& candidate : candidates) {
+        auto it = cache_.find(prefix + candidate);
+        if (it == cache_.end() || !IsFresh(it->second, now)) {
+            stale.push_back(candidate);
+            probe_urls.push_back(BuildProbeUrl(service, candidate));
+        }
+    }
+    if (!stale.empty() && probe_) {
+        std::vector<MirrorProbeResult> results = probe_->Probe(probe_urls);
+        for (size_t i = 0; i < stale.size() && i < results.size(); ++i) {
+            CachedRanking& ranking = cache_[prefix + stale[i]];
+            ranking.score_ms = results[i].ScoreMs();
+            ranking.probed_at = now;
+            debug_log("[ENV] Mirror %s: HTTP %d, connect %.0f ms, %.0f B/s",
+                      stale[i].c_str(), results[i].http_code,
+                      results[i].connect_ms, results[i].bytes_per_second);
+        }
+        if (!Save()) {
+            warn_log("[ENV] Failed to save mirror rankings to %s",
+                     cache_path_.c_str());
+        }
+    }
+
+    // Fastest first, unreachable and unmeasured ones keep their configured
+    // order at the end
+    auto score = [&](const std::string& candidate) {
+        auto it = cache_.find(prefix + candidate);
+        return it == cache_.end() ? -1.0 : it->second.score_ms;
+    };
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [&](const std::string& a, const std::string& b) {
+                         double score_a = score(a);
+                         double score_b = score(b);
+                         if (score_a < 0.0 || score_b < 0.0) {
+                             return score_a >= 0.0 && score_b < 0.0;
+                         }
+                         return score_a < score_b;
+                     });
+
+    info_log("[ENV] Fastest %s source: %s (%.0f ms)",
+             StepClassToString(service), candidates.front().c_str(),
+             score(candidates.front()));
+    return candidates;
+}
+
+std::string MirrorSelector::SelectFastest(StepClass service) {
+    std::vector<std::string> ranked = RankCandidates(service);
+    return ranked.empty() ? GetPrimaryUrl(service) : ranked.front();
+}
+
+std::string MirrorSelector::GetPrimaryUrl(StepClass service) {
+    auto& config = parallax::config::ConfigManager::GetInstance();
+    switch (service) {
+        case StepClass::kApt:
+            return kPrimaryAptUrl;
+        case StepClass::kCudaRepo:
+            return kPrimaryCudaRepoUrl;
+        case StepClass::kPip: {
+            std::string index_url =
+                config.GetConfigValue(parallax::config::KEY_PIP_INDEX_URL);
+            return index_url.empty() ? kPrimaryPipIndexUrl
+                                     : TrimTrailingSlash(index_url);
+        }
+        case StepClass::kGit:
+            return config.GetConfigValue(
+                parallax::config::KEY_PRAKASA_GIT_REPO_URL);
+        case StepClass::kHuggingFace:
+            return kPrimaryHuggingFaceUrl;
+        default:
+            return "";
+    }
+}
+
+std::string MirrorSelector::BuildProbeUrl(StepClass service,
+                                          const std::string& base_url) {
+    std::string base = TrimTrailingSlash(base_url);
+    switch (service) {
+        case StepClass::kApt:
+            return base + "/dists/";
+        case StepClass::kCudaRepo:
+            return base + "/wsl-ubuntu/x86_64/";
+        case StepClass::kPip:
+            return base + "/pip/";
+        case StepClass::kGit:
+            return base + "/info/refs?service=git-upload-pack";
+        case StepClass::kHuggingFace:
+            return base + "/api/models?limit=1";
+        default:
+            return base;
+    }
+}
+
+// One line per candidate: "<service>|<url>|<score ms>|<unix time>"
+void MirrorSelector::Load() {
+    std::ifstream file(cache_path_);
+    if (!file.is_open()) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = parallax::utils::TrimNewlines(line);
+        size_t time_sep = line.find_last_of('|');
+        if (line.empty() || line[0] == '#' || time_sep == std::string::npos ||
+            time_sep == 0) {
+            continue;
+        }
+        size_t score_sep = line.find_last_of('|', time_sep - 1);
+        if (score_sep == std::string::npos ||
+            line.find('|') == score_sep) {
+            continue;
+        }
+
+        CachedRanking ranking;
+        ranking.score_ms = std::atof(
+            line.substr(score_sep + 1, time_sep - score_sep - 1).c_str());
+        ranking.probed_at =
+            std::strtoll(line.substr(time_sep + 1).c_str(), nullptr, 10);
+        cache_[line.substr(0, score_sep)] = ranking;
+    }
+}
+
+bool MirrorSelector::Save() const {
+    std::ofstream file(cache_path_, std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << "# Mirror rankings maintained by prakasa, safe to delete\n";
+    for (const auto& entry : cache_) {
+        file << entry.first << "|" << entry.second.score_ms << "|"
+             << entry.second.probed_at << "\n";
+    }
+    return file.good();
+}
+
+bool MirrorSelector::IsFresh(const CachedRanking& ranking, int64_t now) const {
+    return now >= ranking.probed_at && now - ranking.probed_at < ttl_seconds_;
+}
+
+std::string SelectHuggingFaceEndpoint(const std::string& ubuntu_version,
+                                      const std::string& proxy_url) {
+    if (GetConfiguredMirrors(StepClass::kHuggingFace).empty()) {
+        return "";
+    }
+
+    MirrorSelector selector(
+        std::make_shared<WSLCurlMirrorProbe>(ubuntu_version, proxy_url));
+    std::string fastest = selector.SelectFastest(StepClass::kHuggingFace);
+    return fastest == MirrorSelector::GetPrimaryUrl(StepClass::kHuggingFace)
+               ? ""
+               : fastest;
+}
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "retry_policy.h"
+
+namespace parallax {
+namespace environment {
+
+// Measurement of one candidate: connect time and throughput of a small
+// ranged download
+struct MirrorProbeResult {
+    std::string url;
+    bool reachable = false;
+    int http_code = 0;
+    double connect_ms = 0.0;
+    double bytes_per_second = 0.0;
+
+    // Expected time to fetch the probe range, lower is better
+    double ScoreMs() const;
+};
+
+/**
+ * @brief Measures candidate mirrors
+ *
+ * The default implementation runs curl inside the distro. Tests can inject
+ * a probe that points at local stand-in servers or fakes the timings.
+ */
+class IMirrorProbe {
+ public:
+    virtual ~IMirrorProbe() = default;
+
+    // One result per URL, in the same order
+    virtual std::vector<MirrorProbeResult> Probe(
+        const std::vector<std::string>& probe_urls) = 0;
+};
+
+// Probes all URLs in parallel with one wsl.exe call
+class WSLCurlMirrorProbe : public IMirrorProbe {
+ public:
+    WSLCurlMirrorProbe(const std::string& ubuntu_version,
+                       const std::string& proxy_url);
+
+    std::vector<MirrorProbeResult> Probe(
+        const std::vector<std::string>& probe_urls) override;
+
+    static constexpr int kProbeBytes = 65536;
+
+ private:
+    std::string ubuntu_version_;
+    std::string proxy_url_;
+};
+
+/**
+ * @brief Ranks the primary source and the configured mirrors of a service
+ *
+ * Rankings are cached in mirror_rankings.txt next to the executable for
+ * mirror_probe_ttl hours, so only the first install step or launch of a
+ * day pays for the probe.
+ */
+class MirrorSelector {
+ public:
+    explicit MirrorSelector(std::shared_ptr<IMirrorProbe> probe,
+                            const std::string& cache_path = "");
+
+    // Primary plus configured mirrors, fastest first and unreachable ones
+    // last. No probe runs when no mirror is configured
+    std::vector<std::string> RankCandidates(StepClass service);
+
+    // Fastest reachable candidate, the primary source by default
+    std::string SelectFastest(StepClass service);
+
+    // Source used when no mirror is configured, e.g. https://pypi.org/simple
+    static std::string GetPrimaryUrl(StepClass service);
+
+    // Small resource under a candidate base URL that every mirror serves
+    static std::string BuildProbeUrl(StepClass service,
+                                     const std::string& base_url);
+
+ private:
+    struct CachedRanking {
+        double score_ms = -1.0;  // Negative when unreachable
+        int64_t probed_at = 0;   // Unix time
+    };
+
+    void Load();
+    bool Save() const;
+    bool IsFresh(const CachedRanking& ranking, int64_t now) const;
+
+    std::shared_ptr<IMirrorProbe> probe_;
+    std::string cache_path_;
+    int64_t ttl_seconds_;
+    // "<service>|<url>" -> last measurement
+    std::map<std::string, CachedRanking> cache_;
+    std::mutex mutex_;
+};
+
+// Fastest of huggingface.co and hf_mirrors (ranking cached for
+// mirror_probe_ttl hours), empty when the default endpoint wins or no
+// mirror is configured
+std::string SelectHuggingFaceEndpoint(const std::string& ubuntu_version,
+                                      const std::string& proxy_url);
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,517 @@
+#include "perf_probes.h"
+#include "disk_footprint.h"
+#include "utils/process.h"
+#include "utils/utils.h"
+#include "utils/volume_benchmark.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <random>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const uint64_t kMiB = 1ULL << 20;
+const uint64_t kMountTestBytes = 128 * kMiB;
+const uint64_t kMemoryTestBytes = 256 * kMiB;
+const int kMemoryCopies = 8;
+const int kSpawnRuns = 5;
+
+// Effective GB/s per PCIe lane by generation, index 0 unused
+const double kPcieLaneGBs[] = {0, 0.25, 0.5, 0.985, 1.969, 3.938};
+
+// Active power schemes that do not throttle
+const char* const kHighPerformanceScheme =
+    "8c5e7fda-e8bf-4a96-9a85-a6e23a8c635c";
+const char* const kUltimatePerformanceScheme =
+    "e9a42b02-d5df-448d-aa00-03f14749eb61";
+
+// Prints "<h2d GB/s> <d2h GB/s>" for pinned 256 MiB copies; exits 3 without
+// a CUDA device. No quotes or $, so it survives the bash -c "..." wrapping
+const char* const kGpuTransferScript =
+    "import sys,time,torch; torch.cuda.is_available() or sys.exit(3); "
+    "n=256<<20; h=torch.empty(n,dtype=torch.uint8).pin_memory(); "
+    "d=torch.empty(n,dtype=torch.uint8,device=0); d.copy_(h); "
+    "torch.cuda.synchronize(); t=time.perf_counter(); "
+    "[d.copy_(h,non_blocking=True) for i in range(10)]; "
+    "torch.cuda.synchronize(); a=time.perf_counter()-t; "
+    "t=time.perf_counter(); [h.copy_(d,non_blocking=True) for i in range(10)]; "
+    "torch.cuda.synchronize(); b=time.perf_counter()-t; "
+    "print(10*n/a/1e9, 10*n/b/1e9)";
+
+int RunWSL(const std::string& ubuntu_version, const std::string& command,
+           int timeout_seconds, std::string& output) {
+    std::string stderr_output;
+    return parallax::utils::ExecCommandEx(
+        parallax::utils::BuildWSLCommand(ubuntu_version, command),
+        timeout_seconds, output, stderr_output, false, true);
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+// Last line of output as a number, 0 if there is none
+double LastNumber(const std::string& output) {
+    std::string trimmed = parallax::utils::TrimNewlines(output);
+    size_t line_start = trimmed.find_last_of('\n');
+    return std::atof(trimmed.c_str() +
+                     (line_start == std::string::npos ? 0 : line_start + 1));
+}
+
+// Average of a ping summary "rtt min/avg/max/mdev = 0.03/0.05/0.07/0.01 ms"
+double ParsePingAverage(const std::string& line) {
+    size_t equals = line.find("= ");
+    double min_ms = 0, avg_ms = 0;
+    if (equals == std::string::npos ||
+        std::sscanf(line.c_str() + equals + 2, "%lf/%lf", &min_ms, &avg_ms) !=
+            2) {
+        return 0;
+    }
+    return avg_ms;
+}
+
+PerfProbeResult MakeResult(const std::string& name, const std::string& unit,
+                           double expected, bool lower_is_better,
+                           const std::string& hint) {
+    PerfProbeResult result;
+    result.name = name;
+    result.unit = unit;
+    result.expected = expected;
+    result.lower_is_better = lower_is_better;
+    result.hint = hint;
+    return result;
+}
+
+PerfProbeResult Skip(PerfProbeResult result, const std::string& reason) {
+    result.skipped = true;
+    result.detail = reason;
+    return result;
+}
+
+std::string FormatNumber(const char* format, double value) {
+    char text[64];
+    std::snprintf(text, sizeof(text), format, value);
+    return text;
+}
+
+// Sequential read of a fresh file on the distro's root file system, with
+// the guest page cache dropped. Expected: most of what the host volume
+// under the vhdx delivers
+PerfProbeResult ProbeGuestDisk(const std::string& ubuntu_version,
+                               double host_mib_s) {
+    PerfProbeResult result = MakeResult(
+        "Guest ext4 read", "MiB/s", host_mib_s > 0 ? host_mib_s * 0.6 : 500,
+        false,
+        "The vhdx sits on a slow or busy drive; compare the drives with "
+        "'prakasa move-distro'");
+    result.detail = host_mib_s > 0
+                        ? FormatNumber("60%% of the host volume's %.0f MiB/s",
+                                       host_mib_s)
+                        : "typical NVMe vhdx, host volume not measured";
+
+    std::string output;
+    int exit_code = RunWSL(
+        ubuntu_version,
+        "f=/var/tmp/prakasa-perf.bin && head -c 256M /dev/urandom > \\$f && "
+        "sync && echo 3 > /proc/sys/vm/drop_caches && s=\\$(date +%s%N) && "
+        "cat \\$f > /dev/null && e=\\$(date +%s%N) && rm -f \\$f && "
+        "echo \\$(( (e - s) / 1000 ))",
+        120, output);
+    double micros = LastNumber(output);
+    if (exit_code != 0 || micros <= 0) {
+        RunWSL(ubuntu_version, "rm -f /var/tmp/prakasa-perf.bin", 30, output);
+        return Skip(result, "test file could not be written or read");
+    }
+    result.value = 256.0 / (micros / 1e6);
+    return result;
+}
+
+// Read of a Windows file through the /mnt/<drive> 9P mount. The host cache
+// is warm, so this measures the 9P path itself, which bounds model loads
+// from Windows folders
+PerfProbeResult ProbeWindowsMount(const std::string& ubuntu_version) {
+    PerfProbeResult result = MakeResult(
+        "/mnt/c read (9P)", "MiB/s", 300, false,
+        "Files under /mnt/<drive> load through 9P at this speed; keep models "
+        "and the Hugging Face cache inside the distro");
+    result.detail = "typical WSL2 9P throughput";
+
+    wchar_t temp_dir[MAX_PATH];
+    DWORD length = GetTempPathW(MAX_PATH, temp_dir);
+    if (length == 0 || length >= MAX_PATH) {
+        return Skip(result, "no temporary directory");
+    }
+    std::wstring path = std::wstring(temp_dir, length) + L"prakasa-perf-" +
+                        std::to_wstring(GetCurrentProcessId()) + L".bin";
+    std::string utf8_path = parallax::utils::UnicodeToUtf8(path);
+    if (utf8_path.size() < 3 || utf8_path[1] != ':' ||
+        utf8_path.find('\'') != std::string::npos) {
+        return Skip(result, "temporary directory not on a drive letter");
+    }
+    char drive = static_cast<char>(
+        std::tolower(static_cast<unsigned char>(utf8_path[0])));
+    std::string mount_path = std::string("/mnt/") + drive + utf8_path.substr(2);
+    std::replace(mount_path.begin(), mount_path.end(), '\\', '/');
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return Skip(result, "test file could not be written");
+    }
+    std::vector<uint64_t> block(kMiB / sizeof(uint64_t));
+    std::mt19937_64 random(GetCurrentProcessId());
+    bool written = true;
+    for (uint64_t offset = 0; offset < kMountTestBytes && written;
+         offset += kMiB) {
+        for (auto& word : block) {
+            word = random();
+        }
+        DWORD count = 0;
+        written = WriteFile(file, block.data(), static_cast<DWORD>(kMiB),
+                            &count, nullptr) &&
+                  count == kMiB;
+    }
+    CloseHandle(file);
+
+    std::string output;
+    int exit_code =
+        written ? RunWSL(ubuntu_version,
+                         "echo 3 > /proc/sys/vm/drop_caches; "
+                         "s=\\$(date +%s%N) && cat '" +
+                             mount_path +
+                             "' > /dev/null && e=\\$(date +%s%N) && "
+                             "echo \\$(( (e - s) / 1000 ))",
+                         120, output)
+                : -1;
+    DeleteFileW(path.c_str());
+    double micros = LastNumber(output);
+    if (exit_code != 0 || micros <= 0) {
+        return Skip(result, "test file could not be read through /mnt");
+    }
+    result.value = static_cast<double>(kMountTestBytes / kMiB) / (micros / 1e6);
+    return result;
+}
+
+// Pinned host<->device copies with the Prakasa venv's torch. Expected:
+// most of the PCIe link the GPU negotiated at most
+std::vector<PerfProbeResult> ProbeGpuTransfer(
+    const std::string& ubuntu_version) {
+    const std::string hint =
+        "Check that the GPU sits in a full-width slot at its PCIe generation "
+        "and that no other VM shares it";
+    std::vector<PerfProbeResult> results = {
+        MakeResult("GPU host-to-device copy", "GB/s", 0, false, hint),
+        MakeResult("GPU device-to-host copy", "GB/s", 0, false, hint)};
+
+    double h2d = 0, d2h = 0;
+    std::string reason;
+    if (!MeasurePinnedTransfer(ubuntu_version, "", h2d, d2h, reason)) {
+        for (auto& result : results) {
+            result = Skip(result, reason);
+        }
+        return results;
+    }
+
+    std::string link_line;
+    RunWSL(ubuntu_version,
+           "nvidia-smi --query-gpu=pcie.link.gen.max,pcie.link.width.max "
+           "--format=csv,noheader,nounits -i 0 2>/dev/null | head -n 1",
+           30, link_line);
+    int generation = 0, width = 0;
+    if (std::sscanf(link_line.c_str(), "%d, %d", &generation, &width) != 2 ||
+        generation < 1 || generation > 5 || width < 1) {
+        generation = 3;
+        width = 16;
+    }
+    double expected = kPcieLaneGBs[generation] * width * 0.7;
+    results[0].value = h2d;
+    results[1].value = d2h;
+    for (auto& result : results) {
+        result.expected = expected;
+        result.detail = "70% of PCIe gen " + std::to_string(generation) + " x" +
+                        std::to_string(width);
+    }
+    return results;
+}
+
+// Single-threaded memcpy on the host, which shares its RAM with the guest.
+// Expected: a fraction of one channel at the configured memory speed
+PerfProbeResult ProbeMemoryBandwidth(int memory_mt_s) {
+    PerfProbeResult result = MakeResult(
+        "RAM copy", "GB/s",
+        memory_mt_s > 0 ? memory_mt_s * 8.0 * 0.35 / 1000 : 6, false,
+        "Memory runs below its rated speed; check XMP/EXPO in the BIOS and "
+        "that the modules fill both channels");
+    result.detail =
+        memory_mt_s > 0
+            ? "35% of one channel at " + std::to_string(memory_mt_s) + " MT/s"
+            : "memory speed unknown";
+
+    void* source = VirtualAlloc(nullptr, kMemoryTestBytes,
+                                MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    void* target = VirtualAlloc(nullptr, kMemoryTestBytes,
+                                MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (source == nullptr || target == nullptr) {
+        if (source) VirtualFree(source, 0, MEM_RELEASE);
+        if (target) VirtualFree(target, 0, MEM_RELEASE);
+        return Skip(result, "out of memory");
+    }
+    // Fault the pages in before timing
+    std::memset(source, 1, kMemoryTestBytes);
+    std::memset(target, 0, kMemoryTestBytes);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kMemoryCopies; ++i) {
+        std::memcpy(target, source, kMemoryTestBytes);
+    }
+    double seconds = SecondsSince(start);
+    VirtualFree(source, 0, MEM_RELEASE);
+    VirtualFree(target, 0, MEM_RELEASE);
+    result.value = seconds > 0 ? kMemoryCopies * static_cast<double>(
+                                                     kMemoryTestBytes) /
+                                     seconds / 1e9
+                               : 0;
+    return result;
+}
+
+// Minimum configured speed of the installed modules in MT/s, 0 if unknown
+int QueryMemorySpeed() {
+    std::string stdout_output, stderr_output;
+    int exit_code = parallax::utils::ExecCommandEx(
+        "powershell.exe -Command \"(Get-CimInstance Win32_PhysicalMemory | "
+        "Measure-Object -Property ConfiguredClockSpeed -Minimum).Minimum\"",
+        60, stdout_output, stderr_output);
+    return exit_code == 0 ? std::atoi(stdout_output.c_str()) : 0;
+}
+
+// Median wall time of "wsl.exe ... true" with the distro already running
+PerfProbeResult ProbeSpawnLatency(const std::string& ubuntu_version) {
+    PerfProbeResult result = MakeResult(
+        "wsl.exe start", "ms", 400, true,
+        "Every wsl.exe call costs this much; set session_broker_idle_timeout "
+        "to reuse warm sessions, and exclude wsl.exe from antivirus scans");
+    result.detail = "warm distro";
+
+    std::vector<double> runs;
+    for (int i = 0; i < kSpawnRuns; ++i) {
+        std::string stdout_output, stderr_output;
+        auto start = std::chrono::steady_clock::now();
+        int exit_code = parallax::utils::ExecCommandEx(
+            parallax::utils::BuildWSLDirectCommand(ubuntu_version, "true"), 60,
+            stdout_output, stderr_output, false, true);
+        if (exit_code != 0) {
+            return Skip(result, "wsl.exe failed");
+        }
+        // The first call may boot the distro
+        if (i > 0) {
+            runs.push_back(SecondsSince(start) * 1000);
+        }
+    }
+    std::sort(runs.begin(), runs.end());
+    result.value = runs[runs.size() / 2];
+    return result;
+}
+
+// One wsl.exe call for the guest's memory size and its loopback and
+// gateway round trips
+std::vector<PerfProbeResult> ProbeGuestNetworkAndMemory(
+    const std::string& ubuntu_version) {
+    MEMORYSTATUSEX memory_status;
+    memory_status.dwLength = sizeof(memory_status);
+    double host_gib = GlobalMemoryStatusEx(&memory_status)
+                          ? memory_status.ullTotalPhys /
+                                static_cast<double>(1ULL << 30)
+                          : 0;
+
+    std::vector<PerfProbeResult> results = {
+        MakeResult("Guest memory", "GiB", host_gib * 0.45, false,
+                   "A memory= cap in %USERPROFILE%\\.wslconfig limits the "
+                   "model and page cache; raise or remove it"),
+        MakeResult("Loopback latency", "ms", 0.2, true,
+                   "Loopback is slow, so the guest CPUs are contended or "
+                   "throttled; check the power plan and other VMs"),
+        MakeResult("Host gateway latency", "ms", 1.0, true,
+                   "WSL NAT adds this to every packet; try "
+                   "networkingMode=mirrored in .wslconfig")};
+    results[0].detail =
+        FormatNumber("WSL default is half of the host's %.0f GiB", host_gib);
+
+    std::string output;
+    int exit_code = RunWSL(
+        ubuntu_version,
+        "grep MemTotal /proc/meminfo; echo loopback \\$(ping -c 5 -i 0.2 -q "
+        "127.0.0.1 2>&1 | tail -n 1); gw=\\$(ip route show default "
+        "2>/dev/null | awk '{print \\$3; exit}'); test -z \\$gw || echo "
+        "gateway \\$gw \\$(ping -c 5 -i 0.2 -q \\$gw 2>&1 | tail -n 1)",
+        60, output);
+    if (exit_code != 0) {
+        for (auto& result : results) {
+            result = Skip(result, "guest probe failed");
+        }
+        return results;
+    }
+
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "MemTotal:") {
+            double kib = 0;
+            fields >> kib;
+            results[0].value = kib / (1 << 20);
+        } else if (key == "loopback") {
+            results[1].value = ParsePingAverage(line);
+        } else if (key == "gateway") {
+            std::string gateway;
+            fields >> gateway;
+            results[2].value = ParsePingAverage(line);
+            results[2].detail = "NAT gateway " + gateway;
+        }
+    }
+    if (results[0].value <= 0 || host_gib <= 0) {
+        results[0] = Skip(results[0], "memory size unknown");
+    }
+    if (results[1].value <= 0) {
+        results[1] = Skip(results[1], "ping not available");
+    }
+    if (results[2].value <= 0) {
+        results[2] = Skip(results[2], "no default gateway answered");
+    }
+    return results;
+}
+
+// High performance and Ultimate performance pass, anything else may park
+// cores and lower clocks under load
+PerfProbeResult ProbePowerPlan() {
+    PerfProbeResult result = MakeResult(
+        "Power plan", "", 1, false,
+        "Switch to High performance: powercfg /setactive SCHEME_MIN");
+    std::string stdout_output, stderr_output;
+    if (parallax::utils::ExecCommandEx("powercfg /getactivescheme", 30,
+                                       stdout_output, stderr_output) != 0) {
+        return Skip(result, "powercfg failed");
+    }
+    std::string lower = stdout_output;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    result.value = (lower.find(kHighPerformanceScheme) != std::string::npos ||
+                    lower.find(kUltimatePerformanceScheme) !=
+                        std::string::npos)
+                       ? 1
+                       : 0;
+    size_t open = stdout_output.find('(');
+    size_t close = stdout_output.find(')', open);
+    result.detail = open != std::string::npos && close != std::string::npos
+                        ? stdout_output.substr(open + 1, close - open - 1)
+                        : "active scheme";
+    return result;
+}
+
+}  // namespace
+
+bool MeasurePinnedTransfer(const std::string& ubuntu_version,
+                           const std::string& setup, double& h2d_gbs,
+                           double& d2h_gbs, std::string& reason) {
+    std::string output;
+    int exit_code = RunWSL(
+        ubuntu_version,
+        (setup.empty() ? "" : setup + "; ") +
+            "[ -x ~/prakasa/venv/bin/python ] || exit 4; "
+            "~/prakasa/venv/bin/python -c '" +
+            std::string(kGpuTransferScript) + "'",
+        180, output);
+    if (exit_code != 0) {
+        reason = exit_code == 4   ? "Prakasa venv not installed"
+                 : exit_code == 3 ? "no CUDA device in the distro"
+                                  : "CUDA probe failed";
+        return false;
+    }
+    std::istringstream lines(output);
+    std::string line, last_line;
+    while (std::getline(lines, line)) {
+        if (!parallax::utils::TrimNewlines(line).empty()) {
+            last_line = line;
+        }
+    }
+    h2d_gbs = d2h_gbs = 0;
+    if (std::sscanf(last_line.c_str(), "%lf %lf", &h2d_gbs, &d2h_gbs) != 2) {
+        reason = "unexpected probe output";
+        return false;
+    }
+    return true;
+}
+
+double PerfProbeResult::Score() const {
+    if (skipped || expected <= 0) {
+        return 1;
+    }
+    if (lower_is_better) {
+        return value > 0 ? expected / value : 1;
+    }
+    return value / expected;
+}
+
+std::vector<PerfProbeResult> RunPerfProbes(const std::string& ubuntu_version) {
+    // Light probes overlap: none of them loads the disk, RAM or GPU
+    auto spawn = std::async(std::launch::async, ProbeSpawnLatency,
+                            ubuntu_version);
+    auto guest = std::async(std::launch::async, ProbeGuestNetworkAndMemory,
+                            ubuntu_version);
+    auto power = std::async(std::launch::async, ProbePowerPlan);
+    auto memory_speed = std::async(std::launch::async, QueryMemorySpeed);
+
+    std::vector<PerfProbeResult> results;
+    results.push_back(spawn.get());
+    for (auto& result : guest.get()) {
+        results.push_back(result);
+    }
+    results.push_back(power.get());
+
+    // Heavy probes one at a time
+    double host_mib_s = 0;
+    std::string vhdx_path = LocateDistroVhdx(ubuntu_version);
+    if (!vhdx_path.empty()) {
+        parallax::utils::VolumeBenchmark host =
+            parallax::utils::BenchmarkVolume(
+                vhdx_path.substr(0, vhdx_path.find_last_of('\\')), 128 * kMiB);
+        if (host.ok) {
+            host_mib_s = host.sequential_mib_s;
+        }
+    }
+    results.push_back(ProbeGuestDisk(ubuntu_version, host_mib_s));
+    results.push_back(ProbeWindowsMount(ubuntu_version));
+    results.push_back(ProbeMemoryBandwidth(memory_speed.get()));
+    for (auto& result : ProbeGpuTransfer(ubuntu_version)) {
+        results.push_back(result);
+    }
+
+    for (const auto& result : results) {
+        if (result.skipped) {
+            info_log("[PERF] %s: skipped (%s)", result.name.c_str(),
+                     result.detail.c_str());
+            continue;
+        }
+        info_log("[PERF] %s: %.2f %s (expected %s %.2f, %s)",
+                 result.name.c_str(), result.value, result.unit.c_str(),
+                 result.lower_is_better ? "<=" : ">=", result.expected,
+                 result.detail.c_str());
+    }
+    return results;
+}
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Short benchmarks of the paths a prakasa node depends on (vhdx disk, 9P
+// mounts, GPU transfers, RAM, wsl.exe start, guest networking) and of the
+// host settings that throttle them, each compared with what the detected
+// hardware should reach.
+
+namespace parallax {
+namespace environment {
+
+struct PerfProbeResult {
+    std::string name;  // "Guest ext4 read"
+    std::string unit;  // "MiB/s", "GB/s", "ms"; empty for settings checks
+    double value = 0;
+    double expected = 0;  // Floor, or ceiling when lower_is_better
+    bool lower_is_better = false;
+    bool skipped = false;
+    std::string detail;  // Skip reason, or what the expectation is based on
+    std::string hint;    // What to change when the probe falls short
+
+    // Measured against expected, inverted for latencies: below 1 means a
+    // bottleneck, below 0.5 a severe one. 1 for skipped probes
+    double Score() const;
+};
+
+// Run the whole battery against the distro, about 30 seconds. Independent
+// light probes overlap; disk, RAM and GPU probes run one at a time so they
+// do not disturb each other
+std::vector<PerfProbeResult> RunPerfProbes(const std::string& ubuntu_version);
+
+// Pinned 256 MiB host-to-device and device-to-host copies with the Prakasa
+// venv's torch, in GB/s, after running setup in the same shell. False and
+// reason set without the venv or a CUDA device
+bool MeasurePinnedTransfer(const std::string& ubuntu_version,
+                           const std::string& setup, double& h2d_gbs,
+                           double& d2h_gbs, std::string& reason);
+
+}  // namespace environment
+}  // namespace parallax
@@ -0,0 +1,377 @@
+#include "retry_policy.h"
+#include "base_component.h"
+#include "mirror_selector.h"
+#include "config/config_manager.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <sstream>
+
+namespace parallax {
+namespace environment {
+
+namespace {
+
+const char* const kCudaRepoBaseUrl =
+    "https://developer.download.nvidia.com/compute/cuda/repos";
+
+// Lower-case fragments of network errors printed by apt, pip, git, curl and
+// wget. Anything else (missing package, bad credentials, disk full) fails
+// the same way on every attempt and is not retried
+const char* const kRetryablePatterns[] = {
+    "could not resolve",
+    "temporary failure resolving",
+    "temporary failure in name resolution",
+    "name or service not known",
+    "connection timed out",
+    "connection reset",
+    "connection refused",
+    "network is unreachable",
+    "failed to connect",
+    "operation timed out",
+    "read timed out",
+    "readtimeouterror",
+    "connectionerror",
+    "protocolerror",
+    "incompleteread",
+    "remote end hung up",
+    "early eof",
+    "rpc failed",
+    "gnutls",
+    "ssl_error",
+    "tls handshake",
+    "hash sum mismatch",
+    "failed to fetch",
+    "unable to fetch some archives",
+    "could not get lock",
+    "502 bad gateway",
+    "503 service unavailable",
+    "504 gateway time",
+    "429 too many requests",
+};
+
+// curl: 6 resolve, 7 connect, 18 partial file, 28 timeout, 35 TLS,
+// 52 empty reply, 56 receive error. wget: 4 network failure
+bool IsNetworkExitCode(int exit_code) {
+    switch (exit_code) {
+        case 4:
+        case 6:
+        case 7:
+        case 18:
+        case 28:
+        case 35:
+        case 52:
+        case 56:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string ReplaceFirst(const std::string& text, const std::string& from,
+                         const std::string& to) {
+    size_t pos = text.find(from);
+    if (from.empty() || pos == std::string::npos) {
+        return text;
+    }
+    return text.substr(0, pos) + to + text.substr(pos + from.size());
+}
+
+// Run command with the apt sources rewritten by rewrite, restoring the
+// originals when the step's shell exits so later primary-source attempts
+// and every other apt run still use the configured sources
+std::string WithTemporaryAptSources(const std::string& rewrite,
+                                    const std::string& command) {
+    const std::string kBackupDir = "/etc/apt/prakasa-orig";
+    return "rm -rf " + kBackupDir + " && mkdir -p " + kBackupDir +
+           " && cp -a /etc/apt/sources.list /etc/apt/sources.list.d " +
+           kBackupDir + "/ 2>/dev/null; trap 'cp -a " + kBackupDir +
+           "/. /etc/apt/ && rm -rf " + kBackupDir + "' EXIT; " + rewrite +
+           command;
+}
+
+// Sleep in short slices so a stop request is honoured during the backoff
+void SleepUnlessStopped(ExecutionContext& context, int delay_ms) {
+    const int kSliceMs = 200;
+    for (int waited = 0; waited < delay_ms && !context.IsStopRequested();
+         waited += kSliceMs) {
+        Sleep(static_cast<DWORD>((std::min)(kSliceMs, delay_ms - waited)));
+    }
+}
+
+}  // namespace
+
+const char* StepClassToString(StepClass step_class) {
+    switch (step_class) {
+        case StepClass::kApt:
+            return "apt";
+        case StepClass::kCudaRepo:
+            return "cuda";
+        case StepClass::kPip:
+            return "pip";
+        case StepClass::kGit:
+            return "git";
+        case StepClass::kDownload:
+            return "download";
+        case StepClass::kHuggingFace:
+            return "huggingface";
+        default:
+            return "local";
+    }
+}
+
+RetryPolicy GetRetryPolicy(StepClass step_class) {
+    switch (step_class) {
+        case StepClass::kApt:
+        case StepClass::kCudaRepo:
+        case StepClass::kPip:
+            return {3, 5000, 60000};
+        case StepClass::kGit:
+            return {3, 3000, 30000};
+        case StepClass::kDownload:
+        case StepClass::kHuggingFace:
+            return {4, 2000, 30000};
+        default:
+            return {1, 0, 0};
+    }
+}
+
+StepClass ClassifyStep(const std::string& command) {
+    // dpkg only installs files that are already downloaded
+    if (command.find("dpkg -i") != std::string::npos) {
+        return StepClass::kLocal;
+    }
+    if (command.find("git clone") != std::string::npos ||
+        command.find("git pull") != std::string::npos) {
+        return StepClass::kGit;
+    }
+    if (command.find("pip install") != std::string::npos) {
+        return StepClass::kPip;
+    }
+    if (command.find("cuda-keyring") != std::string::npos ||
+        command.find("cuda-toolkit") != std::string::npos) {
+        return StepClass::kCudaRepo;
+    }
+    if (command.find("apt-get ") != std::string::npos ||
+        command.find("apt ") != std::string::npos) {
+        return StepClass::kApt;
+    }
+    if (command.find("curl ") != std::string::npos ||
+        command.find("wget ") != std::string::npos ||
+        command.find("rustup") != std::string::npos) {
+        return StepClass::kDownload;
+    }
+    return StepClass::kLocal;
+}
+
+bool IsRetryableFailure(StepClass step_class, int exit_code,
+                        const std::string& output) {
+    if (step_class == StepClass::kLocal || exit_code == 0) {
+        return false;
+    }
+    // -1 is a stop request from CommandExecutor, -2 a timeout
+    if (exit_code == -1) {
+        return false;
+    }
+    if (exit_code == -2) {
+        return true;
+    }
+    if (step_class == StepClass::kDownload && IsNetworkExitCode(exit_code)) {
+        return true;
+    }
+
+    std::string lower_output = ToLower(output);
+    for (const char* pattern : kRetryablePatterns) {
+        if (lower_output.find(pattern) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int ComputeBackoffDelayMs(const RetryPolicy& policy, int attempt) {
+    if (policy.base_delay_ms <= 0) {
+        return 0;
+    }
+    long long ceiling = policy.base_delay_ms;
+    for (int i = 0; i < attempt && ceiling < policy.max_delay_ms; ++i) {
+        ceiling *= 2;
+    }
+    ceiling = (std::min)(ceiling, static_cast<long long>(policy.max_delay_ms));
+
+    // Jitter keeps parallel installs from hammering a mirror in lockstep
+    static thread_local std::mt19937 generator{std::random_device{}()};
+    std::uniform_int_distribution<long long> jitter(ceiling / 2, ceiling);
+    return static_cast<int>(jitter(generator));
+}
+
+std::vector<std::string> GetConfiguredMirrors(StepClass step_class) {
+    std::string key;
+    switch (step_class) {
+        case StepClass::kApt:
+            key = parallax::config::KEY_APT_MIRRORS;
+            break;
+        case StepClass::kCudaRepo:
+            key = parallax::config::KEY_CUDA_REPO_MIRRORS;
+            break;
+        case StepClass::kPip:
+            key = parallax::config::KEY_PIP_MIRRORS;
+            break;
+        case StepClass::kGit:
+            key = parallax::config::KEY_GIT_MIRRORS;
+            break;
+        case StepClass::kHuggingFace:
+            key = parallax::config::KEY_HF_MIRRORS;
+            break;
+        default:
+            return {};
+    }
+
+    std::vector<std::string> mirrors;
+    std::stringstream stream(
+        parallax::config::ConfigManager::GetInstance().GetConfigValue(key));
+    std::string mirror;
+    while (std::getline(stream, mirror, ',')) {
+        size_t start = mirror.find_first_not_of(" \t");
+        size_t end = mirror.find_last_not_of(" \t/");
+        if (start != std::string::npos && end != std::string::npos &&
+            end >= start) {
+            mirrors.push_back(mirror.substr(start, end - start + 1));
+        }
+    }
+    return mirrors;
+}
+
+std::string ApplyMirror(StepClass step_class, const std::string& command,
+                        const std::string& mirror) {
+    // The snippets run inside bash -c "...", so they avoid double quotes
+    // and '$'. Rewritten apt sources only last for this attempt
+    const std::string kPipIndexOption = "pip install -i ";
+    switch (step_class) {
+        case StepClass::kApt:
+            return WithTemporaryAptSources(
+                "sed -i -E 's#^URIs: .*#URIs: " + mirror +
+                    "/#' /etc/apt/sources.list.d/ubuntu.sources 2>/dev/null; "
+                    "sed -i -E '/ubuntu/s#^(deb(-src)? (\\[[^]]*\\] )?)"
+                    "[a-z]+://[^ ]+ #\\1" +
+                    mirror + "/ #' /etc/apt/sources.list 2>/dev/null; ",
+                command);
+        case StepClass::kCudaRepo:
+            return WithTemporaryAptSources(
+                "sed -i -E 's#[a-z]+://[^ ]+/(wsl-ubuntu/x86_64)#" + mirror +
+                    "/\\1#' /etc/apt/sources.list.d/cuda-*.list "
+                    "2>/dev/null; ",
+                ReplaceFirst(command, kCudaRepoBaseUrl, mirror));
+        case StepClass::kPip: {
+            size_t index_pos = command.find(kPipIndexOption);
+            if (index_pos == std::string::npos) {
+                return ReplaceFirst(command, "pip install ",
+                                    kPipIndexOption + mirror + " ");
+            }
+            size_t url_start = index_pos + kPipIndexOption.size();
+            size_t url_end = command.find(' ', url_start);
+            return command.substr(0, url_start) + mirror +
+                   (url_end == std::string::npos ? ""
+                                                 : command.substr(url_end));
+        }
+        case StepClass::kGit: {
+            auto& config = parallax::config::ConfigManager::GetInstance();
+            if (command.find("git clone") != std::string::npos) {
+                return ReplaceFirst(
+                    command,
+                    config.GetConfigValue(
+                        parallax::config::KEY_PRAKASA_GIT_REPO_URL),
+                    mirror);
+            }
+            return ReplaceFirst(
+                command, "git pull",
+                "git pull " + mirror + " " +
+                    config.GetConfigValue(
+                        parallax::config::KEY_PRAKASA_GIT_BRANCH));
+        }
+        case StepClass::kHuggingFace:
+            return "HF_ENDPOINT=" + mirror + " " + command;
+        default:
+            return "";
+    }
+}
+
+int RunStepWithRetry(ExecutionContext& context, const std::string& step_name,
+                     const std::string& command, const StepRunner& runner) {
+    StepClass step_class = ClassifyStep(command);
+    RetryPolicy policy = GetRetryPolicy(step_class);
+
+    // The primary source (empty string) and each configured mirror,
+    // fastest first
+    std::vector<std::string> sources(1);
+    if (step_class != StepClass::kLocal &&
+        !GetConfiguredMirrors(step_class).empty()) {
+        std::string primary = MirrorSelector::GetPrimaryUrl(step_class);
+        sources = context.GetMirrorSelector().RankCandidates(step_class);
+        for (auto& source : sources) {
+            if (source == primary) {
+                source.clear();
+            }
+        }
+    }
+
+    int exit_code = 0;
+    for (size_t source = 0; source < sources.size(); ++source) {
+        std::string source_command =
+            sources[source].empty()
+                ? command
+                : ApplyMirror(step_class, command, sources[source]);
+        if (source_command.empty()) {
+            continue;
+        }
+        std::string source_name =
+            sources[source].empty() ? "primary source" : sources[source];
+        if (source > 0) {
+            warn_log("[ENV] Step %s: failing over to %s %s",
+                     step_name.c_str(), StepClassToString(step_class),
+                     source_name.c_str());
+        }
+
+        for (int attempt = 0; attempt < policy.max_attempts; ++attempt) {
+            std::string output;
+            exit_code = runner(source_command, output);
+            if (exit_code == 0) {
+                if (attempt > 0 || source > 0) {
+                    info_log("[ENV] Step %s succeeded on attempt %d using %s",
+                             step_name.c_str(), attempt + 1,
+                             source_name.c_str());
+                }
+                return 0;
+            }
+            if (context.IsStopRequested() ||
+                !IsRetryableFailure(step_class, exit_code, output)) {
+                return exit_code;
+            }
+            if (attempt + 1 == policy.max_attempts) {
+                break;
+            }
+
+            int delay_ms = ComputeBackoffDelayMs(policy, attempt);
+            warn_log("[ENV] Step %s failed with retryable error (code %d), "
+                     "retrying in %d ms (attempt %d/%d)",
+                     step_name.c_str(), exit_code, delay_ms, attempt + 2,
+                     policy.max_attempts);
+            SleepUnlessStopped(context, delay_ms);
+            if (context.IsStopRequested()) {
+                return exit_code;
+            }
+        }
+    }
+    return exit_code;
+}
+
+}  // namespace environment
+}  // namespace parallax
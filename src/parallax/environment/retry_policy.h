@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace parallax {
+namespace environment {
+
+class ExecutionContext;
+
+// Network-bound install steps grouped by the service they depend on
+enum class StepClass {
+    kLocal,     // No network access, never retried
+    kApt,       // Ubuntu archive (apt-get update/install)
+    kCudaRepo,  // NVIDIA CUDA apt repository
+    kPip,       // Python package index
+    kGit,       // Prakasa git repository
+    kDownload,  // Other downloads (curl, wget, rustup)
+    kHuggingFace  // Model downloads by prakasa at run time
+};
+
+struct RetryPolicy {
+    int max_attempts = 1;  // Per source (the primary and each mirror)
+    int base_delay_ms = 0;
+    int max_delay_ms = 0;
+};
+
+// Runs one attempt of a step and returns its exit code; output receives
+// whatever the step printed so the failure can be classified
+using StepRunner =
+    std::function<int(const std::string& command, std::string& output)>;
+
+RetryPolicy GetRetryPolicy(StepClass step_class);
+
+// Short name for logs and cache keys, e.g. "pip"
+const char* StepClassToString(StepClass step_class);
+
+// Infer the step class from the command text
+StepClass ClassifyStep(const std::string& command);
+
+// Transient failure worth retrying: timeouts, curl/wget network exit codes
+// and known network error messages in the output
+bool IsRetryableFailure(StepClass step_class, int exit_code,
+                        const std::string& output);
+
+// Exponential backoff with jitter: a random delay between half and all of
+// min(max_delay, base_delay * 2^attempt), attempt counting from 0
+int ComputeBackoffDelayMs(const RetryPolicy& policy, int attempt);
+
+// Mirrors configured for the class (apt_mirrors, cuda_repo_mirrors,
+// pip_mirrors, git_mirrors, hf_mirrors), in configuration order
+std::vector<std::string> GetConfiguredMirrors(StepClass step_class);
+
+// Command that runs the step against mirror instead of the primary source,
+// empty if the class has no mirror support. Apt sources rewritten for the
+// mirror are restored when the command exits
+std::string ApplyMirror(StepClass step_class, const std::string& command,
+                        const std::string& mirror);
+
+// Run a step with the retry policy of its class, failing over to the
+// configured mirrors once the attempts on a source are used up. When
+// mirrors are configured the sources are tried fastest first, as ranked
+// by the context's MirrorSelector. Only this
+// step is repeated; a non-retryable failure or a stop request ends it at
+// once. Returns the exit code of the last attempt
+int RunStepWithRetry(ExecutionContext& context, const std::string& step_name,
+                     const std::string& command, const StepRunner& runner);
+
+}  // namespace environment
+}  // namespace parallax
@@ -1,5 +1,8 @@
 #include "software_installer.h"
 #include "environment_installer.h"
+#include "retry_policy.h"
+#include "build_environment.h"
+#include "install_manifest.h"
 #include "config/config_manager.h"
 #include "utils/wsl_process.h"
 #include "utils/utils.h"
@@ -42,93 +45,16 @@ ComponentResult CudaToolkitInstaller::Install() {
 
     info_log("[ENV] Installing CUDA Toolkit 12.8 in WSL...");
 
-    // Install command sequence (step name, command, timeout seconds, use
-    // real-time output)
-    std::vector<std::tuple<std::string, std::string, int, bool>> commands;
-
-    const std::string& proxy_url = context_->GetProxyUrl();
-
-    // Download CUDA keyring
-    std::string wget_cmd =
-        "wget "
-        "https://developer.download.nvidia.com/compute/cuda/repos/wsl-ubuntu/"
-        "x86_64/cuda-keyring_1.1-1_all.deb";
-    if (!proxy_url.empty()) {
-        wget_cmd = "ALL_PROXY=" + proxy_url + " " + wget_cmd;
-    }
-    commands.emplace_back("download_cuda_keyring", wget_cmd, 300, false);
-
-    // Install keyring
-    commands.emplace_back("install_cuda_keyring",
-                          "dpkg -i cuda-keyring_1.1-1_all.deb", 60, false);
-
-    // Update package list
-    std::string update_cmd =
-        proxy_url.empty()
-            ? "apt-get update"
-            : "apt-get -o Acquire::http::proxy=\"" + proxy_url +
-                  "\" -o Acquire::https::proxy=\"" + proxy_url + "\" update";
-    commands.emplace_back("update_package_list", update_cmd, 300, false);
-
-    // Install CUDA Toolkit (use real-time output)
-    std::string install_cmd =
-        proxy_url.empty() ? "apt-get -y install cuda-toolkit-12-8"
-                          : "apt-get -o Acquire::http::proxy=\"" + proxy_url +
-                                "\" -o Acquire::https::proxy=\"" + proxy_url +
-                                "\" -y install cuda-toolkit-12-8";
-    commands.emplace_back("install_cuda_toolkit", install_cmd, 1200, true);
-
-    // Add CUDA to environment variables - use multiple methods to ensure
-    // effectiveness
-    commands.emplace_back(
-        "add_cuda_to_bashrc",
-        "echo 'export PATH=/usr/local/cuda-12.8/bin:$PATH' >> ~/.bashrc", 60,
-        false);
-    commands.emplace_back("add_cuda_lib_to_bashrc",
-                          "echo 'export "
-                          "LD_LIBRARY_PATH=/usr/local/cuda-12.8/"
-                          "lib64:$LD_LIBRARY_PATH' >> ~/.bashrc",
-                          60, false);
-    commands.emplace_back(
-        "add_cuda_to_profile",
-        "echo 'export PATH=/usr/local/cuda-12.8/bin:$PATH' >> /etc/profile", 60,
-        false);
-    commands.emplace_back("add_cuda_lib_to_profile",
-                          "echo 'export "
-                          "LD_LIBRARY_PATH=/usr/local/cuda-12.8/"
-                          "lib64:$LD_LIBRARY_PATH' >> /etc/profile",
-                          60, false);
-    commands.emplace_back(
-        "create_cuda_env_script",
-        "echo -e '#!/bin/bash\\nexport "
-        "PATH=/usr/local/cuda-12.8/bin:$PATH\\nexport "
-        "LD_LIBRARY_PATH=/usr/local/cuda-12.8/lib64:$LD_LIBRARY_PATH' > "
-        "/etc/profile.d/cuda.sh && chmod +x /etc/profile.d/cuda.sh",
-        60, false);
-
-    for (const auto& [step_name, cmd, timeout, use_realtime] : commands) {
-        info_log("[ENV] CUDA Toolkit installation step: %s", step_name.c_str());
-
-        int cmd_exit_code = 0;
-        if (use_realtime) {
-            // Use WSLProcess to get real-time output
-            std::string wsl_cmd = parallax::utils::BuildWSLCommand(
-                context_->GetUbuntuVersion(), cmd);
-            WSLProcess wsl_process;
-            cmd_exit_code = wsl_process.Execute(wsl_cmd);
-        } else {
-            // Use regular execution method
-            auto [exit_code, output] = executor_->ExecuteWSL(cmd, timeout);
-            cmd_exit_code = exit_code;
-        }
-
-        if (cmd_exit_code != 0) {
-            std::string error_msg =
-                "Failed at step '" + step_name + "': " + cmd;
-            ComponentResult result = CreateFailureResult(error_msg, 21);
-            LogOperationResult("Installing", result);
-            return result;
-        }
+    // Steps come from the install manifest; those whose inputs did not
+    // change since their last successful run are skipped
+    ManifestRunner runner(context_, executor_);
+    ManifestRunResult run_result =
+        runner.Run("cuda", {}, "CUDA Toolkit installation");
+    if (!run_result.success) {
+        ComponentResult result =
+            CreateFailureResult(run_result.error_message, 21);
+        LogOperationResult("Installing", result);
+        return result;
     }
 
     // Verify installation
@@ -144,30 +70,53 @@ ComponentResult CudaToolkitInstaller::Install() {
 }
 
 bool CudaToolkitInstaller::IsCudaToolkitInstalled() {
-    // Check if CUDA Toolkit is installed - load environment variables first
-    // then detect
-    auto [cuda_code, cuda_output] = executor_->ExecuteWSL(
-        "source ~/.bashrc && nvcc --version 2>/dev/null || "
-        "/usr/local/cuda-12.8/bin/nvcc --version 2>/dev/null || echo 'not "
-        "found'");
-    if (cuda_code == 0 &&
-        (cuda_output.find("release 12.8") != std::string::npos ||
-         cuda_output.find("release 12.9") != std::string::npos)) {
-        return true;
-    }
-
-    // Check if cuda-toolkit-12-8 package exists
-    auto [dpkg_code, dpkg_output] =
-        executor_->ExecuteWSL("dpkg -l | grep cuda-toolkit-12");
-    if (dpkg_code == 0 && !dpkg_output.empty()) {
-        return true;
+    // The three checks are independent; each wsl.exe start costs about a
+    // second, so they run concurrently and the rest are cancelled once one
+    // of them finds CUDA. First: nvcc, after loading environment variables
+    std::vector<AsyncCommand> pending = {
+        executor_->ExecuteWSLAsync(
+            "source ~/.bashrc && nvcc --version 2>/dev/null || "
+            "/usr/local/cuda-12.8/bin/nvcc --version 2>/dev/null || echo 'not "
+            "found'",
+            300, CommandKind::kProbe),
+        // Check if cuda-toolkit-12-8 package exists
+        executor_->ExecuteWSLAsync("dpkg -l | grep cuda-toolkit-12", 300,
+                                   CommandKind::kProbe),
+        // Check if CUDA installation directory exists
+        executor_->ExecuteWSLAsync(
+            "ls -la /usr/local/cuda-12.8/bin/nvcc 2>/dev/null || ls -la "
+            "/usr/local/cuda/bin/nvcc 2>/dev/null || echo 'not found'",
+            300, CommandKind::kProbe)};
+
+    auto found = [](size_t index, int code, const std::string& output) {
+        if (code != 0) {
+            return false;
+        }
+        switch (index) {
+            case 0:
+                return output.find("release 12.8") != std::string::npos ||
+                       output.find("release 12.9") != std::string::npos;
+            case 1:
+                return !output.empty();
+            default:
+                return output.find("not found") == std::string::npos;
+        }
+    };
+
+    std::vector<size_t> pending_index = {0, 1, 2};
+    while (!pending.empty()) {
+        size_t ready = WhenAny(pending);
+        auto [code, output] = pending[ready].Get();
+        if (found(pending_index[ready], code, output)) {
+            for (auto& probe : pending) {
+                probe.Cancel();
+            }
+            return true;
+        }
+        pending.erase(pending.begin() + ready);
+        pending_index.erase(pending_index.begin() + ready);
     }
-
-    // Check if CUDA installation directory exists
-    auto [dir_code, dir_output] = executor_->ExecuteWSL(
-        "ls -la /usr/local/cuda-12.8/bin/nvcc 2>/dev/null || ls -la "
-        "/usr/local/cuda/bin/nvcc 2>/dev/null || echo 'not found'");
-    return (dir_code == 0 && dir_output.find("not found") == std::string::npos);
+    return false;
 }
 
 EnvironmentComponent CudaToolkitInstaller::GetComponentType() const {
@@ -217,7 +166,14 @@ ComponentResult CargoInstaller::Install() {
     std::string download_cmd =
         "curl --proto '=https' --tlsv1.2 -sSf https://sh.rustup.rs -o "
         "/tmp/rustup.sh";
-    std::string install_cmd = "sh /tmp/rustup.sh -y";
+    // Minimal profile: no docs, clippy or rustfmt, which the builds never
+    // use; the toolchain is pinned so rebuilds reuse the shared target cache
+    std::string toolchain =
+        parallax::config::ConfigManager::GetInstance().GetConfigValue(
+            parallax::config::KEY_RUST_TOOLCHAIN);
+    std::string install_cmd =
+        "sh /tmp/rustup.sh -y --profile minimal --default-toolchain " +
+        (toolchain.empty() ? std::string("stable") : toolchain);
 
     if (!proxy_url.empty()) {
         download_cmd = "ALL_PROXY=" + proxy_url + " " + download_cmd;
@@ -227,7 +183,7 @@ ComponentResult CargoInstaller::Install() {
 
     // Download rustup script
     auto [download_code, download_output] =
-        executor_->ExecuteWSL(download_cmd, 300);
+        executor_->ExecuteWSLWithRetry("download_rustup", download_cmd, 300);
     if (download_code != 0) {
         ComponentResult result = CreateFailureResult(
             "Failed to download rustup script: " + download_output, 22);
@@ -235,9 +191,9 @@ ComponentResult CargoInstaller::Install() {
         return result;
     }
 
-    // Perform installation
+    // Perform installation (rustup downloads the toolchain)
     auto [install_code, install_output] =
-        executor_->ExecuteWSL(install_cmd, 600);
+        executor_->ExecuteWSLWithRetry("install_rustup", install_cmd, 600);
     if (install_code != 0) {
         ComponentResult result = CreateFailureResult(
             "Failed to install Rust: " + install_output, 22);
@@ -245,6 +201,22 @@ ComponentResult CargoInstaller::Install() {
         return result;
     }
 
+    // Sparse index (only the crates a build needs are fetched) and a target
+    // directory outside ~/prakasa that survives updates; an existing user
+    // config is left alone
+    std::string cargo_config_cmd =
+        std::string("mkdir -p ~/.cargo ") + kCargoTargetDir +
+        " && ([ -f ~/.cargo/config.toml ] || printf "
+        "'[registries.crates-io]\\nprotocol = \\047sparse\\047\\n\\n"
+        "[build]\\ntarget-dir = \\047" +
+        kCargoTargetDir + "\\047\\n' > ~/.cargo/config.toml)";
+    auto [config_code, config_output] =
+        executor_->ExecuteWSL(cargo_config_cmd, 30);
+    if (config_code != 0) {
+        info_log("[ENV] Warning: Failed to write cargo config: %s",
+                 config_output.c_str());
+    }
+
     // Add Cargo to environment variables - use multiple methods to ensure
     // effectiveness
     auto [bashrc_code, bashrc_output] = executor_->ExecuteWSL(
@@ -277,7 +249,8 @@ bool CargoInstaller::IsCargoInstalled() {
     // then detect
     auto [cargo_code, cargo_output] = executor_->ExecuteWSL(
         "source ~/.bashrc && cargo --version 2>/dev/null || ~/.cargo/bin/cargo "
-        "--version 2>/dev/null || echo 'not found'");
+        "--version 2>/dev/null || echo 'not found'",
+        300, CommandKind::kProbe);
     return (cargo_code == 0 &&
             cargo_output.find("not found") == std::string::npos &&
             !cargo_output.empty());
@@ -331,7 +304,7 @@ ComponentResult NinjaInstaller::Install() {
                                 "\" install -y ninja-build";
 
     auto [install_code, install_output] =
-        executor_->ExecuteWSL(install_cmd, 300);
+        executor_->ExecuteWSLWithRetry("install_ninja", install_cmd, 300);
 
     ComponentResult result =
         (install_code != 0)
@@ -350,7 +323,8 @@ ComponentResult NinjaInstaller::Install() {
 
 bool NinjaInstaller::IsNinjaInstalled() {
     // Check if ninja command is available
-    auto [ninja_code, ninja_output] = executor_->ExecuteWSL("ninja --version");
+    auto [ninja_code, ninja_output] =
+        executor_->ExecuteWSL("ninja --version", 300, CommandKind::kProbe);
     return (ninja_code == 0 && !ninja_output.empty());
 }
 
@@ -362,5 +336,103 @@ std::string NinjaInstaller::GetComponentName() const {
     return "Ninja Build Tool";
 }
 
+// CompilerCacheInstaller implementation
+namespace {
+
+// Statically linked release, independent of the distro's glibc
+const char* const kSccacheVersion = "v0.8.2";
+
+}  // namespace
+
+CompilerCacheInstaller::CompilerCacheInstaller(
+    std::shared_ptr<ExecutionContext> context,
+    std::shared_ptr<CommandExecutor> executor)
+    : BaseEnvironmentComponent(context), executor_(executor) {}
+
+ComponentResult CompilerCacheInstaller::Check() {
+    LogOperationStart("Checking");
+
+    // Builds work without it, so its absence is informational only
+    ComponentResult result =
+        IsCompilerCacheInstalled()
+            ? CreateSkippedResult("sccache is already installed")
+            : CreateSuccessResult(
+                  "sccache is not installed (optional), native builds are "
+                  "not cached");
+
+    LogOperationResult("Checking", result);
+    return result;
+}
+
+ComponentResult CompilerCacheInstaller::Install() {
+    LogOperationStart("Installing");
+
+    if (IsCompilerCacheInstalled()) {
+        ComponentResult result =
+            CreateSkippedResult("sccache is already installed");
+        LogOperationResult("Installing", result);
+        return result;
+    }
+
+    info_log("[ENV] Installing sccache %s in WSL...", kSccacheVersion);
+
+    const std::string& proxy_url = context_->GetProxyUrl();
+    std::string release = std::string("sccache-") + kSccacheVersion +
+                          "-x86_64-unknown-linux-musl";
+    std::string download_cmd =
+        std::string("curl -fsSL https://github.com/mozilla/sccache/releases/"
+                    "download/") +
+        kSccacheVersion + "/" + release + ".tar.gz -o /tmp/sccache.tar.gz";
+    if (!proxy_url.empty()) {
+        download_cmd = "ALL_PROXY=" + proxy_url + " " + download_cmd;
+    }
+
+    auto [download_code, download_output] =
+        executor_->ExecuteWSLWithRetry("download_sccache", download_cmd, 300);
+    if (download_code != 0) {
+        ComponentResult result = CreateFailureResult(
+            "Failed to download sccache: " + download_output, 26);
+        LogOperationResult("Installing", result);
+        return result;
+    }
+
+    // The cache directory lives outside ~/prakasa so a reinstall of the
+    // project keeps it
+    std::string install_cmd =
+        "tar -xzf /tmp/sccache.tar.gz -C /tmp && install -m 755 /tmp/" +
+        release + "/sccache /usr/local/bin/sccache && mkdir -p " +
+        kCompilerCacheDir + " && rm -rf /tmp/sccache.tar.gz /tmp/" + release;
+    auto [install_code, install_output] =
+        executor_->ExecuteWSL(install_cmd, 120);
+
+    ComponentResult result =
+        (install_code != 0)
+            ? CreateFailureResult(
+                  "Failed to install sccache: " + install_output, 26)
+            : (IsCompilerCacheInstalled()
+                   ? CreateSuccessResult("sccache installed successfully")
+                   : CreateFailureResult(
+                         "sccache installation completed but verification "
+                         "failed",
+                         26));
+
+    LogOperationResult("Installing", result);
+    return result;
+}
+
+bool CompilerCacheInstaller::IsCompilerCacheInstalled() {
+    auto [sccache_code, sccache_output] =
+        executor_->ExecuteWSL("sccache --version", 300, CommandKind::kProbe);
+    return (sccache_code == 0 && !sccache_output.empty());
+}
+
+EnvironmentComponent CompilerCacheInstaller::GetComponentType() const {
+    return EnvironmentComponent::kCompilerCache;
+}
+
+std::string CompilerCacheInstaller::GetComponentName() const {
+    return "Compiler Cache (sccache)";
+}
+
 }  // namespace environment
 }  // namespace parallax
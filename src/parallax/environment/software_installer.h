@@ -67,6 +67,28 @@ class NinjaInstaller : public BaseEnvironmentComponent {
     bool IsNinjaInstalled();
 };
 
+/**
+ * @brief sccache compiler cache installer component
+ *
+ * Optional: a missing cache only makes rebuilds of the Prakasa native
+ * extensions slower, so Check reports a warning instead of a failure.
+ */
+class CompilerCacheInstaller : public BaseEnvironmentComponent {
+ public:
+    explicit CompilerCacheInstaller(std::shared_ptr<ExecutionContext> context,
+                                    std::shared_ptr<CommandExecutor> executor);
+
+    ComponentResult Check() override;
+    ComponentResult Install() override;
+    EnvironmentComponent GetComponentType() const override;
+    std::string GetComponentName() const override;
+
+ private:
+    std::shared_ptr<CommandExecutor> executor_;
+
+    bool IsCompilerCacheInstalled();
+};
+
 /**
  * @brief pip upgrade manager component
  */
@@ -105,12 +127,29 @@ class ParallaxProjectInstaller : public BaseEnvironmentComponent {
 
     bool IsParallaxProjectInstalled();
     bool HasParallaxProjectGitUpdates();
+};
+
+/**
+ * @brief WSL disk footprint manager component
+ *
+ * Runs last: cleans the package caches left behind by the install, trims
+ * the guest file system and shrinks the distro's ext4.vhdx on the host.
+ * Optional, so Check reports a warning when space can be reclaimed.
+ */
+class DiskFootprintManager : public BaseEnvironmentComponent {
+ public:
+    explicit DiskFootprintManager(std::shared_ptr<ExecutionContext> context,
+                                  std::shared_ptr<CommandExecutor> executor);
+
+    ComponentResult Check() override;
+    ComponentResult Install() override;
+    EnvironmentComponent GetComponentType() const override;
+    std::string GetComponentName() const override;
+
+ private:
+    std::shared_ptr<CommandExecutor> executor_;
 
-    // Helper method for executing command sequences
-    ComponentResult ExecuteCommandSequence(
-        const std::vector<std::tuple<std::string, std::string, int, bool>>&
-            commands,
-        const std::string& operation_name);
+    bool ShrinkVhdx(const std::string& vhdx_path, std::string& method);
 };
 
 }  // namespace environment
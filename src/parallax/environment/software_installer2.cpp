@@ -1,5 +1,8 @@
 #include "software_installer.h"
 #include "environment_installer.h"
+#include "retry_policy.h"
+#include "build_environment.h"
+#include "install_manifest.h"
 #include "config/config_manager.h"
 #include "utils/wsl_process.h"
 #include "utils/utils.h"
@@ -50,8 +53,8 @@ namespace parallax
                               "\" -o Acquire::https::proxy=\"" + proxy_url +
                               "\" install -y python3-pip";
 
-                auto [install_code, install_output] =
-                    executor_->ExecuteWSL(install_pip_cmd, 300);
+                auto [install_code, install_output] = executor_->ExecuteWSLWithRetry(
+                    "install_python3_pip", install_pip_cmd, 300);
                 if (install_code != 0)
                 {
                     ComponentResult result = CreateFailureResult(
@@ -74,7 +77,7 @@ namespace parallax
             }
 
             auto [upgrade_code, upgrade_output] =
-                executor_->ExecuteWSL(upgrade_cmd, 300);
+                executor_->ExecuteWSLWithRetry("upgrade_pip", upgrade_cmd, 300);
 
             ComponentResult result =
                 (upgrade_code != 0)
@@ -89,7 +92,8 @@ namespace parallax
         bool PipUpgradeManager::IsPipUpToDate()
         {
             // Check if pip is installed and up to date
-            auto [pip_code, pip_output] = executor_->ExecuteWSL("pip --version");
+            auto [pip_code, pip_output] =
+                executor_->ExecuteWSL("pip --version", 300, CommandKind::kProbe);
             return (pip_code == 0 && !pip_output.empty());
         }
 
@@ -168,178 +172,72 @@ namespace parallax
                 info_log("[ENV] Installing Parallax project in WSL...");
             }
 
-            // Get configured git repository URL
-            std::string repo_url =
-                parallax::config::ConfigManager::GetInstance().GetConfigValue(
-                    parallax::config::KEY_PRAKASA_GIT_REPO_URL);
-            std::string git_branch =
-                parallax::config::ConfigManager::GetInstance().GetConfigValue(
-                    parallax::config::KEY_PRAKASA_GIT_BRANCH);
             std::string pip_index_url =
                 parallax::config::ConfigManager::GetInstance().GetConfigValue(
                     parallax::config::KEY_PIP_INDEX_URL);
 
-            const std::string &proxy_url = context_->GetProxyUrl();
-
-            // Install command sequence (step name, command, timeout seconds, use
-            // real-time output)
-            std::vector<std::tuple<std::string, std::string, int, bool>> commands;
-
             // Determine if it's update mode or fresh installation mode
             bool is_update_mode = (is_installed);
 
-            if (is_update_mode)
+            // Build native extensions only for the installed GPUs, with job
+            // counts sized to the distro's cores and free memory
+            BuildEnvironment build_env = DetectBuildEnvironment(executor_);
+            std::string build_exports = build_env.BuildExportCommand();
+
+            // Route C/C++/CUDA/Rust compiles through sccache when the
+            // compiler cache component is installed; counters are reset so
+            // the summary covers this build only
+            auto [cache_code, cache_output] =
+                executor_->ExecuteWSL("command -v sccache", 30, CommandKind::kProbe);
+            bool use_compiler_cache = (cache_code == 0 && !cache_output.empty());
+            if (use_compiler_cache)
             {
-                // Project is installed and has updates, only execute git pull update
-                std::string pull_cmd = "cd ~/prakasa && git checkout " + git_branch + " && git pull";
-                if (!proxy_url.empty())
-                {
-                    pull_cmd = "cd ~/prakasa && git checkout " + git_branch + " && ALL_PROXY=" + proxy_url + " git pull";
-                }
-                commands.emplace_back("update_parallax", pull_cmd, 300, false);
-            }
-            else
-            {
-                // Project not installed, check if prakasa directory exists, decide
-                // whether to clone or pull
-                auto [check_dir_code, check_dir_output] = executor_->ExecuteWSL(
-                    "ls -la ~/prakasa/.git 2>/dev/null || echo 'not found'", 30);
-
-                if (check_dir_code == 0 &&
-                    check_dir_output.find("not found") == std::string::npos)
-                {
-                    // Directory exists, check if it's a git repository
-                    auto [check_git_code, check_git_output] = executor_->ExecuteWSL(
-                        "cd ~/prakasa && git branch 2>/dev/null || echo 'not git'",
-                        30);
-
-                    if (check_git_code == 0 &&
-                        check_git_output.find("not git") == std::string::npos)
-                    {
-                        // Is a git repository, execute pull
-                        info_log(
-                            "[ENV] Prakasa directory exists, updating with git "
-                            "pull...");
-                        std::string pull_cmd = "cd ~/prakasa && git checkout " + git_branch + " && git pull";
-                        if (!proxy_url.empty())
-                        {
-                            pull_cmd =
-                                "cd ~/prakasa && git checkout " + git_branch + " && ALL_PROXY=" + proxy_url + " git pull";
-                        }
-                        commands.emplace_back("update_parallax", pull_cmd, 300, false);
-                    }
-                    else
-                    {
-                        // Not a git repository, remove directory and clone again
-                        info_log(
-                            "[ENV] Prakasa directory exists but is not a git "
-                            "repository, "
-                            "removing and cloning...");
-                        commands.emplace_back("remove_old_prakasa",
-                                              "rm -rf ~/prakasa", 60, false);
-
-                        std::string clone_cmd = "cd ~ && ";
-                        if (!proxy_url.empty())
-                        {
-                            clone_cmd += "ALL_PROXY=" + proxy_url + " ";
-                        }
-                        clone_cmd += "git clone -b " + git_branch + " " + repo_url;
-                        commands.emplace_back("clone_prakasa", clone_cmd, 600, false);
-                    }
-                }
-                else
-                {
-                    // Directory does not exist, execute clone
-                    info_log("[ENV] Prakasa directory not found, cloning...");
-
-                    std::string clone_cmd = "cd ~ && ";
-                    if (!proxy_url.empty())
-                    {
-                        clone_cmd += "ALL_PROXY=" + proxy_url + " ";
-                    }
-                    clone_cmd += "git clone -b " + git_branch + " " + repo_url;
-                    commands.emplace_back("clone_prakasa", clone_cmd, 600, false);
-                }
+                build_exports += " && " + BuildCompilerCacheExportCommand() +
+                                 " && (sccache --zero-stats >/dev/null 2>&1 || true)";
             }
 
-            if (!is_update_mode)
+            // Clone or pull, venv, pip install and bytecode steps come from
+            // the install manifest; git and the configuration items are
+            // expanded there, pip install is skipped when neither the
+            // checkout nor the index changed since the last successful run
+            std::map<std::string, std::string> variables = {
+                {"build_exports", build_exports},
+                {"pip_index_option",
+                 pip_index_url.empty() ? "" : "-i " + pip_index_url}};
+            ManifestRunner runner(context_, executor_);
+            ManifestRunResult run_result =
+                runner.Run("prakasa", variables, "Prakasa project installation");
+            if (!run_result.success)
             {
-                // Only install python3-venv dependency package during first
-                // installation
-                std::string install_venv_cmd =
-                    "apt update && apt-get install -y python3-venv";
-                if (!proxy_url.empty())
-                {
-                    install_venv_cmd =
-                        "apt -o Acquire::http::proxy=\"" + proxy_url +
-                        "\" -o Acquire::https::proxy=\"" + proxy_url +
-                        "\" update && apt-get -o Acquire::http::proxy=\"" + proxy_url +
-                        "\" -o Acquire::https::proxy=\"" + proxy_url +
-                        "\" install -y python3-venv";
-                }
-                commands.emplace_back("install_python3_venv", install_venv_cmd, 300,
-                                      false);
+                ComponentResult result =
+                    CreateFailureResult(run_result.error_message, 25);
+                LogOperationResult("Installing", result);
+                return result;
             }
 
-            // Install Prakasa project (use real-time output)
-            std::string install_base_cmd =
-                "cd ~/prakasa && ([ -d ./venv ] || python3 -m venv ./venv) && source "
-                "./venv/bin/activate "
-                "&& pip install -e '.[gpu]'";
-            if (!pip_index_url.empty())
+            std::string cache_summary;
+            if (use_compiler_cache)
             {
-                install_base_cmd =
-                    "cd ~/prakasa && ([ -d ./venv ] || python3 -m venv ./venv) && source "
-                    "./venv/bin/activate "
-                    "&& pip install -i " +
-                    pip_index_url + " -e '.[gpu]'";
-            }
-            if (!proxy_url.empty())
-            {
-                install_base_cmd =
-                    "cd ~/prakasa && ([ -d ./venv ] || python3 -m venv ./venv) && "
-                    "source "
-                    "./venv/bin/activate && HTTP_PROXY=\"" +
-                    proxy_url + "\" HTTPS_PROXY=\"" + proxy_url +
-                    "\" pip install -e '.[gpu]'";
-                if (!pip_index_url.empty())
+                auto [stats_code, stats_output] =
+                    executor_->ExecuteWSL("sccache --show-stats", 30, CommandKind::kProbe);
+                CompilerCacheStats stats = ParseCompilerCacheStats(stats_output);
+                if (stats_code == 0 && stats.available && stats.compile_requests > 0)
                 {
-                    install_base_cmd =
-                        "cd ~/prakasa && ([ -d ./venv ] || python3 -m venv ./venv) && "
-                        "source "
-                        "./venv/bin/activate && HTTP_PROXY=\"" +
-                        proxy_url + "\" HTTPS_PROXY=\"" + proxy_url +
-                        "\" pip install -i " + pip_index_url + " -e '.[gpu]'";
+                    cache_summary = " (compiler cache: " + stats.Summary() + ")";
+                    info_log("[ENV] Compiler cache: %d requests, %s",
+                             stats.compile_requests, stats.Summary().c_str());
                 }
             }
-            commands.emplace_back("install_prakasa_base", install_base_cmd, 1800,
-                                  true);
-
-            if (!is_update_mode)
-            {
-                // Add CUDA environment variable to system profile (only during first installation)
-                std::string add_cuda_env_cmd =
-                    "grep -q '/usr/local/cuda-12.8/bin' ~/.bashrc || "
-                    "echo 'export PATH=/usr/local/cuda-12.8/bin:$PATH' >> ~/.bashrc";
-                commands.emplace_back("add_cuda_env", add_cuda_env_cmd, 30, false);
-            }
-
-            // Execute command sequence
-            ComponentResult cmd_result =
-                ExecuteCommandSequence(commands, "Prakasa project installation");
-            if (cmd_result.status != InstallationStatus::kSuccess)
-            {
-                LogOperationResult("Installing", cmd_result);
-                return cmd_result;
-            }
 
             // Verify installation
             ComponentResult result =
                 IsParallaxProjectInstalled()
                     ? (is_update_mode ? CreateSuccessResult(
-                                            "Prakasa project updated successfully")
+                                            "Prakasa project updated successfully" +
+                                            cache_summary)
                                       : CreateSuccessResult(
-                                            "Prakasa project installed successfully"))
+                                            "Prakasa project installed successfully" +
+                                            cache_summary))
                     : CreateFailureResult(is_update_mode
                                               ? "Parallax project update completed but "
                                                 "verification failed"
@@ -351,51 +249,14 @@ namespace parallax
             return result;
         }
 
-        ComponentResult ParallaxProjectInstaller::ExecuteCommandSequence(
-            const std::vector<std::tuple<std::string, std::string, int, bool>> &
-                commands,
-            const std::string &operation_name)
-        {
-            // Execute all commands
-            for (const auto &[step_name, cmd, timeout, use_realtime] : commands)
-            {
-                info_log("[ENV] %s step: %s", operation_name.c_str(),
-                         step_name.c_str());
-
-                int cmd_exit_code = 0;
-                if (use_realtime)
-                {
-                    // Use WSLProcess to get real-time output
-                    std::string wsl_cmd = parallax::utils::BuildWSLCommand(
-                        context_->GetUbuntuVersion(), cmd);
-                    WSLProcess wsl_process;
-                    cmd_exit_code = wsl_process.Execute(wsl_cmd);
-                }
-                else
-                {
-                    // Use regular execution method
-                    auto [exit_code, output] = executor_->ExecuteWSL(cmd, timeout);
-                    cmd_exit_code = exit_code;
-                }
-
-                if (cmd_exit_code != 0)
-                {
-                    std::string error_msg =
-                        "Failed at step '" + step_name + "': " + cmd;
-                    return CreateFailureResult(error_msg, 25);
-                }
-            }
-
-            return CreateSuccessResult("Command sequence completed successfully");
-        }
-
         bool ParallaxProjectInstaller::IsParallaxProjectInstalled()
         {
             // Check if prakasa project is installed (need to check in virtual
             // environment)
             auto [check_code, check_output] = executor_->ExecuteWSL(
                 "cd ~/prakasa && [ -d ./venv ] && source ./venv/bin/activate && pip "
-                "list | grep prakasa");
+                "list | grep prakasa",
+                300, CommandKind::kProbe);
             return (check_code == 0 && !check_output.empty());
         }
 
@@ -409,7 +270,8 @@ namespace parallax
             // Check if Prakasa project has git updates
             // First check if git repository exists
             auto [check_git_code, check_git_output] = executor_->ExecuteWSL(
-                "cd ~/prakasa && git rev-parse --is-inside-work-tree 2>/dev/null", 30);
+                "cd ~/prakasa && git rev-parse --is-inside-work-tree 2>/dev/null", 30,
+                CommandKind::kProbe);
 
             if (check_git_code != 0)
             {
@@ -435,7 +297,7 @@ namespace parallax
             // Check if there are differences between local and remote
             auto [diff_code, diff_output] = executor_->ExecuteWSL(
                 "cd ~/prakasa && git rev-list HEAD...origin/" + git_branch + " --count 2>/dev/null",
-                30);
+                30, CommandKind::kProbe);
 
             if (diff_code == 0 && !diff_output.empty())
             {
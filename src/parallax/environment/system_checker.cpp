@@ -408,9 +408,14 @@ namespace parallax
             LogOperationStart("Checking");
 
             // Use systeminfo command to check virtualization support - this method
-            // doesn't depend on WSL distribution
-            auto [systeminfo_code, systeminfo_output] =
-                executor_->ExecutePowerShell("systeminfo");
+            // doesn't depend on WSL distribution. systeminfo takes several
+            // seconds, so the wsl --status fallback runs alongside it and is
+            // cancelled when systeminfo decides
+            AsyncCommand systeminfo =
+                executor_->ExecutePowerShellAsync("systeminfo", 300, CommandKind::kProbe);
+            AsyncCommand wsl_status =
+                executor_->ExecutePowerShellAsync("wsl --status", 300, CommandKind::kProbe);
+            auto [systeminfo_code, systeminfo_output] = systeminfo.Get();
 
             if (systeminfo_code == 0)
             {
@@ -419,6 +424,7 @@ namespace parallax
                 if (systeminfo_output.find("Virtualization Enabled In Firmware: Yes") !=
                     std::string::npos)
                 {
+                    wsl_status.Cancel();
                     ComponentResult result =
                         CreateSuccessResult("BIOS virtualization is enabled");
                     LogOperationResult("Checking", result);
@@ -428,6 +434,7 @@ namespace parallax
                              "Virtualization Enabled In Firmware: No") !=
                          std::string::npos)
                 {
+                    wsl_status.Cancel();
                     ComponentResult result = CreateFailureResult(
                         "BIOS virtualization is not enabled. Please restart your "
                         "computer and enable virtualization in BIOS settings.",
@@ -438,8 +445,7 @@ namespace parallax
             }
 
             // Backup method: use wsl --status command to check virtualization support
-            auto [wsl_status_code, wsl_status_output] =
-                executor_->ExecutePowerShell("wsl --status");
+            auto [wsl_status_code, wsl_status_output] = wsl_status.Get();
 
             // Check if there are virtualization error prompts in wsl --status output
             if (wsl_status_code == 0)
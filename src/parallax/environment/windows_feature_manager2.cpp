@@ -197,19 +197,26 @@ bool WSL2DefaultVersionManager::IsWSL2DefaultVersion() {
         return false;
     }
 
+    // The backup listing runs alongside wsl --status and is cancelled when
+    // the status already answers
+    AsyncCommand status = executor_->ExecutePowerShellAsync(
+        "wsl --status", 300, CommandKind::kProbe);
+    AsyncCommand listing = executor_->ExecutePowerShellAsync(
+        "wsl --list --verbose", 300, CommandKind::kProbe);
+
     // Check if WSL default version is 2
-    auto [exit_code, output] = executor_->ExecutePowerShell("wsl --status");
+    auto [exit_code, output] = status.Get();
     if (exit_code == 0) {
         // Check if output contains "Default Version: 2"
         // Chinese version is default version: 2
         if (output.find(": 2") != std::string::npos) {
+            listing.Cancel();
             return true;
         }
     }
 
     // Backup check method: parse wsl --list --verbose output
-    auto [version_code, version_output] =
-        executor_->ExecutePowerShell("wsl --list --verbose");
+    auto [version_code, version_output] = listing.Get();
     if (version_code == 0) {
         // Parse output format: NAME            STATE           VERSION
         // Default version should have a * mark
@@ -305,6 +312,13 @@ ComponentResult UbuntuInstaller::Install() {
     // specified Ubuntu distribution
     std::string install_cmd =
         "wsl --install -d " + context_->GetUbuntuVersion();
+    // Reinstall where move-distro put the distro last time
+    std::string location =
+        parallax::config::ConfigManager::GetInstance().GetConfigValue(
+            parallax::config::KEY_WSL_INSTALL_LOCATION);
+    if (!location.empty()) {
+        install_cmd += " --location '" + location + "'";
+    }
 
     // Use ExecCommandEx2 to execute command and pass callback function
     auto self = this;  // Capture this pointer
@@ -387,7 +401,8 @@ bool UbuntuInstaller::IsUbuntuInstalled() {
 
     // Use wsl --list --quiet to check if Ubuntu is in the distribution list
     auto [list_exit_code, list_output] =
-        executor_->ExecutePowerShell("wsl --list --quiet");
+        executor_->ExecutePowerShell("wsl --list --quiet", 300,
+                                     CommandKind::kProbe);
     bool ubuntu_installed =
         (list_exit_code == 0 &&
          list_output.find(context_->GetUbuntuVersion()) != std::string::npos);
@@ -405,7 +420,8 @@ bool UbuntuInstaller::CheckUbuntuInstalled() {
 
     // Use wsl --list --quiet to check if Ubuntu is in the distribution list
     auto [list_exit_code, list_output] =
-        executor_->ExecutePowerShell("wsl --list --quiet");
+        executor_->ExecutePowerShell("wsl --list --quiet", 300,
+                                     CommandKind::kProbe);
     return (list_exit_code == 0 &&
             list_output.find(context_->GetUbuntuVersion()) !=
                 std::string::npos);
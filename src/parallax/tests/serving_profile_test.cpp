@@ -0,0 +1,179 @@
+// Runs the serving profile bookkeeping against a fake ServingPlatform: the
+// VM process lookup, priority and power scheme changes, their restore by
+// the last owner and the recovery of state left by a crashed server.
+// Exits non-zero on the first failed check.
+
+#include "utils/serving_profile.h"
+#include <windows.h>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using parallax::utils::ServingPlatform;
+using parallax::utils::ServingProfileSettings;
+
+int g_failures = 0;
+
+#define CHECK(condition)                                                 \
+    do {                                                                 \
+        if (!(condition)) {                                              \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,  \
+                         __LINE__, #condition);                          \
+            ++g_failures;                                                \
+        }                                                                \
+    } while (0)
+
+const char* const kBalanced = "381b4222-f694-41f0-9685-ff5bb260df2e";
+const char* const kHigh = "8c5e7fda-e8bf-4a96-9a85-a6e23a8c635c";
+
+class FakeServingPlatform : public ServingPlatform {
+ public:
+    bool LockState() override { return true; }
+    void UnlockState() override {}
+    bool LoadState(std::string& text) override {
+        if (state.empty()) {
+            return false;
+        }
+        text = state;
+        return true;
+    }
+    bool SaveState(const std::string& text) override {
+        state = text;
+        return true;
+    }
+
+    uint32_t GetCurrentProcessId() override { return 100; }
+    bool IsProcessAlive(uint32_t pid) override {
+        return alive.count(pid) != 0;
+    }
+    std::vector<uint32_t> FindVmProcesses() override { return vm_pids; }
+    uint32_t GetPriorityClass(uint32_t pid) override {
+        auto it = priorities.find(pid);
+        return it == priorities.end() ? 0 : it->second;
+    }
+    bool SetPriorityClass(uint32_t pid, uint32_t priority_class) override {
+        priorities[pid] = priority_class;
+        return true;
+    }
+
+    std::string GetActivePowerScheme() override { return scheme; }
+    bool SetActivePowerScheme(const std::string& guid) override {
+        scheme = guid;
+        return true;
+    }
+
+    void PreventSleep(bool prevent) override { awake = prevent; }
+
+    std::string state;
+    std::set<uint32_t> alive;
+    std::vector<uint32_t> vm_pids;
+    std::map<uint32_t, uint32_t> priorities;
+    std::string scheme;
+    bool awake = false;
+};
+
+ServingProfileSettings PerformanceSettings() {
+    ServingProfileSettings settings;
+    settings.name = "performance";
+    settings.power_scheme = kHigh;
+    settings.vm_priority = ABOVE_NORMAL_PRIORITY_CLASS;
+    settings.process_priority = ABOVE_NORMAL_PRIORITY_CLASS;
+    settings.prevent_sleep = true;
+    return settings;
+}
+
+FakeServingPlatform MakePlatform() {
+    FakeServingPlatform platform;
+    platform.scheme = kBalanced;
+    platform.vm_pids = {7, 8};
+    platform.priorities[7] = NORMAL_PRIORITY_CLASS;
+    platform.priorities[8] = NORMAL_PRIORITY_CLASS;
+    return platform;
+}
+
+// The last of two owners restores what the first one recorded
+void TestSharedOwnersRestoreOnLastRelease() {
+    FakeServingPlatform platform = MakePlatform();
+    platform.alive = {100, 200};
+    bool first = false;
+
+    CHECK(parallax::utils::ApplyServingProfile(
+        platform, PerformanceSettings(), 100, "run", first));
+    CHECK(first);
+    CHECK(platform.scheme == kHigh);
+    CHECK(platform.priorities[7] == ABOVE_NORMAL_PRIORITY_CLASS);
+    CHECK(platform.priorities[8] == ABOVE_NORMAL_PRIORITY_CLASS);
+
+    CHECK(parallax::utils::ApplyServingProfile(
+        platform, PerformanceSettings(), 200, "join", first));
+    CHECK(first);
+    auto state = parallax::utils::ParseServingProfileState(platform.state);
+    CHECK(state.previous_scheme == kBalanced);
+    CHECK(state.vm_priorities.size() == 2);
+    CHECK(state.owners.size() == 2);
+
+    CHECK(parallax::utils::ReleaseServingProfile(platform, 100, "run"));
+    CHECK(platform.scheme == kHigh);
+    CHECK(platform.priorities[7] == ABOVE_NORMAL_PRIORITY_CLASS);
+
+    CHECK(parallax::utils::ReleaseServingProfile(platform, 200, "join"));
+    CHECK(platform.scheme == kBalanced);
+    CHECK(platform.priorities[7] == NORMAL_PRIORITY_CLASS);
+    CHECK(platform.priorities[8] == NORMAL_PRIORITY_CLASS);
+    CHECK(platform.state.empty());
+}
+
+// State of a server that died is restored before a new one records
+void TestCrashedOwnerIsRecovered() {
+    FakeServingPlatform platform = MakePlatform();
+    platform.alive = {100};
+    bool first = false;
+    CHECK(parallax::utils::ApplyServingProfile(
+        platform, PerformanceSettings(), 100, "run", first));
+
+    platform.alive = {300};
+    CHECK(parallax::utils::ApplyServingProfile(
+        platform, PerformanceSettings(), 300, "run", first));
+    auto state = parallax::utils::ParseServingProfileState(platform.state);
+    CHECK(state.owners.size() == 1);
+    CHECK(state.previous_scheme == kBalanced);
+    CHECK(state.vm_priorities.size() == 2);
+    CHECK(state.vm_priorities[0].second == NORMAL_PRIORITY_CLASS);
+}
+
+// The power scheme the user picks while serving is kept, and VM processes
+// that were restarted meanwhile are left alone
+void TestUserChangesAreKept() {
+    FakeServingPlatform platform = MakePlatform();
+    platform.alive = {100};
+    bool first = false;
+    CHECK(parallax::utils::ApplyServingProfile(
+        platform, PerformanceSettings(), 100, "run", first));
+
+    const char* const user_scheme = "e9a42b02-d5df-448d-aa00-03f14749eb61";
+    platform.scheme = user_scheme;
+    platform.vm_pids = {9};
+    platform.priorities[9] = HIGH_PRIORITY_CLASS;
+    CHECK(parallax::utils::ReleaseServingProfile(platform, 100, ""));
+    CHECK(platform.scheme == user_scheme);
+    CHECK(platform.priorities[9] == HIGH_PRIORITY_CLASS);
+    CHECK(platform.priorities[7] == ABOVE_NORMAL_PRIORITY_CLASS);
+}
+
+}  // namespace
+
+int main() {
+    TestSharedOwnersRestoreOnLastRelease();
+    TestCrashedOwnerIsRecovered();
+    TestUserChangesAreKept();
+    if (g_failures != 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("serving_profile_test passed\n");
+    return 0;
+}
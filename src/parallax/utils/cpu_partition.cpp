@@ -0,0 +1,245 @@
+#include "cpu_partition.h"
+#include "process.h"
+#include "utils.h"
+#include "../config/config_manager.h"
+#include "../tinylog/tinylog.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <tuple>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+// Fields of one "lscpu -p=CPU,CORE,SOCKET,NODE" line; empty fields are 0
+std::vector<int> ParseLscpuLine(const std::string& line) {
+    std::vector<int> fields;
+    std::istringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        fields.push_back(std::atoi(field.c_str()));
+    }
+    return fields;
+}
+
+// CPUs each running server may use, from Cpus_allowed_list of its status,
+// by server pid. Servers whose status cannot be read are left out
+std::map<int, std::vector<int>> ProbeServerCpus(
+    const std::string& ubuntu_version,
+    const std::vector<PrakasaServerInfo>& running) {
+    std::map<int, std::vector<int>> server_cpus;
+    std::string probe_cmd;
+    for (const auto& server : running) {
+        std::string pid = std::to_string(server.pid);
+        probe_cmd += "echo " + pid + " \\$(grep Cpus_allowed_list: /proc/" +
+                     pid + "/status 2>/dev/null | cut -f2); ";
+    }
+    if (probe_cmd.empty()) {
+        return server_cpus;
+    }
+
+    std::string stdout_output, stderr_output;
+    if (ExecCommandEx(BuildWSLCommand(ubuntu_version, probe_cmd), 30,
+                      stdout_output, stderr_output, false, true) != 0) {
+        warn_log("[CPU] Affinity probe failed: %s", stderr_output.c_str());
+        return server_cpus;
+    }
+    std::istringstream stream(stdout_output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(TrimNewlines(line));
+        int pid = 0;
+        std::string cpu_list;
+        if (fields >> pid >> cpu_list) {
+            server_cpus[pid] = ParseCpuList(cpu_list);
+        }
+    }
+    return server_cpus;
+}
+
+}  // namespace
+
+std::vector<CpuCore> ProbeCpuTopology(const std::string& ubuntu_version) {
+    std::string stdout_output, stderr_output;
+    int exit_code = ExecCommandEx(
+        BuildWSLCommand(ubuntu_version, "lscpu -p=CPU,CORE,SOCKET,NODE"), 30,
+        stdout_output, stderr_output, false, true);
+    std::vector<CpuCore> cores;
+    if (exit_code != 0) {
+        warn_log("[CPU] lscpu failed: %s", stderr_output.c_str());
+        return cores;
+    }
+
+    std::map<std::tuple<int, int, int>, CpuCore> by_core;
+    std::istringstream stream(stdout_output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        line = TrimNewlines(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<int> fields = ParseLscpuLine(line);
+        if (fields.size() < 3) {
+            continue;
+        }
+        int node = fields.size() > 3 ? fields[3] : 0;
+        CpuCore& core = by_core[std::make_tuple(node, fields[2], fields[1])];
+        core.node = node;
+        core.socket = fields[2];
+        core.core = fields[1];
+        core.cpus.push_back(fields[0]);
+    }
+    for (auto& entry : by_core) {
+        std::sort(entry.second.cpus.begin(), entry.second.cpus.end());
+        cores.push_back(entry.second);
+    }
+    return cores;
+}
+
+std::vector<CpuSlot> PlanCpuSlots(const std::vector<CpuCore>& cores,
+                                  int slot_count) {
+    std::vector<CpuSlot> slots(slot_count > 0 ? slot_count : 0);
+    if (cores.empty() || slots.empty()) {
+        return slots;
+    }
+    size_t core_count = cores.size();
+    for (size_t i = 0; i < slots.size(); ++i) {
+        // Contiguous runs of the node-ordered cores, so a slot only spans
+        // two nodes when the split falls inside one
+        size_t begin = i * core_count / slots.size();
+        size_t end = (i + 1) * core_count / slots.size();
+        if (begin == end) {
+            // Fewer cores than slots: share one
+            begin = i % core_count;
+            end = begin + 1;
+        }
+        for (size_t c = begin; c < end; ++c) {
+            slots[i].cpus.insert(slots[i].cpus.end(), cores[c].cpus.begin(),
+                                 cores[c].cpus.end());
+        }
+        std::sort(slots[i].cpus.begin(), slots[i].cpus.end());
+        slots[i].threads = static_cast<int>(end - begin);
+    }
+    return slots;
+}
+
+std::string FormatCpuList(const std::vector<int>& cpus) {
+    std::ostringstream out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        out << (i > 0 ? "," : "") << cpus[i];
+        if (j > i) {
+            out << "-" << cpus[j];
+        }
+        i = j + 1;
+    }
+    return out.str();
+}
+
+std::vector<int> ParseCpuList(const std::string& cpu_list) {
+    std::vector<int> cpus;
+    std::istringstream stream(cpu_list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos
+                       ? first
+                       : std::atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+std::string BuildCpuSlotCommand(const CpuSlot& slot,
+                                const std::string& prakasa_command) {
+    std::string threads = std::to_string(slot.threads);
+    // taskset and env exec in turn, so the pid recorded for the server
+    // still ends up being prakasa's
+    return "taskset -c " + FormatCpuList(slot.cpus) +
+           " env OMP_NUM_THREADS=" + threads + " MKL_NUM_THREADS=" + threads +
+           " RAYON_NUM_THREADS=" + threads + " " + prakasa_command;
+}
+
+std::string PartitionServerCpus(const std::string& ubuntu_version,
+                                const std::vector<PrakasaServerInfo>& running,
+                                const std::string& prakasa_command) {
+    std::string mode =
+        parallax::config::ConfigManager::GetInstance().GetConfigValue(
+            parallax::config::KEY_CPU_PARTITION);
+    std::transform(mode.begin(), mode.end(), mode.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (mode == "off") {
+        return prakasa_command;
+    }
+
+    // auto gives this server its share of the CPUs among the servers running
+    // now plus this one, so a server started alone keeps all of them; a
+    // fixed count pins every server, the first one included, round-robin
+    bool automatic = mode.empty() || mode == "auto";
+    int slot_count = static_cast<int>(running.size()) + 1;
+    if (automatic && slot_count < 2) {
+        return prakasa_command;
+    }
+    if (!automatic) {
+        slot_count = std::atoi(mode.c_str());
+        if (slot_count < 1) {
+            warn_log("[CPU] Invalid cpu_partition '%s', not partitioning",
+                     mode.c_str());
+            return prakasa_command;
+        }
+    }
+
+    std::vector<CpuCore> cores = ProbeCpuTopology(ubuntu_version);
+    if (cores.empty()) {
+        return prakasa_command;
+    }
+    std::vector<CpuSlot> slots = PlanCpuSlots(cores, slot_count);
+
+    // Take the first slot no pinned server runs on; when every slot is in
+    // use, the one the fewest pinned servers share. A server on all CPUs
+    // is not pinned to any slot, so it takes none
+    size_t cpu_count = 0;
+    for (const auto& core : cores) {
+        cpu_count += core.cpus.size();
+    }
+    std::vector<int> users(slots.size(), 0);
+    for (const auto& server : ProbeServerCpus(ubuntu_version, running)) {
+        const std::vector<int>& cpus = server.second;
+        if (cpus.empty() || cpus.size() >= cpu_count) {
+            continue;
+        }
+        for (size_t i = 0; i < slots.size(); ++i) {
+            bool overlaps = std::any_of(
+                slots[i].cpus.begin(), slots[i].cpus.end(), [&](int cpu) {
+                    return std::binary_search(cpus.begin(), cpus.end(), cpu);
+                });
+            if (overlaps) {
+                ++users[i];
+            }
+        }
+    }
+    const CpuSlot& slot =
+        slots[std::min_element(users.begin(), users.end()) - users.begin()];
+    info_log("[CPU] %zu physical cores in %d slot(s), this server gets CPUs "
+             "%s with %d threads",
+             cores.size(), slot_count, FormatCpuList(slot.cpus).c_str(),
+             slot.threads);
+    return BuildCpuSlotCommand(slot, prakasa_command);
+}
+
+}  // namespace utils
+}  // namespace parallax
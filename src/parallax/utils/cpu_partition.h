@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "prakasa_sessions.h"
+
+// CPU budgets for prakasa servers sharing one distro. Each co-located
+// server gets its own set of physical cores (with their SMT siblings) and
+// thread pools sized to them, instead of every server spawning one OMP,
+// MKL and tokenizer thread per logical CPU.
+
+namespace parallax {
+namespace utils {
+
+struct CpuCore {
+    int node = 0;
+    int socket = 0;
+    int core = 0;
+    std::vector<int> cpus;  // Logical CPUs of this core
+};
+
+struct CpuSlot {
+    std::vector<int> cpus;  // Logical CPUs, sorted
+    int threads = 0;        // Thread pool size, one per physical core
+};
+
+// Physical cores of the distro from lscpu, ordered by NUMA node, socket and
+// core. Empty when lscpu is missing or fails
+std::vector<CpuCore> ProbeCpuTopology(const std::string& ubuntu_version);
+
+// Split cores into slot_count slots of whole cores, keeping each slot on as
+// few NUMA nodes as possible. With fewer cores than slots, slots share
+// cores
+std::vector<CpuSlot> PlanCpuSlots(const std::vector<CpuCore>& cores,
+                                  int slot_count);
+
+// "0-3,8-11"
+std::string FormatCpuList(const std::vector<int>& cpus);
+// Inverse of FormatCpuList, sorted
+std::vector<int> ParseCpuList(const std::string& cpu_list);
+
+// Wrap prakasa_command so it runs pinned to slot with its thread pools
+// sized to it: taskset -c <cpus> env OMP_NUM_THREADS=... <command>
+std::string BuildCpuSlotCommand(const CpuSlot& slot,
+                                const std::string& prakasa_command);
+
+// Apply the cpu_partition setting to a server about to start next to the
+// running ones and return prakasa_command wrapped for the first slot none
+// of them is pinned to, or unchanged when there is nothing to partition.
+// Running servers are never
+// re-pinned: their thread pools were sized to the CPUs they started with,
+// and moving them onto fewer CPUs would oversubscribe those
+std::string PartitionServerCpus(const std::string& ubuntu_version,
+                                const std::vector<PrakasaServerInfo>& running,
+                                const std::string& prakasa_command);
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,176 @@
+#include "gpu_telemetry.h"
+#include "utils.h"
+#include "process.h"
+#include "../tinylog/tinylog.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+const char* const kDevicesMarker = "#gpu-devices";
+const char* const kAppsMarker = "#gpu-apps";
+const char* const kEndMarker = "#gpu-end";
+
+// nvmlClocksThrottleReasons bits
+const uint64_t kThrottleSwPowerCap = 0x4;
+const uint64_t kThrottleHwSlowdown = 0x8;
+const uint64_t kThrottleSwThermal = 0x20;
+const uint64_t kThrottleHwThermal = 0x40;
+const uint64_t kThrottleHwPowerBrake = 0x80;
+
+std::vector<std::string> SplitCsvLine(const std::string& line) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+        size_t start = field.find_first_not_of(" \t");
+        size_t end = field.find_last_not_of(" \t\r");
+        fields.push_back(start == std::string::npos
+                             ? std::string()
+                             : field.substr(start, end - start + 1));
+    }
+    return fields;
+}
+
+}  // namespace
+
+bool GpuDeviceSample::IsThermalThrottled() const {
+    return (throttle_reasons & (kThrottleSwThermal | kThrottleHwThermal)) != 0;
+}
+
+bool GpuDeviceSample::IsPowerThrottled() const {
+    return (throttle_reasons & (kThrottleSwPowerCap | kThrottleHwSlowdown |
+                                kThrottleHwPowerBrake)) != 0;
+}
+
+int GpuTelemetrySnapshot::TotalMemoryUsedMib() const {
+    int total = 0;
+    for (const auto& device : devices) {
+        total += device.memory_used_mib;
+    }
+    return total;
+}
+
+int GpuTelemetrySnapshot::TotalMemoryMib() const {
+    int total = 0;
+    for (const auto& device : devices) {
+        total += device.memory_total_mib;
+    }
+    return total;
+}
+
+int GpuTelemetrySnapshot::ProcessMemoryMib(int pid) const {
+    int total = 0;
+    for (const auto& process : processes) {
+        if (process.pid == pid) {
+            total += process.used_memory_mib;
+        }
+    }
+    return total;
+}
+
+std::string BuildGpuTelemetryProbe() {
+    // Quoted, an unquoted '#' would comment out the rest of the command
+    return std::string("echo '") + kDevicesMarker +
+           "'; nvidia-smi --query-gpu=index,name,memory.used,memory.total,"
+           "utilization.gpu,temperature.gpu,power.draw,clocks.sm,"
+           "clocks.max.sm,clocks_throttle_reasons.active "
+           "--format=csv,noheader,nounits 2>/dev/null; echo '" +
+           kAppsMarker +
+           "'; nvidia-smi --query-compute-apps=pid,used_memory "
+           "--format=csv,noheader,nounits 2>/dev/null; echo '" +
+           kEndMarker + "'";
+}
+
+GpuTelemetrySnapshot ParseGpuTelemetry(const std::string& output) {
+    GpuTelemetrySnapshot snapshot;
+    enum class Section { kNone, kDevices, kApps } section = Section::kNone;
+
+    std::istringstream stream(output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        line = TrimNewlines(line);
+        if (line == kDevicesMarker) {
+            section = Section::kDevices;
+            continue;
+        }
+        if (line == kAppsMarker) {
+            section = Section::kApps;
+            continue;
+        }
+        if (line == kEndMarker) {
+            section = Section::kNone;
+            continue;
+        }
+
+        std::vector<std::string> fields = SplitCsvLine(line);
+        if (section == Section::kDevices && fields.size() >= 8) {
+            GpuDeviceSample device;
+            device.index = std::atoi(fields[0].c_str());
+            device.name = fields[1];
+            device.memory_used_mib = std::atoi(fields[2].c_str());
+            device.memory_total_mib = std::atoi(fields[3].c_str());
+            device.utilization_percent = std::atoi(fields[4].c_str());
+            device.temperature_c = std::atoi(fields[5].c_str());
+            device.power_draw_w = std::atof(fields[6].c_str());
+            device.sm_clock_mhz = std::atoi(fields[7].c_str());
+            if (fields.size() >= 10) {
+                device.max_sm_clock_mhz = std::atoi(fields[8].c_str());
+                // e.g. 0x0000000000000020
+                device.throttle_reasons =
+                    std::strtoull(fields[9].c_str(), nullptr, 16);
+            }
+            snapshot.devices.push_back(device);
+        } else if (section == Section::kApps && fields.size() >= 2) {
+            GpuProcessSample process;
+            process.pid = std::atoi(fields[0].c_str());
+            process.used_memory_mib = std::atoi(fields[1].c_str());
+            if (process.pid > 0) {
+                snapshot.processes.push_back(process);
+            }
+        }
+    }
+
+    snapshot.available = !snapshot.devices.empty();
+    return snapshot;
+}
+
+GpuTelemetrySnapshot SampleGpuTelemetry(const std::string& ubuntu_version) {
+    std::string stdout_output, stderr_output;
+    int exit_code = ExecCommandEx(
+        BuildWSLCommand(ubuntu_version, BuildGpuTelemetryProbe()), 30,
+        stdout_output, stderr_output, false, true);
+    if (exit_code != 0) {
+        debug_log("GPU telemetry probe failed (code %d): %s", exit_code,
+                  stderr_output.c_str());
+        return GpuTelemetrySnapshot();
+    }
+    return ParseGpuTelemetry(stdout_output);
+}
+
+std::string DescribeThrottleReasons(uint64_t mask) {
+    static const struct {
+        uint64_t bit;
+        const char* name;
+    } kReasons[] = {
+        {kThrottleSwThermal, "SW thermal slowdown"},
+        {kThrottleHwThermal, "HW thermal slowdown"},
+        {kThrottleSwPowerCap, "SW power cap"},
+        {kThrottleHwSlowdown, "HW slowdown"},
+        {kThrottleHwPowerBrake, "HW power brake"},
+    };
+    std::string description;
+    for (const auto& reason : kReasons) {
+        if (mask & reason.bit) {
+            description += (description.empty() ? "" : ", ") +
+                           std::string(reason.name);
+        }
+    }
+    return description;
+}
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GPU telemetry sampled with nvidia-smi inside the WSL distro
+
+namespace parallax {
+namespace utils {
+
+// One GPU as reported by nvidia-smi; fields nvidia-smi reports as [N/A]
+// are left at zero
+struct GpuDeviceSample {
+    int index = 0;
+    std::string name;
+    int memory_used_mib = 0;
+    int memory_total_mib = 0;
+    int utilization_percent = 0;
+    int temperature_c = 0;
+    double power_draw_w = 0.0;
+    int sm_clock_mhz = 0;
+    int max_sm_clock_mhz = 0;
+    // nvidia-smi clocks_throttle_reasons.active bit mask, see
+    // DescribeThrottleReasons
+    uint64_t throttle_reasons = 0;
+
+    bool IsThermalThrottled() const;
+    // Software power cap, hardware slowdown or power brake
+    bool IsPowerThrottled() const;
+};
+
+// GPU memory held by one process (pid in the distro's namespace)
+struct GpuProcessSample {
+    int pid = 0;
+    int used_memory_mib = 0;
+};
+
+struct GpuTelemetrySnapshot {
+    bool available = false;  // nvidia-smi answered with at least one GPU
+    std::vector<GpuDeviceSample> devices;
+    // WSL drivers often leave this empty even while memory is in use
+    std::vector<GpuProcessSample> processes;
+
+    int TotalMemoryUsedMib() const;
+    int TotalMemoryMib() const;
+    // Memory attributed to pid, 0 if nvidia-smi did not list it
+    int ProcessMemoryMib(int pid) const;
+};
+
+// Shell snippet printing one sample between marker lines. It is meant to be
+// appended to other probes so one wsl.exe call collects everything
+std::string BuildGpuTelemetryProbe();
+
+// Extract the sample printed by BuildGpuTelemetryProbe from mixed output
+GpuTelemetrySnapshot ParseGpuTelemetry(const std::string& output);
+
+// Run the probe on its own
+GpuTelemetrySnapshot SampleGpuTelemetry(const std::string& ubuntu_version);
+
+// "SW thermal slowdown, SW power cap"; idle and application clock settings
+// are left out, "" when nothing slows the clocks down
+std::string DescribeThrottleReasons(uint64_t mask);
+
+}  // namespace utils
+}  // namespace parallax
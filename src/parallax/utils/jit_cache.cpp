@@ -0,0 +1,95 @@
+#include "jit_cache.h"
+#include "../config/config_manager.h"
+#include "../tinylog/tinylog.h"
+
+namespace parallax {
+namespace utils {
+
+const char* const kJitCacheDir = "/var/cache/prakasa/jit";
+
+namespace {
+
+// Largest value the CUDA driver accepts for its JIT cache
+const char* const kCudaCacheMaxBytes = "4294967296";
+const int kDefaultMaxGib = 20;
+const int kSeedTimeoutSeconds = 120;
+
+// Where an empty cache is seeded from: jit_cache_seed_url, or the
+// prakasa-jit folder of a WebDAV sccache_backend, the site's LAN cache
+std::string GetSeedUrl() {
+    auto& config = parallax::config::ConfigManager::GetInstance();
+    std::string url =
+        config.GetConfigValue(parallax::config::KEY_JIT_CACHE_SEED_URL);
+    if (url.empty()) {
+        std::string backend =
+            config.GetConfigValue(parallax::config::KEY_SCCACHE_BACKEND);
+        if (backend.rfind("http://", 0) == 0 ||
+            backend.rfind("https://", 0) == 0) {
+            url = backend + "/prakasa-jit";
+        }
+    }
+    while (!url.empty() && url.back() == '/') {
+        url.pop_back();
+    }
+    // Goes into the shell line unquoted
+    if (url.find_first_of(" '\"\\$`;&|<>") != std::string::npos) {
+        warn_log("[JIT] Ignoring jit_cache_seed_url with shell characters");
+        return "";
+    }
+    return url;
+}
+
+}  // namespace
+
+std::string BuildJitCacheSetupCommand() {
+    int max_gib =
+        parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+            parallax::config::KEY_JIT_CACHE_MAX_GIB, kDefaultMaxGib);
+    std::string root = kJitCacheDir;
+
+    // Key: distinct compute capabilities of the GPUs ("sm86-sm89", "cpu"
+    // without one) and the venv's torch wheel version
+    std::string command =
+        "{ g=\\$(nvidia-smi --query-gpu=compute_cap --format=csv,noheader "
+        "2>/dev/null | sort -u | tr -d . | sed 's/^/sm/' | paste -sd- -); "
+        "t=\\$(ls -d ./venv/lib/python3*/site-packages/torch-*.dist-info "
+        "2>/dev/null | head -n 1 | sed 's/.*torch-//; s/[.]dist-info//'); "
+        "k=\\${g:-cpu}-torch\\${t:-none}; d=" + root + "/\\$k; "
+        // A shared lock on the key, held by the server through the exec and
+        // by its children, keeps the background prune of another launch off
+        // the caches in use. The directories are created once it is held,
+        // in case a prune emptied the key just before
+        "mkdir -p \\$d && exec 8>> \\$d/.lock && flock -s 8; "
+        "mkdir -p \\$d/cuda \\$d/triton \\$d/inductor && touch \\$d; ";
+
+    std::string seed_url = GetSeedUrl();
+    if (!seed_url.empty()) {
+        // Once per key; a missing archive leaves the cache to fill locally
+        command += "[ -e \\$d/.seeded ] || { curl -fsS --noproxy '*' "
+                   "--max-time " + std::to_string(kSeedTimeoutSeconds) +
+                   " " + seed_url + "/\\$k.tar.gz 2>/dev/null | "
+                   "tar -xz -C \\$d 2>/dev/null; touch \\$d/.seeded; }; ";
+    }
+
+    if (max_gib > 0) {
+        // Oldest keys first, skipping keys a server holds (this launch's
+        // included). A key is emptied under its exclusive lock rather than
+        // removed, so the lock file a waiting launch opened stays the one
+        // later prunes check
+        command += "( cd " + root + " && for o in \\$(ls -tr); "
+                   "do [ \\$(du -sm . | cut -f1) -le " +
+                   std::to_string(max_gib * 1024) +
+                   " ] && break; flock -n -x \\$o/.lock find \\$o -mindepth 1 "
+                   "-maxdepth 1 -not -name .lock -exec rm -rf {} +; "
+                   "done ) > /dev/null 2>&1 & ";
+    }
+
+    return command +
+           "export CUDA_CACHE_PATH=\\$d/cuda CUDA_CACHE_MAXSIZE=" +
+           kCudaCacheMaxBytes +
+           " TRITON_CACHE_DIR=\\$d/triton "
+           "TORCHINDUCTOR_CACHE_DIR=\\$d/inductor; }";
+}
+
+}  // namespace utils
+}  // namespace parallax
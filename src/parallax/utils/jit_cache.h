@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+
+// Persistent caches for the code CUDA, Triton and torch.compile generate
+// at run time. They live on the distro's ext4 outside ~/prakasa, so they
+// survive reboots and venv rebuilds, and are keyed by GPU architecture and
+// torch version, so an update that keeps torch keeps its compiled kernels.
+
+namespace parallax {
+namespace utils {
+
+// Parent of the per-key cache directories inside the distro
+extern const char* const kJitCacheDir;
+
+// In-distro command for the server launch shell (after venv activation):
+// derive the key (e.g. "sm86-torch2.7.1+cu128"), create its directories,
+// take a shared lock on it for the server's lifetime, seed an empty one
+// from jit_cache_seed_url, prune the least recently used keys no server
+// holds beyond jit_cache_max_gib in the background, and export
+// CUDA_CACHE_PATH, CUDA_CACHE_MAXSIZE, TRITON_CACHE_DIR and
+// TORCHINDUCTOR_CACHE_DIR
+std::string BuildJitCacheSetupCommand();
+
+}  // namespace utils
+}  // namespace parallax
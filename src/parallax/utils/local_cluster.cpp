@@ -0,0 +1,455 @@
+#include "local_cluster.h"
+#include "prakasa_sessions.h"
+#include "process.h"
+#include "utils.h"
+#include "../tinylog/tinylog.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace parallax {
+namespace utils {
+
+const char* const kClusterStateDir = "/tmp/prakasa/cluster";
+const char* const kClusterSchedulerVariable = "PRAKASA_CLUSTER_SCHEDULER";
+
+namespace {
+
+// Log lines prakasa and uvicorn print once a node serves; a manifest can
+// name its own with ready = <extended regex>
+const char* const kDefaultReadyPattern = "\\<[Rr]eady\\>|Uvicorn running on";
+
+// libp2p peer id the scheduler prints, passed to join -s
+const char* const kPeerIdPattern = "12D3KooW[1-9A-HJ-NP-Za-km-z]+";
+
+std::string Trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool IsNodeName(const std::string& name) {
+    return !name.empty() && name.size() <= 24 &&
+           name.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+                                  "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") ==
+               std::string::npos;
+}
+
+// NAME=value with a value that needs no quoting in bash -c "..."
+bool IsEnvAssignment(const std::string& assignment) {
+    size_t equals = assignment.find('=');
+    if (equals == 0 || equals == std::string::npos ||
+        std::isdigit(static_cast<unsigned char>(assignment[0]))) {
+        return false;
+    }
+    std::string name = assignment.substr(0, equals);
+    std::string value = assignment.substr(equals + 1);
+    return name.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+                                  "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") ==
+               std::string::npos &&
+           value.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+                                   "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+                                   "_-.,:/=+@%") == std::string::npos;
+}
+
+std::string GetStatePath(unsigned long session, const char* extension) {
+    return std::string(kClusterStateDir) + "/" + std::to_string(session) +
+           extension;
+}
+
+// Bash array of single-quoted words; none of them holds a single quote
+std::string BuildArray(const std::string& name,
+                       const std::vector<std::string>& words) {
+    std::string array = name + "=(";
+    for (size_t i = 0; i < words.size(); ++i) {
+        array += (i > 0 ? " '" : "'") + words[i] + "'";
+    }
+    return array + ")\n";
+}
+
+}  // namespace
+
+bool ClusterManifest::Parse(const std::string& text,
+                            ClusterManifest& manifest, std::string& error) {
+    manifest = ClusterManifest();
+    std::string default_ready = kDefaultReadyPattern;
+    bool in_cluster = false;
+    std::istringstream stream(text);
+    std::string line;
+    int line_number = 0;
+    auto fail = [&](const std::string& message) {
+        error = "line " + std::to_string(line_number) + ": " + message;
+        return false;
+    };
+
+    while (std::getline(stream, line)) {
+        ++line_number;
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                return fail("expected [section]");
+            }
+            std::string section = line.substr(1, line.size() - 2);
+            in_cluster = section == "cluster";
+            if (in_cluster) {
+                continue;
+            }
+            ClusterNode node;
+            if (section == "scheduler") {
+                node.name = "scheduler";
+                node.scheduler = true;
+            } else if (section.compare(0, 7, "worker.") == 0) {
+                node.name = section.substr(7);
+            } else {
+                return fail("expected [cluster], [scheduler] or "
+                            "[worker.<name>]");
+            }
+            if (!IsNodeName(node.name)) {
+                return fail("node names use letters, digits and '_' only");
+            }
+            for (const auto& existing : manifest.nodes) {
+                if (existing.name == node.name) {
+                    return fail("node " + node.name + " is listed twice");
+                }
+            }
+            manifest.nodes.push_back(node);
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string::npos ||
+            (!in_cluster && manifest.nodes.empty())) {
+            return fail("expected key = value inside a section");
+        }
+        std::string key = Trim(line.substr(0, equals));
+        std::string value = Trim(line.substr(equals + 1));
+        if (key == "ready" &&
+            (value.empty() || value.find('\'') != std::string::npos)) {
+            return fail("ready needs a pattern without single quotes");
+        }
+
+        if (in_cluster) {
+            if (key == "ready_timeout") {
+                manifest.ready_timeout_seconds = std::atoi(value.c_str());
+                if (manifest.ready_timeout_seconds <= 0) {
+                    return fail("ready_timeout must be a number of seconds");
+                }
+            } else if (key == "ready") {
+                default_ready = value;
+            } else {
+                return fail("unknown key '" + key + "'");
+            }
+            continue;
+        }
+
+        ClusterNode& node = manifest.nodes.back();
+        if (key == "args") {
+            node.args = value;
+        } else if (key == "env") {
+            std::istringstream assignments(value);
+            std::string assignment;
+            while (assignments >> assignment) {
+                if (!IsEnvAssignment(assignment)) {
+                    return fail("env expects NAME=value, got '" + assignment +
+                                "'");
+                }
+                node.env.push_back(assignment);
+            }
+        } else if (key == "ready") {
+            node.ready = value;
+        } else {
+            return fail("unknown key '" + key + "'");
+        }
+    }
+
+    auto scheduler = std::find_if(
+        manifest.nodes.begin(), manifest.nodes.end(),
+        [](const ClusterNode& node) { return node.scheduler; });
+    if (scheduler == manifest.nodes.end()) {
+        error = "the manifest has no [scheduler] section";
+        return false;
+    }
+    std::rotate(manifest.nodes.begin(), scheduler, scheduler + 1);
+    for (auto& node : manifest.nodes) {
+        if (node.ready.empty()) {
+            node.ready = default_ready;
+        }
+    }
+    return true;
+}
+
+bool ClusterManifest::Load(const std::string& path, ClusterManifest& manifest,
+                           std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    if (!Parse(text.str(), manifest, error)) {
+        error = path + ", " + error;
+        return false;
+    }
+    return true;
+}
+
+std::string BuildClusterSupervisorScript(
+    unsigned long session, const std::vector<ClusterLaunchNode>& nodes,
+    int ready_timeout_seconds, int drain_timeout_seconds) {
+    std::vector<std::string> names, pid_files, logs, ready, prefixes;
+    size_t width = 0;
+    for (const auto& node : nodes) {
+        width = (std::max)(width, node.name.size());
+    }
+    bool wire_address = false;
+    for (const auto& node : nodes) {
+        names.push_back(node.name);
+        pid_files.push_back(node.pid_file);
+        logs.push_back(GetWSLLogFilePath(node.pid_file));
+        ready.push_back(node.ready);
+        prefixes.push_back("[" + node.name + "]" +
+                           std::string(width - node.name.size() + 1, ' '));
+        wire_address = wire_address ||
+                       (!node.scheduler &&
+                        node.launch_command.find(kClusterSchedulerVariable) !=
+                            std::string::npos);
+    }
+    // Leave the launcher's own SIGTERM/SIGKILL escalation the last word
+    int drain = (std::max)(drain_timeout_seconds - 2, 1);
+    std::string timeout = std::to_string(ready_timeout_seconds);
+
+    std::ostringstream script;
+    script << "#!/bin/bash\n"
+           << "# prakasa cluster supervisor of session " << session << "\n"
+           << "dir=" << kClusterStateDir << "\n"
+           << "state=$dir/" << session << "\n"
+           // Status of clusters whose supervisor is gone
+           << "for f in $dir/*.status; do s=${f%.status}; "
+              "kill -0 $(cat $s.pid 2>/dev/null) 2>/dev/null || "
+              "rm -f $s.status $s.sh; done\n"
+           << "echo $$ > $state.pid\n"
+           << BuildArray("names", names) << BuildArray("pidfiles", pid_files)
+           << BuildArray("logs", logs) << BuildArray("ready", ready)
+           << BuildArray("prefixes", prefixes)
+           << "pids=(); started=(); readyin=(); late=(); nready=0; failed=0\n"
+           << "now() { date +%s; }\n"
+           << "say() { echo \"[cluster] $*\"; }\n"
+           << "event() { echo \"$*\" >> $state.status; }\n"
+           << "t0=$(now)\n"
+           << ": > $state.status\n"
+           << "event up $t0\n"
+           << "for i in ${!names[@]}; do "
+              "event node ${names[$i]} ${pidfiles[$i]}; done\n"
+           // Every node leads its own process group (setsid)
+           << "signal_nodes() { for f in ${pidfiles[@]}; do "
+              "p=$(cat $f 2>/dev/null) && [ -n \"$p\" ] && "
+              "kill -$1 -- -$p 2>/dev/null; done; }\n"
+           << "any_alive() { for p in ${pids[@]}; do "
+              "kill -0 $p 2>/dev/null && return 0; done; return 1; }\n"
+           << "finish() { rm -f ${pidfiles[@]} $state.pid; exit $1; }\n"
+           << "stop() { trap '' INT TERM; say stopping the nodes; "
+              "signal_nodes INT; for i in $(seq 1 $1); do "
+              "any_alive || finish 130; sleep 1; done; "
+              "signal_nodes KILL; finish 130; }\n"
+           << "trap 'stop " << drain << "' INT\n"
+           << "trap 'stop 0' TERM\n";
+
+    // Node logs, prefixed; the readers ignore SIGINT so the drain stays
+    // visible, and end with the supervisor
+    script << "start_node() {\n"
+           << "  : > ${logs[$1]}\n"
+           << "  ( trap '' INT; tail -n +1 -F --pid=$$ ${logs[$1]} "
+              "2>/dev/null | sed -u \"s|^|${prefixes[$1]}|\" ) &\n"
+           << "  case $1 in\n";
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        script << "  " << i << ") setsid bash -c \"" << nodes[i].launch_command
+               << "\" < /dev/null >> ${logs[$1]} 2>&1 & ;;\n";
+    }
+    script << "  esac\n"
+           << "  pids[$1]=$!; started[$1]=$(now)\n"
+           << "  event start ${names[$1]} ${started[$1]}\n"
+           << "  say ${names[$1]} starting\n"
+           << "}\n";
+
+    script << "start_node 0\n";
+    if (wire_address) {
+        script << "say waiting for the scheduler address\n"
+               << "addr=\n"
+               << "while [ -z \"$addr\" ] && kill -0 ${pids[0]} 2>/dev/null "
+                  "&& [ $(( $(now) - t0 )) -lt " << timeout << " ]; do "
+                  "sleep 1; addr=$(grep -aoE -m 1 '" << kPeerIdPattern
+               << "' ${logs[0]} | head -n 1); done\n"
+               << "if [ -n \"$addr\" ]; then export "
+               << kClusterSchedulerVariable << "=$addr; event addr $addr; "
+                  "say scheduler address $addr; "
+                  "else say no scheduler address yet, workers rely on local "
+                  "discovery; fi\n";
+    }
+    script << "for i in ${!names[@]}; do [ $i -eq 0 ] || start_node $i; done\n";
+
+    // Readiness and exits, once a second
+    script << "while [ ${#pids[@]} -gt 0 ]; do\n"
+           << "  sleep 1; t=$(now)\n"
+           << "  for i in ${!pids[@]}; do\n"
+           << "    if ! kill -0 ${pids[$i]} 2>/dev/null; then\n"
+           << "      wait ${pids[$i]}; code=$?; unset 'pids[i]'\n"
+           << "      event exit ${names[$i]} $code\n"
+           << "      say ${names[$i]} exited with code $code\n"
+           << "      [ $code -eq 0 ] || failed=1\n"
+           << "    elif [ -z \"${readyin[$i]}\" ] && "
+              "grep -aqE -- \"${ready[$i]}\" ${logs[$i]}; then\n"
+           << "      readyin[$i]=$(( t - started[$i] )); "
+              "nready=$(( nready + 1 ))\n"
+           << "      event ready ${names[$i]} ${readyin[$i]}\n"
+           << "      say ${names[$i]} ready in ${readyin[$i]}s\n"
+           << "      [ $nready -lt ${#names[@]} ] || say all ${#names[@]} "
+              "nodes ready in $(( t - t0 ))s\n"
+           << "    elif [ -z \"${readyin[$i]}${late[$i]}\" ] && "
+              "[ $(( t - started[$i] )) -ge " << timeout << " ]; then\n"
+           << "      late[$i]=1; say ${names[$i]} not ready after "
+           << timeout << "s\n"
+           << "    fi\n"
+           << "  done\n"
+           << "done\n"
+           << "say all nodes exited\n"
+           << "finish $failed\n";
+    return script.str();
+}
+
+std::string InstallClusterSupervisorScript(const std::string& ubuntu_version,
+                                           unsigned long session,
+                                           const std::string& script) {
+    std::string path = GetStatePath(session, ".sh");
+    // Base64 keeps the script's quotes and '$' out of the command line
+    std::string stdout_output, stderr_output;
+    int exit_code = ExecCommandEx(
+        BuildWSLCommand(ubuntu_version,
+                        std::string("mkdir -p ") + kClusterStateDir +
+                            " && echo " + EncodeBase64(script) +
+                            " | base64 -d > " + path),
+        30, stdout_output, stderr_output, false, true);
+    if (exit_code != 0) {
+        error_log("[CLUSTER] Writing %s failed (code %d): %s", path.c_str(),
+                  exit_code, stderr_output.c_str());
+        return "";
+    }
+    return path;
+}
+
+std::string GetClusterSupervisorPidFile(unsigned long session) {
+    return GetStatePath(session, ".pid");
+}
+
+std::vector<ClusterStatus> ProbeClusters(const std::string& ubuntu_version) {
+    std::string dir = kClusterStateDir;
+    std::string probe_cmd =
+        "for f in " + dir + "/*.status; do [ -e \\$f ] || continue; "
+        "s=\\$(basename \\$f .status); a=0; kill -0 \\$(cat " + dir +
+        "/\\$s.pid 2>/dev/null) 2>/dev/null && a=1; "
+        "echo cluster \\$s \\$a \\$(date +%s); cat \\$f; done";
+
+    std::vector<ClusterStatus> clusters;
+    std::string stdout_output, stderr_output;
+    int exit_code =
+        ExecCommandEx(BuildWSLCommand(ubuntu_version, probe_cmd), 30,
+                      stdout_output, stderr_output, false, true);
+    if (exit_code != 0) {
+        warn_log("[CLUSTER] Cluster probe failed (code %d): %s", exit_code,
+                 stderr_output.c_str());
+        return clusters;
+    }
+
+    long now = 0;
+    std::istringstream stream(stdout_output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(TrimNewlines(line));
+        std::string kind, name;
+        fields >> kind;
+        if (kind == "cluster") {
+            ClusterStatus cluster;
+            int alive = 0;
+            fields >> cluster.session >> alive >> now;
+            cluster.running = alive != 0;
+            clusters.push_back(cluster);
+            continue;
+        }
+        if (clusters.empty()) {
+            continue;
+        }
+        ClusterStatus& cluster = clusters.back();
+        if (kind == "up") {
+            long up = 0;
+            fields >> up;
+            cluster.up_seconds = now > up ? now - up : 0;
+        } else if (kind == "addr") {
+            fields >> cluster.scheduler_address;
+        } else if (kind == "node") {
+            ClusterNodeStatus node;
+            fields >> node.name >> node.pid_file;
+            cluster.nodes.push_back(node);
+        } else if (fields >> name) {
+            for (auto& node : cluster.nodes) {
+                if (node.name != name) {
+                    continue;
+                }
+                if (kind == "start") {
+                    node.started = true;
+                } else if (kind == "ready") {
+                    fields >> node.ready_seconds;
+                } else if (kind == "exit") {
+                    node.exited = true;
+                    fields >> node.exit_code;
+                }
+            }
+        }
+    }
+    return clusters;
+}
+
+bool StopClusterSupervisors(const std::string& ubuntu_version,
+                            const std::vector<ClusterStatus>& clusters,
+                            int drain_timeout_seconds) {
+    std::string pid_files;
+    for (const auto& cluster : clusters) {
+        if (cluster.running) {
+            pid_files += " " + GetClusterSupervisorPidFile(cluster.session);
+        }
+    }
+    if (pid_files.empty()) {
+        return true;
+    }
+
+    // The supervisors drain their nodes themselves
+    std::string stop_cmd =
+        "p=\\$(cat" + pid_files + " 2>/dev/null | paste -sd, -); "
+        "[ \\${#p} -gt 0 ] || exit 0; kill -INT \\${p//,/ }; "
+        "for i in \\$(seq 1 " +
+        std::to_string((std::max)(drain_timeout_seconds, 1) + 5) +
+        "); do ps -p \\$p > /dev/null || exit 0; sleep 1; done; exit 1";
+
+    std::string stdout_output, stderr_output;
+    int exit_code = ExecCommandEx(BuildWSLCommand(ubuntu_version, stop_cmd),
+                                  drain_timeout_seconds + 30, stdout_output,
+                                  stderr_output, false, true);
+    if (exit_code != 0) {
+        warn_log("[CLUSTER] Supervisors did not stop (code %d): %s",
+                 exit_code, stderr_output.c_str());
+        return false;
+    }
+    info_log("[CLUSTER] Supervisors stopped:%s", pid_files.c_str());
+    return true;
+}
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// A whole prakasa topology (one scheduler and its workers) started on this
+// machine from a manifest. One in-distro supervisor script launches every
+// node detached with its own session pid file and log, hands the
+// scheduler's address to the workers, prints the node logs with a prefix
+// per node and reports when each node becomes ready.
+
+namespace parallax {
+namespace utils {
+
+// Holds the supervisor scripts, pid files and status files of the clusters
+extern const char* const kClusterStateDir;
+
+struct ClusterNode {
+    std::string name;        // "scheduler", "w1", ...
+    bool scheduler = false;  // prakasa run, otherwise prakasa join
+    std::string args;        // Passed to prakasa run/join
+    std::vector<std::string> env;  // NAME=value, set for this node only
+    std::string ready;       // Extended regex marking the node ready
+};
+
+/**
+ * @brief Layout of a local cluster
+ *
+ * INI-like text: an optional "[cluster]" section with ready_timeout and a
+ * default ready pattern, one "[scheduler]" section and one
+ * "[worker.<name>]" section per worker, each with args, env and ready
+ * keys. '#' starts a comment.
+ */
+struct ClusterManifest {
+    int ready_timeout_seconds = 900;
+    std::vector<ClusterNode> nodes;  // Scheduler first
+
+    static bool Parse(const std::string& text, ClusterManifest& manifest,
+                      std::string& error);
+    static bool Load(const std::string& path, ClusterManifest& manifest,
+                     std::string& error);
+};
+
+// One node as the supervisor starts it
+struct ClusterLaunchNode {
+    std::string name;
+    std::string pid_file;
+    std::string launch_command;  // In-distro command line for bash -c "..."
+    std::string ready;
+    bool scheduler = false;
+};
+
+// Environment variable holding the scheduler address once the supervisor
+// found it; worker commands pass it on with -s
+extern const char* const kClusterSchedulerVariable;
+
+// Supervisor script of session for nodes (scheduler first). Workers whose
+// command uses kClusterSchedulerVariable start once the scheduler printed
+// its address or ready_timeout_seconds elapsed. SIGINT drains every node
+// for up to drain_timeout_seconds, SIGTERM kills them
+std::string BuildClusterSupervisorScript(
+    unsigned long session, const std::vector<ClusterLaunchNode>& nodes,
+    int ready_timeout_seconds, int drain_timeout_seconds);
+
+// Write script to the supervisor script path of session in the distro and
+// return that path, "" on failure
+std::string InstallClusterSupervisorScript(const std::string& ubuntu_version,
+                                           unsigned long session,
+                                           const std::string& script);
+
+// Pid file of the supervisor script of session
+std::string GetClusterSupervisorPidFile(unsigned long session);
+
+struct ClusterNodeStatus {
+    std::string name;
+    std::string pid_file;
+    bool started = false;
+    long ready_seconds = -1;  // Time to ready, -1 while not ready
+    bool exited = false;
+    int exit_code = 0;
+};
+
+struct ClusterStatus {
+    unsigned long session = 0;  // Windows PID of the launching CLI
+    bool running = false;       // Supervisor still alive
+    long up_seconds = 0;
+    std::string scheduler_address;
+    std::vector<ClusterNodeStatus> nodes;
+};
+
+// Clusters launched in the distro, from their status files
+std::vector<ClusterStatus> ProbeClusters(const std::string& ubuntu_version);
+
+// Ask the running supervisors to drain their nodes and wait up to
+// drain_timeout_seconds (plus a margin) for them to finish
+bool StopClusterSupervisors(const std::string& ubuntu_version,
+                            const std::vector<ClusterStatus>& clusters,
+                            int drain_timeout_seconds);
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,410 @@
+#include "prakasa_sessions.h"
+#include "utils.h"
+#include "process.h"
+#include "jit_cache.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+const char* const kPidFilesMarker = "#pidfiles";
+const char* const kProcessesMarker = "#ps";
+
+struct PsEntry {
+    int pid = 0;
+    int pgid = 0;
+    long elapsed_seconds = 0;
+    std::string state;
+    std::string args;
+};
+
+bool IsServerCommandLine(const std::string& args) {
+    // Skip our own probes and attach helpers, they mention the pid directory
+    if (args.find("/tmp/prakasa/") != std::string::npos) {
+        return false;
+    }
+    return args.find("prakasa run") != std::string::npos ||
+           args.find("prakasa join") != std::string::npos ||
+           args.find("prakasa chat") != std::string::npos ||
+           args.find("prakasa/launch.py") != std::string::npos;
+}
+
+// "/tmp/prakasa/join-4312.pid" -> launcher "join", session 4312
+void ParsePidFileName(const std::string& pid_file, std::string& launcher,
+                      unsigned long& session) {
+    size_t slash = pid_file.find_last_of('/');
+    std::string name =
+        pid_file.substr(slash == std::string::npos ? 0 : slash + 1);
+    size_t dash = name.find_last_of('-');
+    size_t dot = name.find_last_of('.');
+    if (dash == std::string::npos || dot == std::string::npos || dot < dash) {
+        return;
+    }
+    launcher = name.substr(0, dash);
+    session = std::strtoul(name.substr(dash + 1, dot - dash - 1).c_str(),
+                           nullptr, 10);
+}
+
+// Creation time of a process in FILETIME units, 0 when it cannot be read
+unsigned long long GetProcessStartTime(HANDLE process) {
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if (!GetProcessTimes(process, &creation_time, &exit_time, &kernel_time,
+                         &user_time)) {
+        return 0;
+    }
+    return (static_cast<unsigned long long>(creation_time.dwHighDateTime)
+            << 32) |
+           creation_time.dwLowDateTime;
+}
+
+// A session is alive while the process that launched the server is still
+// running, whatever its image: the CLI, or a host embedding the C API. The
+// start time recorded in the owner file tells a reused Windows PID apart;
+// without one (servers started by an older CLI) a running PID is trusted
+bool IsSessionAlive(unsigned long session, unsigned long long start_time) {
+    if (session == 0) {
+        return false;
+    }
+
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE,
+                                 static_cast<DWORD>(session));
+    if (process == nullptr) {
+        return false;
+    }
+
+    bool alive = false;
+    DWORD exit_code = 0;
+    if (GetExitCodeProcess(process, &exit_code) && exit_code == STILL_ACTIVE) {
+        alive = start_time == 0 || GetProcessStartTime(process) == start_time;
+    }
+    CloseHandle(process);
+    return alive;
+}
+
+// Records this process as the owner of pid_file
+std::string BuildOwnerRecordCommand(const std::string& pid_file) {
+    return "echo " +
+           std::to_string(GetProcessStartTime(GetCurrentProcess())) + " > " +
+           GetWSLOwnerFilePath(pid_file);
+}
+
+std::string FormatDuration(long seconds) {
+    std::ostringstream out;
+    if (seconds >= 3600) {
+        out << seconds / 3600 << "h" << (seconds % 3600) / 60 << "m";
+    } else if (seconds >= 60) {
+        out << seconds / 60 << "m" << seconds % 60 << "s";
+    } else {
+        out << seconds << "s";
+    }
+    return out.str();
+}
+
+// Signal one server: its whole group when it leads one, otherwise the
+// process and its direct children
+std::string BuildSignalSnippet(const PrakasaServerInfo& server,
+                               const std::string& signal_name) {
+    std::string pid = std::to_string(server.pid);
+    if (server.pgid == server.pid) {
+        return "kill -" + signal_name + " -- -" + pid + " 2>/dev/null; ";
+    }
+    return "pkill -" + signal_name + " -P " + pid + " 2>/dev/null; kill -" +
+           signal_name + " " + pid + " 2>/dev/null; ";
+}
+
+}  // namespace
+
+bool PrakasaServerInfo::IsHealthy() const {
+    return !state.empty() && state[0] != 'Z' && state[0] != 'T';
+}
+
+std::string GetWSLLogFilePath(const std::string& pid_file) {
+    size_t dot = pid_file.find_last_of('.');
+    return (dot == std::string::npos ? pid_file : pid_file.substr(0, dot)) +
+           ".log";
+}
+
+std::string GetWSLOwnerFilePath(const std::string& pid_file) {
+    size_t dot = pid_file.find_last_of('.');
+    return (dot == std::string::npos ? pid_file : pid_file.substr(0, dot)) +
+           ".owner";
+}
+
+PrakasaSessionProbe ProbePrakasaSessions(const std::string& ubuntu_version) {
+    PrakasaSessionProbe probe;
+
+    // '$' is escaped so that the inner bash, not the login shell wsl.exe
+    // starts first, expands it
+    std::string probe_cmd =
+        std::string("echo '") + kPidFilesMarker +
+        "'; for f in /tmp/prakasa/*.pid; do [ -e \\$f ] || continue; "
+        "b=/tmp/prakasa/\\$(basename \\$f .pid); p=\\$(cat \\$f); "
+        "if kill -0 \\$p 2>/dev/null; then "
+        "echo \\$f \\$p \\$(cat \\$b.owner 2>/dev/null); "
+        "else rm -f \\$f \\$b.log \\$b.owner; fi; done; "
+        "for o in /tmp/prakasa/*.owner; do [ -e \\$o ] || continue; "
+        "[ -e \\${o%.owner}.pid ] || rm -f \\$o; done; "
+        "echo '" +
+        kProcessesMarker +
+        "'; ps -ww -eo pid=,pgid=,etimes=,stat=,args=; " +
+        BuildGpuTelemetryProbe();
+
+    std::string stdout_output, stderr_output;
+    int exit_code =
+        ExecCommandEx(BuildWSLCommand(ubuntu_version, probe_cmd), 30,
+                      stdout_output, stderr_output, false, true);
+    if (exit_code != 0) {
+        warn_log("Prakasa session probe failed (code %d): %s", exit_code,
+                 stderr_output.c_str());
+        return probe;
+    }
+
+    struct PidFileEntry {
+        std::string file;
+        unsigned long long owner_start_time = 0;  // 0 without an owner file
+    };
+    std::map<int, PidFileEntry> pid_files;  // pid -> pid file
+    std::map<int, PsEntry> processes;      // pid -> ps entry
+    bool in_pid_files = false;
+    bool in_processes = false;
+
+    std::istringstream stream(stdout_output);
+    std::string line;
+    while (std::getline(stream, line)) {
+        line = TrimNewlines(line);
+        if (line == kPidFilesMarker) {
+            in_pid_files = true;
+            in_processes = false;
+            continue;
+        }
+        if (line == kProcessesMarker) {
+            in_pid_files = false;
+            in_processes = true;
+            continue;
+        }
+        if (!line.empty() && line[0] == '#') {
+            // Start of the GPU telemetry section
+            in_pid_files = false;
+            in_processes = false;
+            continue;
+        }
+
+        std::istringstream fields(line);
+        if (in_pid_files) {
+            PidFileEntry entry;
+            int pid = 0;
+            if (fields >> entry.file >> pid && pid > 0) {
+                fields >> entry.owner_start_time;
+                pid_files[pid] = entry;
+            }
+        } else if (in_processes) {
+            PsEntry entry;
+            if (!(fields >> entry.pid >> entry.pgid >> entry.elapsed_seconds >>
+                  entry.state)) {
+                continue;
+            }
+            std::getline(fields >> std::ws, entry.args);
+            processes[entry.pid] = entry;
+        }
+    }
+
+    probe.gpu = ParseGpuTelemetry(stdout_output);
+
+    // Servers with a pid file first, then unmanaged ones (one per group)
+    std::map<int, size_t> server_by_pgid;
+    auto add_server = [&](const PsEntry& entry, const std::string& pid_file,
+                          unsigned long long owner_start_time) {
+        PrakasaServerInfo server;
+        server.pid = entry.pid;
+        server.pgid = entry.pgid;
+        server.elapsed_seconds = entry.elapsed_seconds;
+        server.state = entry.state;
+        server.command = entry.args;
+        server.pid_file = pid_file;
+        if (!pid_file.empty()) {
+            ParsePidFileName(pid_file, server.launcher, server.owner_session);
+            server.owner_alive =
+                IsSessionAlive(server.owner_session, owner_start_time);
+        }
+        server_by_pgid[entry.pgid] = probe.servers.size();
+        probe.servers.push_back(server);
+    };
+
+    for (const auto& pid_file : pid_files) {
+        auto it = processes.find(pid_file.first);
+        if (it != processes.end() && !server_by_pgid.count(it->second.pgid)) {
+            add_server(it->second, pid_file.second.file,
+                       pid_file.second.owner_start_time);
+        }
+    }
+    for (const auto& process : processes) {
+        if (IsServerCommandLine(process.second.args) &&
+            !server_by_pgid.count(process.second.pgid)) {
+            add_server(process.second, "", 0);
+        }
+    }
+
+    // Attribute GPU memory to the server owning the process group
+    for (const auto& gpu_process : probe.gpu.processes) {
+        auto it = processes.find(gpu_process.pid);
+        if (it == processes.end()) {
+            continue;
+        }
+        auto server = server_by_pgid.find(it->second.pgid);
+        if (server != server_by_pgid.end()) {
+            probe.servers[server->second].gpu_memory_mib +=
+                gpu_process.used_memory_mib;
+        }
+    }
+
+    probe.ok = true;
+    info_log("Prakasa session probe: %zu server(s), GPU memory %d/%d MiB",
+             probe.servers.size(), probe.gpu.TotalMemoryUsedMib(),
+             probe.gpu.TotalMemoryMib());
+    return probe;
+}
+
+bool ReclaimPrakasaServers(const std::string& ubuntu_version,
+                           const std::vector<PrakasaServerInfo>& servers,
+                           int drain_timeout_seconds) {
+    if (servers.empty()) {
+        return true;
+    }
+
+    std::string pid_list;
+    std::string cleanup;
+    for (const auto& server : servers) {
+        pid_list += (pid_list.empty() ? "" : ",") + std::to_string(server.pid);
+        if (!server.pid_file.empty()) {
+            cleanup += " " + server.pid_file + " " +
+                       GetWSLLogFilePath(server.pid_file) + " " +
+                       GetWSLOwnerFilePath(server.pid_file);
+        }
+    }
+
+    std::string reclaim_cmd;
+    for (const auto& server : servers) {
+        reclaim_cmd += BuildSignalSnippet(server, "INT");
+    }
+    reclaim_cmd += "for i in \\$(seq 1 " +
+                   std::to_string((std::max)(drain_timeout_seconds, 1)) +
+                   "); do ps -p " + pid_list +
+                   " >/dev/null || break; sleep 1; done; ";
+    for (const auto& server : servers) {
+        reclaim_cmd += BuildSignalSnippet(server, "KILL");
+    }
+    if (!cleanup.empty()) {
+        reclaim_cmd += "rm -f" + cleanup + "; ";
+    }
+    reclaim_cmd += "sleep 1; ! ps -p " + pid_list + " >/dev/null";
+
+    std::string stdout_output, stderr_output;
+    int exit_code = ExecCommandEx(BuildWSLCommand(ubuntu_version, reclaim_cmd),
+                                  drain_timeout_seconds + 30, stdout_output,
+                                  stderr_output, false, true);
+    if (exit_code != 0) {
+        warn_log("Reclaiming servers %s failed (code %d): %s",
+                 pid_list.c_str(), exit_code, stderr_output.c_str());
+        return false;
+    }
+    info_log("Reclaimed prakasa servers: %s", pid_list.c_str());
+    return true;
+}
+
+std::string BuildAttachCommand(const PrakasaServerInfo& server,
+                               const std::string& pid_file) {
+    std::string pid = std::to_string(server.pid);
+    std::string log_file = GetWSLLogFilePath(pid_file);
+    std::string attach_cmd = "mkdir -p /tmp/prakasa && echo " + pid + " > " +
+                             pid_file + " && " +
+                             BuildOwnerRecordCommand(pid_file) + " && ";
+    if (!server.pid_file.empty()) {
+        attach_cmd += "rm -f " + server.pid_file + " " +
+                      GetWSLOwnerFilePath(server.pid_file) + " && (mv " +
+                      GetWSLLogFilePath(server.pid_file) + " " + log_file +
+                      " 2>/dev/null; true) && ";
+    }
+    return attach_cmd + "tail -n 40 --pid=" + pid + " -F " + log_file +
+           " 2>/dev/null";
+}
+
+std::string DescribePrakasaServer(const PrakasaServerInfo& server) {
+    std::ostringstream out;
+    out << "pid " << server.pid << " ("
+        << (server.launcher.empty() ? "unmanaged" : server.launcher)
+        << ", up " << FormatDuration(server.elapsed_seconds);
+    if (server.gpu_memory_mib > 0) {
+        out << ", " << server.gpu_memory_mib << " MiB GPU";
+    }
+    if (!server.IsHealthy()) {
+        out << ", state " << server.state;
+    }
+    out << ")";
+    if (server.owner_alive) {
+        out << " owned by running session " << server.owner_session;
+    } else if (server.owner_session != 0) {
+        out << " left by session " << server.owner_session;
+    }
+    return out.str();
+}
+
+std::string BuildVenvActivationCommand() {
+    // Filter out Windows paths and add CUDA path
+    // Use single quotes and careful escaping for PowerShell/CMD compatibility
+    return "cd ~/prakasa && "
+           "export PATH=/usr/local/cuda-12.8/bin:$(echo '$PATH' | tr ':' '\\n' "
+           "| grep -v '/mnt/c' | paste -sd ':' -) && "
+           "source ./venv/bin/activate";
+}
+
+std::string BuildServerLaunchCommand(const std::string& prakasa_command,
+                                     const std::string& pid_file,
+                                     const std::string& proxy_url,
+                                     const std::string& hf_endpoint,
+                                     bool echo_output) {
+    std::string log_file = GetWSLLogFilePath(pid_file);
+    std::string full_command = "mkdir -p /tmp/prakasa && echo \\$\\$ > " +
+                               pid_file + " && " +
+                               BuildOwnerRecordCommand(pid_file) + " && " +
+                               BuildVenvActivationCommand();
+    // The tees share the server's process group; they ignore the INT/TERM a
+    // graceful stop sends to the group and exit once the server closes its
+    // output, so the drain is still logged and never hits a closed pipe
+    full_command +=
+        echo_output
+            ? " && exec > >(trap '' INT TERM; exec tee -p -a " + log_file +
+                  ") 2> >(trap '' INT TERM; exec tee -p -a " + log_file +
+                  " >&2)"
+            : " && exec >> " + log_file + " 2>&1";
+
+    // Guest kernel tuning profile, when the tuning component installed it
+    full_command +=
+        " && { [ ! -f /etc/prakasa/inference-tuning.sh ] || "
+        ". /etc/prakasa/inference-tuning.sh; }";
+
+    // Compiled kernels and graphs persist across restarts and updates
+    full_command += " && " + BuildJitCacheSetupCommand();
+
+    // If proxy is configured, add proxy environment variables
+    if (!proxy_url.empty()) {
+        full_command += " && export HTTP_PROXY='" + proxy_url +
+                        "' HTTPS_PROXY='" + proxy_url + "'";
+    }
+
+    // Model downloads go to the fastest Hugging Face endpoint
+    if (!hf_endpoint.empty()) {
+        full_command += " && export HF_ENDPOINT='" + hf_endpoint + "'";
+    }
+
+    return full_command + " && exec " + prakasa_command;
+}
+
+}  // namespace utils
+}  // namespace parallax
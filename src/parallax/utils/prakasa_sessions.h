@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "gpu_telemetry.h"
+
+// Discovery and cleanup of prakasa servers running inside the WSL distro.
+// Servers launched by this CLI or the C API record their PID in a session
+// pid file (see BuildWSLPidFilePath) named after the Windows PID of the
+// launching process, which is used as the session id. An owner file next
+// to it holds that process's start time, so a reused PID is not mistaken
+// for the owner.
+
+namespace parallax {
+namespace utils {
+
+struct PrakasaServerInfo {
+    int pid = 0;
+    int pgid = 0;
+    long elapsed_seconds = 0;
+    std::string state;     // ps STAT column
+    std::string command;   // Full command line
+    std::string pid_file;  // Empty for servers not started through a pid file
+    std::string launcher;  // run / join / chat, parsed from the pid file name
+    unsigned long owner_session = 0;  // Windows PID of the launching process
+    bool owner_alive = false;
+    int gpu_memory_mib = 0;  // Summed over the server's process group
+
+    // Not owned by a live CLI or C API session
+    bool IsStale() const { return !owner_alive; }
+    // Neither zombie nor stopped
+    bool IsHealthy() const;
+};
+
+struct PrakasaSessionProbe {
+    bool ok = false;
+    std::vector<PrakasaServerInfo> servers;
+    GpuTelemetrySnapshot gpu;
+};
+
+// Log file written next to a session pid file
+std::string GetWSLLogFilePath(const std::string& pid_file);
+// Owner record written next to a session pid file
+std::string GetWSLOwnerFilePath(const std::string& pid_file);
+
+// Enumerate prakasa servers, their sessions and GPU memory in a single
+// wsl.exe call. Pid files whose process is gone are removed on the way
+PrakasaSessionProbe ProbePrakasaSessions(const std::string& ubuntu_version);
+
+// SIGINT the given servers, wait up to drain_timeout_seconds and SIGKILL
+// whatever is left, all in one wsl.exe call. Their pid files are removed
+bool ReclaimPrakasaServers(const std::string& ubuntu_version,
+                           const std::vector<PrakasaServerInfo>& servers,
+                           int drain_timeout_seconds);
+
+// In-distro command that moves a server into the session owning pid_file
+// and follows its log until the server exits
+std::string BuildAttachCommand(const PrakasaServerInfo& server,
+                               const std::string& pid_file);
+
+// Changes into ~/prakasa and activates its venv, with the CUDA toolchain
+// first on PATH and the Windows paths removed
+std::string BuildVenvActivationCommand();
+
+// In-distro command line for a long-running prakasa subcommand. The shell
+// records its PID in pid_file and then execs into prakasa, so a stop can be
+// delivered as a real SIGINT. Output is appended to the session log so a
+// later session can attach to the server; with echo_output it also still
+// goes to the caller
+std::string BuildServerLaunchCommand(const std::string& prakasa_command,
+                                     const std::string& pid_file,
+                                     const std::string& proxy_url,
+                                     const std::string& hf_endpoint,
+                                     bool echo_output);
+
+// Human readable one-line summary, e.g. "pid 812 (join, up 1h05m, 9120 MiB)"
+std::string DescribePrakasaServer(const PrakasaServerInfo& server);
+
+}  // namespace utils
+}  // namespace parallax
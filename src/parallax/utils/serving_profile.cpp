@@ -0,0 +1,622 @@
+#include "serving_profile.h"
+#include "process.h"
+#include "utils.h"
+#include "../config/config_manager.h"
+#include "../tinylog/tinylog.h"
+#include <windows.h>
+#include <tlhelp32.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+const char* const kStateFileName = "serving_profile_state.txt";
+const char* const kStateMutexName = "Local\\prakasa-serving-profile";
+const DWORD kStateLockWaitMs = 10000;
+
+const char* const kHighPerformanceScheme =
+    "8c5e7fda-e8bf-4a96-9a85-a6e23a8c635c";
+const char* const kUltimatePerformanceScheme =
+    "e9a42b02-d5df-448d-aa00-03f14749eb61";
+const char* const kBalancedScheme = "381b4222-f694-41f0-9685-ff5bb260df2e";
+
+// This process's priority is shared by the sessions it runs, e.g. a run
+// and a join served from one GUI
+std::mutex g_process_mutex;
+int g_process_sessions = 0;
+uint32_t g_process_previous_priority = 0;
+
+std::string ToLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return value;
+}
+
+bool IsGuidAt(const std::string& text, size_t pos) {
+    if (pos + 36 > text.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < 36; ++i) {
+        char c = text[pos + i];
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            if (c != '-') {
+                return false;
+            }
+        } else if (!std::isxdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// First GUID in text, lower case, "" if none; powercfg output is localized
+// but the GUID is not
+std::string FindGuid(const std::string& text) {
+    for (size_t pos = 0; pos + 36 <= text.size(); ++pos) {
+        if (IsGuidAt(text, pos)) {
+            return ToLower(text.substr(pos, 36));
+        }
+    }
+    return "";
+}
+
+bool ParsePowerScheme(const std::string& value, std::string& guid) {
+    std::string lower = ToLower(value);
+    if (lower.empty() || lower == "keep") {
+        guid.clear();
+    } else if (lower == "high") {
+        guid = kHighPerformanceScheme;
+    } else if (lower == "ultimate") {
+        guid = kUltimatePerformanceScheme;
+    } else if (lower == "balanced") {
+        guid = kBalancedScheme;
+    } else if (lower.size() == 36 && IsGuidAt(lower, 0)) {
+        guid = lower;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool ParsePriority(const std::string& value, uint32_t& priority_class) {
+    std::string lower = ToLower(value);
+    if (lower.empty() || lower == "keep") {
+        priority_class = 0;
+    } else if (lower == "normal") {
+        priority_class = NORMAL_PRIORITY_CLASS;
+    } else if (lower == "above_normal") {
+        priority_class = ABOVE_NORMAL_PRIORITY_CLASS;
+    } else if (lower == "high") {
+        priority_class = HIGH_PRIORITY_CLASS;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string OwnerPrefix(uint32_t pid) { return std::to_string(pid) + ":"; }
+
+bool IsOwnedBy(const std::string& owner, uint32_t pid) {
+    return owner.compare(0, OwnerPrefix(pid).size(), OwnerPrefix(pid)) == 0;
+}
+
+// Put the recorded settings back. The power scheme is only restored while
+// the profile's scheme is still active, so a scheme the user picked while
+// serving is kept; VM priorities only for processes that still run the VM
+void RestoreState(ServingPlatform& platform,
+                  const ServingProfileState& state) {
+    if (!state.previous_scheme.empty()) {
+        std::string active = platform.GetActivePowerScheme();
+        if (active.empty() || active == state.applied_scheme) {
+            if (platform.SetActivePowerScheme(state.previous_scheme)) {
+                info_log("[PROFILE] Restored power scheme %s",
+                         state.previous_scheme.c_str());
+            } else {
+                warn_log("[PROFILE] Failed to restore power scheme %s",
+                         state.previous_scheme.c_str());
+            }
+        } else {
+            info_log("[PROFILE] Power scheme changed to %s while serving, "
+                     "keeping it",
+                     active.c_str());
+        }
+    }
+
+    std::vector<uint32_t> vm_pids = platform.FindVmProcesses();
+    for (const auto& entry : state.vm_priorities) {
+        if (std::find(vm_pids.begin(), vm_pids.end(), entry.first) ==
+            vm_pids.end()) {
+            continue;
+        }
+        if (!platform.SetPriorityClass(entry.first, entry.second)) {
+            warn_log("[PROFILE] Failed to restore priority of VM process %u",
+                     entry.first);
+        }
+    }
+}
+
+// Drop owners whose process is gone; true when live owners remain
+bool PruneOwners(ServingPlatform& platform, ServingProfileState& state) {
+    state.owners.erase(
+        std::remove_if(state.owners.begin(), state.owners.end(),
+                       [&](const std::string& owner) {
+                           uint32_t pid = static_cast<uint32_t>(
+                               std::strtoul(owner.c_str(), nullptr, 10));
+                           return !platform.IsProcessAlive(pid);
+                       }),
+        state.owners.end());
+    return !state.owners.empty();
+}
+
+class StateLock {
+ public:
+    explicit StateLock(ServingPlatform& platform)
+        : platform_(platform), locked_(platform.LockState()) {}
+    ~StateLock() {
+        if (locked_) {
+            platform_.UnlockState();
+        }
+    }
+    bool locked() const { return locked_; }
+
+ private:
+    ServingPlatform& platform_;
+    bool locked_;
+};
+
+class WindowsServingPlatform : public ServingPlatform {
+ public:
+    WindowsServingPlatform()
+        : state_path_(JoinPath(GetAppBinDir(), kStateFileName)),
+          mutex_(CreateMutexA(nullptr, FALSE, kStateMutexName)) {}
+    ~WindowsServingPlatform() override {
+        if (mutex_ != nullptr) {
+            CloseHandle(mutex_);
+        }
+    }
+
+    bool LockState() override {
+        if (mutex_ == nullptr) {
+            return false;
+        }
+        DWORD wait = WaitForSingleObject(mutex_, kStateLockWaitMs);
+        // An abandoned mutex still hands over ownership
+        return wait == WAIT_OBJECT_0 || wait == WAIT_ABANDONED;
+    }
+
+    void UnlockState() override { ReleaseMutex(mutex_); }
+
+    bool LoadState(std::string& text) override {
+        std::ifstream file(state_path_);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::ostringstream content;
+        content << file.rdbuf();
+        text = content.str();
+        return true;
+    }
+
+    bool SaveState(const std::string& text) override {
+        if (text.empty()) {
+            return DeleteFileA(state_path_.c_str()) ||
+                   GetLastError() == ERROR_FILE_NOT_FOUND;
+        }
+        std::ofstream file(state_path_, std::ios::trunc);
+        file << text;
+        return file.good();
+    }
+
+    uint32_t GetCurrentProcessId() override {
+        return ::GetCurrentProcessId();
+    }
+
+    bool IsProcessAlive(uint32_t pid) override {
+        HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+        if (process == nullptr) {
+            // Access denied means it exists
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        }
+        bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return alive;
+    }
+
+    std::vector<uint32_t> FindVmProcesses() override {
+        std::vector<uint32_t> pids;
+        HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+        if (snapshot == INVALID_HANDLE_VALUE) {
+            return pids;
+        }
+        // Wide explicitly, the build defines UNICODE
+        PROCESSENTRY32W entry;
+        entry.dwSize = sizeof(entry);
+        for (BOOL more = Process32FirstW(snapshot, &entry); more;
+             more = Process32NextW(snapshot, &entry)) {
+            std::string name = ToLower(UnicodeToUtf8(entry.szExeFile));
+            if (name == "vmmem" || name == "vmmemwsl" ||
+                name == "vmmem.exe" || name == "vmmemwsl.exe") {
+                pids.push_back(entry.th32ProcessID);
+            }
+        }
+        CloseHandle(snapshot);
+        return pids;
+    }
+
+    uint32_t GetPriorityClass(uint32_t pid) override {
+        HANDLE process =
+            OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (process == nullptr) {
+            return 0;
+        }
+        DWORD priority_class = ::GetPriorityClass(process);
+        CloseHandle(process);
+        return priority_class;
+    }
+
+    bool SetPriorityClass(uint32_t pid, uint32_t priority_class) override {
+        HANDLE process = OpenProcess(PROCESS_SET_INFORMATION, FALSE, pid);
+        if (process == nullptr) {
+            return false;
+        }
+        bool ok = ::SetPriorityClass(process, priority_class) != FALSE;
+        CloseHandle(process);
+        return ok;
+    }
+
+    std::string GetActivePowerScheme() override {
+        std::string stdout_output, stderr_output;
+        if (ExecCommandEx("powercfg /getactivescheme", 30, stdout_output,
+                          stderr_output) != 0) {
+            return "";
+        }
+        return FindGuid(stdout_output);
+    }
+
+    bool SetActivePowerScheme(const std::string& guid) override {
+        std::string stdout_output, stderr_output;
+        return ExecCommandEx("powercfg /setactive " + guid, 30,
+                             stdout_output, stderr_output) == 0;
+    }
+
+    void PreventSleep(bool prevent) override {
+        SetThreadExecutionState(prevent ? ES_CONTINUOUS | ES_SYSTEM_REQUIRED
+                                        : ES_CONTINUOUS);
+    }
+
+ private:
+    std::string state_path_;
+    HANDLE mutex_;
+};
+
+}  // namespace
+
+std::string FormatPriorityClass(uint32_t priority_class) {
+    switch (priority_class) {
+        case 0:
+            return "unchanged";
+        case IDLE_PRIORITY_CLASS:
+            return "idle";
+        case BELOW_NORMAL_PRIORITY_CLASS:
+            return "below_normal";
+        case NORMAL_PRIORITY_CLASS:
+            return "normal";
+        case ABOVE_NORMAL_PRIORITY_CLASS:
+            return "above_normal";
+        case HIGH_PRIORITY_CLASS:
+            return "high";
+        case REALTIME_PRIORITY_CLASS:
+            return "realtime";
+        default:
+            return std::to_string(priority_class);
+    }
+}
+
+bool LoadServingProfileSettings(ServingProfileSettings& settings,
+                                std::string& error) {
+    auto& config = parallax::config::ConfigManager::GetInstance();
+    settings = ServingProfileSettings();
+    settings.name = ToLower(config.GetConfigValue(
+        parallax::config::KEY_SERVING_PROFILE));
+    if (settings.name.empty()) {
+        settings.name = "performance";
+    }
+
+    // performance keeps the CPU clocks up and the VM ahead of desktop
+    // work; quiet only keeps the machine awake
+    if (settings.name == "performance") {
+        settings.power_scheme = kHighPerformanceScheme;
+        settings.vm_priority = ABOVE_NORMAL_PRIORITY_CLASS;
+        settings.process_priority = ABOVE_NORMAL_PRIORITY_CLASS;
+        settings.prevent_sleep = true;
+    } else if (settings.name == "quiet") {
+        settings.prevent_sleep = true;
+    } else if (settings.name == "off") {
+        return true;
+    } else {
+        error = "unknown serving_profile '" + settings.name +
+                "', expected performance, quiet or off";
+        return false;
+    }
+
+    std::string scheme =
+        config.GetConfigValue(parallax::config::KEY_SERVING_POWER_SCHEME);
+    if (!scheme.empty() && !ParsePowerScheme(scheme, settings.power_scheme)) {
+        error = "unknown serving_power_scheme '" + scheme +
+                "', expected high, ultimate, balanced, keep or a GUID";
+        return false;
+    }
+    std::string priority =
+        config.GetConfigValue(parallax::config::KEY_SERVING_PRIORITY);
+    if (!priority.empty()) {
+        uint32_t priority_class = 0;
+        if (!ParsePriority(priority, priority_class)) {
+            error = "unknown serving_priority '" + priority +
+                    "', expected normal, above_normal, high or keep";
+            return false;
+        }
+        settings.vm_priority = priority_class;
+        settings.process_priority = priority_class;
+    }
+    return true;
+}
+
+std::unique_ptr<ServingPlatform> CreateWindowsServingPlatform() {
+    return std::make_unique<WindowsServingPlatform>();
+}
+
+ServingProfileState ParseServingProfileState(const std::string& text) {
+    ServingProfileState state;
+    std::istringstream stream(text);
+    std::string line;
+    while (std::getline(stream, line)) {
+        line = TrimNewlines(line);
+        size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+        std::string key = line.substr(0, equals);
+        std::string value = line.substr(equals + 1);
+        if (key == "previous_scheme") {
+            state.previous_scheme = value;
+        } else if (key == "applied_scheme") {
+            state.applied_scheme = value;
+        } else if (key == "vm") {
+            size_t colon = value.find(':');
+            if (colon != std::string::npos) {
+                state.vm_priorities.emplace_back(
+                    static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr,
+                                                       10)),
+                    static_cast<uint32_t>(std::strtoul(
+                        value.c_str() + colon + 1, nullptr, 10)));
+            }
+        } else if (key == "owner") {
+            state.owners.push_back(value);
+        }
+    }
+    return state;
+}
+
+std::string FormatServingProfileState(const ServingProfileState& state) {
+    std::ostringstream text;
+    if (!state.previous_scheme.empty()) {
+        text << "previous_scheme=" << state.previous_scheme << "\n";
+        text << "applied_scheme=" << state.applied_scheme << "\n";
+    }
+    for (const auto& entry : state.vm_priorities) {
+        text << "vm=" << entry.first << ":" << entry.second << "\n";
+    }
+    for (const auto& owner : state.owners) {
+        text << "owner=" << owner << "\n";
+    }
+    return text.str();
+}
+
+bool ApplyServingProfile(ServingPlatform& platform,
+                         const ServingProfileSettings& settings, uint32_t pid,
+                         const std::string& tag, bool& first_for_pid) {
+    StateLock lock(platform);
+    if (!lock.locked()) {
+        warn_log("[PROFILE] Serving profile state is locked, not applying");
+        return false;
+    }
+
+    std::string text;
+    ServingProfileState state;
+    if (platform.LoadState(text)) {
+        state = ParseServingProfileState(text);
+    }
+    if (!PruneOwners(platform, state)) {
+        // Left by servers that exited without releasing
+        if (!text.empty()) {
+            info_log("[PROFILE] Restoring settings left by a previous "
+                     "server");
+            RestoreState(platform, state);
+        }
+        state = ServingProfileState();
+
+        // Record what the profile is about to change
+        if (!settings.power_scheme.empty()) {
+            std::string active = platform.GetActivePowerScheme();
+            if (!active.empty() && active != settings.power_scheme) {
+                state.previous_scheme = active;
+                state.applied_scheme = settings.power_scheme;
+            }
+        }
+        if (settings.vm_priority != 0) {
+            for (uint32_t vm_pid : platform.FindVmProcesses()) {
+                uint32_t priority_class = platform.GetPriorityClass(vm_pid);
+                if (priority_class != 0 &&
+                    priority_class != settings.vm_priority) {
+                    state.vm_priorities.emplace_back(vm_pid, priority_class);
+                }
+            }
+        }
+    }
+
+    first_for_pid = std::none_of(
+        state.owners.begin(), state.owners.end(),
+        [&](const std::string& owner) { return IsOwnedBy(owner, pid); });
+    state.owners.push_back(OwnerPrefix(pid) + tag);
+    // Saved before anything changes, so a crash from here on is recoverable
+    if (!platform.SaveState(FormatServingProfileState(state))) {
+        warn_log("[PROFILE] Failed to save serving profile state, not "
+                 "applying");
+        return false;
+    }
+
+    if (!state.previous_scheme.empty() &&
+        !platform.SetActivePowerScheme(settings.power_scheme)) {
+        warn_log("[PROFILE] Failed to activate power scheme %s",
+                 settings.power_scheme.c_str());
+    }
+    for (const auto& entry : state.vm_priorities) {
+        if (!platform.SetPriorityClass(entry.first, settings.vm_priority)) {
+            // The VM runs under another account when prakasa is not
+            // elevated
+            warn_log("[PROFILE] Failed to raise priority of VM process %u",
+                     entry.first);
+        }
+    }
+    info_log("[PROFILE] Serving profile %s applied for %u:%s",
+             settings.name.c_str(), pid, tag.c_str());
+    return true;
+}
+
+bool ReleaseServingProfile(ServingPlatform& platform, uint32_t pid,
+                           const std::string& tag) {
+    StateLock lock(platform);
+    if (!lock.locked()) {
+        warn_log("[PROFILE] Serving profile state is locked, not releasing");
+        return false;
+    }
+
+    std::string text;
+    if (!platform.LoadState(text)) {
+        return true;
+    }
+    ServingProfileState state = ParseServingProfileState(text);
+    std::string owner_key = OwnerPrefix(pid) + tag;
+    state.owners.erase(
+        std::remove_if(state.owners.begin(), state.owners.end(),
+                       [&](const std::string& owner) {
+                           return tag.empty() ? IsOwnedBy(owner, pid)
+                                              : owner == owner_key;
+                       }),
+        state.owners.end());
+    if (PruneOwners(platform, state)) {
+        return platform.SaveState(FormatServingProfileState(state));
+    }
+
+    RestoreState(platform, state);
+    info_log("[PROFILE] Serving profile released, settings restored");
+    return platform.SaveState("");
+}
+
+bool RestoreServingProfile(ServingPlatform& platform) {
+    StateLock lock(platform);
+    if (!lock.locked()) {
+        return false;
+    }
+    std::string text;
+    if (!platform.LoadState(text)) {
+        return true;
+    }
+    RestoreState(platform, ParseServingProfileState(text));
+    return platform.SaveState("");
+}
+
+bool StartServingProfileGuard(uint32_t pid) {
+    std::string exe_path = JoinPath(GetAppBinDir(), "prakasa.exe");
+    std::string command_line =
+        "\"" + exe_path + "\" serving-profile guard " + std::to_string(pid);
+    std::vector<char> buffer(command_line.begin(), command_line.end());
+    buffer.push_back('\0');
+
+    STARTUPINFOA si = {sizeof(STARTUPINFOA)};
+    PROCESS_INFORMATION pi = {0};
+    if (!CreateProcessA(exe_path.c_str(), buffer.data(), nullptr, nullptr,
+                        FALSE, DETACHED_PROCESS | CREATE_NEW_PROCESS_GROUP,
+                        nullptr, nullptr, &si, &pi)) {
+        warn_log("[PROFILE] Failed to start the serving profile guard: %lu",
+                 GetLastError());
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    return true;
+}
+
+int RunServingProfileGuard(uint32_t pid) {
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (process != nullptr) {
+        WaitForSingleObject(process, INFINITE);
+        CloseHandle(process);
+    }
+    // A server that exited cleanly has released already; then this finds
+    // no entry of pid and leaves the state alone
+    auto platform = CreateWindowsServingPlatform();
+    return ReleaseServingProfile(*platform, pid, "") ? 0 : 1;
+}
+
+ServingProfileSession::ServingProfileSession(const std::string& tag)
+    : tag_(tag) {
+    std::string error;
+    if (!LoadServingProfileSettings(settings_, error)) {
+        warn_log("[PROFILE] %s, serving without a profile", error.c_str());
+        return;
+    }
+    if (settings_.IsEmpty()) {
+        return;
+    }
+
+    platform_ = CreateWindowsServingPlatform();
+    uint32_t pid = platform_->GetCurrentProcessId();
+    bool first_for_pid = false;
+    applied_ =
+        ApplyServingProfile(*platform_, settings_, pid, tag_, first_for_pid);
+    if (applied_ && first_for_pid) {
+        StartServingProfileGuard(pid);
+    }
+
+    // Process-scoped settings end with the process, so they need no state
+    if (settings_.process_priority != 0) {
+        std::lock_guard<std::mutex> lock(g_process_mutex);
+        if (g_process_sessions++ == 0) {
+            g_process_previous_priority = platform_->GetPriorityClass(pid);
+        }
+        platform_->SetPriorityClass(pid, settings_.process_priority);
+    }
+    if (settings_.prevent_sleep) {
+        platform_->PreventSleep(true);
+    }
+}
+
+ServingProfileSession::~ServingProfileSession() {
+    if (!platform_) {
+        return;
+    }
+    uint32_t pid = platform_->GetCurrentProcessId();
+    if (settings_.prevent_sleep) {
+        platform_->PreventSleep(false);
+    }
+    if (settings_.process_priority != 0) {
+        std::lock_guard<std::mutex> lock(g_process_mutex);
+        if (--g_process_sessions == 0 && g_process_previous_priority != 0) {
+            platform_->SetPriorityClass(pid, g_process_previous_priority);
+        }
+    }
+    if (applied_) {
+        ReleaseServingProfile(*platform_, pid, tag_);
+    }
+}
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Power and scheduling profile applied while run/join serve a model: a
+// power scheme, the priority class of the WSL VM and of this process, and
+// sleep prevention. System-wide settings are recorded in a state file
+// before they change, so the last server to exit restores them, and a
+// guard process or the next server restores them after a crash.
+
+namespace parallax {
+namespace utils {
+
+// What a serving profile changes; empty or 0 fields are left alone
+struct ServingProfileSettings {
+    std::string name;              // "performance", "quiet" or "off"
+    std::string power_scheme;      // Power scheme GUID
+    uint32_t vm_priority = 0;       // Priority class of the WSL VM process
+    uint32_t process_priority = 0;  // Priority class of this process
+    bool prevent_sleep = false;
+
+    bool IsEmpty() const {
+        return power_scheme.empty() && vm_priority == 0 &&
+               process_priority == 0 && !prevent_sleep;
+    }
+};
+
+// "above_normal" for ABOVE_NORMAL_PRIORITY_CLASS, "unchanged" for 0
+std::string FormatPriorityClass(uint32_t priority_class);
+
+// Settings of the serving_profile config key, with serving_power_scheme and
+// serving_priority overriding the profile's defaults. False and error set
+// on an unknown value
+bool LoadServingProfileSettings(ServingProfileSettings& settings,
+                                std::string& error);
+
+// System calls of the serving profile, so the bookkeeping below runs
+// against a fake in tests
+class ServingPlatform {
+ public:
+    virtual ~ServingPlatform() = default;
+
+    // Serialize state changes across prakasa processes
+    virtual bool LockState() = 0;
+    virtual void UnlockState() = 0;
+    // False when there is no state; saving empty text removes it
+    virtual bool LoadState(std::string& text) = 0;
+    virtual bool SaveState(const std::string& text) = 0;
+
+    virtual uint32_t GetCurrentProcessId() = 0;
+    virtual bool IsProcessAlive(uint32_t pid) = 0;
+    // Processes that run the WSL VM (vmmem, vmmemWSL)
+    virtual std::vector<uint32_t> FindVmProcesses() = 0;
+    // 0 when the process cannot be queried
+    virtual uint32_t GetPriorityClass(uint32_t pid) = 0;
+    virtual bool SetPriorityClass(uint32_t pid, uint32_t priority_class) = 0;
+
+    // Empty when the active scheme cannot be read
+    virtual std::string GetActivePowerScheme() = 0;
+    virtual bool SetActivePowerScheme(const std::string& guid) = 0;
+
+    // Keep the system awake while the calling thread runs
+    virtual void PreventSleep(bool prevent) = 0;
+};
+
+std::unique_ptr<ServingPlatform> CreateWindowsServingPlatform();
+
+// Saved state, for prakasa serving-profile status
+struct ServingProfileState {
+    std::string previous_scheme;  // Active before the profile, "" if kept
+    std::string applied_scheme;   // Set by the profile
+    // pid:priority of the VM processes before the profile
+    std::vector<std::pair<uint32_t, uint32_t>> vm_priorities;
+    // "pid:tag" of the servers that hold the profile
+    std::vector<std::string> owners;
+};
+
+ServingProfileState ParseServingProfileState(const std::string& text);
+std::string FormatServingProfileState(const ServingProfileState& state);
+
+// Record the current settings unless a live owner already did, apply
+// settings and add owner pid:tag. State left by owners that are gone is
+// restored first. first_for_pid is set when pid held no entry before
+bool ApplyServingProfile(ServingPlatform& platform,
+                         const ServingProfileSettings& settings, uint32_t pid,
+                         const std::string& tag, bool& first_for_pid);
+
+// Remove owner pid:tag, or every entry of pid when tag is empty, and
+// restore the recorded settings when no live owner is left
+bool ReleaseServingProfile(ServingPlatform& platform, uint32_t pid,
+                           const std::string& tag);
+
+// Restore the recorded settings regardless of owners
+bool RestoreServingProfile(ServingPlatform& platform);
+
+// Start "prakasa.exe serving-profile guard <pid>" detached, which releases
+// pid's entries once pid exits, however it exits
+bool StartServingProfileGuard(uint32_t pid);
+
+// Wait for pid to exit, then release its entries
+int RunServingProfileGuard(uint32_t pid);
+
+// Applies the configured profile for the lifetime of a served model, on the
+// thread that serves it (sleep prevention is per thread)
+class ServingProfileSession {
+ public:
+    explicit ServingProfileSession(const std::string& tag);
+    ~ServingProfileSession();
+
+    ServingProfileSession(const ServingProfileSession&) = delete;
+    ServingProfileSession& operator=(const ServingProfileSession&) = delete;
+
+ private:
+    std::unique_ptr<ServingPlatform> platform_;
+    ServingProfileSettings settings_;
+    std::string tag_;
+    bool applied_ = false;
+};
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,893 @@
+#include "session_broker.h"
+#include "utils.h"
+#include "../config/config_manager.h"
+#include "../tinylog/tinylog.h"
+#include <windows.h>
+#include <sddl.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+const uint32_t kProtocolMagic = 0x424b5250;  // "PRKB"
+const uint32_t kProtocolVersion = 1;
+// Longer commands are install steps, where a warm shell saves nothing
+const int kMaxBrokeredTimeoutSeconds = 300;
+// Clients served at once; further clients run their commands themselves
+const int kPipeInstances = 8;
+const size_t kMaxIdleSessionsPerShell = 4;
+const int kSessionStartSeconds = 30;
+const DWORD kConnectWaitMs = 200;
+const uint32_t kMaxMessageBytes = 64 * 1024 * 1024;
+
+enum class RequestType : uint32_t { kExecute = 1, kStatus = 2, kStop = 3 };
+enum class ResponseStatus : uint32_t { kOk = 0, kUnavailable = 1 };
+
+// Run once by a new PowerShell host: UTF-8 output without BOM, UTF-8 from
+// wsl.exe instead of UTF-16, no progress bars on the redirected output
+const char* const kPowerShellSetup =
+    "[Console]::OutputEncoding = New-Object System.Text.UTF8Encoding $false; "
+    "$env:WSL_UTF8 = '1'; $ProgressPreference = 'SilentlyContinue'\n";
+
+void PutU32(std::string& buffer, uint32_t value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void PutString(std::string& buffer, const std::string& value) {
+    PutU32(buffer, static_cast<uint32_t>(value.size()));
+    buffer += value;
+}
+
+bool WriteAll(HANDLE handle, const std::string& buffer) {
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        DWORD written = 0;
+        if (!WriteFile(handle, buffer.data() + offset,
+                       static_cast<DWORD>(buffer.size() - offset), &written,
+                       nullptr) ||
+            written == 0) {
+            return false;
+        }
+        offset += written;
+    }
+    return true;
+}
+
+bool ReadAll(HANDLE handle, void* data, size_t size) {
+    char* out = static_cast<char*>(data);
+    size_t offset = 0;
+    while (offset < size) {
+        DWORD read = 0;
+        if (!ReadFile(handle, out + offset, static_cast<DWORD>(size - offset),
+                      &read, nullptr) ||
+            read == 0) {
+            return false;
+        }
+        offset += read;
+    }
+    return true;
+}
+
+bool ReadU32(HANDLE handle, uint32_t& value) {
+    return ReadAll(handle, &value, sizeof(value));
+}
+
+bool ReadString(HANDLE handle, std::string& value) {
+    uint32_t size = 0;
+    if (!ReadU32(handle, size) || size > kMaxMessageBytes) {
+        return false;
+    }
+    value.resize(size);
+    return size == 0 || ReadAll(handle, &value[0], size);
+}
+
+std::string BuildResponse(ResponseStatus status, int exit_code,
+                          const std::string& stdout_output,
+                          const std::string& stderr_output) {
+    std::string response;
+    PutU32(response, static_cast<uint32_t>(status));
+    PutU32(response, static_cast<uint32_t>(exit_code));
+    PutString(response, stdout_output);
+    PutString(response, stderr_output);
+    return response;
+}
+
+std::string GetBrokerExePath() {
+    return JoinPath(GetAppBinDir(), "prakasa.exe");
+}
+
+// TokenElevation of process, false if its token cannot be opened
+bool GetProcessElevation(HANDLE process, bool& elevated) {
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(process, TOKEN_QUERY, &token)) {
+        return false;
+    }
+    TOKEN_ELEVATION elevation = {0};
+    DWORD size = 0;
+    bool ok = GetTokenInformation(token, TokenElevation, &elevation,
+                                  sizeof(elevation), &size) != FALSE;
+    CloseHandle(token);
+    elevated = elevation.TokenIsElevated != 0;
+    return ok;
+}
+
+// Pipe DACL granting only this user. An elevated broker also labels the
+// pipe high integrity, so the user's non-elevated processes cannot send
+// it commands. Free with LocalFree
+PSECURITY_DESCRIPTOR BuildPipeSecurityDescriptor() {
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) {
+        return nullptr;
+    }
+    DWORD size = 0;
+    GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+    std::vector<char> buffer(size);
+    char* user_sid = nullptr;
+    bool ok = size > 0 &&
+              GetTokenInformation(token, TokenUser, buffer.data(), size,
+                                  &size) &&
+              ConvertSidToStringSidA(
+                  reinterpret_cast<TOKEN_USER*>(buffer.data())->User.Sid,
+                  &user_sid);
+    CloseHandle(token);
+    if (!ok) {
+        return nullptr;
+    }
+
+    std::string sddl = "D:P(A;;GA;;;" + std::string(user_sid) + ")";
+    LocalFree(user_sid);
+    bool elevated = false;
+    if (GetProcessElevation(GetCurrentProcess(), elevated) && elevated) {
+        sddl += "S:(ML;;NWNR;;;HI)";
+    }
+    PSECURITY_DESCRIPTOR descriptor = nullptr;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorA(
+            sddl.c_str(), SDDL_REVISION_1, &descriptor, nullptr)) {
+        return nullptr;
+    }
+    return descriptor;
+}
+
+// The process serving pipe must be this installation's prakasa.exe with
+// the same elevation as this process; anything else holding the pipe name
+// could forge exit codes and output
+bool IsTrustedBroker(HANDLE pipe) {
+    ULONG server_pid = 0;
+    if (!GetNamedPipeServerProcessId(pipe, &server_pid)) {
+        return false;
+    }
+    HANDLE process =
+        OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, server_pid);
+    if (process == nullptr) {
+        warn_log("[BROKER] Cannot inspect the broker process %lu: %lu",
+                 server_pid, GetLastError());
+        return false;
+    }
+    char image[MAX_PATH * 2] = {0};
+    DWORD image_size = sizeof(image);
+    bool server_elevated = false, client_elevated = false;
+    bool trusted =
+        QueryFullProcessImageNameA(process, 0, image, &image_size) &&
+        _stricmp(image, GetBrokerExePath().c_str()) == 0 &&
+        GetProcessElevation(process, server_elevated) &&
+        GetProcessElevation(GetCurrentProcess(), client_elevated) &&
+        server_elevated == client_elevated;
+    CloseHandle(process);
+    if (!trusted) {
+        warn_log("[BROKER] Ignoring %s served by pid %lu (%s)",
+                 GetSessionBrokerPipeName().c_str(), server_pid, image);
+    }
+    return trusted;
+}
+
+// Poll tightly while a probe is likely to finish, then back off
+void PollWait(uint64_t started_ms) {
+    Sleep(GetTickCountMs() - started_ms < 200 ? 1 : 10);
+}
+
+/**
+ * @brief A long-lived bash (in the distro) or PowerShell process
+ *
+ * Commands are written to the shell's stdin one at a time. Each is
+ * followed by a marker line on stdout carrying the exit code and one on
+ * stderr, which delimit the command's output.
+ */
+class WarmSession {
+ public:
+    explicit WarmSession(BrokerShell shell) : shell_(shell) {}
+    ~WarmSession() { Close(); }
+
+    bool Start(const std::string& ubuntu_version);
+    bool IsAlive() const {
+        return process_ != nullptr &&
+               WaitForSingleObject(process_, 0) == WAIT_TIMEOUT;
+    }
+    // Exit code of the command, -2 on timeout, -3 when abandoned returned
+    // true. The session is closed unless the command completed normally
+    int Run(const std::string& command, int timeout_seconds,
+            const std::function<bool()>& abandoned, std::string& stdout_output,
+            std::string& stderr_output);
+    void Close();
+
+ private:
+    std::string BuildScript(const std::string& command,
+                            const std::string& marker) const;
+    static bool Drain(HANDLE pipe, std::string& buffer);
+
+    BrokerShell shell_;
+    HANDLE process_ = nullptr;
+    HANDLE stdin_write_ = nullptr;
+    HANDLE stdout_read_ = nullptr;
+    HANDLE stderr_read_ = nullptr;
+    unsigned counter_ = 0;
+};
+
+bool WarmSession::Start(const std::string& ubuntu_version) {
+    SECURITY_ATTRIBUTES sa = {sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HANDLE stdin_read = nullptr, stdout_write = nullptr, stderr_write = nullptr;
+    if (!CreatePipe(&stdin_read, &stdin_write_, &sa, 0) ||
+        !CreatePipe(&stdout_read_, &stdout_write, &sa, 0) ||
+        !CreatePipe(&stderr_read_, &stderr_write, &sa, 0)) {
+        if (stdin_read) CloseHandle(stdin_read);
+        if (stdout_write) CloseHandle(stdout_write);
+        Close();
+        return false;
+    }
+    SetHandleInformation(stdin_write_, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(stdout_read_, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(stderr_read_, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA si = {sizeof(STARTUPINFOA)};
+    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;
+    si.hStdInput = stdin_read;
+    si.hStdOutput = stdout_write;
+    si.hStdError = stderr_write;
+    PROCESS_INFORMATION pi = {0};
+
+    // Same user and shell as BuildWSLCommand, minus the start per command
+    std::string command_line =
+        shell_ == BrokerShell::kWSL
+            ? BuildWSLDirectCommand(ubuntu_version, "bash --noprofile --norc")
+            : "powershell.exe -NoLogo -NoProfile -NonInteractive -Command -";
+    std::vector<char> buffer(command_line.begin(), command_line.end());
+    buffer.push_back('\0');
+    BOOL created = CreateProcessA(nullptr, buffer.data(), nullptr, nullptr,
+                                  TRUE, CREATE_NO_WINDOW, nullptr, nullptr,
+                                  &si, &pi);
+    CloseHandle(stdin_read);
+    CloseHandle(stdout_write);
+    CloseHandle(stderr_write);
+    if (!created) {
+        warn_log("[BROKER] Failed to start '%s': %lu", command_line.c_str(),
+                 GetLastError());
+        Close();
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    process_ = pi.hProcess;
+
+    if (shell_ == BrokerShell::kPowerShell) {
+        std::string setup = kPowerShellSetup;
+        DWORD written = 0;
+        WriteFile(stdin_write_, setup.data(), static_cast<DWORD>(setup.size()),
+                  &written, nullptr);
+    }
+
+    // The first round trip proves the shell (and for WSL, the distro) is up
+    std::string stdout_output, stderr_output;
+    int exit_code =
+        Run(shell_ == BrokerShell::kWSL ? "true" : "$null", kSessionStartSeconds,
+            nullptr, stdout_output, stderr_output);
+    if (exit_code != 0) {
+        warn_log("[BROKER] '%s' did not come up (code %d): %s",
+                 command_line.c_str(), exit_code, stderr_output.c_str());
+        Close();
+        return false;
+    }
+    return true;
+}
+
+std::string WarmSession::BuildScript(const std::string& command,
+                                     const std::string& marker) const {
+    if (shell_ == BrokerShell::kWSL) {
+        // bash -c "..." gets the command through the same double-quote
+        // expansion as wsl.exe's login shell gives it, so '\$' escapes in
+        // commands keep working. Each command runs in a fresh bash
+        return "bash -c \"" + command + "\" </dev/null; printf '\\n%s %d\\n' " +
+               marker + " $?; printf '\\n%s\\n' " + marker + " >&2\n";
+    }
+
+    // Base64 avoids quoting issues; one line, as the host executes stdin
+    // line by line. The exit code follows powershell.exe -Command: 1 when
+    // the command raised an error or a native command failed
+    return "$Error.Clear(); $global:LASTEXITCODE = 0; $__failed = $false; "
+           "try { & ([ScriptBlock]::Create([Text.Encoding]::UTF8.GetString("
+           "[Convert]::FromBase64String('" +
+           EncodeBase64(command) +
+           "')))) | Out-String -Stream -Width 4096 | "
+           "ForEach-Object { [Console]::Out.WriteLine($_) } } "
+           "catch { [Console]::Error.WriteLine(($_ | Out-String)); "
+           "$__failed = $true }; "
+           "$__rc = if ($__failed -or $Error.Count -gt 0 -or $LASTEXITCODE) "
+           "{ 1 } else { 0 }; [Console]::Out.Write(\"`n" +
+           marker + " $__rc`n\"); [Console]::Out.Flush(); "
+           "[Console]::Error.Write(\"`n" +
+           marker + "`n\"); [Console]::Error.Flush()\n";
+}
+
+bool WarmSession::Drain(HANDLE pipe, std::string& buffer) {
+    bool got_data = false;
+    DWORD available = 0;
+    while (PeekNamedPipe(pipe, nullptr, 0, nullptr, &available, nullptr) &&
+           available > 0) {
+        char chunk[4096];
+        DWORD read = 0;
+        if (!ReadFile(pipe, chunk,
+                      (std::min)(available, static_cast<DWORD>(sizeof(chunk))),
+                      &read, nullptr) ||
+            read == 0) {
+            break;
+        }
+        buffer.append(chunk, read);
+        got_data = true;
+    }
+    return got_data;
+}
+
+int WarmSession::Run(const std::string& command, int timeout_seconds,
+                     const std::function<bool()>& abandoned,
+                     std::string& stdout_output, std::string& stderr_output) {
+    stdout_output.clear();
+    stderr_output.clear();
+    std::string marker = "__prakasa_broker_" +
+                         std::to_string(GetCurrentProcessId()) + "_" +
+                         std::to_string(++counter_) + "__";
+    std::string script = BuildScript(command, marker);
+    DWORD written = 0;
+    if (!IsAlive() ||
+        !WriteFile(stdin_write_, script.data(),
+                   static_cast<DWORD>(script.size()), &written, nullptr)) {
+        Close();
+        return -1;
+    }
+
+    const std::string stdout_end = "\n" + marker + " ";
+    const std::string stderr_end = "\n" + marker + "\n";
+    size_t stdout_marker = std::string::npos;
+    size_t stderr_marker = std::string::npos;
+    uint64_t started_ms = GetTickCountMs();
+    uint64_t deadline_ms = started_ms + timeout_seconds * 1000ULL;
+    for (;;) {
+        bool got_data = Drain(stdout_read_, stdout_output);
+        got_data = Drain(stderr_read_, stderr_output) || got_data;
+
+        if (stdout_marker == std::string::npos) {
+            stdout_marker = stdout_output.find(stdout_end);
+        }
+        if (stderr_marker == std::string::npos) {
+            stderr_marker = stderr_output.find(stderr_end);
+        }
+        if (stdout_marker != std::string::npos &&
+            stderr_marker != std::string::npos &&
+            stdout_output.find('\n', stdout_marker + stdout_end.size()) !=
+                std::string::npos) {
+            int exit_code = std::atoi(stdout_output.c_str() + stdout_marker +
+                                      stdout_end.size());
+            stdout_output.resize(stdout_marker);
+            stderr_output.resize(stderr_marker);
+            return exit_code;
+        }
+        if (got_data) {
+            continue;
+        }
+
+        if (!IsAlive()) {
+            // The shell itself ended: "exit 3" in a PowerShell command, or
+            // wsl --shutdown took the distro down
+            Drain(stdout_read_, stdout_output);
+            Drain(stderr_read_, stderr_output);
+            DWORD exit_code = 1;
+            GetExitCodeProcess(process_, &exit_code);
+            Close();
+            return static_cast<int>(exit_code);
+        }
+        if (GetTickCountMs() >= deadline_ms) {
+            Close();
+            return -2;
+        }
+        if (abandoned && abandoned()) {
+            Close();
+            return -3;
+        }
+        PollWait(started_ms);
+    }
+}
+
+void WarmSession::Close() {
+    if (process_ != nullptr) {
+        if (WaitForSingleObject(process_, 0) == WAIT_TIMEOUT) {
+            TerminateProcess(process_, 1);
+        }
+        CloseHandle(process_);
+        process_ = nullptr;
+    }
+    for (HANDLE* handle : {&stdin_write_, &stdout_read_, &stderr_read_}) {
+        if (*handle != nullptr) {
+            CloseHandle(*handle);
+            *handle = nullptr;
+        }
+    }
+}
+
+// True once the client closed its end, e.g. because it was cancelled
+bool ClientGone(HANDLE pipe) {
+    DWORD available = 0;
+    return !PeekNamedPipe(pipe, nullptr, 0, nullptr, &available, nullptr) &&
+           GetLastError() == ERROR_BROKEN_PIPE;
+}
+
+class SessionBroker {
+ public:
+    explicit SessionBroker(int idle_timeout_seconds)
+        : pipe_name_(GetSessionBrokerPipeName()),
+          idle_timeout_seconds_(idle_timeout_seconds),
+          started_ms_(GetTickCountMs()),
+          last_activity_ms_(started_ms_) {}
+    ~SessionBroker() {
+        if (security_descriptor_ != nullptr) {
+            LocalFree(security_descriptor_);
+        }
+    }
+
+    int Serve();
+
+ private:
+    HANDLE CreateInstance(bool first);
+    void ServeInstance(HANDLE pipe);
+    void HandleClient(HANDLE pipe);
+    std::string Execute(HANDLE pipe);
+    std::unique_ptr<WarmSession> AcquireSession(
+        const std::string& key, BrokerShell shell,
+        const std::string& ubuntu_version);
+    void ReleaseSession(const std::string& key,
+                        std::unique_ptr<WarmSession> session);
+    std::string DescribeStatus();
+
+    std::string pipe_name_;
+    PSECURITY_DESCRIPTOR security_descriptor_ = nullptr;
+    int idle_timeout_seconds_;
+    uint64_t started_ms_;
+    std::atomic<uint64_t> last_activity_ms_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> active_requests_{0};
+    std::atomic<int> finished_workers_{0};
+    std::atomic<uint64_t> requests_served_{0};
+    std::mutex sessions_mutex_;
+    // "wsl:<distro>" or "powershell" -> idle warm sessions
+    std::map<std::string, std::vector<std::unique_ptr<WarmSession>>>
+        idle_sessions_;
+};
+
+HANDLE SessionBroker::CreateInstance(bool first) {
+    SECURITY_ATTRIBUTES sa = {sizeof(SECURITY_ATTRIBUTES),
+                              security_descriptor_, FALSE};
+    return CreateNamedPipeA(
+        pipe_name_.c_str(),
+        PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+            PIPE_REJECT_REMOTE_CLIENTS,
+        PIPE_UNLIMITED_INSTANCES, 64 * 1024, 64 * 1024, 0, &sa);
+}
+
+int SessionBroker::Serve() {
+    // Never serve with the default DACL, which lets other users connect
+    security_descriptor_ = BuildPipeSecurityDescriptor();
+    if (security_descriptor_ == nullptr) {
+        error_log("[BROKER] Failed to build the pipe security descriptor: %lu",
+                  GetLastError());
+        return 1;
+    }
+
+    // The first instance fails if another broker owns the name
+    HANDLE first_instance = CreateInstance(true);
+    if (first_instance == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        if (error == ERROR_ACCESS_DENIED) {
+            info_log("[BROKER] Another broker already serves %s",
+                     pipe_name_.c_str());
+            return 0;
+        }
+        error_log("[BROKER] Failed to create %s: %lu", pipe_name_.c_str(),
+                  error);
+        return 1;
+    }
+    info_log("[BROKER] Serving %s, idle timeout %d s", pipe_name_.c_str(),
+             idle_timeout_seconds_);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < kPipeInstances; ++i) {
+        HANDLE instance = i == 0 ? first_instance : INVALID_HANDLE_VALUE;
+        workers.emplace_back([this, instance]() { ServeInstance(instance); });
+    }
+
+    while (!stopping_) {
+        Sleep(250);
+        if (active_requests_ == 0 &&
+            GetTickCountMs() - last_activity_ms_ >
+                idle_timeout_seconds_ * 1000ULL) {
+            info_log("[BROKER] Idle for %d s, exiting", idle_timeout_seconds_);
+            stopping_ = true;
+        }
+    }
+
+    // Workers blocked in ConnectNamedPipe only notice stopping_ once a
+    // client connects, so connect until all of them returned. A client that
+    // connected and sends nothing, or never reads its response, leaves its
+    // worker blocked in ReadFile or FlushFileBuffers; cancelling the
+    // workers' pending I/O ends those. Repeated, since a worker may enter
+    // a blocking call just after a cancel
+    while (finished_workers_ < kPipeInstances) {
+        for (auto& worker : workers) {
+            CancelSynchronousIo(worker.native_handle());
+        }
+        HANDLE wake = CreateFileA(pipe_name_.c_str(),
+                                  GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                                  OPEN_EXISTING, 0, nullptr);
+        if (wake != INVALID_HANDLE_VALUE) {
+            CloseHandle(wake);
+        } else {
+            Sleep(20);
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    idle_sessions_.clear();
+    info_log("[BROKER] Stopped after %llu requests",
+             static_cast<unsigned long long>(requests_served_.load()));
+    return 0;
+}
+
+void SessionBroker::ServeInstance(HANDLE pipe) {
+    while (!stopping_) {
+        if (pipe == INVALID_HANDLE_VALUE) {
+            pipe = CreateInstance(false);
+            if (pipe == INVALID_HANDLE_VALUE) {
+                error_log("[BROKER] Failed to create a pipe instance: %lu",
+                          GetLastError());
+                break;
+            }
+        }
+        bool connected = ConnectNamedPipe(pipe, nullptr) ||
+                         GetLastError() == ERROR_PIPE_CONNECTED;
+        if (connected && !stopping_) {
+            HandleClient(pipe);
+        }
+        DisconnectNamedPipe(pipe);
+    }
+    if (pipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(pipe);
+    }
+    ++finished_workers_;
+}
+
+void SessionBroker::HandleClient(HANDLE pipe) {
+    uint32_t magic = 0, version = 0, type = 0;
+    if (!ReadU32(pipe, magic) || magic != kProtocolMagic ||
+        !ReadU32(pipe, version) || !ReadU32(pipe, type)) {
+        return;
+    }
+
+    ++active_requests_;
+    std::string response;
+    if (version != kProtocolVersion) {
+        // A client of another prakasa version runs its commands itself
+        response = BuildResponse(ResponseStatus::kUnavailable, -1, "", "");
+    } else if (type == static_cast<uint32_t>(RequestType::kExecute)) {
+        response = Execute(pipe);
+    } else if (type == static_cast<uint32_t>(RequestType::kStatus)) {
+        response = BuildResponse(ResponseStatus::kOk, 0, DescribeStatus(), "");
+    } else if (type == static_cast<uint32_t>(RequestType::kStop)) {
+        info_log("[BROKER] Stop requested");
+        stopping_ = true;
+        response = BuildResponse(ResponseStatus::kOk, 0, "", "");
+    } else {
+        response = BuildResponse(ResponseStatus::kUnavailable, -1, "", "");
+    }
+
+    // DisconnectNamedPipe drops unread data, so wait for the client to
+    // read the response
+    if (WriteAll(pipe, response)) {
+        FlushFileBuffers(pipe);
+    }
+    last_activity_ms_ = GetTickCountMs();
+    --active_requests_;
+}
+
+std::string SessionBroker::Execute(HANDLE pipe) {
+    uint32_t shell_value = 0, timeout_seconds = 0;
+    std::string ubuntu_version, command;
+    if (!ReadU32(pipe, shell_value) || !ReadU32(pipe, timeout_seconds) ||
+        !ReadString(pipe, ubuntu_version) || !ReadString(pipe, command) ||
+        (shell_value != static_cast<uint32_t>(BrokerShell::kWSL) &&
+         shell_value != static_cast<uint32_t>(BrokerShell::kPowerShell))) {
+        return BuildResponse(ResponseStatus::kUnavailable, -1, "", "");
+    }
+
+    BrokerShell shell = static_cast<BrokerShell>(shell_value);
+    std::string key =
+        shell == BrokerShell::kWSL ? "wsl:" + ubuntu_version : "powershell";
+    std::unique_ptr<WarmSession> session =
+        AcquireSession(key, shell, ubuntu_version);
+    if (!session) {
+        return BuildResponse(ResponseStatus::kUnavailable, -1, "", "");
+    }
+
+    uint64_t started_ms = GetTickCountMs();
+    std::string stdout_output, stderr_output;
+    int exit_code =
+        session->Run(command, static_cast<int>(timeout_seconds),
+                     [pipe]() { return ClientGone(pipe); }, stdout_output,
+                     stderr_output);
+    debug_log("[BROKER] %s command finished in %llu ms (code %d)", key.c_str(),
+              static_cast<unsigned long long>(GetTickCountMs() - started_ms),
+              exit_code);
+    ReleaseSession(key, std::move(session));
+    ++requests_served_;
+    return BuildResponse(ResponseStatus::kOk, exit_code, stdout_output,
+                         stderr_output);
+}
+
+std::unique_ptr<WarmSession> SessionBroker::AcquireSession(
+    const std::string& key, BrokerShell shell,
+    const std::string& ubuntu_version) {
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto& idle = idle_sessions_[key];
+        while (!idle.empty()) {
+            std::unique_ptr<WarmSession> session = std::move(idle.back());
+            idle.pop_back();
+            if (session->IsAlive()) {
+                return session;
+            }
+        }
+    }
+
+    // Started outside the lock; concurrent requests each get their own
+    auto session = std::make_unique<WarmSession>(shell);
+    uint64_t started_ms = GetTickCountMs();
+    if (!session->Start(ubuntu_version)) {
+        return nullptr;
+    }
+    info_log("[BROKER] Started a %s session in %llu ms", key.c_str(),
+             static_cast<unsigned long long>(GetTickCountMs() - started_ms));
+    return session;
+}
+
+void SessionBroker::ReleaseSession(const std::string& key,
+                                   std::unique_ptr<WarmSession> session) {
+    if (!session->IsAlive()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto& idle = idle_sessions_[key];
+    if (idle.size() < kMaxIdleSessionsPerShell) {
+        idle.push_back(std::move(session));
+    }
+}
+
+std::string SessionBroker::DescribeStatus() {
+    size_t warm_sessions = 0;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (const auto& entry : idle_sessions_) {
+            warm_sessions += entry.second.size();
+        }
+    }
+    return "pid " + std::to_string(GetCurrentProcessId()) + ", up " +
+           std::to_string((GetTickCountMs() - started_ms_) / 1000) + " s, " +
+           std::to_string(requests_served_.load()) + " requests, " +
+           std::to_string(warm_sessions) + " warm sessions, idle timeout " +
+           std::to_string(idle_timeout_seconds_) + " s";
+}
+
+HANDLE ConnectToBroker(DWORD& error) {
+    std::string pipe_name = GetSessionBrokerPipeName();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        // Identification level only: a process squatting on the pipe name
+        // cannot impersonate the client
+        HANDLE pipe = CreateFileA(
+            pipe_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+            OPEN_EXISTING, SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION,
+            nullptr);
+        if (pipe != INVALID_HANDLE_VALUE) {
+            if (IsTrustedBroker(pipe)) {
+                return pipe;
+            }
+            CloseHandle(pipe);
+            error = ERROR_ACCESS_DENIED;
+            return INVALID_HANDLE_VALUE;
+        }
+        error = GetLastError();
+        if (error != ERROR_PIPE_BUSY ||
+            !WaitNamedPipeA(pipe_name.c_str(), kConnectWaitMs)) {
+            break;
+        }
+    }
+    return INVALID_HANDLE_VALUE;
+}
+
+// Send a request without payload and read the response
+bool SendSimpleRequest(RequestType type, std::string& stdout_output) {
+    DWORD error = 0;
+    HANDLE pipe = ConnectToBroker(error);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    std::string request;
+    PutU32(request, kProtocolMagic);
+    PutU32(request, kProtocolVersion);
+    PutU32(request, static_cast<uint32_t>(type));
+    uint32_t status = 0, exit_code = 0;
+    std::string stderr_output;
+    bool ok = WriteAll(pipe, request) && ReadU32(pipe, status) &&
+              ReadU32(pipe, exit_code) && ReadString(pipe, stdout_output) &&
+              ReadString(pipe, stderr_output) &&
+              status == static_cast<uint32_t>(ResponseStatus::kOk);
+    CloseHandle(pipe);
+    return ok;
+}
+
+std::atomic<bool> g_broker_start_attempted(false);
+
+}  // namespace
+
+std::string GetSessionBrokerPipeName() {
+    char user_name[256] = {0};
+    DWORD size = sizeof(user_name);
+    std::string user = GetUserNameA(user_name, &size) ? user_name : "default";
+    for (char& c : user) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+            c = '_';
+        }
+    }
+    return "\\\\.\\pipe\\prakasa-broker-" + user +
+           (IsAdmin() ? "-elevated" : "");
+}
+
+bool RunThroughSessionBroker(BrokerShell shell,
+                             const std::string& ubuntu_version,
+                             const std::string& command, int timeout_seconds,
+                             const std::function<bool()>& check_cancel,
+                             BrokerCommandResult& result) {
+    int idle_timeout =
+        parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+            parallax::config::KEY_SESSION_BROKER_IDLE_TIMEOUT, 0);
+    if (idle_timeout <= 0 || timeout_seconds <= 0 ||
+        timeout_seconds > kMaxBrokeredTimeoutSeconds) {
+        return false;
+    }
+
+    DWORD error = 0;
+    HANDLE pipe = ConnectToBroker(error);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        // This call pays the process start as before; later ones find the
+        // broker warm
+        if (error == ERROR_FILE_NOT_FOUND &&
+            !g_broker_start_attempted.exchange(true)) {
+            StartSessionBrokerProcess(idle_timeout);
+        }
+        return false;
+    }
+
+    std::string request;
+    PutU32(request, kProtocolMagic);
+    PutU32(request, kProtocolVersion);
+    PutU32(request, static_cast<uint32_t>(RequestType::kExecute));
+    PutU32(request, static_cast<uint32_t>(shell));
+    PutU32(request, static_cast<uint32_t>(timeout_seconds));
+    PutString(request, ubuntu_version);
+    PutString(request, command);
+    if (!WriteAll(pipe, request)) {
+        CloseHandle(pipe);
+        return false;
+    }
+
+    // The broker enforces the timeout; the margin covers a session start
+    uint64_t started_ms = GetTickCountMs();
+    uint64_t deadline_ms =
+        started_ms + (timeout_seconds + kSessionStartSeconds) * 1000ULL;
+    for (;;) {
+        DWORD available = 0;
+        if (!PeekNamedPipe(pipe, nullptr, 0, nullptr, &available, nullptr)) {
+            // The broker went away; the caller runs the command itself
+            warn_log("[BROKER] Broker closed the connection: %lu",
+                     GetLastError());
+            CloseHandle(pipe);
+            return false;
+        }
+        if (available > 0) {
+            break;
+        }
+        // Closing the pipe makes the broker terminate the command
+        if (check_cancel && check_cancel()) {
+            CloseHandle(pipe);
+            result.exit_code = -3;
+            return true;
+        }
+        if (GetTickCountMs() >= deadline_ms) {
+            CloseHandle(pipe);
+            result.exit_code = -2;
+            return true;
+        }
+        PollWait(started_ms);
+    }
+
+    uint32_t status = 0, exit_code = 0;
+    bool ok = ReadU32(pipe, status) && ReadU32(pipe, exit_code) &&
+              ReadString(pipe, result.stdout_output) &&
+              ReadString(pipe, result.stderr_output);
+    CloseHandle(pipe);
+    if (!ok || status != static_cast<uint32_t>(ResponseStatus::kOk)) {
+        return false;
+    }
+    result.exit_code = static_cast<int>(exit_code);
+    debug_log("[BROKER] Brokered command finished in %llu ms",
+              static_cast<unsigned long long>(GetTickCountMs() - started_ms));
+    return true;
+}
+
+bool QuerySessionBroker(std::string& status) {
+    return SendSimpleRequest(RequestType::kStatus, status);
+}
+
+bool StopSessionBroker() {
+    std::string unused;
+    return SendSimpleRequest(RequestType::kStop, unused);
+}
+
+bool StartSessionBrokerProcess(int idle_timeout_seconds) {
+    std::string exe_path = GetBrokerExePath();
+    std::string command_line = "\"" + exe_path +
+                               "\" broker start --idle-timeout " +
+                               std::to_string(idle_timeout_seconds);
+    std::vector<char> buffer(command_line.begin(), command_line.end());
+    buffer.push_back('\0');
+
+    STARTUPINFOA si = {sizeof(STARTUPINFOA)};
+    PROCESS_INFORMATION pi = {0};
+    if (!CreateProcessA(exe_path.c_str(), buffer.data(), nullptr, nullptr,
+                        FALSE, DETACHED_PROCESS | CREATE_NEW_PROCESS_GROUP,
+                        nullptr, nullptr, &si, &pi)) {
+        warn_log("[BROKER] Failed to start the session broker: %lu",
+                 GetLastError());
+        return false;
+    }
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    info_log("[BROKER] Started the session broker (pid %lu)",
+             pi.dwProcessId);
+    return true;
+}
+
+int RunSessionBroker(int idle_timeout_seconds) {
+    SessionBroker broker(idle_timeout_seconds);
+    return broker.Serve();
+}
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <string>
+
+// Per-user broker process that keeps warm WSL bash sessions and a
+// PowerShell host between CLI invocations. Clients talk to it over a named
+// pipe; when it is disabled, busy or not running they run the command
+// themselves, so the broker only ever saves time.
+
+namespace parallax {
+namespace utils {
+
+// Shell a brokered command runs in
+enum class BrokerShell { kWSL = 1, kPowerShell = 2 };
+
+struct BrokerCommandResult {
+    // As ExecCommandEx2: -2 on timeout, -3 when check_cancel stopped it
+    int exit_code = -1;
+    std::string stdout_output;  // UTF-8, no further conversion needed
+    std::string stderr_output;
+};
+
+// Named pipe of this user's broker. Elevated processes get their own
+// broker, so commands never run with more rights than the client has. The
+// pipe only admits this user (and only elevated clients for an elevated
+// broker); clients only talk to prakasa.exe of the same elevation
+std::string GetSessionBrokerPipeName();
+
+// Run the read-only probe command the way
+// "wsl -d <ubuntu_version> -u root bash -c \"command\"" or
+// "powershell.exe -Command \"command\"" would, in a warm session of the
+// broker. Returns false when the broker is disabled
+// (session_broker_idle_timeout 0), not running or busy, or the command's
+// timeout is too long to be a probe; the caller then runs the command
+// itself. A broker that is enabled but not running is started for later
+// calls
+bool RunThroughSessionBroker(BrokerShell shell,
+                             const std::string& ubuntu_version,
+                             const std::string& command, int timeout_seconds,
+                             const std::function<bool()>& check_cancel,
+                             BrokerCommandResult& result);
+
+// One-line description of the running broker, false if none answers
+bool QuerySessionBroker(std::string& status);
+
+// Ask the running broker to close its sessions and exit
+bool StopSessionBroker();
+
+// Start "prakasa.exe broker start" detached from this console
+bool StartSessionBrokerProcess(int idle_timeout_seconds);
+
+// Serve broker requests until idle_timeout_seconds pass without one, or a
+// stop request arrives. Returns 0, or 1 when the pipe could not be created
+int RunSessionBroker(int idle_timeout_seconds);
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,388 @@
+#include "slo_watchdog.h"
+#include "prakasa_sessions.h"
+#include "process.h"
+#include "utils.h"
+#include "../config/config_manager.h"
+#include "../tinylog/tinylog.h"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+// One wsl.exe call per sample
+const int kSampleIntervalSeconds = 15;
+// Consumer GPUs start to pull their clocks back around here even before
+// nvidia-smi reports a thermal slowdown
+const int kHotTemperatureC = 87;
+// A server that keeps degrading after this many restarts needs a person
+const int kMaxRestarts = 3;
+const char* const kEventsFileName = "slo_events.log";
+
+const char* const kLogSizeMarker = "#slo-size";
+const char* const kGroupMarker = "#slo-group";
+
+std::string FormatDevice(const GpuDeviceSample& device) {
+    char buffer[160];
+    std::snprintf(buffer, sizeof(buffer),
+                  "GPU %d: %d C, SM clock %d/%d MHz, %d%% busy, %.0f W",
+                  device.index, device.temperature_c, device.sm_clock_mhz,
+                  device.max_sm_clock_mhz, device.utilization_percent,
+                  device.power_draw_w);
+    std::string description = buffer;
+    std::string reasons = DescribeThrottleReasons(device.throttle_reasons);
+    return reasons.empty() ? description : description + " (" + reasons + ")";
+}
+
+std::string CurrentTimestampUtc() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc_time;
+    gmtime_s(&utc_time, &now);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc_time);
+    return buffer;
+}
+
+// Samples one server on its own thread until stopped, or until it drained
+// the server for a restart
+class SloWatchdogThread {
+ public:
+    SloWatchdogThread(const std::string& ubuntu_version,
+                      const std::string& launcher, const std::string& pid_file,
+                      const SloSettings& settings, bool echo_alerts)
+        : ubuntu_version_(ubuntu_version),
+          launcher_(launcher),
+          pid_file_(pid_file),
+          settings_(settings),
+          echo_alerts_(echo_alerts) {}
+
+    ~SloWatchdogThread() { Stop(); }
+
+    void Start() { thread_ = std::thread([this]() { Run(); }); }
+
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    bool RestartRequested() const { return restart_requested_; }
+
+ private:
+    void Run();
+    bool Sample(SloObservation& observation);
+    void Record(const SloViolation& violation, const std::string& action);
+    void DrainServer();
+
+    std::string ubuntu_version_;
+    std::string launcher_;
+    std::string pid_file_;
+    SloSettings settings_;
+    bool echo_alerts_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    bool restart_requested_ = false;
+
+    long long log_offset_ = -1;  // Bytes of the log already read
+};
+
+void SloWatchdogThread::Run() {
+    SloEvaluator evaluator(settings_);
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (wake_.wait_for(lock, std::chrono::seconds(kSampleIntervalSeconds),
+                               [this]() { return stop_; })) {
+                return;
+            }
+        }
+
+        SloObservation observation;
+        SloViolation violation;
+        if (!Sample(observation) ||
+            !evaluator.Observe(observation, violation)) {
+            continue;
+        }
+
+        // Restarting does not cool a GPU, lift a power cap or evict a
+        // neighbour, so only a drop nothing explains gets one
+        bool restart =
+            settings_.restart && violation.cause == SloCause::kUnexplained;
+        Record(violation, restart ? "drain and restart"
+                          : settings_.restart
+                              ? "alert, a restart would not help"
+                              : "alert");
+        if (restart) {
+            restart_requested_ = true;
+            DrainServer();
+            return;
+        }
+    }
+}
+
+bool SloWatchdogThread::Sample(SloObservation& observation) {
+    std::string log_file = GetWSLLogFilePath(pid_file_);
+    std::string offset = std::to_string((std::max)(log_offset_, 0LL));
+    // New log bytes only (from the start again if the log was truncated),
+    // then the pids of the server's group and the GPU state
+    std::string sample_cmd =
+        "s=\\$(stat -c %s " + log_file + " 2>/dev/null || echo 0); o=" +
+        offset + "; [ \\$s -ge \\$o ] || o=0; echo '" + kLogSizeMarker +
+        "' \\$s; tail -c +\\$((o + 1)) " + log_file +
+        " 2>/dev/null | head -c \\$((s - o)) | grep -aoiE "
+        "'gen(eration)? throughput[^0-9]*[0-9]+(\\.[0-9]+)?' | "
+        "grep -oE '[0-9.]+\\$'; echo '" + kGroupMarker +
+        "'; p=\\$(cat " + pid_file_ + " 2>/dev/null); "
+        "g=\\$(ps -o pgid= -p \\${p:-0} 2>/dev/null | tr -d ' '); "
+        "[ \\${#g} -gt 0 ] && pgrep -g \\$g; " + BuildGpuTelemetryProbe();
+
+    std::string stdout_output, stderr_output;
+    int exit_code =
+        ExecCommandEx(BuildWSLCommand(ubuntu_version_, sample_cmd), 30,
+                      stdout_output, stderr_output, false, true);
+    if (exit_code != 0) {
+        debug_log("[SLO] Sample failed (code %d): %s", exit_code,
+                  stderr_output.c_str());
+        return false;
+    }
+
+    long long log_size = -1;
+    std::set<int> group;
+    enum class Section { kNone, kThroughput, kGroup } section = Section::kNone;
+    std::istringstream lines(stdout_output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = TrimNewlines(line);
+        if (line.compare(0, 9, kLogSizeMarker) == 0) {
+            log_size = std::atoll(line.c_str() + 9);
+            section = Section::kThroughput;
+        } else if (line == kGroupMarker) {
+            section = Section::kGroup;
+        } else if (!line.empty() && line[0] == '#') {
+            section = Section::kNone;
+        } else if (section == Section::kThroughput && !line.empty()) {
+            observation.tokens_per_s.push_back(std::atof(line.c_str()));
+        } else if (section == Section::kGroup && !line.empty()) {
+            group.insert(std::atoi(line.c_str()));
+        }
+    }
+    if (log_size < 0) {
+        return false;
+    }
+    // What the log held before the watchdog started is not this run's
+    if (log_offset_ < 0) {
+        observation.tokens_per_s.clear();
+    }
+    log_offset_ = log_size;
+
+    observation.time_ms = GetTickCountMs();
+    observation.gpu = ParseGpuTelemetry(stdout_output);
+    for (const auto& process : observation.gpu.processes) {
+        if (!group.empty() && !group.count(process.pid)) {
+            ++observation.other_processes;
+            observation.other_memory_mib += process.used_memory_mib;
+        }
+    }
+    return true;
+}
+
+void SloWatchdogThread::Record(const SloViolation& violation,
+                               const std::string& action) {
+    char throughput[96];
+    std::snprintf(throughput, sizeof(throughput),
+                  "%.1f tokens/s below the SLO of %.1f for %d s",
+                  violation.tokens_per_s, settings_.min_tokens_per_s,
+                  violation.seconds);
+    std::string message = launcher_ + " server " + throughput + ", cause: " +
+                          SloCauseToString(violation.cause) + " (" +
+                          violation.detail + "), action: " + action;
+    warn_log("[SLO] %s", message.c_str());
+    if (echo_alerts_) {
+        std::cerr << "\n[SLO] " << message << std::endl;
+    }
+
+    std::ofstream events(JoinPath(GetAppBinDir(), kEventsFileName),
+                         std::ios::app);
+    if (events) {
+        events << CurrentTimestampUtc() << " " << message << "\n";
+    }
+}
+
+void SloWatchdogThread::DrainServer() {
+    int drain_timeout =
+        parallax::config::ConfigManager::GetInstance().GetConfigIntValue(
+            parallax::config::KEY_SHUTDOWN_DRAIN_TIMEOUT, 30);
+    std::string drain_cmd =
+        BuildWSLSignalCommand(pid_file_, "INT") + "; for i in \\$(seq 1 " +
+        std::to_string((std::max)(drain_timeout, 1)) + "); do [ -f " +
+        pid_file_ + " ] && kill -0 \\$(cat " + pid_file_ +
+        ") 2>/dev/null || exit 0; sleep 1; done; " +
+        BuildWSLSignalCommand(pid_file_, "KILL");
+
+    std::string stdout_output, stderr_output;
+    ExecCommandEx(BuildWSLCommand(ubuntu_version_, drain_cmd),
+                  drain_timeout + 30, stdout_output, stderr_output, false,
+                  true);
+}
+
+}  // namespace
+
+SloSettings LoadSloSettings() {
+    auto& config = parallax::config::ConfigManager::GetInstance();
+    SloSettings settings;
+    settings.min_tokens_per_s = std::atof(
+        config.GetConfigValue(parallax::config::KEY_SLO_MIN_TOKENS_PER_S)
+            .c_str());
+    settings.window_seconds = (std::max)(
+        config.GetConfigIntValue(parallax::config::KEY_SLO_WINDOW_SECONDS,
+                                 120),
+        kSampleIntervalSeconds);
+    std::string action =
+        config.GetConfigValue(parallax::config::KEY_SLO_ACTION);
+    std::transform(action.begin(), action.end(), action.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    settings.restart = action == "restart";
+    return settings;
+}
+
+std::string SloCauseToString(SloCause cause) {
+    switch (cause) {
+        case SloCause::kThermal:
+            return "thermal throttling";
+        case SloCause::kPower:
+            return "power or clock limit";
+        case SloCause::kContention:
+            return "GPU shared with other processes";
+        case SloCause::kUnexplained:
+        default:
+            return "no throttling or contention seen";
+    }
+}
+
+SloCause ClassifySloCause(const SloObservation& observation,
+                          std::string& detail) {
+    for (const auto& device : observation.gpu.devices) {
+        if (device.IsThermalThrottled() ||
+            device.temperature_c >= kHotTemperatureC) {
+            detail = FormatDevice(device);
+            return SloCause::kThermal;
+        }
+    }
+    for (const auto& device : observation.gpu.devices) {
+        if (device.IsPowerThrottled()) {
+            detail = FormatDevice(device);
+            return SloCause::kPower;
+        }
+    }
+    if (observation.other_processes > 0) {
+        detail = std::to_string(observation.other_processes) +
+                 " other process(es) hold " +
+                 std::to_string(observation.other_memory_mib) + " MiB";
+        return SloCause::kContention;
+    }
+
+    // Possibly memory fragmentation or a changed workload
+    detail.clear();
+    for (const auto& device : observation.gpu.devices) {
+        detail += (detail.empty() ? "" : "; ") + FormatDevice(device);
+    }
+    if (detail.empty()) {
+        detail = "no GPU telemetry";
+    }
+    return SloCause::kUnexplained;
+}
+
+SloEvaluator::SloEvaluator(const SloSettings& settings)
+    : settings_(settings) {}
+
+bool SloEvaluator::Observe(const SloObservation& observation,
+                           SloViolation& violation) {
+    if (settings_.min_tokens_per_s <= 0 || observation.tokens_per_s.empty()) {
+        return false;
+    }
+    double sum = 0;
+    for (double value : observation.tokens_per_s) {
+        sum += value;
+    }
+    if (sum / observation.tokens_per_s.size() >= settings_.min_tokens_per_s) {
+        below_since_ms_ = 0;
+        below_sum_ = 0;
+        below_count_ = 0;
+        reported_ = false;
+        return false;
+    }
+
+    if (below_count_ == 0) {
+        below_since_ms_ = observation.time_ms;
+    }
+    below_sum_ += sum;
+    below_count_ += static_cast<int>(observation.tokens_per_s.size());
+    uint64_t below_ms = observation.time_ms - below_since_ms_;
+    if (reported_ ||
+        below_ms < static_cast<uint64_t>(settings_.window_seconds) * 1000) {
+        return false;
+    }
+
+    reported_ = true;
+    violation.tokens_per_s = below_sum_ / below_count_;
+    violation.seconds = static_cast<int>(below_ms / 1000);
+    violation.cause = ClassifySloCause(observation, violation.detail);
+    return true;
+}
+
+int RunUnderSloWatchdog(const std::string& ubuntu_version,
+                        const std::string& launcher,
+                        const std::string& pid_file, bool echo_alerts,
+                        const std::function<int()>& run_server) {
+    SloSettings settings = LoadSloSettings();
+    if (settings.min_tokens_per_s <= 0) {
+        return run_server();
+    }
+    info_log("[SLO] Watching %s for %.1f tokens/s over %d s", launcher.c_str(),
+             settings.min_tokens_per_s, settings.window_seconds);
+
+    for (int restarts = 0;; ++restarts) {
+        SloWatchdogThread watchdog(ubuntu_version, launcher, pid_file,
+                                   settings, echo_alerts);
+        watchdog.Start();
+        int exit_code = run_server();
+        watchdog.Stop();
+        if (!watchdog.RestartRequested()) {
+            return exit_code;
+        }
+        if (restarts >= kMaxRestarts) {
+            warn_log("[SLO] %s restarted %d times, not restarting again",
+                     launcher.c_str(), restarts);
+            return exit_code;
+        }
+        info_log("[SLO] Restarting %s after an SLO violation",
+                 launcher.c_str());
+        if (echo_alerts) {
+            std::cerr << "[SLO] Restarting the " << launcher << " server..."
+                      << std::endl;
+        }
+    }
+}
+
+}  // namespace utils
+}  // namespace parallax
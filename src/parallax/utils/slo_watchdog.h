@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "gpu_telemetry.h"
+
+// Throughput SLO watchdog for a supervised server. The server can degrade
+// while its process stays alive (a throttling GPU, another process on the
+// GPU, fragmented memory), which exit monitoring never notices. The
+// watchdog samples the generation throughput the server logs together with
+// the GPU clocks, temperature and throttle reasons, and when throughput
+// stays below slo_min_tokens_per_s for slo_window_seconds it records an
+// alert with the likely cause, and with slo_action restart drains and
+// relaunches the server when a restart can help.
+
+namespace parallax {
+namespace utils {
+
+struct SloSettings {
+    double min_tokens_per_s = 0;  // 0 disables the watchdog
+    int window_seconds = 120;
+    bool restart = false;
+};
+
+SloSettings LoadSloSettings();
+
+enum class SloCause {
+    kThermal,     // Thermal slowdown or a hot GPU
+    kPower,       // Power cap, hardware slowdown or power brake
+    kContention,  // Other processes use the GPU
+    kUnexplained  // None of the above, e.g. fragmentation or a stuck state
+};
+
+std::string SloCauseToString(SloCause cause);
+
+// One sample of the server
+struct SloObservation {
+    uint64_t time_ms = 0;
+    // Throughput values the server logged since the previous sample
+    std::vector<double> tokens_per_s;
+    GpuTelemetrySnapshot gpu;
+    // GPU memory of processes outside the server's process group, when the
+    // driver lists compute processes (WSL drivers often do not)
+    int other_processes = 0;
+    int other_memory_mib = 0;
+};
+
+struct SloViolation {
+    double tokens_per_s = 0;  // Mean over the window
+    int seconds = 0;          // How long throughput stayed below the SLO
+    SloCause cause = SloCause::kUnexplained;
+    std::string detail;       // GPU state backing the cause
+};
+
+// Cause of a throughput drop given the GPU state at the time
+SloCause ClassifySloCause(const SloObservation& observation,
+                          std::string& detail);
+
+// Tracks the samples of one server. A sample without logged throughput
+// (an idle server) neither starts nor ends a violation; one at or above
+// the SLO ends it
+class SloEvaluator {
+ public:
+    explicit SloEvaluator(const SloSettings& settings);
+
+    // True when this sample completes a violation window; reported once
+    // per violation
+    bool Observe(const SloObservation& observation, SloViolation& violation);
+
+ private:
+    SloSettings settings_;
+    uint64_t below_since_ms_ = 0;
+    double below_sum_ = 0;
+    int below_count_ = 0;
+    bool reported_ = false;
+};
+
+// Run the server with run_server, which returns its exit code, under the
+// watchdog of the server recording its pid in pid_file. When the watchdog
+// drained the server to restart it, run_server is called again, a few
+// times at most. echo_alerts also prints alerts to the console
+int RunUnderSloWatchdog(const std::string& ubuntu_version,
+                        const std::string& launcher,
+                        const std::string& pid_file, bool echo_alerts,
+                        const std::function<int()>& run_server);
+
+}  // namespace utils
+}  // namespace parallax
@@ -459,6 +459,60 @@ std::string TrimNewlines(const std::string& str) {
     return str.substr(start, end - start);
 }
 
+std::string EscapeJsonString(const std::string& str) {
+    std::string escaped;
+    escaped.reserve(str.size() + 8);
+    for (unsigned char c : str) {
+        switch (c) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\r':
+                escaped += "\\r";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    escaped += buffer;
+                } else {
+                    escaped += static_cast<char>(c);
+                }
+        }
+    }
+    return escaped;
+}
+
+std::string EncodeBase64(const std::string& data) {
+    static const char kAlphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string encoded;
+    encoded.reserve((data.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t chunk = static_cast<unsigned char>(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            chunk |= static_cast<unsigned char>(data[i + 1]) << 8;
+        }
+        if (i + 2 < data.size()) {
+            chunk |= static_cast<unsigned char>(data[i + 2]);
+        }
+        encoded += kAlphabet[(chunk >> 18) & 0x3f];
+        encoded += kAlphabet[(chunk >> 12) & 0x3f];
+        encoded += i + 1 < data.size() ? kAlphabet[(chunk >> 6) & 0x3f] : '=';
+        encoded += i + 2 < data.size() ? kAlphabet[chunk & 0x3f] : '=';
+    }
+    return encoded;
+}
+
 int64_t GetFileSize(const char* path) {
     if (!path) return -1;
 
@@ -684,5 +738,23 @@ std::string BuildWSLDirectCommand(const std::string& ubuntu_version,
     return GetWSLCommandPrefix(ubuntu_version) + " " + command;
 }
 
+std::string BuildWSLPidFilePath(const std::string& launcher_name) {
+    return "/tmp/prakasa/" + launcher_name + "-" +
+           std::to_string(GetCurrentProcessId()) + ".pid";
+}
+
+std::string BuildWSLSignalCommand(const std::string& pid_file,
+                                  const std::string& signal_name) {
+    // Signal the whole process group when the recorded process leads it,
+    // otherwise fall back to the process and its direct children so that
+    // an unrelated group is never hit. The snippet is embedded in
+    // bash -c "..." and wsl.exe hands that line to the login shell first,
+    // so '$' is escaped to reach the inner bash unexpanded
+    return "p=\\$(cat " + pid_file + " 2>/dev/null) && [ -n \\$p ] && "
+           "if [ \\$(ps -o pgid= -p \\$p) = \\$p ] 2>/dev/null; then "
+           "kill -" + signal_name + " -- -\\$p; else pkill -" + signal_name +
+           " -P \\$p; kill -" + signal_name + " \\$p; fi";
+}
+
 }  // namespace utils
 }  // namespace parallax
@@ -37,6 +37,10 @@ size_t FindUtf8StartPosition(const std::string& mixed_output);
 
 // String processing utilities
 std::string TrimNewlines(const std::string& str);
+// Escape a UTF-8 string for use inside a JSON string literal (no quotes)
+std::string EscapeJsonString(const std::string& str);
+// Standard base64 with padding, e.g. to pass a script through a command line
+std::string EncodeBase64(const std::string& data);
 
 // File operations
 int64_t GetFileSize(const char* path);
@@ -51,6 +55,15 @@ std::string BuildWSLDirectCommand(const std::string& ubuntu_version,
                                   const std::string& command);
 std::string GetWSLCommandPrefix(const std::string& ubuntu_version);
 
+// In-distro pid file for a process launched by this CLI instance
+// (e.g. /tmp/prakasa/run-1234.pid, where 1234 is the Windows PID)
+std::string BuildWSLPidFilePath(const std::string& launcher_name);
+
+// Shell snippet that delivers a signal (INT, TERM, KILL) to the process
+// recorded in pid_file and to its process group inside the distro
+std::string BuildWSLSignalCommand(const std::string& pid_file,
+                                  const std::string& signal_name);
+
 // HTTP download functionality
 bool DownloadFile(const std::string& url, const std::string& local_path);
 
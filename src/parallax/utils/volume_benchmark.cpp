@@ -0,0 +1,167 @@
+#include "volume_benchmark.h"
+#include "utils.h"
+#include "tinylog/tinylog.h"
+#include <windows.h>
+#include <chrono>
+#include <random>
+
+namespace parallax {
+namespace utils {
+
+namespace {
+
+const DWORD kSequentialBlock = 1 << 20;
+const DWORD kRandomBlock = 4096;
+// Random reads stop after this long or this many reads, whichever is first
+const int kRandomReadMs = 2000;
+const int kMaxRandomReads = 50000;
+
+double ElapsedSeconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+bool ReadAt(HANDLE file, uint64_t offset, void* buffer, DWORD size) {
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(offset);
+    DWORD read = 0;
+    return SetFilePointerEx(file, position, nullptr, FILE_BEGIN) &&
+           ReadFile(file, buffer, size, &read, nullptr) && read == size;
+}
+
+}  // namespace
+
+std::vector<std::string> ListFixedVolumes() {
+    std::vector<std::string> roots;
+    DWORD drives = GetLogicalDrives();
+    for (int letter = 0; letter < 26; ++letter) {
+        if ((drives & (1u << letter)) == 0) {
+            continue;
+        }
+        std::string root = std::string(1, static_cast<char>('A' + letter)) +
+                           ":\\";
+        if (GetDriveTypeA(root.c_str()) == DRIVE_FIXED) {
+            roots.push_back(root);
+        }
+    }
+    return roots;
+}
+
+std::string GetVolumeRoot(const std::string& path) {
+    char root[MAX_PATH];
+    if (!GetVolumePathNameA(path.c_str(), root, MAX_PATH)) {
+        return path.size() >= 2 && path[1] == ':' ? path.substr(0, 2) + "\\"
+                                                  : "";
+    }
+    return root;
+}
+
+bool CreateDirectoryTree(const std::string& path) {
+    size_t pos = path.find_first_of("\\/", 3);
+    while (true) {
+        std::string prefix = path.substr(0, pos);
+        if (!CreateDirectoryA(prefix.c_str(), nullptr) &&
+            GetLastError() != ERROR_ALREADY_EXISTS) {
+            return false;
+        }
+        if (pos == std::string::npos) {
+            return true;
+        }
+        pos = path.find_first_of("\\/", pos + 1);
+    }
+}
+
+VolumeBenchmark BenchmarkVolume(const std::string& directory,
+                                uint64_t test_bytes) {
+    VolumeBenchmark result;
+    result.directory = directory;
+    result.root = GetVolumeRoot(directory);
+
+    ULARGE_INTEGER free_bytes, total_bytes;
+    if (GetDiskFreeSpaceExA(directory.c_str(), &free_bytes, &total_bytes,
+                            nullptr)) {
+        result.free_bytes = free_bytes.QuadPart;
+        result.total_bytes = total_bytes.QuadPart;
+    }
+    if (result.free_bytes < test_bytes * 2) {
+        result.error = "not enough free space for the test file";
+        return result;
+    }
+
+    // Unbuffered I/O needs sector-aligned buffers; VirtualAlloc returns
+    // page-aligned memory
+    void* buffer = VirtualAlloc(nullptr, kSequentialBlock,
+                                MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (buffer == nullptr) {
+        result.error = "out of memory";
+        return result;
+    }
+    // Random content, so compressing or deduplicating drives cannot skip
+    // the reads
+    std::mt19937_64 random(GetTickCountMs());
+    uint64_t* words = static_cast<uint64_t*>(buffer);
+    for (size_t i = 0; i < kSequentialBlock / sizeof(uint64_t); ++i) {
+        words[i] = random();
+    }
+
+    std::string path = JoinPath(
+        directory,
+        "prakasa-bench-" + std::to_string(GetCurrentProcessId()) + ".tmp");
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH |
+            FILE_FLAG_DELETE_ON_CLOSE,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        result.error = "cannot write to " + directory;
+        VirtualFree(buffer, 0, MEM_RELEASE);
+        return result;
+    }
+
+    uint64_t blocks = test_bytes / kSequentialBlock;
+    bool io_ok = true;
+    for (uint64_t i = 0; i < blocks && io_ok; ++i) {
+        DWORD written = 0;
+        io_ok = WriteFile(file, buffer, kSequentialBlock, &written, nullptr) &&
+                written == kSequentialBlock;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < blocks && io_ok; ++i) {
+        io_ok = ReadAt(file, i * kSequentialBlock, buffer, kSequentialBlock);
+    }
+    double seconds = ElapsedSeconds(start);
+    if (io_ok && seconds > 0) {
+        result.sequential_mib_s = static_cast<double>(blocks) / seconds;
+    }
+
+    uint64_t random_blocks = blocks * (kSequentialBlock / kRandomBlock);
+    int reads = 0;
+    start = std::chrono::steady_clock::now();
+    while (io_ok && reads < kMaxRandomReads &&
+           ElapsedSeconds(start) * 1000 < kRandomReadMs) {
+        io_ok = ReadAt(file, (random() % random_blocks) * kRandomBlock,
+                       buffer, kRandomBlock);
+        ++reads;
+    }
+    seconds = ElapsedSeconds(start);
+    if (io_ok && seconds > 0) {
+        result.random_iops = reads / seconds;
+    }
+
+    CloseHandle(file);
+    VirtualFree(buffer, 0, MEM_RELEASE);
+    if (!io_ok) {
+        result.error = "I/O error on the test file";
+        return result;
+    }
+
+    result.ok = true;
+    info_log("Volume benchmark %s: %.0f MiB/s sequential, %.0f IOPS random",
+             directory.c_str(), result.sequential_mib_s, result.random_iops);
+    return result;
+}
+
+}  // namespace utils
+}  // namespace parallax
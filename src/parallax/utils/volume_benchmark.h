@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Quick read benchmark of local volumes, used to pick the drive the WSL
+// distro lives on. Reads bypass the file cache, so the figures reflect the
+// device rather than RAM.
+
+namespace parallax {
+namespace utils {
+
+struct VolumeBenchmark {
+    std::string root;       // "D:\"
+    std::string directory;  // Where the test file was written
+    uint64_t free_bytes = 0;
+    uint64_t total_bytes = 0;
+    bool ok = false;
+    std::string error;            // Why the benchmark did not run
+    double sequential_mib_s = 0;  // 1 MiB reads
+    double random_iops = 0;       // 4 KiB reads at random offsets, one by one
+};
+
+// Roots of the fixed local volumes, "C:\", "D:\", ...
+std::vector<std::string> ListFixedVolumes();
+
+// "D:\" for "D:\wsl\Ubuntu"
+std::string GetVolumeRoot(const std::string& path);
+
+// Create path and its missing parents
+bool CreateDirectoryTree(const std::string& path);
+
+// Write a test file of test_bytes in directory, read it back sequentially
+// and at random offsets, and delete it
+VolumeBenchmark BenchmarkVolume(const std::string& directory,
+                                uint64_t test_bytes = 256ULL << 20);
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,227 @@
+#include "weight_residency.h"
+#include "process.h"
+#include "utils.h"
+#include "../config/config_manager.h"
+#include "../tinylog/tinylog.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace parallax {
+namespace utils {
+
+const char* const kWeightResidencyHubDir = "/dev/shm/prakasa-weights/hub";
+
+namespace {
+
+// A large model copies from ext4 to tmpfs at a few hundred MB/s at worst
+const int kStagingTimeoutSeconds = 1800;
+
+// Exit codes of the staging script
+const int kStageNoSource = 3;
+const int kStageTooLarge = 4;
+const int kStageNoRoom = 5;
+
+bool IsHubModelId(const std::string& value) {
+    // org/name, not a path
+    size_t slash = value.find('/');
+    return !value.empty() && slash != std::string::npos && slash > 0 &&
+           value.find('/', slash + 1) == std::string::npos &&
+           value[0] != '.' && value[0] != '~' && value.back() != '/';
+}
+
+// "org/name" -> "models--org--name", the hub cache entry of a model
+std::string GetHubEntryName(const std::string& model_id) {
+    size_t slash = model_id.find('/');
+    return "models--" + model_id.substr(0, slash) + "--" +
+           model_id.substr(slash + 1);
+}
+
+// Replace the model argument (a word of its own or the value of --model=)
+// with path; false when command does not contain it
+bool ReplaceModelArgument(std::string& command, const std::string& model_id,
+                          const std::string& path) {
+    for (size_t pos = command.find(model_id); pos != std::string::npos;
+         pos = command.find(model_id, pos + 1)) {
+        size_t end = pos + model_id.size();
+        if ((pos == 0 || command[pos - 1] == ' ' || command[pos - 1] == '=') &&
+            (end == command.size() || command[end] == ' ')) {
+            command.replace(pos, model_id.size(), path);
+            return true;
+        }
+    }
+    return false;
+}
+
+// In-distro script that stages the current snapshot (refs/main) of
+// models--<org>--<name> under the budget, with the blobs it links to
+// copied in as plain files. A staged copy of another revision is replaced;
+// a server still mapping it keeps its files until it exits. The whole run
+// holds a lock, so concurrent launches do not evict or copy over each
+// other. Prints "hit <revision>", "staged <MiB> <revision>" or the reason
+// it gave up, plus one "evicted <entry>" line per eviction
+std::string BuildStagingScript(const std::string& model_id,
+                               int budget_mib) {
+    std::string entry = GetHubEntryName(model_id);
+    std::string root = kWeightResidencyHubDir;
+    return "src=\\${HF_HUB_CACHE:-\\${HF_HOME:-\\$HOME/.cache/huggingface}"
+           "/hub}/" + entry + "; dst=" + root + "/" + entry + "; "
+           "rev=\\$(cat \\$src/refs/main 2>/dev/null); "
+           "[ \\${#rev} -gt 0 ] && [ -d \\$src/snapshots/\\$rev ] || "
+           "{ echo not downloaded; exit " +
+           std::to_string(kStageNoSource) + "; }; "
+           "ls \\$src/blobs/*.incomplete > /dev/null 2>&1 && "
+           "{ echo download incomplete; exit " +
+           std::to_string(kStageNoSource) + "; }; "
+           "mkdir -p " + root + " && exec 9> " + root + "/.lock && flock 9; "
+           "if [ -f \\$dst/.prakasa-staged ]; then "
+           "if [ \\$(cat \\$dst/refs/main 2>/dev/null)x = \\${rev}x ]; then "
+           "touch \\$dst/.prakasa-staged; echo hit \\$rev; exit 0; fi; "
+           "rm -rf \\$dst; echo evicted " + entry + " outdated; fi; "
+           // Copies interrupted by a crash never got their stamp
+           "for d in " + root + "/models--*; do "
+           "[ -d \\$d ] && [ ! -f \\$d/.prakasa-staged ] && rm -rf \\$d; done; "
+           "need=\\$(du -smL \\$src/snapshots/\\$rev | cut -f1); "
+           "budget=" + std::to_string(budget_mib) + "; "
+           "[ \\$budget -gt 0 ] || budget=\\$(( \\$(df -m --output=size "
+           "/dev/shm | tail -n 1) * 3 / 4 )); "
+           "[ \\$need -le \\$budget ] || "
+           "{ echo larger than the budget: \\$need of \\$budget MiB; "
+           "exit " + std::to_string(kStageTooLarge) + "; }; "
+           // Least recently launched first, skipping models a running
+           // process still maps
+           "while [ \\$(( \\$(du -sm " + root + " | cut -f1) + need )) "
+           "-gt \\$budget ]; do victim=; "
+           "for s in \\$(ls -tr " + root + "/*/.prakasa-staged 2>/dev/null); "
+           "do d=\\${s%/.prakasa-staged}; "
+           "grep -qsF \\$d/ /proc/[0-9]*/maps || { victim=\\$d; break; }; "
+           "done; "
+           "[ \\${#victim} -gt 0 ] || "
+           "{ echo no room: staged models are in use; exit " +
+           std::to_string(kStageNoRoom) + "; }; "
+           "rm -rf \\$victim; echo evicted \\${victim##*/}; done; "
+           "mkdir -p \\$dst/snapshots \\$dst/refs && "
+           "cp -rL \\$src/snapshots/\\$rev \\$dst/snapshots/ && "
+           "echo \\$rev > \\$dst/refs/main && touch \\$dst/.prakasa-staged && "
+           "echo staged \\$need \\$rev";
+}
+
+std::string LastLine(const std::string& output) {
+    std::istringstream lines(output);
+    std::string line, last_line;
+    while (std::getline(lines, line)) {
+        line = TrimNewlines(line);
+        if (!line.empty()) {
+            last_line = line;
+        }
+    }
+    return last_line;
+}
+
+}  // namespace
+
+std::string FindHubModelId(const std::vector<std::string>& args) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& arg = args[i];
+        std::string value;
+        if ((arg == "-m" || arg == "--model" || arg == "--model-path") &&
+            i + 1 < args.size()) {
+            value = args[i + 1];
+        } else if (arg.compare(0, 8, "--model=") == 0) {
+            value = arg.substr(8);
+        } else if (arg.compare(0, 13, "--model-path=") == 0) {
+            value = arg.substr(13);
+        } else {
+            continue;
+        }
+        return IsHubModelId(value) ? value : "";
+    }
+    return "";
+}
+
+std::vector<std::string> SplitArguments(const std::string& args) {
+    std::vector<std::string> result;
+    std::istringstream stream(args);
+    std::string arg;
+    while (stream >> arg) {
+        result.push_back(arg);
+    }
+    return result;
+}
+
+std::string StageModelWeights(const std::string& ubuntu_version,
+                              const std::vector<std::string>& args,
+                              const std::string& prakasa_command,
+                              std::string& message) {
+    message.clear();
+    auto& config = parallax::config::ConfigManager::GetInstance();
+    std::string enabled =
+        config.GetConfigValue(parallax::config::KEY_WEIGHT_RESIDENCY);
+    std::transform(enabled.begin(), enabled.end(), enabled.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (enabled != "on" && enabled != "true" && enabled != "1") {
+        return prakasa_command;
+    }
+    std::string model_id = FindHubModelId(args);
+    // Ids end up in the script, so only plain ones are staged
+    if (model_id.empty() ||
+        model_id.find_first_not_of("abcdefghijklmnopqrstuvwxyz"
+                                   "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789"
+                                   "-_./") != std::string::npos) {
+        return prakasa_command;
+    }
+    int budget_gib = config.GetConfigIntValue(
+        parallax::config::KEY_WEIGHT_RESIDENCY_BUDGET_GIB, 0);
+
+    uint64_t started_ms = GetTickCountMs();
+    std::string stdout_output, stderr_output;
+    int exit_code = ExecCommandEx(
+        BuildWSLCommand(ubuntu_version,
+                        BuildStagingScript(model_id, budget_gib * 1024)),
+        kStagingTimeoutSeconds, stdout_output, stderr_output, false, true);
+    uint64_t elapsed_ms = GetTickCountMs() - started_ms;
+
+    std::istringstream lines(stdout_output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = TrimNewlines(line);
+        if (line.compare(0, 8, "evicted ") == 0) {
+            info_log("[WEIGHTS] Evicted %s from /dev/shm", line.c_str() + 8);
+        }
+    }
+
+    std::string outcome = LastLine(stdout_output);
+    std::string revision = outcome.substr(outcome.find_last_of(' ') + 1);
+    std::string snapshot = std::string(kWeightResidencyHubDir) + "/" +
+                           GetHubEntryName(model_id) + "/snapshots/" +
+                           revision;
+    std::string staged_command = prakasa_command;
+    if (exit_code == 0 &&
+        !ReplaceModelArgument(staged_command, model_id, snapshot)) {
+        exit_code = -1;
+        outcome = "model argument not found in the command";
+    }
+    if (exit_code != 0) {
+        message = "Weights of " + model_id + " not staged in /dev/shm: " +
+                  (exit_code == kStageNoSource || exit_code == kStageTooLarge ||
+                           exit_code == kStageNoRoom || exit_code == -1
+                       ? outcome
+                       : "staging failed (" + std::to_string(exit_code) +
+                             ")");
+        warn_log("[WEIGHTS] %s %s", message.c_str(), stderr_output.c_str());
+        return prakasa_command;
+    }
+
+    message = outcome.compare(0, 7, "staged ") == 0
+                  ? "Staged " + outcome.substr(7, outcome.find(' ', 7) - 7) +
+                        " MiB of " + model_id + " weights in /dev/shm in " +
+                        std::to_string(elapsed_ms / 1000) + " s"
+                  : "Weights of " + model_id + " already staged in /dev/shm";
+    info_log("[WEIGHTS] %s (revision %s)", message.c_str(), revision.c_str());
+    // Only the model is served from tmpfs; HF_HUB_CACHE stays on disk, so
+    // whatever else the server downloads lands there
+    return staged_command;
+}
+
+}  // namespace utils
+}  // namespace parallax
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Opt-in staging of a served model's Hugging Face cache entry into
+// /dev/shm, which outlives the server process (until the WSL VM stops), so
+// a restarted run/join maps its weights from RAM instead of reading them
+// from the vhdx again. Staged models share a memory budget and the least
+// recently launched one not mapped by a running process is evicted first.
+
+namespace parallax {
+namespace utils {
+
+// Where the staged models live, in the layout of the hub cache
+extern const char* const kWeightResidencyHubDir;
+
+// Hugging Face model id given with -m/--model/--model-path, "" when there
+// is none or it names a local directory
+std::string FindHubModelId(const std::vector<std::string>& args);
+
+// Split a command line the way the C API receives prakasa arguments
+std::vector<std::string> SplitArguments(const std::string& args);
+
+// With weight_residency on and the model fully downloaded, make sure its
+// current revision is staged (evicting older models to fit
+// weight_residency_budget_gib) and return prakasa_command with the model
+// argument replaced by the staged snapshot directory. Otherwise
+// prakasa_command is returned unchanged. message says what happened, ""
+// when staging is off or there is no hub model
+std::string StageModelWeights(const std::string& ubuntu_version,
+                              const std::vector<std::string>& args,
+                              const std::string& prakasa_command,
+                              std::string& message);
+
+}  // namespace utils
+}  // namespace parallax
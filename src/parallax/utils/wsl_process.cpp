@@ -1,13 +1,22 @@
 #include "wsl_process.h"
 #include "utils.h"
+#include "process.h"
 #include "tinylog/tinylog.h"
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 // Static member for console control handler
 WSLProcess* WSLProcess::s_instance = nullptr;
 
-WSLProcess::WSLProcess() : running_(false), shouldStop_(false), exitCode_(0) {
+WSLProcess::WSLProcess()
+    : running_(false),
+      shouldStop_(false),
+      drainTimeoutMs_(0),
+      gracefulStopping_(false),
+      escalateEvent_(INVALID_HANDLE_VALUE),
+      timeoutMs_(INFINITE),
+      exitCode_(0) {
     ZeroMemory(&processInfo_, sizeof(PROCESS_INFORMATION));
     ZeroMemory(&startupInfo_, sizeof(STARTUPINFOA));
     processHandle_ = INVALID_HANDLE_VALUE;
@@ -20,6 +29,7 @@ WSLProcess::WSLProcess() : running_(false), shouldStop_(false), exitCode_(0) {
 
     // Create exit event for graceful shutdown
     exitEvent_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    escalateEvent_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
 
     // Set this instance as the global instance for console control
     s_instance = this;
@@ -31,6 +41,10 @@ WSLProcess::~WSLProcess() {
         CloseHandle(exitEvent_);
         exitEvent_ = INVALID_HANDLE_VALUE;
     }
+    if (escalateEvent_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(escalateEvent_);
+        escalateEvent_ = INVALID_HANDLE_VALUE;
+    }
 
     // Clear global instance
     if (s_instance == this) {
@@ -59,18 +73,28 @@ int WSLProcess::Execute(const std::string& wsl_command) {
 
     running_ = true;
     shouldStop_ = false;
+    gracefulStopping_ = false;
     exitCode_ = 0;
+    if (escalateEvent_ != INVALID_HANDLE_VALUE) {
+        ResetEvent(escalateEvent_);
+    }
 
     // Start I/O thread
     ioThread_ = std::thread([this]() { IOReaderThread(); });
 
     // Wait for process to complete
     if (processHandle_ != INVALID_HANDLE_VALUE) {
-        WaitForSingleObject(processHandle_, INFINITE);
-
-        DWORD processExitCode = 0;
-        if (GetExitCodeProcess(processHandle_, &processExitCode)) {
-            exitCode_ = static_cast<int>(processExitCode);
+        if (WaitForSingleObject(processHandle_, timeoutMs_) == WAIT_TIMEOUT) {
+            error_log("WSL command timed out after %lu ms, terminating",
+                      timeoutMs_);
+            TerminateProcess(processHandle_, 1);
+            WaitForSingleObject(processHandle_, 5000);
+            exitCode_ = -2;
+        } else {
+            DWORD processExitCode = 0;
+            if (GetExitCodeProcess(processHandle_, &processExitCode)) {
+                exitCode_ = static_cast<int>(processExitCode);
+            }
         }
     }
 
@@ -86,8 +110,26 @@ int WSLProcess::Execute(const std::string& wsl_command) {
         ioThread_.join();
     }
 
+    // The graceful stop thread may still hold the process handle
+    {
+        std::lock_guard<std::mutex> lock(stopMutex_);
+        if (stopThread_.joinable()) {
+            stopThread_.join();
+        }
+    }
+
     CleanupProcess();
 
+    // The server execs over the shell that wrote the pid file, so nothing in
+    // the distro removes the file when it exits or is killed
+    if (!gracefulPidFile_.empty()) {
+        std::string out, err;
+        parallax::utils::ExecCommandEx(
+            parallax::utils::BuildWSLCommand(gracefulDistro_,
+                                             "rm -f " + gracefulPidFile_),
+            10, out, err);
+    }
+
     // Remove console control handler
     SetConsoleCtrlHandler(ConsoleCtrlHandler, FALSE);
 
@@ -126,6 +168,104 @@ void WSLProcess::Stop() {
 
 bool WSLProcess::IsRunning() const { return running_.load(); }
 
+std::string WSLProcess::GetOutputTail() const {
+    std::lock_guard<std::mutex> lock(outputMutex_);
+    return outputTail_;
+}
+
+void WSLProcess::SetTimeout(int timeout_seconds) {
+    timeoutMs_ = timeout_seconds > 0
+                     ? static_cast<DWORD>(timeout_seconds) * 1000
+                     : INFINITE;
+}
+
+void WSLProcess::EnableGracefulStop(const std::string& ubuntu_version,
+                                    const std::string& pid_file,
+                                    int drain_timeout_seconds) {
+    gracefulDistro_ = ubuntu_version;
+    gracefulPidFile_ = pid_file;
+    drainTimeoutMs_ =
+        static_cast<DWORD>((std::max)(drain_timeout_seconds, 0)) * 1000;
+}
+
+bool WSLProcess::RequestGracefulStop() {
+    if (gracefulPidFile_.empty() || !IsRunning()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stopMutex_);
+    if (gracefulStopping_) {
+        // Second Ctrl+C: stop waiting for the drain
+        std::cerr << "\n[Ctrl+C] Forcing shutdown...\n" << std::flush;
+        if (escalateEvent_ != INVALID_HANDLE_VALUE) {
+            SetEvent(escalateEvent_);
+        }
+        return true;
+    }
+
+    gracefulStopping_ = true;
+    std::cerr << "\n[Ctrl+C] Asking the server to shut down (up to "
+              << drainTimeoutMs_ / 1000
+              << "s), press Ctrl+C again to force...\n"
+              << std::flush;
+    stopThread_ = std::thread([this]() { GracefulStopThread(); });
+    return true;
+}
+
+void WSLProcess::GracefulStopThread() {
+    // SIGINT lets the server run its shutdown path: finish in-flight
+    // requests, leave the swarm and release CUDA contexts
+    if (SignalDistroProcess("INT") &&
+        WaitForExitOrEscalation(drainTimeoutMs_)) {
+        info_log("WSL process exited after SIGINT");
+        return;
+    }
+
+    warn_log("Server did not exit after SIGINT, sending SIGTERM");
+    if (SignalDistroProcess("TERM") && WaitForExitOrEscalation(3000)) {
+        info_log("WSL process exited after SIGTERM");
+        return;
+    }
+
+    warn_log("Server did not exit after SIGTERM, killing it");
+    SignalDistroProcess("KILL");
+    if (processHandle_ != INVALID_HANDLE_VALUE &&
+        WaitForSingleObject(processHandle_, 2000) != WAIT_OBJECT_0) {
+        TerminateProcess(processHandle_, 1);
+    }
+}
+
+bool WSLProcess::SignalDistroProcess(const std::string& signal_name) {
+    std::string cmd = parallax::utils::BuildWSLCommand(
+        gracefulDistro_,
+        parallax::utils::BuildWSLSignalCommand(gracefulPidFile_, signal_name));
+    std::string out, err;
+    int ret = parallax::utils::ExecCommandEx(cmd, 15, out, err);
+    if (ret != 0) {
+        warn_log("Failed to send SIG%s to server (code %d): %s",
+                 signal_name.c_str(), ret, err.c_str());
+        return false;
+    }
+    debug_log("Sent SIG%s to server", signal_name.c_str());
+    return true;
+}
+
+bool WSLProcess::WaitForExitOrEscalation(DWORD timeout_ms) {
+    if (processHandle_ == INVALID_HANDLE_VALUE) {
+        return true;
+    }
+    HANDLE handles[2] = {processHandle_, escalateEvent_};
+    DWORD count = (escalateEvent_ != INVALID_HANDLE_VALUE) ? 2 : 1;
+    DWORD waitResult =
+        WaitForMultipleObjects(count, handles, FALSE, timeout_ms);
+    if (waitResult == WAIT_OBJECT_0 + 1) {
+        // Escalation requested; skip the remainder of this stage
+        ResetEvent(escalateEvent_);
+        return false;
+    }
+    return waitResult == WAIT_OBJECT_0;
+}
+
 bool WSLProcess::CreateWSLProcess(const std::string& command) {
     SECURITY_ATTRIBUTES saAttr;
     saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
@@ -163,14 +303,15 @@ bool WSLProcess::CreateWSLProcess(const std::string& command) {
         GetStdHandle(STD_INPUT_HANDLE);  // Use current stdin
     startupInfo_.dwFlags |= STARTF_USESTDHANDLES;
 
-    // Prepare command line
-    char cmdLine[2048];
-    strcpy_s(cmdLine, sizeof(cmdLine), command.c_str());
+    // Prepare command line, a writable copy sized to the command since
+    // CreateProcess may modify it and launch commands outgrow a fixed buffer
+    std::vector<char> cmdLine(command.begin(), command.end());
+    cmdLine.push_back('\0');
 
     // Create process
     BOOL result = CreateProcessA(
         nullptr,           // No module name (use command line)
-        cmdLine,           // Command line
+        cmdLine.data(),    // Command line
         nullptr,           // Process handle not inheritable
         nullptr,           // Thread handle not inheritable
         TRUE,              // Set handle inheritance to TRUE
@@ -373,6 +514,14 @@ void WSLProcess::ProcessOutput(const std::vector<uint8_t>& buffer,
         convertedOutput = outputStr;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(outputMutex_);
+        outputTail_ += convertedOutput;
+        if (outputTail_.size() > OUTPUT_TAIL_SIZE) {
+            outputTail_.erase(0, outputTail_.size() - OUTPUT_TAIL_SIZE);
+        }
+    }
+
     // Output to appropriate stream
     if (is_stderr) {
         std::cerr << convertedOutput << std::flush;
@@ -385,6 +534,9 @@ BOOL WINAPI WSLProcess::ConsoleCtrlHandler(DWORD dwCtrlType) {
     switch (dwCtrlType) {
         case CTRL_C_EVENT:
         case CTRL_BREAK_EVENT:
+            if (s_instance && s_instance->RequestGracefulStop()) {
+                return TRUE;
+            }
             if (s_instance && s_instance->IsRunning()) {
                 std::cerr << "\n[Ctrl+C] Stopping WSL process...\n"
                           << std::flush;
@@ -395,6 +547,13 @@ BOOL WINAPI WSLProcess::ConsoleCtrlHandler(DWORD dwCtrlType) {
         case CTRL_CLOSE_EVENT:
         case CTRL_LOGOFF_EVENT:
         case CTRL_SHUTDOWN_EVENT:
+            // Windows only grants a few seconds here, so skip the drain but
+            // still give the server a chance to release the GPU
+            if (s_instance && !s_instance->gracefulPidFile_.empty() &&
+                s_instance->IsRunning()) {
+                s_instance->SignalDistroProcess("TERM");
+                s_instance->WaitForExitOrEscalation(2000);
+            }
             if (s_instance && s_instance->IsRunning()) {
                 s_instance->Stop();
                 return TRUE;
@@ -6,6 +6,7 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <mutex>
 
 #include <windows.h>
 
@@ -21,6 +22,21 @@ class WSLProcess {
     // Stop the running process (for Ctrl+C handling)
     void Stop();
 
+    // Enable graceful shutdown for a long-running server. On Ctrl+C the
+    // process recorded in pid_file (inside the distro) receives SIGINT, then
+    // SIGTERM once drain_timeout_seconds elapse, and only then is it killed
+    // together with wsl.exe. A second Ctrl+C skips the drain.
+    void EnableGracefulStop(const std::string& ubuntu_version,
+                            const std::string& pid_file,
+                            int drain_timeout_seconds);
+
+    // Kill the process once timeout_seconds elapse (0 waits forever).
+    // Execute then returns -2, like ExecCommandEx on timeout
+    void SetTimeout(int timeout_seconds);
+
+    // Last few KB of stdout/stderr, for classifying a failed command
+    std::string GetOutputTail() const;
+
     // Check if process is running
     bool IsRunning() const;
 
@@ -38,6 +54,12 @@ class WSLProcess {
     void ProcessOutput(const std::vector<uint8_t>& buffer, DWORD bytesRead,
                        const char* source);
 
+    // Graceful shutdown helpers
+    bool RequestGracefulStop();
+    void GracefulStopThread();
+    bool SignalDistroProcess(const std::string& signal_name);
+    bool WaitForExitOrEscalation(DWORD timeout_ms);
+
     // Console control handler for Ctrl+C
     static BOOL WINAPI ConsoleCtrlHandler(DWORD dwCtrlType);
     static WSLProcess* s_instance;
@@ -60,6 +82,22 @@ class WSLProcess {
     std::thread ioThread_;
     HANDLE exitEvent_;  // Event handle for graceful shutdown
 
+    // Graceful shutdown state
+    std::string gracefulDistro_;
+    std::string gracefulPidFile_;
+    DWORD drainTimeoutMs_;
+    std::atomic<bool> gracefulStopping_;
+    std::thread stopThread_;
+    std::mutex stopMutex_;
+    HANDLE escalateEvent_;  // Signaled by a second Ctrl+C during drain
+
+    DWORD timeoutMs_;  // INFINITE unless SetTimeout was called
+
+    // Tail of the combined output
+    mutable std::mutex outputMutex_;
+    std::string outputTail_;
+    static const size_t OUTPUT_TAIL_SIZE = 8192;
+
     // Buffer size
     static const int BUFFER_SIZE = 4096;
 